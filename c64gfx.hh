@@ -0,0 +1,35 @@
+#ifndef __C64GFX_HH_2026__
+#define __C64GFX_HH_2026__
+/*! \file c64gfx.hh
+ *  \brief Umbrella header of libc64gfx.
+ *
+ * libc64gfx holds the conversion cores of the converters with in-memory
+ * interfaces: images come in as ImageBuffer (see imageload.hh, which can
+ * also decode files held in memory), C64 data goes out as plain values or
+ * into a caller-supplied stream. Palettes and options are passed
+ * explicitly, there is no global state apart from the run statistics,
+ * so conversions can run concurrently.
+ *
+ * - hires.hh: hires bitmaps (graphconv)
+ * - charset.hh: character sets and character mode (chargenconv, charmodeconv)
+ * - petscii.hh: screen code images and sequences (petscii80x50)
+ * - sprites.hh: sprite sheets (spriteconv)
+ * - parse-petsciifile.hh, petsciiframes.hh: PETSCII animations (petsciiconvert)
+ * - convcache.hh: content-addressed cache of conversion results
+ * - runstats.hh: per-stage timings and counters (--stats)
+ *
+ * Link with -lc64gfx plus libpng and Magick++ (pkg-config libpng Magick++).
+ */
+#include "c64palette.hh"
+#include "charset.hh"
+#include "convcache.hh"
+#include "glyph.hh"
+#include "hires.hh"
+#include "imageload.hh"
+#include "parse-petsciifile.hh"
+#include "petscii.hh"
+#include "petsciiframes.hh"
+#include "runstats.hh"
+#include "sprites.hh"
+
+#endif
@@ -0,0 +1,745 @@
+/**
+ * \file c64gfxbench.cc
+ * \brief Microbenchmarks of the converters (make bench).
+ *
+ * All input is generated from a seeded random number generator, so every
+ * run on every machine measures the same work:
+ * - 320×200 images: a synthetic photo (smooth colour blobs with grain),
+ *   a colour gradient and uniform noise,
+ * - a PETSCII animation of many 80×50 plasma frames, converted with the
+ *   quad blocks and written in the petsciiconvert C format,
+ * - a character set of random glyphs for the glyph matcher,
+ * - an indexed and a truecolour sprite sheet.
+ *
+ * The PETSCII parser is also run on prefixes of the animation of
+ * increasing length and on a single frame with a data array of a few
+ * megabytes. Its throughput in MB/s must not drop by more than
+ * PARSE_SLOWDOWN_LIMIT from the shortest to the longest file, otherwise
+ * the parse time grows faster than linear and the program fails.
+ *
+ * The dithering engines of the hires conversion are also rated by their
+ * error: the mean RGB distance between the source and the result after
+ * both are blurred (5×5 box), which approximates the viewing distance.
+ * It is printed and written as "error" next to the rate.
+ *
+ * Each benchmark is repeated until it has run for --min-time seconds.
+ * The throughput (images/s, frames/s, …) is printed on stderr while
+ * running and written as JSON to stdout (or --output), so that results of
+ * two releases can be compared.
+ *
+ * The hires helpers (col_dist(), distance_table(), block_error(),
+ * optimise_pairs(), handle_block_wise(), handle_strip_wise(), the
+ * dithering engines and the integer pipeline) are internal to hires.cc;
+ * hires_internal.hh declares them, and they are linked from libc64gfx
+ * like the rest.
+ *
+ * Build dependencies: libc64gfx, libpng, Magick++, Boost.Format, CLI11
+ * Requires: C++23 (-std=c++23)
+ */
+
+#include "codegenerator.hh"
+#include "hires_internal.hh"
+#include "parse-petsciifile.hh"
+#include "petscii.hh"
+#include "sprites.hh"
+#include <CLI/CLI.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+using namespace hires_internal;
+
+/// Largest accepted drop of the parser throughput between the file sizes.
+inline constexpr double PARSE_SLOWDOWN_LIMIT = 3.0;
+
+// ── corpus ────────────────────────────────────────────────────────────────────
+
+/**
+ * \brief SplitMix64, a small generator with identical output everywhere.
+ */
+class Random {
+  std::uint64_t state;
+
+public:
+  explicit Random(std::uint64_t seed) : state(seed) {}
+
+  std::uint64_t next() {
+    std::uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+  }
+  /// Uniform value in [0, 1).
+  double uniform() { return static_cast<double>(next() >> 11) * 0x1.0p-53; }
+  /// Uniform value in [0, n).
+  unsigned below(unsigned n) { return static_cast<unsigned>(next() % n); }
+};
+
+/// An empty RGB image of \p width × \p height pixels.
+ImageBuffer rgb_image(unsigned width, unsigned height) {
+  ImageBuffer ret;
+  ret.width = width;
+  ret.height = height;
+  ret.format = PixelFormat::rgb;
+  ret.pixels.resize(ret.stride() * height);
+  return ret;
+}
+
+/// A 8-bit value from a value in [0, 1], clamped.
+std::uint8_t to_byte(double value) {
+  return static_cast<std::uint8_t>(std::clamp(value, 0.0, 1.0) * 255.0 + 0.5);
+}
+
+/**
+ * \brief Photo-like image: overlapping smooth colour blobs plus grain.
+ */
+ImageBuffer make_photo(unsigned width, unsigned height, Random &rng) {
+  struct Blob {
+    double x, y, radius;
+    std::array<double, 3> colour;
+  };
+  std::vector<Blob> blobs(12);
+  for(auto &blob : blobs) {
+    blob = { rng.uniform() * width, rng.uniform() * height, 20.0 + rng.uniform() * 120.0,
+             { rng.uniform(), rng.uniform(), rng.uniform() } };
+  }
+  ImageBuffer ret = rgb_image(width, height);
+  for(unsigned y = 0; y < height; ++y) {
+    for(unsigned x = 0; x < width; ++x) {
+      std::array<double, 3> sum{ 0.1, 0.1, 0.15 };
+      for(const auto &blob : blobs) {
+        const double dx = x - blob.x;
+        const double dy = y - blob.y;
+        const double w = std::exp(-(dx * dx + dy * dy) / (blob.radius * blob.radius));
+        for(unsigned c = 0; c < 3; ++c) {
+          sum[c] += w * blob.colour[c];
+        }
+      }
+      const double grain = (rng.uniform() - 0.5) * 0.06;
+      for(unsigned c = 0; c < 3; ++c) {
+        ret.row(y)[3 * x + c] = to_byte(sum[c] + grain);
+      }
+    }
+  }
+  return ret;
+}
+
+/// Diagonal colour gradient.
+ImageBuffer make_gradient(unsigned width, unsigned height) {
+  ImageBuffer ret = rgb_image(width, height);
+  for(unsigned y = 0; y < height; ++y) {
+    for(unsigned x = 0; x < width; ++x) {
+      const double u = static_cast<double>(x) / width;
+      const double v = static_cast<double>(y) / height;
+      ret.row(y)[3 * x] = to_byte(u);
+      ret.row(y)[3 * x + 1] = to_byte(v);
+      ret.row(y)[3 * x + 2] = to_byte(1.0 - (u + v) / 2);
+    }
+  }
+  return ret;
+}
+
+/// Uniform RGB noise.
+ImageBuffer make_noise(unsigned width, unsigned height, Random &rng) {
+  ImageBuffer ret = rgb_image(width, height);
+  for(auto &p : ret.pixels) {
+    p = static_cast<std::uint8_t>(rng.next());
+  }
+  return ret;
+}
+
+/// The canvas convert_hires() builds from an image.
+Canvas make_canvas(const ImageBuffer &img) {
+  Canvas ret{ img.width, img.height, std::vector<RGB>(img.width * img.height) };
+  for(std::size_t i = 0; i < ret.pixels.size(); ++i) {
+    for(unsigned c = 0; c < 3; ++c) {
+      ret.pixels[i][c] = img.pixels[3 * i + c] / 255.0;
+    }
+  }
+  return ret;
+}
+
+/// The canvas of the integer pipeline of convert_hires().
+Canvas8 make_canvas8(const ImageBuffer &img) {
+  Canvas8 ret{ img.width, img.height, std::vector<RGB8>(img.width * img.height) };
+  for(std::size_t i = 0; i < ret.pixels.size(); ++i) {
+    for(unsigned c = 0; c < 3; ++c) {
+      ret.pixels[i][c] = img.pixels[3 * i + c];
+    }
+  }
+  return ret;
+}
+
+/// \p img as a Canvas, for blurred_error().
+Canvas to_canvas(const Canvas8 &img) {
+  Canvas ret{ img.width, img.height, std::vector<RGB>(img.pixels.size()) };
+  for(std::size_t i = 0; i < ret.pixels.size(); ++i) {
+    for(unsigned c = 0; c < 3; ++c) {
+      ret.pixels[i][c] = img.pixels[i][c] / 255.0;
+    }
+  }
+  return ret;
+}
+
+/// The dithering engines of hires.cc by their --dither name.
+const std::array<std::pair<const char *, DitherEngine>, 6> DITHER_ENGINES{ {
+  { "stucki", dither_stucki },
+  { "floyd-steinberg", dither_floyd_steinberg },
+  { "atkinson", dither_atkinson },
+  { "bayer4", dither_bayer4 },
+  { "bayer8", dither_bayer8 },
+  { "blue-noise", dither_blue_noise },
+} };
+
+/// \p img blurred with a 5×5 box, clamped at the borders.
+Canvas box_blur(const Canvas &img) {
+  constexpr int R = 2;
+  Canvas ret{ img.width, img.height, std::vector<RGB>(img.pixels.size()) };
+  for(unsigned y = 0; y < img.height; ++y) {
+    for(unsigned x = 0; x < img.width; ++x) {
+      RGB sum{ 0.0, 0.0, 0.0 };
+      for(int dy = -R; dy <= R; ++dy) {
+        for(int dx = -R; dx <= R; ++dx) {
+          const auto nx = static_cast<unsigned>(std::clamp<int>(x + dx, 0, img.width - 1));
+          const auto ny = static_cast<unsigned>(std::clamp<int>(y + dy, 0, img.height - 1));
+          for(unsigned c = 0; c < 3; ++c) {
+            sum[c] += img.at(nx, ny)[c];
+          }
+        }
+      }
+      for(unsigned c = 0; c < 3; ++c) {
+        ret.at(x, y)[c] = sum[c] / ((2 * R + 1) * (2 * R + 1));
+      }
+    }
+  }
+  return ret;
+}
+
+/// Mean distance of two images after blurring, the quality of a dithering.
+double blurred_error(const Canvas &source, const Canvas &result) {
+  const Canvas a = box_blur(source);
+  const Canvas b = box_blur(result);
+  double sum = 0.0;
+  for(std::size_t i = 0; i < a.pixels.size(); ++i) {
+    sum += col_dist(a.pixels[i], b.pixels[i]);
+  }
+  return sum / a.pixels.size();
+}
+
+/// Grey plasma frame \p f of an animation, MAX_W × MAX_H pixels.
+std::vector<std::uint8_t> plasma_frame(unsigned f) {
+  std::vector<std::uint8_t> ret(MAX_W * MAX_H);
+  for(unsigned y = 0; y < MAX_H; ++y) {
+    for(unsigned x = 0; x < MAX_W; ++x) {
+      const double v = std::sin(x * 0.21 + f * 0.11) * std::cos(y * 0.17 - f * 0.07) + std::sin((x + y) * 0.05 + f * 0.03);
+      ret[y * MAX_W + x] = to_byte(0.5 + v / 4);
+    }
+  }
+  return ret;
+}
+
+/// 256 random glyphs, each with 16 to 48 set pixels.
+std::array<GlyphWord, 256> random_charset(Random &rng) {
+  std::array<GlyphWord, 256> ret{};
+  for(auto &glyph : ret) {
+    const unsigned bits = 16 + rng.below(33);
+    for(unsigned b = 0; b < bits; ++b) {
+      glyph |= GlyphWord{ 1 } << rng.below(64);
+    }
+  }
+  return ret;
+}
+
+/**
+ * \brief A single frame in the petsciiconvert C format with \p cells cells.
+ *
+ * The array is much longer than a screen; the parser accepts it and it
+ * shows the cost of long data arrays.
+ */
+std::string long_array_text(unsigned cells, Random &rng) {
+  std::string ret = "unsigned char long_array[]={// border,bg,chars,colors\n14,6,\n";
+  for(unsigned i = 0; i < 2 * cells; ++i) {
+    ret += std::to_string(rng.below(256));
+    ret += i + 1 < 2 * cells ? (i % WIDTH == WIDTH - 1 ? ",\n" : ",") : "\n";
+  }
+  ret += "};\n// META: 40 25 C64 upper\n";
+  return ret;
+}
+
+/**
+ * \brief Sprite sheet of \p columns × \p rows sprites with random blobs.
+ *
+ * The indexed sheet uses colours 0 (transparent) to 3, the truecolour
+ * sheet maps them to the grafx2 palette colours 0, 2, 7 and 14.
+ */
+std::pair<ImageBuffer, ImageBuffer> make_sprite_sheets(unsigned columns, unsigned rows, Random &rng) {
+  ImageBuffer indexed;
+  indexed.width = columns * 24;
+  indexed.height = rows * 21;
+  indexed.format = PixelFormat::indexed;
+  indexed.pixels.assign(indexed.width * indexed.height, 0);
+  for(unsigned s = 0; s < columns * rows; ++s) {
+    const unsigned ox = (s % columns) * 24;
+    const unsigned oy = (s / columns) * 21;
+    for(unsigned blob = 0; blob < 4; ++blob) {
+      const double cx = rng.uniform() * 24, cy = rng.uniform() * 21, r = 2.0 + rng.uniform() * 6.0;
+      const std::uint8_t colour = static_cast<std::uint8_t>(1 + rng.below(3));
+      for(unsigned y = 0; y < 21; ++y) {
+        for(unsigned x = 0; x < 24; ++x) {
+          if((x - cx) * (x - cx) + (y - cy) * (y - cy) < r * r) {
+            indexed.row(oy + y)[ox + x] = colour;
+          }
+        }
+      }
+    }
+  }
+  constexpr std::array<int, 4> colours{ 0, 2, 7, 14 };
+  for(int c : colours) {
+    const auto &pal = palette_grafx2[c];
+    indexed.palette.push_back({ to_byte(pal[0]), to_byte(pal[1]), to_byte(pal[2]), 255 });
+  }
+  ImageBuffer rgb = rgb_image(indexed.width, indexed.height);
+  for(std::size_t i = 0; i < indexed.pixels.size(); ++i) {
+    for(unsigned c = 0; c < 3; ++c) {
+      rgb.pixels[3 * i + c] = indexed.palette[indexed.pixels[i]][c];
+    }
+  }
+  return { std::move(indexed), std::move(rgb) };
+}
+
+// ── runner ────────────────────────────────────────────────────────────────────
+
+/// Throughput of one benchmark.
+struct BenchResult {
+  std::string name;   ///< Benchmark name, "group/function/input"
+  std::string unit;   ///< Unit of the rate, e.g. "images/s"
+  double items = 0;   ///< Items processed in all iterations
+  double seconds = 0; ///< Time of all iterations
+  unsigned long iterations = 0;
+  std::optional<double> error{}; ///< Quality of the result, lower is better (dithering)
+};
+
+/**
+ * \brief Runs benchmarks and collects their results.
+ */
+class BenchRunner {
+  double min_time;
+  std::string filter;
+  std::vector<BenchResult> results;
+  volatile std::uint64_t sink = 0; ///< Results of all calls, keeps the work from being optimised away
+
+public:
+  BenchRunner(double min_time_, std::string filter_) : min_time(min_time_), filter(std::move(filter_)) {}
+
+  /**
+   * \brief Time \p fun, which processes \p items items per call.
+   *
+   * \p fun returns a value derived from its result. One untimed call
+   * warms up the caches.
+   *
+   * \return the result, nullptr if the benchmark is filtered out
+   */
+  template <typename F>
+  BenchResult *run(const std::string &name, const std::string &unit, double items, F &&fun) {
+    if(!filter.empty() && name.find(filter) == std::string::npos) {
+      return nullptr;
+    }
+    sink = sink + static_cast<std::uint64_t>(fun());
+    BenchResult result{ name, unit };
+    const auto start = std::chrono::steady_clock::now();
+    do {
+      sink = sink + static_cast<std::uint64_t>(fun());
+      ++result.iterations;
+      result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while(result.seconds < min_time);
+    result.items = items * result.iterations;
+    std::cerr << std::format("{:42} {:14.1f} {}\n", name, result.items / result.seconds, unit);
+    results.push_back(std::move(result));
+    return &results.back();
+  }
+
+  [[nodiscard]] const std::vector<BenchResult> &get_results() const { return results; }
+};
+
+/// Discards everything written to it, for the diagnostics of CodeGenerator.
+class NullBuffer : public std::streambuf {
+protected:
+  int overflow(int c) override { return c; }
+  std::streamsize xsputn(const char *, std::streamsize n) override { return n; }
+};
+
+// ── entry point ───────────────────────────────────────────────────────────────
+
+/**
+ * \brief Program entry point.
+ *
+ * Generates the corpus, runs all benchmarks (or those matching --filter)
+ * and writes the results as JSON.
+ */
+int main(int argc, char **argv) {
+  CLI::App app{ std::format("c64gfxbench V{} – benchmarks of the C64 graphics converters", SUITE_VERSION) };
+
+  std::uint64_t seed = 2016;
+  unsigned frames = 2000;
+  double min_time = 0.5;
+  std::string filter;
+  std::optional<std::string> output_file;
+  bool quick = false;
+
+  app.add_option("--seed", seed, "Seed of the generated corpus (default 2016)");
+  app.add_option("--frames", frames, "Frames of the generated PETSCII animation (default 2000)")
+  ->check(CLI::Range(2u, 100000u));
+  app.add_option("--min-time", min_time, "Minimum time per benchmark in seconds (default 0.5)")
+  ->check(CLI::Range(0.0, 60.0));
+  app.add_option("--filter", filter, "Only run benchmarks whose name contains this text");
+  app.add_option("--output,-o", output_file, "Write the JSON results to this file instead of stdout");
+  app.add_flag("--quick", quick, "Smoke test: 200 frames and 0.05 s per benchmark");
+
+  CLI11_PARSE(app, argc, argv);
+  if(quick) {
+    frames = std::min(frames, 200u);
+    min_time = std::min(min_time, 0.05);
+  }
+
+  // ── corpus ────────────────────────────────────────────────────────────────
+  Random rng(seed);
+  const std::vector<std::pair<std::string, ImageBuffer> > images{
+    { "photo", make_photo(HIRES_W, HIRES_H, rng) },
+    { "gradient", make_gradient(HIRES_W, HIRES_H) },
+    { "noise", make_noise(HIRES_W, HIRES_H, rng) },
+  };
+  const GlyphMatcher matcher(random_charset(rng));
+  const auto [sheet, truecolour_sheet] = make_sprite_sheets(8, 8, rng);
+  const unsigned sheet_sprites = 64;
+
+  std::vector<std::vector<std::uint8_t> > plasma;
+  std::vector<Frame> animation;
+  for(unsigned f = 0; f < frames; ++f) {
+    plasma.push_back(plasma_frame(f));
+    const PetsciiScreen screen = scan_image_quads(plasma.back(), MAX_W, MAX_H, 128);
+    animation.push_back(to_frame(screen, std::format("frame{:05}", f), 14, 6, 1 + (f / 50) % 15));
+  }
+  std::ostringstream animation_c;
+  write_frames_c(animation, animation_c);
+  const std::string animation_text = animation_c.str();
+  const FrameArray parsed = [&] {
+    std::istringstream in(animation_text);
+    return parse_file(in);
+  }();
+
+  BenchRunner bench(min_time, filter);
+  const C64Palette &palette = palette_grafx2;
+
+  // ── hires ─────────────────────────────────────────────────────────────────
+  {
+    const Canvas canvas = make_canvas(images[0].second);
+    bench.run("hires/col_dist", "calls/s", canvas.pixels.size(), [&] {
+      double sum = 0;
+      for(const RGB &p : canvas.pixels) {
+        sum += col_dist(p, palette[7]);
+      }
+      return sum;
+    });
+    bench.run("hires/nearest_color", "pixels/s", canvas.pixels.size(), [&] {
+      unsigned long sum = 0;
+      for(const RGB &p : canvas.pixels) {
+        int best = 0;
+        for(int c = 1; c < NCOLORS; ++c) {
+          if(col_dist(p, palette[c]) < col_dist(p, palette[best])) {
+            best = c;
+          }
+        }
+        sum += best;
+      }
+      return sum;
+    });
+    bench.run("hires/distance_table", "images/s", 1, [&] {
+      return distance_table(canvas, palette, 1).planes[0][0];
+    });
+    const DistanceTable table = distance_table(canvas, palette, 1);
+    bench.run("hires/block_error", "calls/s", NPAIRS, [&] {
+      double sum = 0;
+      for(int i = 0; i < NCOLORS; ++i) {
+        for(int j = i + 1; j < NCOLORS; ++j) {
+          sum += block_error(table, 64, 64, BLK, i, j);
+        }
+      }
+      return sum;
+    });
+
+    const Canvas8 canvas8 = make_canvas8(images[0].second);
+    bench.run("hires/integer/distance_table", "images/s", 1, [&] {
+      return distance_table(canvas8, palette8(palette), 1).planes[0][0];
+    });
+    const DistanceTable16 table16 = distance_table(canvas8, palette8(palette), 1);
+    bench.run("hires/integer/block_error", "calls/s", NPAIRS, [&] {
+      double sum = 0;
+      for(int i = 0; i < NCOLORS; ++i) {
+        for(int j = i + 1; j < NCOLORS; ++j) {
+          sum += block_error(table16, 64, 64, BLK, i, j);
+        }
+      }
+      return sum;
+    });
+  }
+  for(const auto &[name, img] : images) {
+    const Canvas canvas = make_canvas(img);
+    bench.run("hires/handle_block_wise/" + name, "images/s", 1, [&] {
+      Canvas work = canvas;
+      return handle_block_wise(work, palette, nullptr).front().idx1;
+    });
+  }
+  // The engines alone, on the colour pairs of the image.
+  for(const auto &[dither, engine] : DITHER_ENGINES) {
+    for(const auto &[name, img] : images) {
+      const Canvas canvas = make_canvas(img);
+      const auto pairs = strip_pairs(distance_table(canvas, palette, 1), BLK, 1);
+      const StripColours colours{ pairs, BLK, HIRES_W / BLK };
+      std::vector<std::uint8_t> bits(canvas.pixels.size());
+      Canvas work;
+      BenchResult *result = bench.run(std::format("hires/dither/{}/{}", dither, name), "images/s", 1, [&] {
+        work = canvas;
+        engine(work, palette, colours, bits, 1);
+        return bits[0];
+      });
+      if(result) {
+        result->error = blurred_error(canvas, work);
+        std::cerr << std::format("{:42} {:14.4f} error\n", "", *result->error);
+      }
+    }
+  }
+  // The same in the integer pipeline.
+  for(const auto &[dither, engine] : DITHER_ENGINES) {
+    const Dither mode = dither_registry.at(dither);
+    for(const auto &[name, img] : images) {
+      const Canvas canvas = make_canvas(img);
+      const Canvas8 canvas8 = make_canvas8(img);
+      const Palette8 palette_8 = palette8(palette);
+      const auto pairs = strip_pairs(distance_table(canvas8, palette_8, 1), BLK, 1);
+      const StripColours colours{ pairs, BLK, HIRES_W / BLK };
+      std::vector<std::uint8_t> bits(canvas8.pixels.size());
+      Canvas8 work;
+      BenchResult *result = bench.run(std::format("hires/integer/dither/{}/{}", dither, name), "images/s", 1, [&] {
+        work = canvas8;
+        if(const DiffusionKernel *kernel = diffusion_kernel(mode)) {
+          diffuse8(work, palette_8, colours, bits, *kernel);
+        } else {
+          ordered8(work, palette_8, colours, bits, 1, *threshold_map(mode));
+        }
+        return bits[0];
+      });
+      if(result) {
+        result->error = blurred_error(canvas, to_canvas(work));
+        std::cerr << std::format("{:42} {:14.4f} error\n", "", *result->error);
+      }
+    }
+  }
+  for(const auto &[name, img] : images) {
+    const Canvas8 canvas8 = make_canvas8(img);
+    bench.run("hires/integer/handle_integer/" + name, "images/s", 1, [&] {
+      Canvas8 work = canvas8;
+      return handle_integer(work, palette8(palette), Dither::none, PairSearch{}).front().idx1;
+    });
+  }
+  for(const auto &[name, img] : images) {
+    const Canvas canvas = make_canvas(img);
+    bench.run("hires/handle_strip_wise/" + name, "images/s", 1, [&] {
+      Canvas work = canvas;
+      return handle_strip_wise(work, palette, PairSearch{ 1, 1 }).front().idx1;
+    });
+  }
+  for(const auto &[name, img] : images) {
+    const Canvas canvas = make_canvas(img);
+    Canvas work;
+    BenchResult *result = bench.run("hires/refine/" + name, "images/s", 1, [&] {
+      work = canvas;
+      return handle_refined(work, palette, STUCKI, PairSearch{ 1, 1 }, 3).front().idx1;
+    });
+    if(result) {
+      result->error = blurred_error(canvas, work);
+      std::cerr << std::format("{:42} {:14.4f} error\n", "", *result->error);
+    }
+  }
+  for(const auto &[name, img] : images) {
+    const DistanceTable table = distance_table(make_canvas(img), palette, 1);
+    const auto greedy = strip_pairs(table, BLK, 1);
+    bench.run("hires/optimise_pairs/" + name, "images/s", 1, [&] {
+      auto pairs = greedy;
+      return optimise_pairs(table, pairs, 0.05, 8, 1);
+    });
+  }
+
+  // ── petscii80x50 ──────────────────────────────────────────────────────────
+  const unsigned scan_frames = std::min<unsigned>(frames, 100);
+  bench.run("petscii/scan_image_quads", "frames/s", scan_frames, [&] {
+    unsigned sum = 0;
+    for(unsigned f = 0; f < scan_frames; ++f) {
+      sum += scan_image_quads(plasma[f], MAX_W, MAX_H, 128).chars[f];
+    }
+    return sum;
+  });
+  {
+    std::vector<std::uint8_t> grey(GLYPH_W * GLYPH_H);
+    const std::vector<std::uint8_t> rgb = to_rgb(crop_image(images[0].second, 0, 0, GLYPH_W, GLYPH_H)).pixels;
+    for(std::size_t i = 0; i < grey.size(); ++i) {
+      grey[i] = static_cast<std::uint8_t>((rgb[3 * i] * 77 + rgb[3 * i + 1] * 150 + rgb[3 * i + 2] * 29) >> 8);
+    }
+    bench.run("petscii/scan_image_glyphs", "frames/s", 1, [&] {
+      return scan_image_glyphs(grey, GLYPH_W, GLYPH_H, 128, matcher, false).chars[0];
+    });
+    bench.run("petscii/scan_image_glyphs/perceptual", "frames/s", 1, [&] {
+      return scan_image_glyphs(grey, GLYPH_W, GLYPH_H, 128, matcher, true).chars[0];
+    });
+    bench.run("petscii/scan_image_glyphs_colour", "frames/s", 1, [&] {
+      return scan_image_glyphs_colour(rgb, GLYPH_W, GLYPH_H, palette, std::nullopt, matcher, false).chars[0];
+    });
+  }
+
+  // ── petsciiconvert ────────────────────────────────────────────────────────
+  bench.run("petsciiconvert/parse_file", "frames/s", frames, [&] {
+    std::istringstream in(animation_text);
+    return parse_file(in).size();
+  });
+  // Throughput for growing prefixes of the animation; a parser which is
+  // linear in the input size keeps its MB/s.
+  struct ScalingPoint {
+    unsigned frames;
+    std::size_t bytes;
+    double rate; ///< MB/s
+  };
+  std::vector<ScalingPoint> scaling;
+  for(unsigned n = std::min(32u, frames);; n = std::min(4 * n, frames)) {
+    std::ostringstream prefix_c;
+    write_frames_c(std::vector<Frame>(animation.begin(), animation.begin() + n), prefix_c);
+    const std::string prefix = prefix_c.str();
+    const BenchResult *result = bench.run(std::format("petsciiconvert/parse_file/{}", n), "MB/s", prefix.size() / 1e6, [&] {
+      std::istringstream in(prefix);
+      return parse_file(in).size();
+    });
+    if(result) {
+      scaling.push_back({ n, prefix.size(), result->items / result->seconds });
+    }
+    if(n == frames) {
+      break;
+    }
+  }
+  {
+    const std::string long_array = long_array_text(quick ? 100000 : 500000, rng);
+    bench.run("petsciiconvert/parse_file/long_array", "MB/s", long_array.size() / 1e6, [&] {
+      std::istringstream in(long_array);
+      return parse_file(in)[0].chars.size();
+    });
+    std::ostringstream binary_out;
+    for(const Frame &frame : animation) {
+      frame.save(binary_out);
+    }
+    const std::string binary = binary_out.str();
+    bench.run("petsciiconvert/read_binary_frames", "MB/s", binary.size() / 1e6, [&] {
+      std::istringstream in(binary);
+      return read_binary_frames(in).size();
+    });
+  }
+  bench.run("petsciiconvert/compare_frames", "frames/s", frames - 1, [&] {
+    std::size_t sum = 0;
+    for(unsigned f = 0; f + 1 < frames; ++f) {
+      for(const auto &row : compare_frames(parsed[f], parsed[f + 1])) {
+        sum += row ? row->second - row->first : 0;
+      }
+    }
+    return sum;
+  });
+  bench.run("petsciiconvert/CodeGenerator::generate", "frames/s", frames - 1, [&] {
+    // CodeGenerator lists the labels on stderr.
+    NullBuffer null;
+    std::streambuf *saved = std::cerr.rdbuf(&null);
+    CodeGenerator generator("bench", parsed[0], false);
+    for(unsigned f = 0; f + 1 < frames; ++f) {
+      generator.generate(parsed[f], parsed[f + 1]);
+    }
+    std::ostringstream out;
+    generator.write(out);
+    std::cerr.rdbuf(saved);
+    return out.tellp();
+  });
+
+  // ── spriteconv ────────────────────────────────────────────────────────────
+  {
+    SheetOptions opts;
+    opts.spritecolumns = 8;
+    opts.spriterows = 8;
+    bench.run("sprites/extract_sprite_data/mono", "sprites/s", sheet_sprites, [&] {
+      return extract_sprite_data(sheet, opts).size();
+    });
+    opts.multi_mode = true;
+    opts.multi1 = 2;
+    opts.multi2 = 3;
+    bench.run("sprites/extract_sprite_data/multi", "sprites/s", sheet_sprites, [&] {
+      return extract_sprite_data(sheet, opts).size();
+    });
+    opts.multi1 = opts.multi2 = -1;
+    ImageBuffer c64sheet = sheet;
+    for(auto &p : c64sheet.pixels) {
+      p = static_cast<std::uint8_t>(std::array{ 0, 2, 7, 14 }[p]);
+    }
+    bench.run("sprites/optimise_indexed_colours", "sprites/s", sheet_sprites, [&] {
+      auto sprites = extract_sprite_data(c64sheet, opts);
+      return optimise_indexed_colours(sprites, c64sheet, palette, ColourMetric::error).multi1;
+    });
+    bench.run("sprites/quantise_and_optimise", "sprites/s", sheet_sprites, [&] {
+      TrueColourSheet colours;
+      SheetOptions qopts = opts;
+      qopts.transparent = QUANTISED_TRANSPARENT;
+      const ImageBuffer quantised = quantise_image(truecolour_sheet, palette, 0, colours);
+      auto sprites = extract_sprite_data(quantised, qopts);
+      return optimise_sprite_colours(sprites, colours, true).multi1;
+    });
+    bench.run("sprites/find_objects", "sheets/s", 1, [&] {
+      std::vector<PixelRun> runs;
+      return find_objects(sheet, 0, runs).size();
+    });
+  }
+
+  // ── report ────────────────────────────────────────────────────────────────
+  std::string json = std::format("{{\n  \"suite_version\": \"{}\",\n  \"corpus\": {{ \"seed\": {}, \"image\": \"{}x{}\", "
+                                 "\"frames\": {}, \"sprites\": {} }},\n  \"min_time\": {},\n  \"benchmarks\": [\n",
+                                 SUITE_VERSION, seed, HIRES_W, HIRES_H, frames, sheet_sprites, min_time);
+  const auto &results = bench.get_results();
+  for(std::size_t i = 0; i < results.size(); ++i) {
+    const BenchResult &r = results[i];
+    json += std::format("    {{ \"name\": \"{}\", \"unit\": \"{}\", \"rate\": {:.6g}, \"iterations\": {}, "
+                        "\"seconds\": {:.6f}{} }}{}\n",
+                        r.name, r.unit, r.items / r.seconds, r.iterations, r.seconds,
+                        r.error ? std::format(", \"error\": {:.6g}", *r.error) : "", i + 1 < results.size() ? "," : "");
+  }
+  json += "  ]";
+  bool linear = true;
+  if(scaling.size() >= 2) {
+    const double slowdown = scaling.front().rate / scaling.back().rate;
+    linear = slowdown <= PARSE_SLOWDOWN_LIMIT;
+    std::cerr << std::format("parse_file is {:.2f} times slower per byte at {} frames than at {} frames{}\n",
+                             slowdown, scaling.back().frames, scaling.front().frames,
+                             linear ? "" : ", parse time grows faster than linear");
+    json += ",\n  \"parse_scaling\": {\n    \"points\": [\n";
+    for(std::size_t i = 0; i < scaling.size(); ++i) {
+      json += std::format("      {{ \"frames\": {}, \"bytes\": {}, \"rate\": {:.6g} }}{}\n", scaling[i].frames,
+                          scaling[i].bytes, scaling[i].rate, i + 1 < scaling.size() ? "," : "");
+    }
+    json += std::format("    ],\n    \"slowdown\": {:.4f},\n    \"limit\": {},\n    \"linear\": {}\n  }}",
+                        slowdown, PARSE_SLOWDOWN_LIMIT, linear);
+  }
+  json += "\n}\n";
+  if(output_file) {
+    std::ofstream(*output_file) << json;
+  } else {
+    std::cout << json;
+  }
+  return linear ? 0 : 1;
+}
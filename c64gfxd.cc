@@ -0,0 +1,783 @@
+/**
+ * \file c64gfxd.cc
+ * \brief Conversion server: the converters of libc64gfx behind a Unix socket.
+ *
+ * Tools which convert many images (build systems, live previews) pay
+ * the process start-up, the ImageMagick initialisation and the charset
+ * tables of every converter call again. c64gfxd starts once, keeps all
+ * of this in memory and converts the images sent to it over a Unix
+ * domain socket. Requests are served by a fixed pool of worker threads;
+ * a connection may send any number of requests. The main thread waits
+ * for requests on all idle connections and queues each request for a
+ * worker, so open but idle clients do not block anybody. A client which
+ * pauses for more than 30 seconds in the middle of a request is dropped.
+ *
+ * ### Protocol
+ *
+ * All integers are little-endian. A request is
+ *
+ * ```
+ * u8  command
+ * u16 length of the options
+ * u32 length of the data
+ * options: ASCII "key=value" pairs separated by spaces
+ * data: the complete image file (PNG, PNM or any ImageMagick format)
+ * ```
+ *
+ * and is answered by
+ *
+ * ```
+ * u8  status (0 = ok, 1 = error)
+ * u32 length of the payload
+ * payload: converted data, or the error message
+ * ```
+ *
+ * Commands, their options (defaults in brackets) and results:
+ *
+ * - 1 hires: \c palette [grafx2], \c dither [none] (see graphconv
+ *   --dither), \c stucki [0] (same as \c dither=stucki), \c fli [0] (1 or 2
+ *   lines per colour pair), \c optimise [0] (pair tolerance, see
+ *   graphconv --optimise-pairs), \c refine [0] (see graphconv --refine),
+ *   \c integer [0] (see graphconv --integer), \c address [0x2000,
+ *   0x4000 with \c fli]; the .c64 file of graphconv, or its .afl file with \c fli.
+ * - 2 petscii: \c threshold [0.5], \c charset [none] (\c upper or
+ *   \c lower, needs --charset, \c lower a 4 KiB ROM), \c perceptual [0],
+ *   \c colour [0], \c palette [grafx2], \c background [most frequent
+ *   colour]; columns, rows and background colour (one byte each)
+ *   followed by the screen codes and, with \c colour, the colour RAM.
+ *   Images which are too large for the mode are scaled like petscii80x50
+ *   does.
+ * - 3 sprites: \c multi [0], \c x [0], \c y [0], \c transparent [0],
+ *   \c columns [1], \c rows [1], \c width [24], \c height [21],
+ *   \c multi1 [1], \c multi2 [2], \c autocol [0], \c auto [0],
+ *   \c quantise [0], \c optimise [0], \c palette [grafx2]; the
+ *   multicolour registers (two bytes, 0xFF if unused) followed by the
+ *   64-byte sprites. Truecolour images are quantised and the colours
+ *   are chosen like in spriteconv.
+ * - 4 chargen: \c x [0], \c y [0], \c columns [16], \c count [256],
+ *   \c tile_width [1], \c tile_height [1], \c threshold [0.763],
+ *   \c dedup [0]; the .c64 file of chargenconv, with \c dedup preceded
+ *   by the number of glyphs (u16) and followed by the .map file.
+ * - 5 stats: no options or data; the latency counters as text.
+ *
+ * The counters (requests, errors, average and maximum latency per
+ * command) are also printed when the server stops (SIGINT, SIGTERM).
+ *
+ * Build dependencies: libc64gfx, libpng, Magick++, CLI11
+ * Requires: C++23 (-std=c++23)
+ */
+
+#include "c64gfx.hh"
+#include <CLI/CLI.hpp>
+#include <Magick++.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// ── constants ─────────────────────────────────────────────────────────────────
+
+/// Largest image file accepted in a request.
+inline constexpr std::uint32_t MAX_DATA = 64u << 20;
+
+/// Seconds a client may pause in the middle of a request or answer.
+inline constexpr time_t CLIENT_TIMEOUT = 30;
+
+/// Request commands.
+enum class Command : std::uint8_t {
+  hires   = 1,
+  petscii = 2,
+  sprites = 3,
+  chargen = 4,
+  stats   = 5,
+};
+
+/// Names of the commands, indexed by command number.
+inline constexpr std::array<const char *, 6> COMMAND_NAMES{ "?", "hires", "petscii", "sprites", "chargen", "stats" };
+
+// ── latency counters ──────────────────────────────────────────────────────────
+
+/**
+ * \brief Request counters of one command.
+ *
+ * Updated by all workers without a lock.
+ */
+struct Counter {
+  std::atomic<std::uint64_t> requests{0}; ///< Requests served
+  std::atomic<std::uint64_t> errors{0};   ///< Requests answered with an error
+  std::atomic<std::uint64_t> total_us{0}; ///< Summed latency in microseconds
+  std::atomic<std::uint64_t> max_us{0};   ///< Largest latency in microseconds
+
+  void record(std::uint64_t us, bool failed) {
+    ++requests;
+    if(failed) {
+      ++errors;
+    }
+    total_us += us;
+    std::uint64_t prev = max_us;
+    while(prev < us && !max_us.compare_exchange_weak(prev, us)) {
+    }
+  }
+};
+
+/// One counter per command.
+std::array<Counter, COMMAND_NAMES.size()> counters;
+
+/// The counters as text, one line per command which was used ("?" = unknown commands).
+std::string format_counters() {
+  std::string ret;
+  for(std::size_t c = 0; c < counters.size(); ++c) {
+    const Counter &cnt = counters[c];
+    if(const std::uint64_t n = cnt.requests; n > 0) {
+      ret += std::format("{:8} {:8} requests {:6} errors  avg {:9.3f} ms  max {:9.3f} ms\n", COMMAND_NAMES[c], n,
+                         cnt.errors.load(), cnt.total_us / 1000.0 / n, cnt.max_us / 1000.0);
+    }
+  }
+  return ret;
+}
+
+// ── request options ───────────────────────────────────────────────────────────
+
+/**
+ * \brief The "key=value" options of a request.
+ */
+class RequestOptions {
+  std::map<std::string, std::string> values;
+
+public:
+  explicit RequestOptions(const std::string &text) {
+    std::istringstream in(text);
+    std::string pair;
+    while(in >> pair) {
+      const auto eq = pair.find('=');
+      if(eq == std::string::npos || eq == 0) {
+        throw std::invalid_argument(std::format("option '{}' is not key=value", pair));
+      }
+      values[pair.substr(0, eq)] = pair.substr(eq + 1);
+    }
+  }
+
+  /// String value of \p key, or \p def.
+  [[nodiscard]] std::string str(const std::string &key, const std::string &def) const {
+    const auto it = values.find(key);
+    return it == values.end() ? def : it->second;
+  }
+
+  /// Value of \p key converted to \p T (integers also in hex with 0x), or \p def.
+  template <typename T>
+  [[nodiscard]] T get(const std::string &key, T def) const {
+    const auto it = values.find(key);
+    if(it == values.end()) {
+      return def;
+    }
+    const std::string &text = it->second;
+    T value{};
+    std::from_chars_result res{};
+    if constexpr(std::is_integral_v<T>) {
+      const bool hex = text.starts_with("0x");
+      res = std::from_chars(text.data() + (hex ? 2 : 0), text.data() + text.size(), value, hex ? 16 : 10);
+    } else {
+      res = std::from_chars(text.data(), text.data() + text.size(), value);
+    }
+    if(res.ec != std::errc() || res.ptr != text.data() + text.size()) {
+      throw std::invalid_argument(std::format("invalid value '{}' for option '{}'", text, key));
+    }
+    return value;
+  }
+
+  /// Palette named by option \c palette.
+  [[nodiscard]] const C64Palette &palette() const {
+    const std::string name = str("palette", "grafx2");
+    const auto it = palette_registry.find(name);
+    if(it == palette_registry.end()) {
+      throw std::invalid_argument(std::format("unknown palette '{}', available: {}", name, palette_names()));
+    }
+    return *it->second;
+  }
+};
+
+// ── conversions ───────────────────────────────────────────────────────────────
+
+/**
+ * \brief State shared by all workers, set up once at start-up.
+ */
+struct Server {
+  std::optional<GlyphMatcher> upper; ///< Upper case set of the --charset ROM
+  std::optional<GlyphMatcher> lower; ///< Lower case set of the --charset ROM
+};
+
+/// Append \p value as little-endian u16.
+void put_u16(std::string &out, unsigned value) {
+  out.push_back(static_cast<char>(value & 0xFF));
+  out.push_back(static_cast<char>((value >> 8) & 0xFF));
+}
+
+/**
+ * \brief Scale an image to fit within \p width × \p height pixels.
+ *
+ * Uses ImageMagick like petscii80x50, so the results are the same.
+ */
+ImageBuffer fit_image(const ImageBuffer &img, unsigned width, unsigned height) {
+  const ImageBuffer rgba = to_rgba(img);
+  Magick::Image magick(rgba.width, rgba.height, "RGBA", Magick::CharPixel, rgba.pixels.data());
+  magick.resize(Magick::Geometry(width, height));
+  ImageBuffer ret;
+  ret.width = magick.columns();
+  ret.height = magick.rows();
+  ret.format = PixelFormat::rgba;
+  ret.pixels.resize(ret.stride() * ret.height);
+  magick.write(0, 0, ret.width, ret.height, "RGBA", Magick::CharPixel, ret.pixels.data());
+  return ret;
+}
+
+std::string convert_hires_request(const RequestOptions &ropts, const ImageBuffer &img) {
+  HiresOptions opts;
+  opts.palette = &ropts.palette();
+  const std::string dither = ropts.str("dither", ropts.get("stucki", 0) != 0 ? "stucki" : "none");
+  const auto it = dither_registry.find(dither);
+  if(it == dither_registry.end()) {
+    throw std::invalid_argument(std::format("unknown dithering '{}', available: {}", dither, dither_names()));
+  }
+  opts.dither = it->second;
+  opts.fli_lines = ropts.get("fli", 0u);
+  opts.pair_tolerance = ropts.get("optimise", 0.0);
+  opts.refine_passes = ropts.get("refine", 0u);
+  opts.integer = ropts.get("integer", 0) != 0;
+  std::ostringstream out;
+  if(opts.fli_lines != 0) {
+    write_fli_blocks(convert_hires(img, opts).blocks, out, ropts.get<unsigned short>("address", 0x4000));
+  } else {
+    write_char_blocks(convert_hires(img, opts).blocks, out, ropts.get<unsigned short>("address", 0x2000));
+  }
+  return out.str();
+}
+
+std::string convert_petscii_request(const Server &server, const RequestOptions &ropts, const ImageBuffer &img) {
+  ConvertOptions opts;
+  opts.threshold = ropts.get("threshold", DEFAULT_THRESHOLD);
+  opts.perceptual = ropts.get("perceptual", 0) != 0;
+  opts.colour = ropts.get("colour", 0) != 0;
+  opts.palette = &ropts.palette();
+  if(const int bg = ropts.get("background", -1); bg >= 0) {
+    opts.background = bg;
+  }
+  if(const std::string set = ropts.str("charset", "none"); set == "upper" || set == "lower") {
+    const auto &matcher = set == "upper" ? server.upper : server.lower;
+    if(!server.upper) {
+      throw std::invalid_argument("no character ROM loaded, start the server with --charset");
+    }
+    if(!matcher) {
+      throw std::invalid_argument("the character ROM has 2 KiB, no lower case set");
+    }
+    opts.matcher = &*matcher;
+  } else if(set != "none") {
+    throw std::invalid_argument(std::format("unknown charset '{}'", set));
+  }
+
+  const PetsciiScreen screen = (img.width > opts.max_width() || img.height > opts.max_height())
+    ? convert_petscii(fit_image(img, opts.max_width(), opts.max_height()), opts)
+    : convert_petscii(img, opts);
+  std::string ret;
+  ret.push_back(static_cast<char>(screen.columns));
+  ret.push_back(static_cast<char>(screen.rows));
+  ret.push_back(static_cast<char>(screen.background));
+  ret.append(screen.chars.begin(), screen.chars.end());
+  ret.append(screen.colours.begin(), screen.colours.end());
+  return ret;
+}
+
+std::string convert_sprites_request(const RequestOptions &ropts, const ImageBuffer &img) {
+  SheetOptions opts;
+  opts.multi_mode = ropts.get("multi", 0) != 0;
+  opts.x_position = ropts.get("x", 0);
+  opts.y_position = ropts.get("y", 0);
+  opts.transparent = ropts.get("transparent", 0);
+  opts.spritecolumns = ropts.get("columns", 1);
+  opts.spriterows = ropts.get("rows", 1);
+  opts.columnwidth = ropts.get("width", 24);
+  opts.rowheight = ropts.get("height", 21);
+  opts.multi1 = ropts.get("multi1", 1);
+  opts.multi2 = ropts.get("multi2", 2);
+  opts.autocol = ropts.get("autocol", 0) != 0;
+
+  const ImageBuffer *sheet = &img;
+  ImageBuffer quantised;
+  TrueColourSheet truecolour;
+  const bool quantise = img.channels() != 1 || ropts.get("quantise", 0) != 0;
+  if(quantise) {
+    quantised = quantise_image(img, ropts.palette(), opts.transparent, truecolour);
+    sheet = &quantised;
+    opts.transparent = QUANTISED_TRANSPARENT;
+    opts.autocol = false;
+    opts.multi1 = opts.multi2 = -1;
+  }
+  const bool optimise = !quantise && opts.multi_mode && ropts.get("optimise", 0) != 0;
+  if(optimise) {
+    opts.autocol = false;
+    opts.multi1 = opts.multi2 = -1;
+  }
+  std::vector<ObjectLayout> layouts;
+  std::vector<SheetObject> skipped;
+  std::vector<SheetSprite> sprites = ropts.get("auto", 0) != 0
+    ? extract_objects(*sheet, opts, layouts, skipped)
+    : extract_sprite_data(*sheet, opts);
+  if(quantise) {
+    const SheetColours colours = optimise_sprite_colours(sprites, truecolour, opts.multi_mode);
+    opts.multi1 = colours.multi1;
+    opts.multi2 = colours.multi2;
+  } else if(optimise) {
+    const SheetColours colours = optimise_indexed_colours(sprites, *sheet, ropts.palette(), ColourMetric::error);
+    opts.multi1 = colours.multi1;
+    opts.multi2 = colours.multi2;
+  }
+
+  std::string ret;
+  ret.push_back(static_cast<char>(opts.multi_mode && opts.multi1 >= 0 ? opts.multi1 : 0xFF));
+  ret.push_back(static_cast<char>(opts.multi_mode && opts.multi2 >= 0 ? opts.multi2 : 0xFF));
+  for(const SheetSprite &sprite : sprites) {
+    ret.append(sprite.bytes.begin(), sprite.bytes.end());
+  }
+  return ret;
+}
+
+std::string convert_chargen_request(const RequestOptions &ropts, const ImageBuffer &img) {
+  GlyphGrid grid;
+  grid.x = ropts.get("x", 0u);
+  grid.y = ropts.get("y", 0u);
+  grid.columns = std::max(1u, ropts.get("columns", 16u));
+  grid.count = ropts.get("count", 256u);
+  grid.tile_width = std::max(1u, ropts.get("tile_width", 1u));
+  grid.tile_height = std::max(1u, ropts.get("tile_height", 1u));
+  const double threshold = std::clamp(ropts.get("threshold", 50000.0 / 65535.0), 0.0, 1.0);
+
+  const auto glyphs = extract_glyphs(img, grid, static_cast<std::uint8_t>(threshold * 255.0 + 0.5));
+  std::ostringstream out;
+  if(ropts.get("dedup", 0) != 0) {
+    const GlyphDedup result = deduplicate_glyphs(glyphs);
+    std::string count;
+    put_u16(count, static_cast<unsigned>(result.unique.size()));
+    out << count;
+    write_charset(result.unique, out);
+    write_remap(result.remap, result.unique.size() > 256, out);
+  } else {
+    write_charset(glyphs, out);
+  }
+  return out.str();
+}
+
+/**
+ * \brief Run one request.
+ *
+ * \return the payload of the answer
+ * \throw std::exception with the error message for the client
+ */
+std::string handle_request(const Server &server, Command command, const std::string &options,
+                           const std::vector<std::uint8_t> &data) {
+  const RequestOptions ropts(options);
+  if(command == Command::stats) {
+    return format_counters();
+  }
+  if(data.empty()) {
+    throw std::invalid_argument("no image data");
+  }
+  const ImageBuffer img = decode_image(data);
+  switch(command) {
+  case Command::hires:
+    return convert_hires_request(ropts, img);
+  case Command::petscii:
+    return convert_petscii_request(server, ropts, img);
+  case Command::sprites:
+    return convert_sprites_request(ropts, img);
+  case Command::chargen:
+    return convert_chargen_request(ropts, img);
+  default:
+    throw std::invalid_argument(std::format("unknown command {}", static_cast<int>(command)));
+  }
+}
+
+// ── connections ───────────────────────────────────────────────────────────────
+
+/// Read exactly \p size bytes; false on end of file or error.
+bool read_all(int fd, void *buf, std::size_t size) {
+  auto *p = static_cast<char *>(buf);
+  while(size > 0) {
+    const ssize_t n = ::read(fd, p, size);
+    if(n < 0 && errno == EINTR) {
+      continue;
+    }
+    if(n <= 0) {
+      return false;
+    }
+    p += n;
+    size -= static_cast<std::size_t>(n);
+  }
+  return true;
+}
+
+/// Write all of \p data; false if the client went away.
+bool write_all(int fd, const std::string &data) {
+  const char *p = data.data();
+  std::size_t size = data.size();
+  while(size > 0) {
+    const ssize_t n = ::send(fd, p, size, MSG_NOSIGNAL);
+    if(n < 0 && errno == EINTR) {
+      continue;
+    }
+    if(n <= 0) {
+      return false;
+    }
+    p += n;
+    size -= static_cast<std::size_t>(n);
+  }
+  return true;
+}
+
+/**
+ * \brief Read one request from \p fd and answer it.
+ *
+ * \return false if the connection is to be closed (end of file, error or
+ *         a client which does not speak the protocol)
+ */
+bool serve_request(const Server &server, int fd) {
+  std::array<std::uint8_t, 7> header;
+  if(!read_all(fd, header.data(), header.size())) {
+    return false;
+  }
+  const auto command = static_cast<Command>(header[0]);
+  const std::size_t optlen = header[1] | (header[2] << 8);
+  const std::uint32_t datalen = header[3] | (header[4] << 8) | (header[5] << 16) | (std::uint32_t{header[6]} << 24);
+  if(datalen > MAX_DATA) {
+    return false; // Not a client of this protocol.
+  }
+  std::string options(optlen, '\0');
+  std::vector<std::uint8_t> data(datalen);
+  if(!read_all(fd, options.data(), optlen) || !read_all(fd, data.data(), datalen)) {
+    return false;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  std::string payload;
+  bool failed = false;
+  try {
+    payload = handle_request(server, command, options, data);
+  } catch(const std::exception &e) {
+    payload = e.what();
+    failed = true;
+  }
+  const auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+  const std::size_t idx = header[0] < counters.size() ? header[0] : 0;
+  counters[idx].record(static_cast<std::uint64_t>(us), failed);
+
+  std::string answer;
+  answer.push_back(failed ? 1 : 0);
+  put_u16(answer, static_cast<unsigned>(payload.size() & 0xFFFF));
+  put_u16(answer, static_cast<unsigned>(payload.size() >> 16));
+  answer += payload;
+  return write_all(fd, answer);
+}
+
+/**
+ * \brief Connections with a request waiting for a worker.
+ *
+ * A worker serves one request and hands the connection back to the main
+ * thread, so idle clients do not occupy a worker.
+ */
+class RequestQueue {
+  std::deque<int> fds;
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool closed = false;
+
+public:
+  void push(int fd) {
+    {
+      const std::lock_guard lock(mutex);
+      fds.push_back(fd);
+    }
+    cv.notify_one();
+  }
+
+  /// Next connection, or -1 once the queue is closed and empty.
+  int pop() {
+    std::unique_lock lock(mutex);
+    cv.wait(lock, [this] { return closed || !fds.empty(); });
+    if(fds.empty()) {
+      return -1;
+    }
+    const int fd = fds.front();
+    fds.pop_front();
+    return fd;
+  }
+
+  void close() {
+    {
+      const std::lock_guard lock(mutex);
+      closed = true;
+    }
+    cv.notify_all();
+  }
+};
+
+/**
+ * \brief All open connections.
+ *
+ * The main thread polls the idle connections; workers give a connection
+ * back after its request or close it. Giving one back wakes the main
+ * thread through a pipe. All file descriptors are closed under the lock,
+ * so shutdown_all() never hits a number which was already reused.
+ */
+class Connections {
+  std::vector<int> open;
+  std::vector<int> returned;
+  std::mutex mutex;
+  std::array<int, 2> wakeup{ -1, -1 };
+
+public:
+  Connections() {
+    if(::pipe(wakeup.data()) != 0) {
+      throw std::runtime_error(std::format("cannot create pipe: {}", std::strerror(errno)));
+    }
+    ::fcntl(wakeup[0], F_SETFL, O_NONBLOCK);
+    ::fcntl(wakeup[1], F_SETFL, O_NONBLOCK);
+  }
+
+  Connections(const Connections &) = delete;
+  Connections &operator=(const Connections &) = delete;
+
+  ~Connections() {
+    for(const int fd : open) {
+      ::close(fd);
+    }
+    ::close(wakeup[0]);
+    ::close(wakeup[1]);
+  }
+
+  /// Read end of the wake-up pipe, readable when connections were given back.
+  [[nodiscard]] int wakeup_fd() const noexcept { return wakeup[0]; }
+
+  /// Register a newly accepted connection.
+  void add(int fd) {
+    const std::lock_guard lock(mutex);
+    open.push_back(fd);
+  }
+
+  /// Hand a connection back to the main thread after a request.
+  void give_back(int fd) {
+    {
+      const std::lock_guard lock(mutex);
+      returned.push_back(fd);
+    }
+    const char byte = 0;
+    [[maybe_unused]] const auto n = ::write(wakeup[1], &byte, 1);
+  }
+
+  /// The connections given back since the last call.
+  [[nodiscard]] std::vector<int> take_returned() {
+    std::array<char, 64> buf;
+    while(::read(wakeup[0], buf.data(), buf.size()) > 0) {
+    }
+    const std::lock_guard lock(mutex);
+    return std::exchange(returned, {});
+  }
+
+  /// Close \p fd and forget it.
+  void close(int fd) {
+    const std::lock_guard lock(mutex);
+    std::erase(open, fd);
+    ::close(fd);
+  }
+
+  /// Shut all connections down, so that workers blocked on one return.
+  void shutdown_all() {
+    const std::lock_guard lock(mutex);
+    for(const int fd : open) {
+      ::shutdown(fd, SHUT_RDWR);
+    }
+  }
+};
+
+/**
+ * \brief Remove the socket a previous server left behind at \p addr.
+ *
+ * Only a socket which refuses connections is removed. Anything else at
+ * the path, a regular file or a server which is still running, is an
+ * error.
+ *
+ * \return the error message, or nothing if the path is free now
+ */
+std::optional<std::string> remove_stale_socket(const sockaddr_un &addr) {
+  struct stat st{};
+  if(::lstat(addr.sun_path, &st) != 0) {
+    return errno == ENOENT ? std::nullopt : std::optional<std::string>(std::strerror(errno));
+  }
+  if(!S_ISSOCK(st.st_mode)) {
+    return "the path exists and is not a socket";
+  }
+  const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if(fd < 0) {
+    return std::strerror(errno);
+  }
+  const bool refused = ::connect(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof addr) != 0 && errno == ECONNREFUSED;
+  ::close(fd);
+  if(!refused) {
+    return "another server is listening on it";
+  }
+  if(::unlink(addr.sun_path) != 0) {
+    return std::strerror(errno);
+  }
+  return std::nullopt;
+}
+
+/// Set by SIGINT and SIGTERM.
+volatile std::sig_atomic_t stop_requested = 0;
+
+extern "C" void request_stop(int) { stop_requested = 1; }
+
+// ── entry point ───────────────────────────────────────────────────────────────
+
+/**
+ * \brief Program entry point.
+ *
+ * Parses CLI options, loads the character ROM, opens the socket and
+ * serves requests until SIGINT or SIGTERM.
+ */
+int main(int argc, char **argv) {
+  CLI::App app{ std::format("c64gfxd V{} – conversion server for the C64 graphics converters", SUITE_VERSION) };
+
+  std::string socket_path = "c64gfxd.sock";
+  unsigned jobs = std::max(1u, std::thread::hardware_concurrency());
+  std::optional<std::string> charset_file;
+
+  app.add_option("--socket,-s", socket_path, "Path of the Unix domain socket (default: c64gfxd.sock)");
+  app.add_option("--jobs,-j", jobs, "Number of worker threads (default: number of CPUs)")
+  ->check(CLI::Range(1u, 256u));
+  app.add_option("--charset", charset_file, "Character ROM (2 or 4 KiB) for the petscii glyph mode")
+  ->check(CLI::ExistingFile);
+
+  CLI11_PARSE(app, argc, argv);
+
+  Magick::InitializeMagick(*argv);
+  Server server;
+  if(charset_file) {
+    try {
+      server.upper.emplace(load_charset(*charset_file, false));
+      if(std::filesystem::file_size(*charset_file) == 4096) {
+        server.lower.emplace(load_charset(*charset_file, true));
+      }
+    } catch(const std::exception &e) {
+      std::cerr << std::format("Cannot load the character ROM: {}\n", e.what());
+      return 1;
+    }
+  }
+
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  if(socket_path.size() >= sizeof addr.sun_path) {
+    std::cerr << std::format("Socket path '{}' is too long.\n", socket_path);
+    return 1;
+  }
+  std::memcpy(addr.sun_path, socket_path.c_str(), socket_path.size() + 1);
+  if(const auto error = remove_stale_socket(addr)) {
+    std::cerr << std::format("Cannot listen on '{}': {}\n", socket_path, *error);
+    return 1;
+  }
+  const int listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if(listen_fd < 0 || ::bind(listen_fd, reinterpret_cast<const sockaddr *>(&addr), sizeof addr) != 0
+     || ::listen(listen_fd, 64) != 0) {
+    std::cerr << std::format("Cannot listen on '{}': {}\n", socket_path, std::strerror(errno));
+    return 1;
+  }
+
+  struct sigaction action{};
+  action.sa_handler = request_stop;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGINT, &action, nullptr);
+  sigaction(SIGTERM, &action, nullptr);
+
+  RequestQueue queue;
+  Connections connections;
+  std::vector<std::thread> pool;
+  for(unsigned j = 0; j < jobs; ++j) {
+    pool.emplace_back([&] {
+      for(int fd = queue.pop(); fd >= 0; fd = queue.pop()) {
+        if(serve_request(server, fd)) {
+          connections.give_back(fd);
+        } else {
+          connections.close(fd);
+        }
+      }
+    });
+  }
+  std::cerr << std::format("Listening on '{}' with {} workers.\n", socket_path, jobs);
+
+  // The main thread accepts connections and waits for requests on the idle
+  // ones; only a connection with data to read is queued for a worker.
+  std::vector<int> idle;
+  std::vector<pollfd> pfds;
+  while(!stop_requested) {
+    std::ranges::copy(connections.take_returned(), std::back_inserter(idle));
+    pfds.assign({ { listen_fd, POLLIN, 0 }, { connections.wakeup_fd(), POLLIN, 0 } });
+    for(const int fd : idle) {
+      pfds.push_back({ fd, POLLIN, 0 });
+    }
+    if(::poll(pfds.data(), pfds.size(), 200) <= 0) {
+      continue; // Timeout or signal, check the stop flag.
+    }
+    idle.clear();
+    for(std::size_t i = 2; i < pfds.size(); ++i) {
+      if(pfds[i].revents != 0) {
+        queue.push(pfds[i].fd); // Request, end of file or error: the worker finds out.
+      } else {
+        idle.push_back(pfds[i].fd);
+      }
+    }
+    if((pfds[0].revents & POLLIN) != 0) {
+      if(const int fd = ::accept(listen_fd, nullptr, nullptr); fd >= 0) {
+        // A client which stops in the middle of a request must not keep its worker.
+        const timeval timeout{ CLIENT_TIMEOUT, 0 };
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+        ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof timeout);
+        connections.add(fd);
+        idle.push_back(fd);
+      }
+    }
+  }
+
+  ::close(listen_fd);
+  ::unlink(socket_path.c_str());
+  queue.close();
+  connections.shutdown_all();
+  for(auto &t : pool) {
+    t.join();
+  }
+  std::cerr << format_counters();
+  return 0;
+}
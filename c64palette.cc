@@ -0,0 +1,18 @@
+#include "c64palette.hh"
+
+const std::map<std::string, const C64Palette *> palette_registry{
+  { "grafx2", &palette_grafx2 }, { "pepto", &palette_pepto },
+  { "colodore", &palette_colodore }, { "vice", &palette_vice },
+  { "ccs64", &palette_ccs64 },
+};
+
+std::string palette_names() {
+  std::string ret;
+  for(const auto &[name, _] : palette_registry) {
+    if(!ret.empty()) {
+      ret += ", ";
+    }
+    ret += name;
+  }
+  return ret;
+}
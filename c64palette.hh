@@ -0,0 +1,218 @@
+#ifndef __C64PALETTE_HH_2026__
+#define __C64PALETTE_HH_2026__
+/*! \file c64palette.hh
+ *  \brief The 16 colours of the C64 in several measured palettes.
+ *
+ * All palettes are stored as normalised RGB (0.0–1.0). They are shared
+ * by every converter which has to match true-colour pixels against the
+ * C64 colours, so there is exactly one copy of the values.
+ */
+#include <array>
+#include <map>
+#include <string>
+
+inline constexpr int NCOLORS = 16; ///< Number of C64 palette entries
+
+// ── C64 palette definitions
+// ───────────────────────────────────────────────────
+
+/**
+ * \brief Symbolic names for the 16 C64 palette entries.
+ *
+ * The ordering matches the hardware colour register numbers 0–15.
+ */
+enum class C64Color : int {
+  Black = 0,
+  White,
+  Red,
+  Cyan,
+  Purple,
+  Green,
+  Blue,
+  Yellow,
+  Orange,
+  Brown,
+  LightRed,
+  DarkGrey,
+  Grey,
+  LightGreen,
+  LightBlue,
+  LightGrey
+};
+
+/// Type alias: a full 16-entry palette in normalised RGB (0.0–1.0).
+using C64Palette = std::array<std::array<double, 3>, NCOLORS>;
+
+/**
+ * \brief Grafx2 palette (original palette shipped with this tool).
+ *
+ * Values taken from the Grafx2 palette definition file c64vic20.pal.
+ */
+inline constexpr C64Palette palette_grafx2{ {
+  { { 0.000000e+00, 0.000000e+00, 0.000000e+00 } }, ///<  0 Black
+  { { 1.000000e+00, 1.000000e+00, 1.000000e+00 } }, ///<  1 White
+  { { 4.078431e-01, 2.156863e-01, 1.686275e-01 } }, ///<  2 Red
+  { { 4.392157e-01, 6.431373e-01, 6.980392e-01 } }, ///<  3 Cyan
+  { { 4.352941e-01, 2.392157e-01, 5.254902e-01 } }, ///<  4 Purple
+  { { 3.450980e-01, 5.529412e-01, 2.627451e-01 } }, ///<  5 Green
+  { { 2.078431e-01, 1.568627e-01, 4.745098e-01 } }, ///<  6 Blue
+  { { 7.215686e-01, 7.803922e-01, 4.352941e-01 } }, ///<  7 Yellow
+  { { 4.352941e-01, 3.098039e-01, 1.450980e-01 } }, ///<  8 Orange
+  { { 2.627451e-01, 2.235294e-01, 0.000000e+00 } }, ///<  9 Brown
+  { { 6.039216e-01, 4.039216e-01, 3.490196e-01 } }, ///< 10 LightRed
+  { { 2.666667e-01, 2.666667e-01, 2.666667e-01 } }, ///< 11 DarkGrey
+  { { 4.235294e-01, 4.235294e-01, 4.235294e-01 } }, ///< 12 Grey
+  { { 6.039216e-01, 8.235294e-01, 5.176471e-01 } }, ///< 13 LightGreen
+  { { 4.235294e-01, 3.686275e-01, 7.098039e-01 } }, ///< 14 LightBlue
+  { { 5.843137e-01, 5.843137e-01, 5.843137e-01 } }, ///< 15 LightGrey
+} };
+
+/**
+ * \brief Pepto palette by Phillip Timmermann.
+ *
+ * Mathematically derived from the C64's VIC-II colour generation circuit.
+ * Reference: https://www.pepto.de/projects/colorvic/
+ * RGB values (sRGB, 8-bit): normalised to [0,1] here.
+ *
+ *  0 Black      #000000    8 Orange     #8D3105
+ *  1 White      #FFFFFF    9 Brown      #5B4100
+ *  2 Red        #68372B   10 LightRed   #9A6759
+ *  3 Cyan       #70A4B2   11 DarkGrey   #444444
+ *  4 Purple     #6F3D86   12 Grey       #6C6C6C
+ *  5 Green      #588D43   13 LightGreen #9AD284
+ *  6 Blue       #352879   14 LightBlue  #6C5EB5
+ *  7 Yellow     #B8C76F   15 LightGrey  #959595
+ */
+inline constexpr C64Palette palette_pepto{ {
+  { { 0x00 / 255.0, 0x00 / 255.0, 0x00 / 255.0 } }, ///<  0 Black
+  { { 0xFF / 255.0, 0xFF / 255.0, 0xFF / 255.0 } }, ///<  1 White
+  { { 0x68 / 255.0, 0x37 / 255.0, 0x2B / 255.0 } }, ///<  2 Red
+  { { 0x70 / 255.0, 0xA4 / 255.0, 0xB2 / 255.0 } }, ///<  3 Cyan
+  { { 0x6F / 255.0, 0x3D / 255.0, 0x86 / 255.0 } }, ///<  4 Purple
+  { { 0x58 / 255.0, 0x8D / 255.0, 0x43 / 255.0 } }, ///<  5 Green
+  { { 0x35 / 255.0, 0x28 / 255.0, 0x79 / 255.0 } }, ///<  6 Blue
+  { { 0xB8 / 255.0, 0xC7 / 255.0, 0x6F / 255.0 } }, ///<  7 Yellow
+  { { 0x8D / 255.0, 0x31 / 255.0, 0x05 / 255.0 } }, ///<  8 Orange
+  { { 0x5B / 255.0, 0x41 / 255.0, 0x00 / 255.0 } }, ///<  9 Brown
+  { { 0x9A / 255.0, 0x67 / 255.0, 0x59 / 255.0 } }, ///< 10 LightRed
+  { { 0x44 / 255.0, 0x44 / 255.0, 0x44 / 255.0 } }, ///< 11 DarkGrey
+  { { 0x6C / 255.0, 0x6C / 255.0, 0x6C / 255.0 } }, ///< 12 Grey
+  { { 0x9A / 255.0, 0xD2 / 255.0, 0x84 / 255.0 } }, ///< 13 LightGreen
+  { { 0x6C / 255.0, 0x5E / 255.0, 0xB5 / 255.0 } }, ///< 14 LightBlue
+  { { 0x95 / 255.0, 0x95 / 255.0, 0x95 / 255.0 } }, ///< 15 LightGrey
+} };
+
+/**
+ * \brief Colodore palette by Paolo Paglianti.
+ *
+ * Perceptually optimised palette derived from extensive measurement.
+ * Reference: https://www.colodore.com/
+ * RGB values (sRGB, 8-bit): normalised to [0,1] here.
+ *
+ *  0 Black      #000000    8 Orange     #8E3620
+ *  1 White      #FFFFFF    9 Brown      #604000
+ *  2 Red        #6D3B37   10 LightRed   #9A6758
+ *  3 Cyan       #6EB6CC   11 DarkGrey   #444444
+ *  4 Purple     #703778   12 Grey       #6C6C6C
+ *  5 Green      #56892E   13 LightGreen #96D862
+ *  6 Blue       #2F2EA6   14 LightBlue  #6C5ACA
+ *  7 Yellow     #BBBA6E   15 LightGrey  #959595
+ */
+inline constexpr C64Palette palette_colodore{ {
+  { { 0x00 / 255.0, 0x00 / 255.0, 0x00 / 255.0 } }, ///<  0 Black
+  { { 0xFF / 255.0, 0xFF / 255.0, 0xFF / 255.0 } }, ///<  1 White
+  { { 0x6D / 255.0, 0x3B / 255.0, 0x37 / 255.0 } }, ///<  2 Red
+  { { 0x6E / 255.0, 0xB6 / 255.0, 0xCC / 255.0 } }, ///<  3 Cyan
+  { { 0x70 / 255.0, 0x37 / 255.0, 0x78 / 255.0 } }, ///<  4 Purple
+  { { 0x56 / 255.0, 0x89 / 255.0, 0x2E / 255.0 } }, ///<  5 Green
+  { { 0x2F / 255.0, 0x2E / 255.0, 0xA6 / 255.0 } }, ///<  6 Blue
+  { { 0xBB / 255.0, 0xBA / 255.0, 0x6E / 255.0 } }, ///<  7 Yellow
+  { { 0x8E / 255.0, 0x36 / 255.0, 0x20 / 255.0 } }, ///<  8 Orange
+  { { 0x60 / 255.0, 0x40 / 255.0, 0x00 / 255.0 } }, ///<  9 Brown
+  { { 0x9A / 255.0, 0x67 / 255.0, 0x58 / 255.0 } }, ///< 10 LightRed
+  { { 0x44 / 255.0, 0x44 / 255.0, 0x44 / 255.0 } }, ///< 11 DarkGrey
+  { { 0x6C / 255.0, 0x6C / 255.0, 0x6C / 255.0 } }, ///< 12 Grey
+  { { 0x96 / 255.0, 0xD8 / 255.0, 0x62 / 255.0 } }, ///< 13 LightGreen
+  { { 0x6C / 255.0, 0x5A / 255.0, 0xCA / 255.0 } }, ///< 14 LightBlue
+  { { 0x95 / 255.0, 0x95 / 255.0, 0x95 / 255.0 } }, ///< 15 LightGrey
+} };
+
+/**
+ * \brief VICE emulator default palette.
+ *
+ * The palette used by VICE 3.x as its built-in default (c64hq palette).
+ * Reference: VICE source tree data/C64/vice.vpl
+ * RGB values (sRGB, 8-bit): normalised to [0,1] here.
+ *
+ *  0 Black      #000000    8 Orange     #8D4616
+ *  1 White      #FFFFFF    9 Brown      #654100
+ *  2 Red        #8D2020   10 LightRed   #C06060
+ *  3 Cyan       #4DB4C7   11 DarkGrey   #404040
+ *  4 Purple     #813079   12 Grey       #707070
+ *  5 Green      #4D9051   13 LightGreen #82D37E
+ *  6 Blue       #2B2B8D   14 LightBlue  #6060C0
+ *  7 Yellow     #BDBD6D   15 LightGrey  #A0A0A0
+ */
+inline constexpr C64Palette palette_vice{ {
+  { { 0x00 / 255.0, 0x00 / 255.0, 0x00 / 255.0 } }, ///<  0 Black
+  { { 0xFF / 255.0, 0xFF / 255.0, 0xFF / 255.0 } }, ///<  1 White
+  { { 0x8D / 255.0, 0x20 / 255.0, 0x20 / 255.0 } }, ///<  2 Red
+  { { 0x4D / 255.0, 0xB4 / 255.0, 0xC7 / 255.0 } }, ///<  3 Cyan
+  { { 0x81 / 255.0, 0x30 / 255.0, 0x79 / 255.0 } }, ///<  4 Purple
+  { { 0x4D / 255.0, 0x90 / 255.0, 0x51 / 255.0 } }, ///<  5 Green
+  { { 0x2B / 255.0, 0x2B / 255.0, 0x8D / 255.0 } }, ///<  6 Blue
+  { { 0xBD / 255.0, 0xBD / 255.0, 0x6D / 255.0 } }, ///<  7 Yellow
+  { { 0x8D / 255.0, 0x46 / 255.0, 0x16 / 255.0 } }, ///<  8 Orange
+  { { 0x65 / 255.0, 0x41 / 255.0, 0x00 / 255.0 } }, ///<  9 Brown
+  { { 0xC0 / 255.0, 0x60 / 255.0, 0x60 / 255.0 } }, ///< 10 LightRed
+  { { 0x40 / 255.0, 0x40 / 255.0, 0x40 / 255.0 } }, ///< 11 DarkGrey
+  { { 0x70 / 255.0, 0x70 / 255.0, 0x70 / 255.0 } }, ///< 12 Grey
+  { { 0x82 / 255.0, 0xD3 / 255.0, 0x7E / 255.0 } }, ///< 13 LightGreen
+  { { 0x60 / 255.0, 0x60 / 255.0, 0xC0 / 255.0 } }, ///< 14 LightBlue
+  { { 0xA0 / 255.0, 0xA0 / 255.0, 0xA0 / 255.0 } }, ///< 15 LightGrey
+} };
+
+/**
+ * \brief CCS64 emulator palette.
+ *
+ * The palette used by Per Håkan Sundell's CCS64 emulator.
+ * Reference: https://ccs64.com/ / community measurements
+ * RGB values (sRGB, 8-bit): normalised to [0,1] here.
+ *
+ *  0 Black      #101010    8 Orange     #993300
+ *  1 White      #FFFFFF    9 Brown      #663300
+ *  2 Red        #993322   10 LightRed   #CC6655
+ *  3 Cyan       #55CCDD   11 DarkGrey   #444444
+ *  4 Purple     #882277   12 Grey       #777777
+ *  5 Green      #33AA44   13 LightGreen #66DD55
+ *  6 Blue       #2233BB   14 LightBlue  #5566EE
+ *  7 Yellow     #CCDD55   15 LightGrey  #AAAAAA
+ */
+inline constexpr C64Palette palette_ccs64{ {
+  { { 0x10 / 255.0, 0x10 / 255.0, 0x10 / 255.0 } }, ///<  0 Black
+  { { 0xFF / 255.0, 0xFF / 255.0, 0xFF / 255.0 } }, ///<  1 White
+  { { 0x99 / 255.0, 0x33 / 255.0, 0x22 / 255.0 } }, ///<  2 Red
+  { { 0x55 / 255.0, 0xCC / 255.0, 0xDD / 255.0 } }, ///<  3 Cyan
+  { { 0x88 / 255.0, 0x22 / 255.0, 0x77 / 255.0 } }, ///<  4 Purple
+  { { 0x33 / 255.0, 0xAA / 255.0, 0x44 / 255.0 } }, ///<  5 Green
+  { { 0x22 / 255.0, 0x33 / 255.0, 0xBB / 255.0 } }, ///<  6 Blue
+  { { 0xCC / 255.0, 0xDD / 255.0, 0x55 / 255.0 } }, ///<  7 Yellow
+  { { 0x99 / 255.0, 0x33 / 255.0, 0x00 / 255.0 } }, ///<  8 Orange
+  { { 0x66 / 255.0, 0x33 / 255.0, 0x00 / 255.0 } }, ///<  9 Brown
+  { { 0xCC / 255.0, 0x66 / 255.0, 0x55 / 255.0 } }, ///< 10 LightRed
+  { { 0x44 / 255.0, 0x44 / 255.0, 0x44 / 255.0 } }, ///< 11 DarkGrey
+  { { 0x77 / 255.0, 0x77 / 255.0, 0x77 / 255.0 } }, ///< 12 Grey
+  { { 0x66 / 255.0, 0xDD / 255.0, 0x55 / 255.0 } }, ///< 13 LightGreen
+  { { 0x55 / 255.0, 0x66 / 255.0, 0xEE / 255.0 } }, ///< 14 LightBlue
+  { { 0xAA / 255.0, 0xAA / 255.0, 0xAA / 255.0 } }, ///< 15 LightGrey
+} };
+
+/// Registry: map palette name → pointer to palette data.
+/// Extend this map (in c64palette.cc) to add further palettes without
+/// changing any other code.
+extern const std::map<std::string, const C64Palette *> palette_registry;
+
+/*! \brief Comma separated list of all palette names, for help texts. */
+std::string palette_names();
+
+#endif
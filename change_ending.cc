@@ -1,6 +1,6 @@
 #include "change_ending.hh"
+#include <filesystem>
 
 std::string change_ending(std::string fn, const char *ending) {
-  fn = fn.substr(0, fn.rfind('.')) + '.' + ending;
-  return fn;
+  return std::filesystem::path(fn).replace_extension(ending).string();
 }
@@ -3,6 +3,9 @@
 #include <string>
 
 /*! \brief change the ending of the string aka change extension of a filename
+ *
+ * Only the last component is changed, dots in directory names are kept;
+ * a name without extension gets one.
  *
  * \brief fn filename
  * \brief ending new extension
@@ -1,85 +1,135 @@
-#include <inttypes.h>
-#include <iostream>
-#include <sstream>
-#include <fstream>
-#include <algorithm>
-#include <Magick++.h>
+/**
+ * \file chargenconv.cc
+ * \brief Extract a C64 character set (font) from an image.
+ *
+ * The image is read as a grid of character tiles. A tile consists of
+ * tile-width × tile-height 8×8 glyphs (1×1 for a plain font, 2×2 for
+ * a typical tile set). Tiles are read left to right, top to bottom,
+ * starting at the given offset; the glyphs inside a tile are stored in
+ * row-major order.
+ *
+ * The image is loaded with load_image() (see imageload.hh) and the glyphs
+ * are extracted with extract_glyphs() from libc64gfx (see charset.hh),
+ * which packs every glyph into a 64-bit word (see glyph.hh). Magick++ is
+ * only started for formats other than PNG and PNM and for --display and
+ * --write-xpm.
+ * Optionally duplicate glyphs are eliminated: the charset then only
+ * contains unique glyphs and a remap table (one entry per glyph of the
+ * sheet) tells which character to use at which position.
+ *
+ * Output files (derived from the input file name):
+ * - .c64 : character set, 8 bytes per glyph, no load address
+ * - .map : remap table (only with --dedup), one byte per entry, or
+ *          two bytes little-endian if there are more than 256 glyphs
+ * - .xpm : thresholded image (only with --write-xpm)
+ *
+ * --stats prints the time spent per stage on stderr (see runstats.hh).
+ *
+ * Build dependencies: libc64gfx, libpng, Magick++, CLI11
+ * Requires: C++23 (-std=c++23)
+ */
+
 #include "change_ending.hh"
+#include "charset.hh"
+#include "imageload.hh"
+#include "runstats.hh"
+#include <CLI/CLI.hpp>
+#include <Magick++.h>
+#include <cstdint>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// ── constants ─────────────────────────────────────────────────────────────────
 
-/*
- * chargenconv
- * ===========
+/// Default brightness threshold, equals the former fixed threshold of 50000.
+inline constexpr double DEFAULT_THRESHOLD = 50000.0 / 65535.0;
+
+// ── entry point ───────────────────────────────────────────────────────────────
+
+/**
+ * \brief Program entry point.
  *
- * Convert a bitmap of at least 128 * 128 pixels as we assume that the
- * characters are aligned into a 8 characters times 8 characters
- * matrix.
+ * Parses CLI options, loads the image, extracts and optionally
+ * deduplicates the glyphs, and writes the charset (and remap table).
  */
+int main(int argc, char **argv) {
+  CLI::App app{
+    std::format("chargenconv V{} – extract a C64 character set from an image", SUITE_VERSION) };
 
+  std::string input_file;
+  GlyphGrid grid;
+  double threshold = DEFAULT_THRESHOLD;
+  bool dedup = false;
+  bool write_xpm = false;
+  bool display_gfx = false;
+  std::string stats_format;
 
-std::vector<uint8_t> get_bitmap(const Magick::Image &img, unsigned x_, unsigned y_) {
-  unsigned x, y;
-  std::vector<uint8_t> ret;
-  uint8_t val;
-  uint8_t mask;
+  app.add_option("file", input_file, "Input image file to convert")
+  ->required()
+  ->check(CLI::ExistingFile);
+  app.add_option("--x-position,-x", grid.x, "X offset of the first tile in pixels");
+  app.add_option("--y-position,-y", grid.y, "Y offset of the first tile in pixels");
+  app.add_option("--columns,-c", grid.columns, "Number of tiles per row in the image (default 16)")
+  ->check(CLI::Range(1u, 4096u));
+  app.add_option("--count,-n", grid.count, "Number of tiles to extract (default 256)")
+  ->check(CLI::Range(1u, 65536u));
+  app.add_option("--tile-width", grid.tile_width, "Tile width in characters (default 1)")
+  ->check(CLI::Range(1u, 40u));
+  app.add_option("--tile-height", grid.tile_height, "Tile height in characters (default 1)")
+  ->check(CLI::Range(1u, 25u));
+  app.add_option("--threshold,-t", threshold,
+                 std::format("Brightness threshold, brighter pixels are set bits "
+                             "(0.0–1.0, default {:.3f})", DEFAULT_THRESHOLD))
+  ->check(CLI::Range(0.0, 1.0));
+  app.add_flag("--dedup", dedup,
+               "Eliminate duplicate glyphs and write a remap table (.map)");
+  app.add_flag("--write-xpm", write_xpm, "Also save the thresholded image as XPM");
+  app.add_flag("--display", display_gfx, "Display the image before conversion");
+  app.add_flag("--stats{table}", stats_format,
+               "Print the time per stage, counters and memory use on stderr "
+               "(--stats=json for one line of JSON)")
+  ->check(CLI::IsMember({ "table", "json" }));
 
-  for(y = y_; y < y_ + 8; ++y) {
-    val = 0;
-    mask = 0x80;
-    for(x = x_; x < x_ + 8; ++x) {
-      Magick::ColorMono col(img.pixelColor(x, y));
-      if(col.mono()) {
-	val |= mask;
-      }
-      mask >>= 1; // Move mask bit to the right.
-    }
-    ret.push_back(val);
-  }
-  return ret;
-}
+  CLI11_PARSE(app, argc, argv);
+  const StatsReport report("chargenconv", stats_format, std::cerr);
 
+  const ImageBuffer img = load_image(input_file);
+  if(display_gfx) {
+    Magick::Image(input_file).display();
+  }
 
-std::vector<uint8_t> convert_whole_bitmap(const Magick::Image &img) {
-  std::vector<uint8_t> chargen;
+  const auto glyphs = extract_glyphs(img, grid, static_cast<std::uint8_t>(threshold * 255.0 + 0.5));
+  std::cerr << std::format("Extracted {} glyphs from {} tiles\n", glyphs.size(), grid.count);
+  count_stat("glyphs", glyphs.size());
 
-  for(unsigned y = 0; y < 128; y += 8) {
-    for(unsigned x = 0; x < 128; x += 8) {
-      auto block(get_bitmap(img, x, y));
-      std::copy(block.begin(), block.end(), std::back_inserter(chargen));
+  std::ofstream outfile(change_ending(input_file, "c64"), std::ios::binary);
+  if(dedup) {
+    StageTimer dedup_timer(Stage::diff);
+    const GlyphDedup result = deduplicate_glyphs(glyphs);
+    dedup_timer.stop();
+    const bool wide = result.unique.size() > 256;
+    std::cerr << std::format("{} unique glyphs, {} duplicates removed\n", result.unique.size(),
+                             glyphs.size() - result.unique.size());
+    if(wide) {
+      std::cerr << "More than 256 unique glyphs, remap table uses 16-bit entries\n";
     }
+    const StageTimer timer(Stage::write);
+    write_charset(result.unique, outfile);
+    std::ofstream mapfile(change_ending(input_file, "map"), std::ios::binary);
+    write_remap(result.remap, wide, mapfile);
+  } else {
+    const StageTimer timer(Stage::write);
+    write_charset(glyphs, outfile);
   }
-  return chargen;
-}
-
 
-int main(int argc, char **argv) {
-  if(argc < 2) {
-    std::cerr << "Usage: chargenconv <file>\n";
-    return 1;
-  } else {
-    Magick::Image img(argv[1]);
-    if(img.columns() < 128 || img.rows() < 128) {
-      std::ostringstream out;
-      out << "wrong picture size (" << img.columns() << '*' << img.rows() << ')';
-      throw std::invalid_argument(out.str());
-    } else {
-      img.crop(Magick::Geometry(128, 128, 0, 0));
-    }
-    /*
-     * Convert the image to a true type image so that the following
-     * pixel methods work correctly as we assume an RGB image. See
-     * also https://www.imagemagick.org/Magick++/Pixels.html.
-     */
-    img.threshold(50000);
-    img.type(Magick::TrueColorType);
-    img.modifyImage();
-    //img.type(Magick::BilevelType);
-    auto chargen(convert_whole_bitmap(img));
-    img.display(); // After display, image data is botched???
-    //img.write(change_ending(argv[1], "ilbm"));
-    img.write(change_ending(argv[1], "xpm"));
-    std::ofstream outfile(change_ending(argv[1], "c64"));
-    //std::copy(chargen.begin(), chargen.end(), std::ostream_iterator<int>(std::cout, " "));
-    std::copy(chargen.begin(), chargen.end(), std::ostream_iterator<char>(outfile));
+  if(write_xpm) {
+    Magick::Image xpm(input_file);
+    xpm.crop(Magick::Geometry(grid.pixel_width(), grid.pixel_height(), grid.x, grid.y));
+    xpm.threshold(threshold * QuantumRange);
+    xpm.write(change_ending(input_file, "xpm"));
   }
   return 0;
 }
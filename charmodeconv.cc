@@ -0,0 +1,106 @@
+/**
+ * \file charmodeconv.cc
+ * \brief Convert an image to C64 hires character mode.
+ *
+ * Loads an image (see imageload.hh), crops it to 320×200 pixels
+ * and cuts it into 40×25 cells of 8×8 pixels. Every pixel is matched to
+ * the nearest colour of the chosen palette. The background colour
+ * ($d021) is shared by the whole screen, each cell gets its own
+ * foreground colour (colour RAM) and a glyph.
+ *
+ * Identical glyphs are merged exactly. If more than the allowed number
+ * of characters (256 by default) remain, near-identical glyphs are merged
+ * by k-medoids clustering on the Hamming distance (see glyph.hh).
+ * The conversion is convert_charmode() from libc64gfx (see charset.hh).
+ *
+ * Output files (derived from the input file name):
+ * - .chr : character set, 8 bytes per glyph
+ * - .scr : screen RAM, 1000 bytes
+ * - .col : colour RAM, 1000 bytes
+ *
+ * --stats prints the time spent per stage on stderr (see runstats.hh).
+ *
+ * Reads PNG and PNM files only (see imageload_plain.cc).
+ *
+ * Build dependencies: libc64gfx, libpng, CLI11
+ * Requires: C++23 (-std=c++23)
+ */
+
+#include "c64palette.hh"
+#include "change_ending.hh"
+#include "charset.hh"
+#include "imageload.hh"
+#include "runstats.hh"
+#include <CLI/CLI.hpp>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string>
+
+// ── entry point ───────────────────────────────────────────────────────────────
+
+/**
+ * \brief Program entry point.
+ *
+ * Parses CLI options, loads and crops the image, converts it and writes
+ * charset, screen RAM and colour RAM.
+ */
+int main(int argc, char **argv) {
+  CLI::App app{
+    std::format("charmodeconv V{} – convert an image to C64 character mode", SUITE_VERSION) };
+
+  std::string input_file;
+  std::string palette_name = "grafx2";
+  std::optional<int> background;
+  unsigned max_chars = 256;
+  std::string stats_format;
+
+  app.add_option("file", input_file, "Input image file to convert")
+  ->required()
+  ->check(CLI::ExistingFile);
+  app.add_option("--palette", palette_name,
+                 std::format("C64 colour palette to use (default: grafx2).\n"
+                             "Available palettes: {}",
+                             palette_names()))
+  ->check([](const std::string &val) -> std::string {
+    if(palette_registry.count(val) == 0) {
+      return std::format("unknown palette '{}'. "
+                         "Run with --help for a list of valid palettes.",
+                         val);
+    }
+    return {};
+  });
+  app.add_option("--background,-b", background,
+                 "Background colour (0–15), default is the most frequent colour")
+  ->check(CLI::Range(0, NCOLORS - 1));
+  app.add_option("--max-chars,-m", max_chars,
+                 "Maximum number of characters in the charset (default 256)")
+  ->check(CLI::Range(1u, 256u));
+  app.add_flag("--stats{table}", stats_format,
+               "Print the time per stage, counters and memory use on stderr "
+               "(--stats=json for one line of JSON)")
+  ->check(CLI::IsMember({ "table", "json" }));
+
+  CLI11_PARSE(app, argc, argv);
+  const StatsReport report("charmodeconv", stats_format, std::cerr);
+
+  const CharScreen result =
+    convert_charmode(load_image(input_file), *palette_registry.at(palette_name), background, max_chars);
+  std::cerr << std::format("{} unique glyphs\n", result.unique);
+  if(result.unique > max_chars) {
+    std::cerr << std::format("Merged into {} glyphs, {} pixels changed, at most {} per cell\n",
+                             result.charset.size(), result.changed, result.worst);
+  }
+  std::cerr << std::format("Background colour: {}\n", result.background);
+
+  count_stat("glyphs", result.charset.size());
+  const StageTimer timer(Stage::write);
+  std::ofstream charfile(change_ending(input_file, "chr"), std::ios::binary);
+  write_charset(result.charset, charfile);
+  std::ofstream screenfile(change_ending(input_file, "scr"), std::ios::binary);
+  screenfile.write(reinterpret_cast<const char *>(result.screen.data()), result.screen.size());
+  std::ofstream colourfile(change_ending(input_file, "col"), std::ios::binary);
+  colourfile.write(reinterpret_cast<const char *>(result.colour.data()), result.colour.size());
+  return 0;
+}
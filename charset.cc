@@ -0,0 +1,155 @@
+#include "charset.hh"
+#include "runstats.hh"
+#include <algorithm>
+#include <format>
+#include <stdexcept>
+
+namespace {
+
+inline constexpr unsigned IMG_W = CHARMODE_COLS * GLYPH; ///< Screen width in pixels
+inline constexpr unsigned IMG_H = CHARMODE_ROWS * GLYPH; ///< Screen height in pixels
+
+/**
+ * \brief Squared distance between an 8-bit RGB pixel and a palette colour.
+ */
+[[nodiscard]] double pixel_dist(const std::uint8_t *rgb, const std::array<double, 3> &pal) noexcept {
+  double total = 0.0;
+  for(unsigned c = 0; c < 3; ++c) {
+    const double d = rgb[c] / 255.0 - pal[c];
+    total += d * d;
+  }
+  return total;
+}
+
+/// True if \p count cells of \p size pixels from \p offset on fit into \p extent pixels, without overflow.
+[[nodiscard]] bool cells_fit(unsigned offset, std::uint64_t count, std::uint64_t size, unsigned extent) noexcept {
+  return offset <= extent && (count == 0 || (size > 0 && count <= (extent - offset) / size));
+}
+
+} // namespace
+
+std::vector<GlyphWord> extract_glyphs(const ImageBuffer &img, const GlyphGrid &grid, std::uint8_t threshold) {
+  const StageTimer timer(Stage::quantise);
+  if(grid.columns == 0 || grid.tile_width == 0 || grid.tile_height == 0) {
+    throw std::invalid_argument("the glyph grid needs at least one column and tiles of at least one glyph");
+  }
+  // The grid may come from a c64gfxd client: pixel_width() and
+  // pixel_height() are only computed once they are known to fit.
+  const std::uint64_t rows = grid.rows();
+  if(!cells_fit(grid.x, grid.columns, std::uint64_t{ grid.tile_width } * GLYPH, img.width) ||
+     !cells_fit(grid.y, rows, std::uint64_t{ grid.tile_height } * GLYPH, img.height)) {
+    throw std::invalid_argument(
+            std::format("wrong picture size ({}x{}), need {}x{} tiles of {}x{} glyphs at {},{}", img.width,
+                        img.height, grid.columns, rows, grid.tile_width, grid.tile_height, grid.x, grid.y));
+  }
+  const std::vector<std::uint8_t> grey =
+    to_grey(crop_image(img, grid.x, grid.y, grid.pixel_width(), grid.pixel_height())).pixels;
+  const std::size_t stride = grid.pixel_width();
+  std::vector<GlyphWord> glyphs;
+
+  glyphs.reserve(static_cast<std::size_t>(grid.count) * grid.tile_width * grid.tile_height);
+  for(unsigned tile = 0; tile < grid.count; ++tile) {
+    const unsigned tx = (tile % grid.columns) * grid.tile_width * GLYPH;
+    const unsigned ty = (tile / grid.columns) * grid.tile_height * GLYPH;
+    for(unsigned gy = 0; gy < grid.tile_height; ++gy) {
+      for(unsigned gx = 0; gx < grid.tile_width; ++gx) {
+        const std::uint8_t *origin = grey.data() + (ty + gy * GLYPH) * stride + tx + gx * GLYPH;
+        glyphs.push_back(pack_glyph(origin, stride, threshold));
+      }
+    }
+  }
+  return glyphs;
+}
+
+void write_remap(const std::vector<unsigned> &remap, bool wide, std::ostream &out) {
+  for(unsigned idx : remap) {
+    out.put(static_cast<char>(idx & 0xFF));
+    if(wide) {
+      out.put(static_cast<char>(idx >> 8));
+    }
+  }
+}
+
+std::vector<std::array<double, NCOLORS> > distance_table(const std::vector<std::uint8_t> &rgb, const C64Palette &palette) {
+  std::vector<std::array<double, NCOLORS> > dist(rgb.size() / 3);
+  for(std::size_t i = 0; i < dist.size(); ++i) {
+    for(int c = 0; c < NCOLORS; ++c) {
+      dist[i][c] = pixel_dist(&rgb[3 * i], palette[c]);
+    }
+  }
+  return dist;
+}
+
+CharScreen convert_charmode(const std::vector<std::array<double, NCOLORS> > &dist, std::optional<int> background, unsigned max_chars) {
+  CharScreen ret;
+  std::vector<std::uint8_t> nearest(dist.size());
+  std::array<unsigned, NCOLORS> histogram{};
+
+  for(std::size_t i = 0; i < dist.size(); ++i) {
+    nearest[i] = static_cast<std::uint8_t>(std::distance(dist[i].begin(), std::min_element(dist[i].begin(), dist[i].end())));
+    ++histogram[nearest[i]];
+  }
+  ret.background = background.value_or(
+    static_cast<int>(std::distance(histogram.begin(), std::max_element(histogram.begin(), histogram.end()))));
+
+  std::vector<GlyphWord> glyphs(CHARMODE_COLS * CHARMODE_ROWS);
+  for(unsigned cy = 0; cy < CHARMODE_ROWS; ++cy) {
+    for(unsigned cx = 0; cx < CHARMODE_COLS; ++cx) {
+      std::array<unsigned, NCOLORS> votes{};
+      for(unsigned y = cy * GLYPH; y < (cy + 1) * GLYPH; ++y) {
+        for(unsigned x = cx * GLYPH; x < (cx + 1) * GLYPH; ++x) {
+          ++votes[nearest[y * IMG_W + x]];
+        }
+      }
+      votes[ret.background] = 0;
+      const auto fg = static_cast<int>(std::distance(votes.begin(), std::max_element(votes.begin(), votes.end())));
+      GlyphWord glyph = 0;
+      if(votes[fg] != 0) {
+        for(unsigned y = cy * GLYPH; y < (cy + 1) * GLYPH; ++y) {
+          for(unsigned x = cx * GLYPH; x < (cx + 1) * GLYPH; ++x) {
+            const auto &d = dist[y * IMG_W + x];
+            glyph = (glyph << 1) | (d[fg] < d[ret.background] ? 1u : 0u);
+          }
+        }
+      }
+      glyphs[cy * CHARMODE_COLS + cx] = glyph;
+      ret.colour[cy * CHARMODE_COLS + cx] = static_cast<std::uint8_t>(fg);
+    }
+  }
+
+  const GlyphDedup dedup = deduplicate_glyphs(glyphs);
+  ret.unique = static_cast<unsigned>(dedup.unique.size());
+  if(dedup.unique.size() <= max_chars) {
+    ret.charset = dedup.unique;
+    for(unsigned i = 0; i < glyphs.size(); ++i) {
+      ret.screen[i] = static_cast<std::uint8_t>(dedup.remap[i]);
+    }
+  } else {
+    std::vector<unsigned> weights(dedup.unique.size(), 0);
+    for(unsigned idx : dedup.remap) {
+      ++weights[idx];
+    }
+    const GlyphClusters clusters = cluster_glyphs(dedup.unique, weights, max_chars);
+    ret.charset = clusters.medoids;
+    for(unsigned i = 0; i < glyphs.size(); ++i) {
+      const unsigned medoid = clusters.assignment[dedup.remap[i]];
+      const unsigned d = glyph_distance(glyphs[i], clusters.medoids[medoid]);
+      ret.worst = std::max(ret.worst, d);
+      ret.changed += d;
+      ret.screen[i] = static_cast<std::uint8_t>(medoid);
+    }
+  }
+  return ret;
+}
+
+CharScreen convert_charmode(const ImageBuffer &img, const C64Palette &palette, std::optional<int> background, unsigned max_chars) {
+  if(img.width < IMG_W || img.height < IMG_H) {
+    throw std::invalid_argument(
+            std::format("wrong picture size ({}x{})", img.width, img.height));
+  }
+  StageTimer resize_timer(Stage::resize);
+  const std::vector<std::uint8_t> rgb = to_rgb(crop_image(img, 0, 0, IMG_W, IMG_H)).pixels;
+  resize_timer.stop();
+  const StageTimer timer(Stage::quantise);
+  return convert_charmode(distance_table(rgb, palette), background, max_chars);
+}
@@ -0,0 +1,114 @@
+#ifndef __CHARSET_HH_2026__
+#define __CHARSET_HH_2026__
+/*! \file charset.hh
+ *  \brief Character set extraction and character mode conversion.
+ *
+ * extract_glyphs() reads a font or tile set laid out on a grid (the core
+ * of chargenconv), convert_charmode() turns a 320×200 image into a
+ * character set plus screen and colour RAM (the core of charmodeconv).
+ * Both work on an ImageBuffer and report their statistics in the result
+ * instead of printing them.
+ */
+#include "c64palette.hh"
+#include "glyph.hh"
+#include "imageload.hh"
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <vector>
+
+inline constexpr unsigned GLYPH = 8; ///< Glyph side length in pixels
+
+inline constexpr unsigned CHARMODE_COLS = 40; ///< Character columns of the screen
+inline constexpr unsigned CHARMODE_ROWS = 25; ///< Character rows of the screen
+
+// ── glyph grid ────────────────────────────────────────────────────────────────
+
+/**
+ * \brief Layout of the glyphs in the source image.
+ */
+struct GlyphGrid {
+  unsigned x = 0;           ///< X offset of the first tile in pixels
+  unsigned y = 0;           ///< Y offset of the first tile in pixels
+  unsigned columns = 16;    ///< Number of tiles per row in the image
+  unsigned count = 256;     ///< Number of tiles to extract
+  unsigned tile_width = 1;  ///< Tile width in glyphs
+  unsigned tile_height = 1; ///< Tile height in glyphs
+
+  /// Number of tile rows needed for \c count tiles.
+  [[nodiscard]] unsigned rows() const { return count / columns + (count % columns != 0 ? 1 : 0); }
+  /// Width of the area covered by the grid in pixels.
+  [[nodiscard]] unsigned pixel_width() const { return columns * tile_width * GLYPH; }
+  /// Height of the area covered by the grid in pixels.
+  [[nodiscard]] unsigned pixel_height() const { return rows() * tile_height * GLYPH; }
+};
+
+/**
+ * \brief Pack all glyphs of the grid.
+ *
+ * \param img source image in any pixel format, converted to grey values
+ * \param grid glyph layout
+ * \param threshold grey values above this threshold are set bits
+ * \return glyphs in tile order, tile_width * tile_height per tile
+ * \throw std::invalid_argument if the grid is empty or does not fit into the image
+ */
+std::vector<GlyphWord> extract_glyphs(const ImageBuffer &img, const GlyphGrid &grid, std::uint8_t threshold);
+
+/**
+ * \brief Write the remap table of a deduplicated charset.
+ *
+ * \param remap glyph index for every position of the sheet
+ * \param wide write two bytes (little-endian) per entry
+ */
+void write_remap(const std::vector<unsigned> &remap, bool wide, std::ostream &out);
+
+// ── character mode ────────────────────────────────────────────────────────────
+
+/**
+ * \brief A converted character mode screen.
+ */
+struct CharScreen {
+  int background = 0;                  ///< Background colour ($d021)
+  std::vector<GlyphWord> charset;      ///< Character set
+  std::array<std::uint8_t, CHARMODE_COLS * CHARMODE_ROWS> screen{}; ///< Screen RAM
+  std::array<std::uint8_t, CHARMODE_COLS * CHARMODE_ROWS> colour{}; ///< Colour RAM
+  unsigned unique = 0;                 ///< Distinct glyphs before merging
+  unsigned long changed = 0;           ///< Pixels changed by merging glyphs
+  unsigned worst = 0;                  ///< Most pixels changed in one cell
+};
+
+/**
+ * \brief Distances of all pixels to all palette colours.
+ *
+ * \param rgb interleaved 8-bit RGB pixels
+ * \param palette palette to match against
+ * \return NCOLORS squared distances per pixel
+ */
+std::vector<std::array<double, NCOLORS> > distance_table(const std::vector<std::uint8_t> &rgb, const C64Palette &palette);
+
+/**
+ * \brief Convert distances of a 320×200 image into a charmode screen.
+ *
+ * Every pixel votes for its nearest palette colour. The most frequent
+ * colour becomes the background (unless \p background is given), the
+ * most frequent other colour of a cell becomes the cell's foreground. A
+ * pixel is set if it is closer to the foreground than to the background.
+ * Identical glyphs are merged exactly; if more than \p max_chars remain,
+ * near-identical glyphs are merged by cluster_glyphs().
+ *
+ * \param dist distance table as returned by distance_table()
+ * \param background fixed background colour, chosen automatically if empty
+ * \param max_chars maximum size of the character set
+ * \return converted screen
+ */
+CharScreen convert_charmode(const std::vector<std::array<double, NCOLORS> > &dist, std::optional<int> background, unsigned max_chars);
+
+/**
+ * \brief Convert the top-left 320×200 pixels of an image into a charmode screen.
+ *
+ * \throw std::invalid_argument if the image is smaller than 320×200
+ */
+CharScreen convert_charmode(const ImageBuffer &img, const C64Palette &palette, std::optional<int> background, unsigned max_chars);
+
+#endif
@@ -1,8 +1,10 @@
 #include "petsciiframes.hh"
+#include "runstats.hh"
 #include <limits>
 #include <cassert>
 
 std::vector<std::optional<std::pair<unsigned, unsigned>>> compare_frames(const Frame &prev, const Frame &next) {
+  const StageTimer timer(Stage::diff);
   std::vector<std::optional<std::pair<unsigned, unsigned>>> ret;
 
   for(unsigned row = 0; row < HEIGHT; ++row) {
@@ -0,0 +1,373 @@
+#include "convcache.hh"
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+namespace {
+
+namespace fs = std::filesystem;
+
+/// FNV-1a 128-bit offset basis.
+constexpr unsigned __int128 FNV_OFFSET = (static_cast<unsigned __int128>(0x6c62272e07bb0142ull) << 64) | 0x62b821756295c58dull;
+/// FNV-1a 128-bit prime (2^88 + 2^8 + 0x3b).
+constexpr unsigned __int128 FNV_PRIME = (static_cast<unsigned __int128>(1) << 88) | 0x13bu;
+
+/// First bytes of an entry file; the last byte is the format version.
+constexpr std::string_view ENTRY_MAGIC{ "C64GFXC\x01", 8 };
+/// Extension of entry files.
+constexpr std::string_view ENTRY_EXT = ".entry";
+/// Name of the counter file in the cache directory.
+constexpr std::string_view STATS_FILE = "stats";
+
+/// Read a whole file, nothing if it cannot be opened.
+std::optional<std::string> read_file(const fs::path &path) {
+  std::ifstream in(path, std::ios::binary);
+  if(!in) {
+    return std::nullopt;
+  }
+  return std::string(std::istreambuf_iterator<char>(in), {});
+}
+
+void put_u64(std::string &out, std::uint64_t value) {
+  for(unsigned i = 0; i < 8; ++i) {
+    out.push_back(static_cast<char>(value >> (8 * i)));
+  }
+}
+
+void put_string(std::string &out, std::string_view text) {
+  put_u64(out, text.size());
+  out += text;
+}
+
+/**
+ * \brief Reads the fields of an entry file, throws on truncated data.
+ */
+struct EntryReader {
+  std::string_view data;
+
+  std::uint64_t u64() {
+    if(data.size() < 8) {
+      throw std::runtime_error("truncated cache entry");
+    }
+    std::uint64_t ret = 0;
+    for(unsigned i = 0; i < 8; ++i) {
+      ret |= std::uint64_t{ static_cast<unsigned char>(data[i]) } << (8 * i);
+    }
+    data.remove_prefix(8);
+    return ret;
+  }
+  std::string string() {
+    const std::uint64_t size = u64();
+    if(data.size() < size) {
+      throw std::runtime_error("truncated cache entry");
+    }
+    std::string ret(data.substr(0, size));
+    data.remove_prefix(size);
+    return ret;
+  }
+};
+
+std::string serialise(const CacheEntry &entry) {
+  std::string ret(ENTRY_MAGIC);
+  put_u64(ret, static_cast<std::uint32_t>(entry.status));
+  put_string(ret, entry.out);
+  put_u64(ret, entry.files.size());
+  for(const CachedFile &file : entry.files) {
+    put_string(ret, file.path);
+    put_string(ret, file.data);
+  }
+  return ret;
+}
+
+CacheEntry deserialise(std::string_view data) {
+  if(!data.starts_with(ENTRY_MAGIC)) {
+    throw std::runtime_error("not a cache entry");
+  }
+  EntryReader reader{ data.substr(ENTRY_MAGIC.size()) };
+  CacheEntry ret;
+  ret.status = static_cast<int>(static_cast<std::uint32_t>(reader.u64()));
+  ret.out = reader.string();
+  const std::uint64_t count = reader.u64();
+  for(std::uint64_t i = 0; i < count; ++i) {
+    CachedFile file;
+    file.path = reader.string();
+    file.data = reader.string();
+    ret.files.push_back(std::move(file));
+  }
+  if(!reader.data.empty()) {
+    throw std::runtime_error("trailing data in cache entry");
+  }
+  return ret;
+}
+
+/**
+ * \brief The counter file, locked for the lifetime of the object.
+ */
+class LockedCounters {
+  int fd;
+
+public:
+  explicit LockedCounters(const fs::path &path) : fd(::open(path.c_str(), O_RDWR | O_CREAT, 0644)) {
+    if(fd >= 0) {
+      ::flock(fd, LOCK_EX);
+    }
+  }
+  ~LockedCounters() {
+    if(fd >= 0) {
+      ::close(fd); // Also releases the lock.
+    }
+  }
+  LockedCounters(const LockedCounters &) = delete;
+  LockedCounters &operator=(const LockedCounters &) = delete;
+
+  /// Hits, misses and bytes saved; zero for a new or unreadable file.
+  [[nodiscard]] std::array<std::uint64_t, 3> read() const {
+    std::array<std::uint64_t, 3> ret{};
+    char buf[128] = {};
+    if(fd >= 0 && ::pread(fd, buf, sizeof buf - 1, 0) > 0) {
+      std::istringstream in(buf);
+      in >> ret[0] >> ret[1] >> ret[2];
+      if(!in) {
+        ret = {};
+      }
+    }
+    return ret;
+  }
+  void write(const std::array<std::uint64_t, 3> &values) const {
+    if(fd < 0) {
+      return;
+    }
+    const std::string text = std::format("{} {} {}\n", values[0], values[1], values[2]);
+    if(::pwrite(fd, text.data(), text.size(), 0) == static_cast<ssize_t>(text.size())) {
+      [[maybe_unused]] const int ret = ::ftruncate(fd, static_cast<off_t>(text.size()));
+    }
+  }
+};
+
+} // namespace
+
+// ── CacheKey ──────────────────────────────────────────────────────────────────
+
+void CacheKey::hash_bytes(const void *data, std::size_t size) {
+  const auto *p = static_cast<const unsigned char *>(data);
+  for(std::size_t i = 0; i < size; ++i) {
+    state = (state ^ p[i]) * FNV_PRIME;
+  }
+}
+
+CacheKey::CacheKey(std::string_view tool) : state(FNV_OFFSET) {
+  add(tool);
+  add(SUITE_VERSION);
+}
+
+CacheKey &CacheKey::add(std::string_view text) {
+  return add(std::span(reinterpret_cast<const std::uint8_t *>(text.data()), text.size()));
+}
+
+CacheKey &CacheKey::add(std::span<const std::uint8_t> data) {
+  const std::uint64_t size = data.size();
+  hash_bytes(&size, sizeof size);
+  hash_bytes(data.data(), data.size());
+  return *this;
+}
+
+CacheKey &CacheKey::add_file(const std::string &path) {
+  const auto data = read_file(path);
+  if(!data) {
+    throw std::runtime_error(std::format("cannot read '{}'", path));
+  }
+  return add(std::string_view(*data));
+}
+
+std::string CacheKey::hex() const {
+  return std::format("{:016x}{:016x}", static_cast<std::uint64_t>(state >> 64), static_cast<std::uint64_t>(state));
+}
+
+// ── CacheEntry ────────────────────────────────────────────────────────────────
+
+void CacheEntry::add_file(const std::string &path) {
+  auto data = read_file(path);
+  if(!data) {
+    throw std::runtime_error(std::format("cannot read '{}'", path));
+  }
+  files.push_back({ path, std::move(*data) });
+}
+
+std::uintmax_t CacheEntry::bytes() const {
+  std::uintmax_t ret = out.size();
+  for(const CachedFile &file : files) {
+    ret += file.data.size();
+  }
+  return ret;
+}
+
+void CacheEntry::restore(std::ostream &stream) const {
+  for(const CachedFile &file : files) {
+    std::ofstream outfile(file.path, std::ios::binary);
+    if(!outfile.write(file.data.data(), static_cast<std::streamsize>(file.data.size()))) {
+      throw std::runtime_error(std::format("cannot write '{}'", file.path));
+    }
+  }
+  stream << out << std::flush;
+}
+
+// ── ConversionCache ───────────────────────────────────────────────────────────
+
+std::string format_cache_stats(const CacheStats &stats) {
+  return std::format("Cache: {} hits, {} misses ({:.1f}% hit rate), {} bytes saved, "
+                     "{} entries, {:.1f} of {:.1f} MiB\n",
+                     stats.hits, stats.misses, stats.hit_rate(), stats.bytes_saved, stats.entries,
+                     stats.size / 1048576.0, stats.limit / 1048576.0);
+}
+
+ConversionCache::ConversionCache(const fs::path &directory, unsigned limit_mib)
+  : dir(directory), limit(std::uintmax_t{ limit_mib } << 20) {
+  std::error_code ec;
+  fs::create_directories(dir, ec);
+  if(!fs::is_directory(dir)) {
+    throw std::runtime_error(std::format("cannot create cache directory '{}'", dir.string()));
+  }
+}
+
+fs::path ConversionCache::entry_path(const CacheKey &key) const {
+  return dir / (key.hex() + std::string(ENTRY_EXT));
+}
+
+void ConversionCache::count(std::uint64_t hits, std::uint64_t misses, std::uint64_t bytes_saved) const {
+  const LockedCounters counters(dir / STATS_FILE);
+  auto values = counters.read();
+  values[0] += hits;
+  values[1] += misses;
+  values[2] += bytes_saved;
+  counters.write(values);
+}
+
+std::optional<CacheEntry> ConversionCache::lookup(const CacheKey &key) const {
+  const fs::path path = entry_path(key);
+  if(const auto data = read_file(path)) {
+    try {
+      CacheEntry entry = deserialise(*data);
+      std::error_code ec;
+      fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+      count(1, 0, entry.bytes());
+      return entry;
+    } catch(const std::runtime_error &) {
+      std::error_code ec;
+      fs::remove(path, ec);
+    }
+  }
+  count(0, 1, 0);
+  return std::nullopt;
+}
+
+void ConversionCache::store(const CacheKey &key, const CacheEntry &entry) const {
+  const std::string data = serialise(entry);
+  if(data.size() > limit) {
+    return;
+  }
+  const fs::path path = entry_path(key);
+  fs::path tmp = path;
+  tmp += std::format(".{}.tmp", ::getpid());
+  {
+    std::ofstream out(tmp, std::ios::binary);
+    if(!out.write(data.data(), static_cast<std::streamsize>(data.size())) || !out.flush()) {
+      std::error_code ec;
+      fs::remove(tmp, ec);
+      return;
+    }
+  }
+  std::error_code ec;
+  fs::rename(tmp, path, ec);
+  if(ec) {
+    fs::remove(tmp, ec);
+    return;
+  }
+  evict();
+}
+
+void ConversionCache::evict() const {
+  struct Item {
+    fs::file_time_type time;
+    std::uintmax_t size;
+    fs::path path;
+  };
+  std::vector<Item> items;
+  std::uintmax_t total = 0;
+  std::error_code ec;
+  for(const auto &dirent : fs::directory_iterator(dir, ec)) {
+    if(dirent.path().extension() != ENTRY_EXT) {
+      continue;
+    }
+    std::error_code ec2;
+    const auto size = dirent.file_size(ec2);
+    const auto time = dirent.last_write_time(ec2);
+    if(!ec2) {
+      items.push_back({ time, size, dirent.path() });
+      total += size;
+    }
+  }
+  if(total <= limit) {
+    return;
+  }
+  std::sort(items.begin(), items.end(), [](const Item &a, const Item &b) { return a.time < b.time; });
+  for(const Item &item : items) {
+    if(total <= limit) {
+      break;
+    }
+    fs::remove(item.path, ec);
+    total -= item.size;
+  }
+}
+
+CacheStats ConversionCache::stats() const {
+  CacheStats ret;
+  {
+    const LockedCounters counters(dir / STATS_FILE);
+    const auto values = counters.read();
+    ret.hits = values[0];
+    ret.misses = values[1];
+    ret.bytes_saved = values[2];
+  }
+  std::error_code ec;
+  for(const auto &dirent : fs::directory_iterator(dir, ec)) {
+    if(dirent.path().extension() == ENTRY_EXT) {
+      std::error_code ec2;
+      const auto size = dirent.file_size(ec2);
+      if(!ec2) {
+        ++ret.entries;
+        ret.size += size;
+      }
+    }
+  }
+  ret.limit = limit;
+  return ret;
+}
+
+// ── StreamCapture ─────────────────────────────────────────────────────────────
+
+StreamCapture::StreamCapture(std::ostream &target) : stream(target), saved(target.rdbuf(buffer.rdbuf())) {}
+
+StreamCapture::~StreamCapture() {
+  if(active) {
+    release();
+  }
+}
+
+std::string StreamCapture::release() {
+  stream.rdbuf(saved);
+  active = false;
+  std::string text = buffer.str();
+  stream << text << std::flush;
+  return text;
+}
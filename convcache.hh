@@ -0,0 +1,188 @@
+#ifndef __CONVCACHE_HH_2026__
+#define __CONVCACHE_HH_2026__
+/*! \file convcache.hh
+ *  \brief Content-addressed cache of converter results.
+ *
+ * A conversion is identified by a CacheKey: a 128-bit hash of the tool
+ * name, the suite version, the effective options and the bytes of all
+ * input files. The outputs of a conversion (files written, text written
+ * to stdout and the exit status) are stored as one CacheEntry in the
+ * cache directory, in a file named after the key. A later run with the
+ * same key restores the stored outputs instead of converting again.
+ *
+ * The directory is bounded in size: after storing an entry the least
+ * recently used entries are removed until the directory fits. Hits
+ * refresh the modification time of an entry, which serves as the
+ * access time. Several processes can share one directory; entries are
+ * written to a temporary file and renamed, the hit/miss counters are
+ * updated under a file lock.
+ */
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// Default size limit of a cache directory in MiB.
+inline constexpr unsigned DEFAULT_CACHE_MIB = 256;
+
+// ── keys ──────────────────────────────────────────────────────────────────────
+
+/**
+ * \brief Incremental 128-bit FNV-1a hash identifying a conversion.
+ *
+ * Every part is hashed together with its length, so that the boundary
+ * between two parts cannot be moved without changing the key.
+ */
+class CacheKey {
+  unsigned __int128 state;
+
+  void hash_bytes(const void *data, std::size_t size);
+
+public:
+  /// Start a key for \p tool; the suite version is included as well.
+  explicit CacheKey(std::string_view tool);
+
+  /// Add text, e.g. the options or a file name.
+  CacheKey &add(std::string_view text);
+  /// Add binary data.
+  CacheKey &add(std::span<const std::uint8_t> data);
+  /**
+   * \brief Add the contents of a file.
+   * \throw std::runtime_error if the file cannot be read
+   */
+  CacheKey &add_file(const std::string &path);
+
+  /// The key as 32 hex digits.
+  [[nodiscard]] std::string hex() const;
+};
+
+// ── entries ───────────────────────────────────────────────────────────────────
+
+/// One output file of a conversion.
+struct CachedFile {
+  std::string path; ///< Path as written by the converter
+  std::string data; ///< File contents
+};
+
+/**
+ * \brief All outputs of one conversion.
+ */
+struct CacheEntry {
+  int status = 0;                ///< Exit status of the converter
+  std::string out;               ///< Text written to stdout
+  std::vector<CachedFile> files; ///< Files written
+
+  /**
+   * \brief Read a file written by the converter into the entry.
+   * \throw std::runtime_error if the file cannot be read
+   */
+  void add_file(const std::string &path);
+
+  /// Number of output bytes (stdout and files).
+  [[nodiscard]] std::uintmax_t bytes() const;
+
+  /**
+   * \brief Write the files again and the stdout text to \p out.
+   * \throw std::runtime_error if a file cannot be written
+   */
+  void restore(std::ostream &out) const;
+};
+
+// ── cache directory ───────────────────────────────────────────────────────────
+
+/**
+ * \brief Counters of a cache directory.
+ *
+ * Hits, misses and bytes saved are accumulated over all runs using the
+ * directory. Bytes saved are the output bytes restored from the cache
+ * instead of being converted again.
+ */
+struct CacheStats {
+  std::uint64_t hits = 0;        ///< Lookups answered from the cache
+  std::uint64_t misses = 0;      ///< Lookups which had to convert
+  std::uint64_t bytes_saved = 0; ///< Output bytes restored by hits
+  std::uint64_t entries = 0;     ///< Entries in the directory
+  std::uintmax_t size = 0;       ///< Size of all entries in bytes
+  std::uintmax_t limit = 0;      ///< Size limit in bytes
+
+  /// Hits in percent of all lookups.
+  [[nodiscard]] double hit_rate() const {
+    return hits + misses == 0 ? 0.0 : 100.0 * hits / (hits + misses);
+  }
+};
+
+/// One line summarising \p stats, for --cache-stats.
+std::string format_cache_stats(const CacheStats &stats);
+
+/**
+ * \brief A cache directory with LRU eviction.
+ */
+class ConversionCache {
+  std::filesystem::path dir;
+  std::uintmax_t limit;
+
+  [[nodiscard]] std::filesystem::path entry_path(const CacheKey &key) const;
+  void count(std::uint64_t hits, std::uint64_t misses, std::uint64_t bytes_saved) const;
+  void evict() const;
+
+public:
+  /**
+   * \brief Open (and create) a cache directory.
+   *
+   * \param directory cache directory
+   * \param limit_mib size limit of all entries in MiB
+   * \throw std::runtime_error if the directory cannot be created
+   */
+  ConversionCache(const std::filesystem::path &directory, unsigned limit_mib = DEFAULT_CACHE_MIB);
+
+  /**
+   * \brief Look up a conversion and count the hit or miss.
+   *
+   * Unreadable or damaged entries are removed and count as a miss.
+   *
+   * \return the stored outputs, or nothing on a miss
+   */
+  std::optional<CacheEntry> lookup(const CacheKey &key) const;
+
+  /**
+   * \brief Store the outputs of a conversion and evict old entries.
+   *
+   * Entries larger than the size limit are not stored. Errors while
+   * writing are ignored, the cache is only an optimisation.
+   */
+  void store(const CacheKey &key, const CacheEntry &entry) const;
+
+  /// Counters and current size of the directory.
+  [[nodiscard]] CacheStats stats() const;
+};
+
+// ── stdout capture ────────────────────────────────────────────────────────────
+
+/**
+ * \brief Collect everything written to a stream, to store it in a CacheEntry.
+ *
+ * The text is passed on to the stream when the capture ends, so the
+ * output of the converter is unchanged, only delayed.
+ */
+class StreamCapture {
+  std::ostream &stream;
+  std::streambuf *saved;
+  std::ostringstream buffer;
+  bool active = true;
+
+public:
+  explicit StreamCapture(std::ostream &target);
+  ~StreamCapture();
+  StreamCapture(const StreamCapture &) = delete;
+  StreamCapture &operator=(const StreamCapture &) = delete;
+
+  /// End the capture, pass the text on and return it.
+  std::string release();
+};
+
+#endif
@@ -0,0 +1,140 @@
+#include "glyph.hh"
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define POPCNT_CLONES __attribute__((target_clones("popcnt", "default")))
+#else
+#define POPCNT_CLONES
+#endif
+
+GlyphWord pack_glyph(const std::uint8_t *pixels, std::size_t stride, std::uint8_t threshold) {
+  GlyphWord ret = 0;
+  for(unsigned y = 0; y < 8; ++y) {
+    const std::uint8_t *row = pixels + y * stride;
+    for(unsigned x = 0; x < 8; ++x) {
+      ret = (ret << 1) | (row[x] > threshold ? 1u : 0u);
+    }
+  }
+  return ret;
+}
+
+void write_charset(const std::vector<GlyphWord> &glyphs, std::ostream &out) {
+  for(GlyphWord g : glyphs) {
+    for(std::uint8_t byte : glyph_bytes(g)) {
+      out.put(static_cast<char>(byte));
+    }
+  }
+}
+
+POPCNT_CLONES
+unsigned nearest_glyph(const GlyphWord *glyphs, std::size_t count, GlyphWord mask) {
+  unsigned best = 0;
+  unsigned best_dist = std::numeric_limits<unsigned>::max();
+  for(std::size_t i = 0; i < count; ++i) {
+    if(const unsigned d = static_cast<unsigned>(std::popcount(mask ^ glyphs[i])); d < best_dist) {
+      best = static_cast<unsigned>(i);
+      best_dist = d;
+    }
+  }
+  return best;
+}
+
+GlyphDedup deduplicate_glyphs(const std::vector<GlyphWord> &glyphs) {
+  GlyphDedup ret;
+  std::unordered_map<GlyphWord, unsigned> seen;
+
+  seen.reserve(glyphs.size());
+  ret.remap.reserve(glyphs.size());
+  for(GlyphWord g : glyphs) {
+    auto [it, inserted] = seen.emplace(g, static_cast<unsigned>(ret.unique.size()));
+    if(inserted) {
+      ret.unique.push_back(g);
+    }
+    ret.remap.push_back(it->second);
+  }
+  return ret;
+}
+
+GlyphClusters cluster_glyphs(const std::vector<GlyphWord> &glyphs, const std::vector<unsigned> &weights,
+                             unsigned k, unsigned max_iterations) {
+  const std::size_t n = glyphs.size();
+  GlyphClusters ret;
+
+  if(n <= k) {
+    ret.medoids = glyphs;
+    for(unsigned i = 0; i < n; ++i) {
+      ret.assignment.push_back(i);
+    }
+    return ret;
+  }
+  // Farthest-first seeding, weighted by the number of occurrences.
+  std::vector<std::size_t> medoids;
+  std::vector<unsigned> nearest(n, std::numeric_limits<unsigned>::max());
+  medoids.push_back(std::distance(weights.begin(), std::max_element(weights.begin(), weights.end())));
+  while(medoids.size() < k) {
+    const GlyphWord last = glyphs[medoids.back()];
+    std::size_t best = 0;
+    unsigned long best_score = 0;
+    for(std::size_t i = 0; i < n; ++i) {
+      nearest[i] = std::min(nearest[i], glyph_distance(glyphs[i], last));
+      const unsigned long score = static_cast<unsigned long>(nearest[i]) * weights[i];
+      if(score > best_score) {
+        best = i;
+        best_score = score;
+      }
+    }
+    if(best_score == 0) {
+      break; // Every glyph is already a medoid.
+    }
+    medoids.push_back(best);
+  }
+
+  ret.assignment.assign(n, 0);
+  std::vector<std::vector<std::size_t> > members(medoids.size());
+  auto cluster_cost = [&](std::size_t candidate, const std::vector<std::size_t> &cluster) {
+    unsigned long cost = 0;
+    for(std::size_t other : cluster) {
+      cost += static_cast<unsigned long>(glyph_distance(glyphs[candidate], glyphs[other])) * weights[other];
+    }
+    return cost;
+  };
+  for(unsigned iteration = 0; iteration < max_iterations; ++iteration) {
+    for(auto &m : members) {
+      m.clear();
+    }
+    for(std::size_t i = 0; i < n; ++i) {
+      unsigned best_dist = std::numeric_limits<unsigned>::max();
+      for(unsigned m = 0; m < medoids.size(); ++m) {
+        if(const unsigned d = glyph_distance(glyphs[i], glyphs[medoids[m]]); d < best_dist) {
+          best_dist = d;
+          ret.assignment[i] = m;
+        }
+      }
+      members[ret.assignment[i]].push_back(i);
+    }
+    if(iteration + 1 == max_iterations) {
+      break; // Keep the assignment consistent with the medoids.
+    }
+    bool changed = false;
+    for(unsigned m = 0; m < medoids.size(); ++m) {
+      // The current medoid wins ties, so the iteration terminates.
+      unsigned long best_cost = cluster_cost(medoids[m], members[m]);
+      for(std::size_t candidate : members[m]) {
+        if(const unsigned long cost = cluster_cost(candidate, members[m]); cost < best_cost) {
+          best_cost = cost;
+          medoids[m] = candidate;
+          changed = true;
+        }
+      }
+    }
+    if(!changed) {
+      break;
+    }
+  }
+  for(std::size_t m : medoids) {
+    ret.medoids.push_back(glyphs[m]);
+  }
+  return ret;
+}
@@ -0,0 +1,116 @@
+#ifndef __GLYPH_HH_2026__
+#define __GLYPH_HH_2026__
+/*! \file glyph.hh
+ *  \brief 8×8 character glyphs packed into 64-bit words.
+ *
+ * A glyph is stored as a \c GlyphWord: row 0 lives in the most
+ * significant byte, and within a byte the leftmost pixel is the most
+ * significant bit. This is exactly the byte order of a C64 character
+ * set, so a glyph can be written out with glyph_bytes().
+ *
+ * Keeping a glyph in a single machine word makes equality tests,
+ * hashing and Hamming distances (one XOR plus one popcount) cheap.
+ */
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+/// One 8×8 glyph, row 0 in the most significant byte.
+using GlyphWord = std::uint64_t;
+
+/*! \brief Pack an 8×8 area of 8-bit grey pixels into a glyph.
+ *
+ * \param pixels pointer to the top-left pixel of the area
+ * \param stride distance in bytes between two pixel rows
+ * \param threshold pixels brighter than this value are set bits
+ * \return packed glyph
+ */
+GlyphWord pack_glyph(const std::uint8_t *pixels, std::size_t stride, std::uint8_t threshold);
+
+/*! \brief Unpack a glyph into the eight bytes of a C64 character. */
+[[nodiscard]] inline std::array<std::uint8_t, 8> glyph_bytes(GlyphWord glyph) noexcept {
+  std::array<std::uint8_t, 8> ret;
+  for(unsigned row = 0; row < 8; ++row) {
+    ret[row] = static_cast<std::uint8_t>(glyph >> (56 - 8 * row));
+  }
+  return ret;
+}
+
+/*! \brief Build a glyph from the eight bytes of a C64 character. */
+[[nodiscard]] inline GlyphWord glyph_from_bytes(const std::uint8_t *bytes) noexcept {
+  GlyphWord ret = 0;
+  for(unsigned row = 0; row < 8; ++row) {
+    ret = (ret << 8) | bytes[row];
+  }
+  return ret;
+}
+
+/*! \brief Write glyphs as a C64 character set, 8 bytes per glyph. */
+void write_charset(const std::vector<GlyphWord> &glyphs, std::ostream &out);
+
+/*! \brief Number of differing pixels between two glyphs. */
+[[nodiscard]] inline unsigned glyph_distance(GlyphWord a, GlyphWord b) noexcept {
+  return static_cast<unsigned>(std::popcount(a ^ b));
+}
+
+/*! \brief Index of the glyph with the smallest Hamming distance.
+ *
+ * On x86-64 a popcnt variant is selected at load time when the CPU
+ * supports it, which is about three times faster than the generic
+ * bit counting fallback.
+ *
+ * \param glyphs candidate glyphs
+ * \param count number of candidates (at least one)
+ * \param mask glyph to match
+ * \return index of the first best candidate
+ */
+unsigned nearest_glyph(const GlyphWord *glyphs, std::size_t count, GlyphWord mask);
+
+/*! \brief Result of a duplicate elimination.
+ *
+ * \c unique holds every distinct glyph in order of first occurrence,
+ * \c remap holds for every input glyph the index into \c unique.
+ */
+struct GlyphDedup {
+  std::vector<GlyphWord> unique;
+  std::vector<unsigned> remap;
+};
+
+/*! \brief Remove duplicate glyphs.
+ *
+ * \param glyphs input glyphs
+ * \return unique glyphs and the remap table
+ */
+GlyphDedup deduplicate_glyphs(const std::vector<GlyphWord> &glyphs);
+
+/*! \brief Result of a glyph clustering.
+ *
+ * \c medoids holds the representative glyphs (each one is an input
+ * glyph), \c assignment holds for every input glyph the index of its
+ * medoid.
+ */
+struct GlyphClusters {
+  std::vector<GlyphWord> medoids;
+  std::vector<unsigned> assignment;
+};
+
+/*! \brief Reduce a set of glyphs to at most \p k representatives.
+ *
+ * k-medoids clustering on the Hamming distance. The medoids are seeded
+ * farthest-first starting with the most frequent glyph, then assignment
+ * and medoid update alternate until the medoids are stable or
+ * \p max_iterations is reached. The result is deterministic.
+ *
+ * \param glyphs distinct input glyphs
+ * \param weights number of occurrences of every glyph
+ * \param k maximum number of medoids
+ * \param max_iterations upper bound for the refinement iterations
+ * \return medoids and assignment
+ */
+GlyphClusters cluster_glyphs(const std::vector<GlyphWord> &glyphs, const std::vector<unsigned> &weights,
+                             unsigned k, unsigned max_iterations = 32);
+
+#endif
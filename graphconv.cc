@@ -2,15 +2,38 @@
  * \file graphconv.cc
  * \brief Convert an image to a Commodore 64 hires bitmap format.
  *
- * Loads an image (via ImageMagick/Magick++), crops it to 320×200 pixels,
+ * Loads an image (see imageload.hh), crops it to 320×200 pixels,
  * quantises every 8×8 pixel block to the two best-matching C64 palette
  * colours, and writes the result as a raw C64 bitmap file (.c64).
  * Optionally the quantised image can also be saved as ILBM and/or XPM.
+ * The conversion itself is convert_hires() from libc64gfx (hires.hh).
  *
- * Two quantisation modes are available (selectable at runtime):
- * - Default: nearest-colour snap per pixel, block colour pair chosen by
- *   exhaustive error minimisation.
- * - Stucki: block-constrained Stucki error diffusion for smoother output.
+ * The colour pair of every block is chosen by exhaustive error
+ * minimisation. By default every pixel then gets the nearest of the two
+ * colours; --dither selects a dithering engine instead, constrained to
+ * the pair (selectable at runtime):
+ * - stucki, floyd-steinberg, atkinson: error diffusion;
+ * - bayer4, bayer8, blue-noise: ordered dithering, parallel in --jobs
+ *   threads.
+ * --stucki is short for --dither stucki. With an error diffusion,
+ * --refine PASSES chooses the colour pairs again for the pixels plus the
+ * diffused error, up to PASSES times per block row.
+ *
+ * --integer converts with the 8-bit values of the pixels, integer
+ * distances and a 16-bit error buffer instead of double precision. It
+ * decides the pixels like the default pipeline, but a colour pair can
+ * differ where two pairs fit nearly equally well.
+ *
+ * With --fli the colour pair changes every line (AFLI) or every second
+ * line of a block and the result is written as an AFLI file (.afl):
+ * eight screen RAMs at $4000 followed by the bitmap at $6000. The
+ * colour pair search runs in --jobs threads.
+ *
+ * --optimise-pairs TOLERANCE chooses the colour pairs of all blocks
+ * together, accepting up to TOLERANCE more error per block for fewer
+ * changes of the screen RAM byte, which crunches better. --pair-report
+ * prints the error and the run-length encoded size for a range of
+ * tolerances to help choosing one.
  *
  * Multiple C64 palettes are available via --palette:
  * - grafx2   : Grafx2 default (original palette in this tool)
@@ -19,582 +42,55 @@
  * - vice     : VICE emulator default palette
  * - ccs64    : CCS64 emulator palette
  *
- * Build dependencies: Magick++, CLI11
+ * The palettes themselves live in c64palette.hh.
+ *
+ * With --cache-dir (or $C64GFX_CACHE_DIR) the outputs are stored in a
+ * content-addressed cache (see convcache.hh) keyed on the input image
+ * and the options; an unchanged input is then restored from the cache
+ * instead of being converted again.
+ *
+ * --stats prints the time spent loading, cropping, quantising or
+ * dithering and writing on stderr (see runstats.hh).
+ *
+ * Build dependencies: libc64gfx, libpng, Magick++, CLI11
  * Requires: C++23 (-std=c++23)
  */
 
+#include "c64palette.hh"
 #include "change_ending.hh"
+#include "convcache.hh"
+#include "hires.hh"
+#include "imageload.hh"
+#include "runstats.hh"
 #include <CLI/CLI.hpp>
 #include <Magick++.h>
-#include <array>
-#include <cassert>
-#include <cmath>
+#include <algorithm>
 #include <format>
 #include <fstream>
 #include <iostream>
-#include <limits>
-#include <list>
-#include <map>
-#include <ranges>
-#include <stdexcept>
+#include <optional>
 #include <string>
+#include <thread>
 #include <vector>
 
-// ── compile-time constants
-// ────────────────────────────────────────────────────
-
-inline constexpr unsigned IMG_W = 320; ///< C64 hires bitmap width in pixels
-inline constexpr unsigned IMG_H = 200; ///< C64 hires bitmap height in pixels
-inline constexpr unsigned BLK = 8; ///< Character block side length in pixels
-inline constexpr int NCOLORS = 16; ///< Number of C64 palette entries
-
-// ── C64 palette definitions
-// ───────────────────────────────────────────────────
-
-/**
- * \brief Symbolic names for the 16 C64 palette entries.
- *
- * The ordering matches the hardware colour register numbers 0–15.
- */
-enum class C64Color : int {
-  Black = 0,
-  White,
-  Red,
-  Cyan,
-  Purple,
-  Green,
-  Blue,
-  Yellow,
-  Orange,
-  Brown,
-  LightRed,
-  DarkGrey,
-  Grey,
-  LightGreen,
-  LightBlue,
-  LightGrey
-};
-
-/// Type alias: a full 16-entry palette in normalised RGB (0.0–1.0).
-using C64Palette = std::array<std::array<double, 3>, NCOLORS>;
-
-/**
- * \brief Grafx2 palette (original palette shipped with this tool).
- *
- * Values taken from the Grafx2 palette definition file c64vic20.pal.
- */
-constexpr C64Palette palette_grafx2{ {
-  { { 0.000000e+00, 0.000000e+00, 0.000000e+00 } }, ///<  0 Black
-  { { 1.000000e+00, 1.000000e+00, 1.000000e+00 } }, ///<  1 White
-  { { 4.078431e-01, 2.156863e-01, 1.686275e-01 } }, ///<  2 Red
-  { { 4.392157e-01, 6.431373e-01, 6.980392e-01 } }, ///<  3 Cyan
-  { { 4.352941e-01, 2.392157e-01, 5.254902e-01 } }, ///<  4 Purple
-  { { 3.450980e-01, 5.529412e-01, 2.627451e-01 } }, ///<  5 Green
-  { { 2.078431e-01, 1.568627e-01, 4.745098e-01 } }, ///<  6 Blue
-  { { 7.215686e-01, 7.803922e-01, 4.352941e-01 } }, ///<  7 Yellow
-  { { 4.352941e-01, 3.098039e-01, 1.450980e-01 } }, ///<  8 Orange
-  { { 2.627451e-01, 2.235294e-01, 0.000000e+00 } }, ///<  9 Brown
-  { { 6.039216e-01, 4.039216e-01, 3.490196e-01 } }, ///< 10 LightRed
-  { { 2.666667e-01, 2.666667e-01, 2.666667e-01 } }, ///< 11 DarkGrey
-  { { 4.235294e-01, 4.235294e-01, 4.235294e-01 } }, ///< 12 Grey
-  { { 6.039216e-01, 8.235294e-01, 5.176471e-01 } }, ///< 13 LightGreen
-  { { 4.235294e-01, 3.686275e-01, 7.098039e-01 } }, ///< 14 LightBlue
-  { { 5.843137e-01, 5.843137e-01, 5.843137e-01 } }, ///< 15 LightGrey
-} };
-
-/**
- * \brief Pepto palette by Phillip Timmermann.
- *
- * Mathematically derived from the C64's VIC-II colour generation circuit.
- * Reference: https://www.pepto.de/projects/colorvic/
- * RGB values (sRGB, 8-bit): normalised to [0,1] here.
- *
- *  0 Black      #000000    8 Orange     #8D3105
- *  1 White      #FFFFFF    9 Brown      #5B4100
- *  2 Red        #68372B   10 LightRed   #9A6759
- *  3 Cyan       #70A4B2   11 DarkGrey   #444444
- *  4 Purple     #6F3D86   12 Grey       #6C6C6C
- *  5 Green      #588D43   13 LightGreen #9AD284
- *  6 Blue       #352879   14 LightBlue  #6C5EB5
- *  7 Yellow     #B8C76F   15 LightGrey  #959595
- */
-constexpr C64Palette palette_pepto{ {
-  { { 0x00 / 255.0, 0x00 / 255.0, 0x00 / 255.0 } }, ///<  0 Black
-  { { 0xFF / 255.0, 0xFF / 255.0, 0xFF / 255.0 } }, ///<  1 White
-  { { 0x68 / 255.0, 0x37 / 255.0, 0x2B / 255.0 } }, ///<  2 Red
-  { { 0x70 / 255.0, 0xA4 / 255.0, 0xB2 / 255.0 } }, ///<  3 Cyan
-  { { 0x6F / 255.0, 0x3D / 255.0, 0x86 / 255.0 } }, ///<  4 Purple
-  { { 0x58 / 255.0, 0x8D / 255.0, 0x43 / 255.0 } }, ///<  5 Green
-  { { 0x35 / 255.0, 0x28 / 255.0, 0x79 / 255.0 } }, ///<  6 Blue
-  { { 0xB8 / 255.0, 0xC7 / 255.0, 0x6F / 255.0 } }, ///<  7 Yellow
-  { { 0x8D / 255.0, 0x31 / 255.0, 0x05 / 255.0 } }, ///<  8 Orange
-  { { 0x5B / 255.0, 0x41 / 255.0, 0x00 / 255.0 } }, ///<  9 Brown
-  { { 0x9A / 255.0, 0x67 / 255.0, 0x59 / 255.0 } }, ///< 10 LightRed
-  { { 0x44 / 255.0, 0x44 / 255.0, 0x44 / 255.0 } }, ///< 11 DarkGrey
-  { { 0x6C / 255.0, 0x6C / 255.0, 0x6C / 255.0 } }, ///< 12 Grey
-  { { 0x9A / 255.0, 0xD2 / 255.0, 0x84 / 255.0 } }, ///< 13 LightGreen
-  { { 0x6C / 255.0, 0x5E / 255.0, 0xB5 / 255.0 } }, ///< 14 LightBlue
-  { { 0x95 / 255.0, 0x95 / 255.0, 0x95 / 255.0 } }, ///< 15 LightGrey
-} };
-
-/**
- * \brief Colodore palette by Paolo Paglianti.
- *
- * Perceptually optimised palette derived from extensive measurement.
- * Reference: https://www.colodore.com/
- * RGB values (sRGB, 8-bit): normalised to [0,1] here.
- *
- *  0 Black      #000000    8 Orange     #8E3620
- *  1 White      #FFFFFF    9 Brown      #604000
- *  2 Red        #6D3B37   10 LightRed   #9A6758
- *  3 Cyan       #6EB6CC   11 DarkGrey   #444444
- *  4 Purple     #703778   12 Grey       #6C6C6C
- *  5 Green      #56892E   13 LightGreen #96D862
- *  6 Blue       #2F2EA6   14 LightBlue  #6C5ACA
- *  7 Yellow     #BBBA6E   15 LightGrey  #959595
- */
-constexpr C64Palette palette_colodore{ {
-  { { 0x00 / 255.0, 0x00 / 255.0, 0x00 / 255.0 } }, ///<  0 Black
-  { { 0xFF / 255.0, 0xFF / 255.0, 0xFF / 255.0 } }, ///<  1 White
-  { { 0x6D / 255.0, 0x3B / 255.0, 0x37 / 255.0 } }, ///<  2 Red
-  { { 0x6E / 255.0, 0xB6 / 255.0, 0xCC / 255.0 } }, ///<  3 Cyan
-  { { 0x70 / 255.0, 0x37 / 255.0, 0x78 / 255.0 } }, ///<  4 Purple
-  { { 0x56 / 255.0, 0x89 / 255.0, 0x2E / 255.0 } }, ///<  5 Green
-  { { 0x2F / 255.0, 0x2E / 255.0, 0xA6 / 255.0 } }, ///<  6 Blue
-  { { 0xBB / 255.0, 0xBA / 255.0, 0x6E / 255.0 } }, ///<  7 Yellow
-  { { 0x8E / 255.0, 0x36 / 255.0, 0x20 / 255.0 } }, ///<  8 Orange
-  { { 0x60 / 255.0, 0x40 / 255.0, 0x00 / 255.0 } }, ///<  9 Brown
-  { { 0x9A / 255.0, 0x67 / 255.0, 0x58 / 255.0 } }, ///< 10 LightRed
-  { { 0x44 / 255.0, 0x44 / 255.0, 0x44 / 255.0 } }, ///< 11 DarkGrey
-  { { 0x6C / 255.0, 0x6C / 255.0, 0x6C / 255.0 } }, ///< 12 Grey
-  { { 0x96 / 255.0, 0xD8 / 255.0, 0x62 / 255.0 } }, ///< 13 LightGreen
-  { { 0x6C / 255.0, 0x5A / 255.0, 0xCA / 255.0 } }, ///< 14 LightBlue
-  { { 0x95 / 255.0, 0x95 / 255.0, 0x95 / 255.0 } }, ///< 15 LightGrey
-} };
-
-/**
- * \brief VICE emulator default palette.
- *
- * The palette used by VICE 3.x as its built-in default (c64hq palette).
- * Reference: VICE source tree data/C64/vice.vpl
- * RGB values (sRGB, 8-bit): normalised to [0,1] here.
- *
- *  0 Black      #000000    8 Orange     #8D4616
- *  1 White      #FFFFFF    9 Brown      #654100
- *  2 Red        #8D2020   10 LightRed   #C06060
- *  3 Cyan       #4DB4C7   11 DarkGrey   #404040
- *  4 Purple     #813079   12 Grey       #707070
- *  5 Green      #4D9051   13 LightGreen #82D37E
- *  6 Blue       #2B2B8D   14 LightBlue  #6060C0
- *  7 Yellow     #BDBD6D   15 LightGrey  #A0A0A0
- */
-constexpr C64Palette palette_vice{ {
-  { { 0x00 / 255.0, 0x00 / 255.0, 0x00 / 255.0 } }, ///<  0 Black
-  { { 0xFF / 255.0, 0xFF / 255.0, 0xFF / 255.0 } }, ///<  1 White
-  { { 0x8D / 255.0, 0x20 / 255.0, 0x20 / 255.0 } }, ///<  2 Red
-  { { 0x4D / 255.0, 0xB4 / 255.0, 0xC7 / 255.0 } }, ///<  3 Cyan
-  { { 0x81 / 255.0, 0x30 / 255.0, 0x79 / 255.0 } }, ///<  4 Purple
-  { { 0x4D / 255.0, 0x90 / 255.0, 0x51 / 255.0 } }, ///<  5 Green
-  { { 0x2B / 255.0, 0x2B / 255.0, 0x8D / 255.0 } }, ///<  6 Blue
-  { { 0xBD / 255.0, 0xBD / 255.0, 0x6D / 255.0 } }, ///<  7 Yellow
-  { { 0x8D / 255.0, 0x46 / 255.0, 0x16 / 255.0 } }, ///<  8 Orange
-  { { 0x65 / 255.0, 0x41 / 255.0, 0x00 / 255.0 } }, ///<  9 Brown
-  { { 0xC0 / 255.0, 0x60 / 255.0, 0x60 / 255.0 } }, ///< 10 LightRed
-  { { 0x40 / 255.0, 0x40 / 255.0, 0x40 / 255.0 } }, ///< 11 DarkGrey
-  { { 0x70 / 255.0, 0x70 / 255.0, 0x70 / 255.0 } }, ///< 12 Grey
-  { { 0x82 / 255.0, 0xD3 / 255.0, 0x7E / 255.0 } }, ///< 13 LightGreen
-  { { 0x60 / 255.0, 0x60 / 255.0, 0xC0 / 255.0 } }, ///< 14 LightBlue
-  { { 0xA0 / 255.0, 0xA0 / 255.0, 0xA0 / 255.0 } }, ///< 15 LightGrey
-} };
-
-/**
- * \brief CCS64 emulator palette.
- *
- * The palette used by Per Håkan Sundell's CCS64 emulator.
- * Reference: https://ccs64.com/ / community measurements
- * RGB values (sRGB, 8-bit): normalised to [0,1] here.
- *
- *  0 Black      #101010    8 Orange     #993300
- *  1 White      #FFFFFF    9 Brown      #663300
- *  2 Red        #993322   10 LightRed   #CC6655
- *  3 Cyan       #55CCDD   11 DarkGrey   #444444
- *  4 Purple     #882277   12 Grey       #777777
- *  5 Green      #33AA44   13 LightGreen #66DD55
- *  6 Blue       #2233BB   14 LightBlue  #5566EE
- *  7 Yellow     #CCDD55   15 LightGrey  #AAAAAA
- */
-constexpr C64Palette palette_ccs64{ {
-  { { 0x10 / 255.0, 0x10 / 255.0, 0x10 / 255.0 } }, ///<  0 Black
-  { { 0xFF / 255.0, 0xFF / 255.0, 0xFF / 255.0 } }, ///<  1 White
-  { { 0x99 / 255.0, 0x33 / 255.0, 0x22 / 255.0 } }, ///<  2 Red
-  { { 0x55 / 255.0, 0xCC / 255.0, 0xDD / 255.0 } }, ///<  3 Cyan
-  { { 0x88 / 255.0, 0x22 / 255.0, 0x77 / 255.0 } }, ///<  4 Purple
-  { { 0x33 / 255.0, 0xAA / 255.0, 0x44 / 255.0 } }, ///<  5 Green
-  { { 0x22 / 255.0, 0x33 / 255.0, 0xBB / 255.0 } }, ///<  6 Blue
-  { { 0xCC / 255.0, 0xDD / 255.0, 0x55 / 255.0 } }, ///<  7 Yellow
-  { { 0x99 / 255.0, 0x33 / 255.0, 0x00 / 255.0 } }, ///<  8 Orange
-  { { 0x66 / 255.0, 0x33 / 255.0, 0x00 / 255.0 } }, ///<  9 Brown
-  { { 0xCC / 255.0, 0x66 / 255.0, 0x55 / 255.0 } }, ///< 10 LightRed
-  { { 0x44 / 255.0, 0x44 / 255.0, 0x44 / 255.0 } }, ///< 11 DarkGrey
-  { { 0x77 / 255.0, 0x77 / 255.0, 0x77 / 255.0 } }, ///< 12 Grey
-  { { 0x66 / 255.0, 0xDD / 255.0, 0x55 / 255.0 } }, ///< 13 LightGreen
-  { { 0x55 / 255.0, 0x66 / 255.0, 0xEE / 255.0 } }, ///< 14 LightBlue
-  { { 0xAA / 255.0, 0xAA / 255.0, 0xAA / 255.0 } }, ///< 15 LightGrey
-} };
-
-/// Registry: map palette name → pointer to palette data.
-/// Extend this map to add further palettes without changing any other code.
-const std::map<std::string, const C64Palette *> palette_registry{
-  { "grafx2", &palette_grafx2 }, { "pepto", &palette_pepto },
-  { "colodore", &palette_colodore }, { "vice", &palette_vice },
-  { "ccs64", &palette_ccs64 },
-};
-
-/// The active palette, set by main() from --palette; defaults to grafx2.
-const C64Palette *active_palette = &palette_grafx2;
-
-// ── data types
-// ────────────────────────────────────────────────────────────────
-
-/**
- * \brief One 8×8 character block with its two palette colours.
- *
- * \c idx1 and \c idx2 index into the active palette (0–15).
- * \c data holds 64 per-pixel colour decisions in row-major order:
- * \c false → colour \c idx1, \c true → colour \c idx2.
- */
-struct CharBlock {
-  int idx0, idx1;         ///< Palette indices for the bit-0 and bit-1 colours
-  std::vector<bool> data; ///< Per-pixel colour assignment (exactly 64 elements)
-
-  void swap_colours() {
-    std::swap(idx0, idx1);
-    // Here `auto &&` has to be used as a vector implements the
-    // specialisation for bool with proxy objects, a `bool &` will
-    // give an error.
-    for(auto &&b : data) {
-       b = !b;
-    }
-  }
-  bool all_equal() const {
-    /*
-     * Nice trick: identity just returns the first element given so if
-     * the first element is false, it returns false, if it is true it
-     * returns true. Then the algorithm can check if all other
-     * elements are the same.
-     */
-    return std::all_of(data.begin(), data.end(), std::identity());
-  }
-};
-
-// ── colour helpers
-// ────────────────────────────────────────────────────────────
-
-/// Construct a Magick++ colour for palette index \p idx using the active
-/// palette.
-[[nodiscard]] inline Magick::ColorRGB palette_color(int idx) noexcept {
-  const auto &c = (*active_palette)[idx];
-
-  return { c[0], c[1], c[2] };
-}
-
-/**
- * \brief Euclidean distance between two RGB colours in the [0,1]³ cube.
- */
-[[nodiscard]] double col_dist(const Magick::ColorRGB &a,
-                              const Magick::ColorRGB &b) noexcept {
-  return std::sqrt(std::pow(a.red() - b.red(), 2) +
-                   std::pow(a.green() - b.green(), 2) +
-                   std::pow(a.blue() - b.blue(), 2));
-}
-
-/**
- * \brief Index of the active palette entry closest to \p col.
- */
-[[nodiscard]] int nearest_color(const Magick::ColorRGB &col) noexcept {
-  auto idxs = std::views::iota(0, NCOLORS);
-
-  return *std::ranges::min_element(
-    idxs, {}, [&](int i) {
-    return col_dist(col, palette_color(i));
-  });
+/// Wrap an RGB image for display and writing with Magick++.
+Magick::Image magick_image(const ImageBuffer &rgb) {
+  return Magick::Image(rgb.width, rgb.height, "RGB", Magick::CharPixel, rgb.pixels.data());
 }
 
-// ── C64 binary output
-// ─────────────────────────────────────────────────────────
-
 /**
- * \brief Serialise a list of CharBlocks to a raw C64 bitmap stream.
- *
- * Output layout:
- *  - 2-byte little-endian load address
- *  - Bitmap section: 8 bytes per block, one bit per pixel,
- *    left-to-right / top-to-bottom (320×200÷8 = 8 000 bytes)
- *  - Colour attribute section: one byte per block,
- *    high nybble = idx1, low nybble = idx0 (40×25 = 1 000 bytes)
- */
-void write_char_blocks(const std::list<CharBlock> &blocks, std::ostream &out,
-                       unsigned short addr = 0x2000) {
-  CharBlock blk; // Used for assignment and handling the inversion.
-  std::list<char> colours; // Store the colour blocks here.
-
-  std::cerr << std::format("Writing {} blocks\n", blocks.size());
-  out << static_cast<char>(addr & 0xFF) << static_cast<char>(addr >> 8);
-  // For checking if last blocks colours are just swapped, this helps
-  // in compressing the image.
-  int last0 = -1;
-  int last1 = -1;
-  for(const CharBlock &blkiterator : blocks) {
-    assert(blk.data.size() == BLK * BLK);
-    
-    blk = blkiterator;
-    if(last0 == blk.idx1 && last1 == blk.idx0) {
-      blk.swap_colours();
-    }
-    if(blk.all_equal()) {
-      if(last0 == blk.idx1 || last1 == blk.idx0) {
-	blk.swap_colours();
-      }
-      // Now just set the colours to be equal to last blocks colours. Improves compression!
-      blk.idx0 = last0;
-      blk.idx1 = last1;
-    }
-    for(auto row : blk.data | std::views::chunk(BLK)) {
-      uint8_t byte = 0;
-      for(bool bit : row) {
-        byte = static_cast<uint8_t>((byte << 1) | (bit ? 1u : 0u));
-      }
-      out << static_cast<char>(byte);
-    }
-    last0 = blk.idx0;
-    last1 = blk.idx1;
-    colours.push_back(static_cast<char>((blk.idx1 << 4) | blk.idx0));
-  }
-
-  for(char col : colours) {
-    out << col;
-  }
-
-  constexpr unsigned gfx_bytes = IMG_W * IMG_H / BLK;
-  std::cerr << std::format("Gfx: ${:04X}-${:04X}\n", addr,
-                           addr + gfx_bytes - 1);
-  std::cerr << std::format("Col: ${:04X}-${:04X}\n", addr + gfx_bytes,
-                           addr + gfx_bytes + 40u * 25u);
-}
-
-// ── block quantisation helpers
-// ────────────────────────────────────────────────
-
-[[nodiscard]] double block_error(const Magick::Image &img, unsigned x_,
-                                 unsigned y_, int cidx0, int cidx1) noexcept {
-  assert(cidx0 < NCOLORS && cidx1 < NCOLORS);
-  const auto col0 = palette_color(cidx0);
-  const auto col1 = palette_color(cidx1);
-  double total = 0.0;
-  for(unsigned dy = 0; dy < BLK; ++dy) {
-    for(unsigned dx = 0; dx < BLK; ++dx) {
-      const Magick::ColorRGB col(img.pixelColor(x_ + dx, y_ + dy));
-      total += std::min(col_dist(col, col0), col_dist(col, col1));
-    }
-  }
-  return total;
-}
-
-[[nodiscard]] std::pair<std::vector<bool>, double>
-quantise_block(Magick::Image &img, unsigned x_, unsigned y_, int cidx0,
-               int cidx1, bool verbose) {
-  const auto col0 = palette_color(cidx0);
-  const auto col1 = palette_color(cidx1);
-  std::vector<bool> bitmap;
-
-  bitmap.reserve(BLK * BLK);
-  double total = 0.0;
-  for(unsigned dy = 0; dy < BLK; ++dy) {
-    for(unsigned dx = 0; dx < BLK; ++dx) {
-      const Magick::ColorRGB col(img.pixelColor(x_ + dx, y_ + dy));
-      const double c0dist = col_dist(col, col0);
-      const double c1dist = col_dist(col, col1);
-      const bool usefg = c1dist < c0dist;
-      if(verbose) {
-        std::cout << std::format("\t{} {} {:9.4e} {:9.4e} {}\n", dx, dy, c0dist, c1dist, usefg);
-      }
-      bitmap.push_back(usefg);
-      total += usefg ? c1dist : c0dist;
-      img.pixelColor(x_ + dx, y_ + dy, usefg ? col1 : col0);
-    }
-  }
-  return { std::move(bitmap), total };
-}
-
-// ── nearest-colour quantisation pass ─────────────────────────────────────────
-
-
-/*! \brief handle the image block wise
+ * \brief Print the error-versus-size trade-off of the pair optimisation.
  *
- * The blocks of 8*8 pixel are handled from left to right and top to
- * bottom. First the colours with the lowest error are selected for
- * foreground and background and then the block is quantised. A list
- * of blocks is returned.
- *
- * \param img the image to handle
- * \param verbose output some diagnostic information per block
+ * Converts \p img with a range of tolerances and \p opts otherwise.
  */
-[[nodiscard]] std::list<CharBlock> handle_block_wise(Magick::Image &img, bool verbose) {
-  std::list<CharBlock> blocks;
-
-  for(unsigned y = 0; y < img.rows(); y += BLK) {
-    for(unsigned x = 0; x < img.columns(); x += BLK) {
-      double best_err = std::numeric_limits<double>::infinity();
-      int best_i = 0, best_j = 1;
-      for(int i : std::views::iota(0, NCOLORS)) {
-        for(int j : std::views::iota(i + 1, NCOLORS)) {
-          if(const double e = block_error(img, x, y, i, j); e < best_err) {
-            std::tie(best_i, best_j, best_err) = std::tuple{ i, j, e };
-          }
-        }
-      }
-      auto [bitmap, err] = quantise_block(img, x, y, best_i, best_j, verbose);
-      if(verbose) {
-        std::cout << std::format("Block at X={:3d} Y={:3d} has colors {} and {}, error is {:13.6e}\n", x, y, best_i, best_j, err);
-        for(const auto &row : bitmap | std::views::chunk(BLK)) {
-          std::cout << '\t';
-          for(bool b : row) {
-            std::cout << (b ? '#' : '.') << ' ';
-          }
-          std::cout << '\n';
-        }
-      }
-      blocks.push_back({ best_i, best_j, std::move(bitmap) });
-    }
-  }
-  return blocks;
-}
-
-// ── Stucki dithering pass
-// ─────────────────────────────────────────────────────
-
-[[nodiscard]] std::list<CharBlock>
-handle_block_wise_stucki(Magick::Image &img) {
-  const unsigned W = img.columns();
-  const unsigned H = img.rows();
-
-  using KernelEntry = std::tuple<int, int, int>;
-  constexpr std::array<KernelEntry, 12> stucki_kernel{ {
-    { 1, 0, 8 },
-    { 2, 0, 4 },
-    { -2, 1, 2 },
-    { -1, 1, 4 },
-    { 0, 1, 8 },
-    { 1, 1, 4 },
-    { 2, 1, 2 },
-    { -2, 2, 1 },
-    { -1, 2, 2 },
-    { 0, 2, 4 },
-    { 1, 2, 2 },
-    { 2, 2, 1 },
-  } };
-  constexpr double STUCKI_DIV = 42.0;
-
-  std::vector<std::array<double, 3> > err(W * H, { 0.0, 0.0, 0.0 });
-
-  const unsigned BW = W / BLK;
-  const unsigned BH = H / BLK;
-  std::vector<std::pair<int, int> > block_colors(BW * BH);
-  for(unsigned by = 0; by < BH; ++by) {
-    for(unsigned bx = 0; bx < BW; ++bx) {
-      double best_err = std::numeric_limits<double>::infinity();
-      int best_i = 0, best_j = 1;
-      for(int i : std::views::iota(0, NCOLORS)) {
-        for(int j : std::views::iota(i + 1, NCOLORS)) {
-          if(const double e = block_error(img, bx * BLK, by * BLK, i, j);
-             e < best_err) {
-            std::tie(best_i, best_j, best_err) = std::tuple{ i, j, e };
-          }
-        }
-      }
-      ;
-      block_colors[by * BW + bx] = { best_i, best_j };
-    }
-  }
-
-  std::vector<std::vector<bool> > bitmaps(BW * BH,
-                                          std::vector<bool>(BLK * BLK, false));
-
-  for(unsigned y = 0; y < H; ++y) {
-    for(unsigned x = 0; x < W; ++x) {
-      const unsigned bx = x / BLK;
-      const unsigned by = y / BLK;
-      const auto [cidx0, cidx1] = block_colors[by * BW + bx];
-      const auto pal0 = palette_color(cidx0);
-      const auto pal1 = palette_color(cidx1);
-
-      const Magick::ColorRGB orig(img.pixelColor(x, y));
-      const auto &e = err[y * W + x];
-      const Magick::ColorRGB corrected(
-        std::clamp(orig.red() + e[0], 0.0, 1.0),
-        std::clamp(orig.green() + e[1], 0.0, 1.0),
-        std::clamp(orig.blue() + e[2], 0.0, 1.0));
-
-      const bool use1 = col_dist(corrected, pal1) < col_dist(corrected, pal0);
-      const Magick::ColorRGB &chosen = use1 ? pal1 : pal0;
-
-      bitmaps[by * BW + bx][(y % BLK) * BLK + (x % BLK)] = use1;
-      img.pixelColor(x, y, chosen);
-
-      const std::array<double, 3> qerr{
-        corrected.red() - chosen.red(),
-        corrected.green() - chosen.green(),
-        corrected.blue() - chosen.blue(),
-      };
-
-      for(const auto &[dx, dy, w] : stucki_kernel) {
-        const int nx = static_cast<int>(x) + dx;
-        const int ny = static_cast<int>(y) + dy;
-        if(nx < 0 || nx >= static_cast<int>(W) || ny < 0 ||
-           ny >= static_cast<int>(H)) {
-          continue;
-        }
-        const double weight = static_cast<double>(w) / STUCKI_DIV;
-        auto &ne = err[ny * W + nx];
-        ne[0] += qerr[0] * weight;
-        ne[1] += qerr[1] * weight;
-        ne[2] += qerr[2] * weight;
-      }
-    }
-  }
-
-  std::list<CharBlock> blocks;
-  for(unsigned by = 0; by < BH; ++by) {
-    for(unsigned bx = 0; bx < BW; ++bx) {
-      const auto [i, j] = block_colors[by * BW + bx];
-      blocks.push_back({ i, j, std::move(bitmaps[by * BW + bx]) });
-    }
-  }
-  return blocks;
-}
-
-// ── diagnostic helper
-// ─────────────────────────────────────────────────────────
-
-void handle_image(Magick::Image &img, unsigned x_, unsigned y_, unsigned width,
-                  unsigned height) {
-  img.type(Magick::TrueColorType);
-  const Magick::ColorRGB origin(img.pixelColor(0, 0));
-  std::cout << std::format("{} {} {}\n", origin.red(), origin.green(),
-                           origin.blue());
-  for(int i = 0; i < NCOLORS; ++i) {
-    const auto pc = palette_color(i);
-    const double d = col_dist(origin, pc);
-    std::cout << std::format("{:02X} {:13.6e} {:13.6e} {:13.6e} {:13.6E}\n", i,
-                             std::abs(origin.red() - pc.red()),
-                             std::abs(origin.green() - pc.green()),
-                             std::abs(origin.blue() - pc.blue()), d);
-  }
-  for(unsigned dy = 0; dy < height; ++dy) {
-    for(unsigned dx = 0; dx < width; ++dx) {
-      Magick::ColorRGB col(img.pixelColor(x_ + dx, y_ + dy));
-      img.pixelColor(x_ + dx, y_ + dy, palette_color(nearest_color(col)));
-    }
+void print_pair_report(const ImageBuffer &img, HiresOptions opts, std::ostream &out) {
+  opts.verbose = nullptr;
+  out << std::format("{:>9} {:>10} {:>8} {:>7} {:>7}\n", "tolerance", "error", "changes", "packed", "ratio");
+  for(const double tolerance : { 0.0, 0.01, 0.02, 0.05, 0.1, 0.2, 0.5 }) {
+    opts.pair_tolerance = tolerance;
+    const HiresMeasure m = measure_hires(img, convert_hires(img, opts));
+    out << std::format("{:>9.2f} {:>10.1f} {:>8} {:>7} {:>6.1f}%\n", tolerance, m.error, m.colour_changes,
+                       m.packed_size, 100.0 * m.packed_size / m.raw_size);
   }
 }
 
@@ -618,8 +114,20 @@ int main(int argc, char **argv) {
   bool write_xpm = false;
   bool display_gfx = false;
   bool use_stucki = false;
+  std::string dither_name = "none";
+  unsigned refine_passes = 0;
+  bool integer = false;
   bool verbose = false;
   std::string palette_name = "grafx2";
+  unsigned fli_lines = 0;
+  unsigned jobs = std::max(1u, std::thread::hardware_concurrency());
+  double pair_tolerance = 0;
+  unsigned pair_candidates = 8;
+  bool pair_report = false;
+  std::optional<std::string> cache_dir;
+  unsigned cache_size = DEFAULT_CACHE_MIB;
+  bool cache_stats = false;
+  std::string stats_format;
 
   app.add_option("file", input_file, "Input image file to convert")
   ->required()
@@ -631,24 +139,52 @@ int main(int argc, char **argv) {
                "Also save the quantised image as XPM");
   app.add_flag("--display", display_gfx,
                "Display the image before and after conversion");
-  app.add_flag("--stucki", use_stucki,
-               "Use block-constrained Stucki error diffusion instead of "
-               "nearest-colour quantisation (smoother output, slower)");
+  auto *stucki_opt = app.add_flag("--stucki", use_stucki,
+                                  "Use block-constrained Stucki error diffusion instead of "
+                                  "nearest-colour quantisation (same as --dither stucki)");
+  app.add_option("--dither", dither_name,
+                 std::format("Dithering within the block colours (default: none).\n"
+                             "Available: {}",
+                             dither_names()))
+  ->check([](const std::string &val) -> std::string {
+    if(dither_registry.count(val) == 0) {
+      return std::format("unknown dithering '{}'. "
+                         "Run with --help for a list of valid names.",
+                         val);
+    }
+    return {};
+  })
+  ->excludes(stucki_opt);
+  auto *refine_opt = app.add_option("--refine", refine_passes,
+                 "Choose the colour pairs again for the diffused error, up to this many passes per block row (e.g. 3)")
+  ->check(CLI::Range(0u, 16u));
+  app.add_flag("--integer", integer, "Convert with 8-bit pixels and integer arithmetic instead of doubles")
+  ->excludes(refine_opt);
+  auto *fli_opt = app.add_option("--fli", fli_lines,
+                 "FLI mode: a colour pair per LINES pixel rows of a block "
+                 "(1 = AFLI, 2), written as .afl file with eight screen RAMs")
+  ->check(CLI::IsMember({ 1u, 2u }));
+  auto *optimise_opt = app.add_option("--optimise-pairs", pair_tolerance,
+                                      "Choose the colour pairs for fewer screen RAM changes, accepting up to "
+                                      "this much more error per block (e.g. 0.05 for 5%)")
+  ->check(CLI::Range(0.0, 10.0))
+  ->excludes(fli_opt)
+  ->excludes(refine_opt);
+  app.add_option("--pair-candidates", pair_candidates,
+                 "Best colour pairs per block considered by --optimise-pairs (default 8)")
+  ->check(CLI::Range(1u, 120u))
+  ->needs(optimise_opt);
+  app.add_flag("--pair-report", pair_report,
+               "Print error, screen RAM changes and packed size for several tolerances on stderr")
+  ->excludes(fli_opt)
+  ->configurable(false);
   app.add_flag("--verbose", verbose,
                "Output verbose information while processing the image");
 
-  // Build a human-readable list of palette names for the help text.
-  std::string palette_list;
-  for(const auto &[name, _] : palette_registry) {
-    if(!palette_list.empty()) {
-      palette_list += ", ";
-    }
-    palette_list += name;
-  }
   app.add_option("--palette", palette_name,
                  std::format("C64 colour palette to use (default: grafx2).\n"
                              "Available palettes: {}",
-                             palette_list))
+                             palette_names()))
   ->check([](const std::string &val) -> std::string {
     if(palette_registry.count(val) == 0) {
       return std::format("unknown palette '{}'. "
@@ -658,42 +194,143 @@ int main(int argc, char **argv) {
     return {};
   });
 
-  CLI11_PARSE(app, argc, argv);
-
-  // Activate the selected palette (global pointer used by palette_color()).
-  active_palette = palette_registry.at(palette_name);
-  std::cerr << std::format("Using palette: {}\n", palette_name);
-
-  Magick::Image img(input_file);
-  img.crop(Magick::Geometry(IMG_W, IMG_H, 0, 0));
+  // The cache options do not change the result and stay out of the cache key.
+  app.add_option("--cache-dir", cache_dir,
+                 "Reuse the results of earlier runs stored in this directory")
+  ->envname("C64GFX_CACHE_DIR")
+  ->configurable(false);
+  app.add_option("--cache-size", cache_size,
+                 std::format("Size limit of the cache directory in MiB (default {})", DEFAULT_CACHE_MIB))
+  ->check(CLI::Range(1u, 1u << 20))
+  ->configurable(false);
+  app.add_flag("--cache-stats", cache_stats, "Print hit rate and bytes saved by the cache")
+  ->configurable(false);
+  app.add_option("--jobs,-j", jobs, "Number of threads searching the colour pairs")
+  ->check(CLI::Range(1u, 256u))
+  ->configurable(false);
+  app.add_flag("--stats{table}", stats_format,
+               "Print the time per stage, counters and memory use on stderr "
+               "(--stats=json for one line of JSON)")
+  ->check(CLI::IsMember({ "table", "json" }))
+  ->configurable(false);
+
+  // Whether the dithering is an error diffusion is only known after parsing.
+  app.callback([&] {
+    const Dither dither = use_stucki ? Dither::stucki : dither_registry.at(dither_name);
+    if(refine_passes > 0 && !is_error_diffusion(dither)) {
+      throw CLI::ValidationError("--refine", "needs an error diffusion (--stucki or --dither stucki, "
+                                             "floyd-steinberg or atkinson)");
+    }
+  });
 
-  if(img.columns() < IMG_W || img.rows() < IMG_H) {
-    throw std::invalid_argument(
-            std::format("wrong picture size ({}x{})", img.columns(), img.rows()));
+  CLI11_PARSE(app, argc, argv);
+  const StatsReport report("graphconv", stats_format, std::cerr);
+
+  // The display is interactive, so it always converts.
+  std::optional<ConversionCache> cache;
+  std::optional<CacheKey> key;
+  // The cache is only an optimisation: on any error it is left out.
+  if(cache_dir && !display_gfx && !pair_report) {
+    try {
+      cache.emplace(*cache_dir, cache_size);
+      key.emplace("graphconv");
+      key->add(app.config_to_str()).add(input_file).add_file(input_file);
+      if(const auto hit = cache->lookup(*key)) {
+        hit->restore(std::cout);
+        std::cerr << std::format("Restored {} from the cache\n", change_ending(input_file, fli_lines != 0 ? "afl" : "c64"));
+        if(cache_stats) {
+          std::cerr << format_cache_stats(cache->stats());
+        }
+        return hit->status;
+      }
+    } catch(const std::exception &e) {
+      std::cerr << std::format("Warning: cache not used: {}\n", e.what());
+      cache.reset();
+    }
+  }
+  std::optional<StreamCapture> captured;
+  if(cache) {
+    captured.emplace(std::cout);
   }
 
-  img.type(Magick::TrueColorType);
+  HiresOptions opts;
+  opts.palette = palette_registry.at(palette_name);
+  opts.dither = use_stucki ? Dither::stucki : dither_registry.at(dither_name);
+  opts.verbose = verbose ? &std::cout : nullptr;
+  opts.fli_lines = fli_lines;
+  opts.jobs = jobs;
+  opts.pair_tolerance = pair_tolerance;
+  opts.pair_candidates = pair_candidates;
+  opts.refine_passes = refine_passes;
+  opts.integer = integer;
+  std::cerr << std::format("Using palette: {}\n", palette_name);
 
+  const ImageBuffer img = load_image(input_file);
   if(display_gfx) {
-    img.display();
+    magick_image(to_rgb(img)).display();
   }
 
-  const std::list<CharBlock> blocks =
-    use_stucki ? handle_block_wise_stucki(img) : handle_block_wise(img, verbose);
+  const HiresBitmap result = convert_hires(img, opts);
+  if(pair_report) {
+    print_pair_report(img, opts, std::cerr);
+  }
+  Magick::Image quantised = magick_image(result.image);
 
+  std::vector<std::string> written;
   if(write_ilbm) {
-    img.write(change_ending(input_file, "ilbm"));
+    const StageTimer timer(Stage::write);
+    written.push_back(change_ending(input_file, "ilbm"));
+    quantised.write(written.back());
   }
   if(write_xpm) {
-    img.write(change_ending(input_file, "xpm"));
+    const StageTimer timer(Stage::write);
+    written.push_back(change_ending(input_file, "xpm"));
+    quantised.write(written.back());
   }
 
-  std::ofstream outfile(change_ending(input_file, "c64"), std::ios::binary);
-  write_char_blocks(blocks, outfile);
+  constexpr unsigned gfx_bytes = HIRES_W * HIRES_H / 8;
+  std::cerr << std::format("Writing {} blocks\n", result.blocks.size());
+  if(fli_lines != 0) {
+    const unsigned short addr = 0x4000;
+    written.push_back(change_ending(input_file, "afl"));
+    {
+      std::ofstream outfile(written.back(), std::ios::binary);
+      write_fli_blocks(result.blocks, outfile, addr);
+    }
+    std::cerr << std::format("Scr: ${:04X}-${:04X}\n", addr, addr + 0x2000 - 1);
+    std::cerr << std::format("Gfx: ${:04X}-${:04X}\n", addr + 0x2000,
+                             addr + 0x2000 + gfx_bytes - 1);
+  } else {
+    const unsigned short addr = 0x2000;
+    written.push_back(change_ending(input_file, "c64"));
+    {
+      std::ofstream outfile(written.back(), std::ios::binary);
+      write_char_blocks(result.blocks, outfile, addr);
+    }
+    std::cerr << std::format("Gfx: ${:04X}-${:04X}\n", addr,
+                             addr + gfx_bytes - 1);
+    std::cerr << std::format("Col: ${:04X}-${:04X}\n", addr + gfx_bytes,
+                             addr + gfx_bytes + 40u * 25u);
+  }
 
   if(display_gfx) {
-    img.display();
+    quantised.display();
   }
 
+  if(cache) {
+    try {
+      CacheEntry entry;
+      entry.out = captured->release();
+      for(const auto &path : written) {
+        entry.add_file(path);
+      }
+      cache->store(*key, entry);
+      if(cache_stats) {
+        std::cerr << format_cache_stats(cache->stats());
+      }
+    } catch(const std::exception &e) {
+      std::cerr << std::format("Warning: result not cached: {}\n", e.what());
+    }
+  }
   return 0;
 }
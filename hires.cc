@@ -0,0 +1,1374 @@
+#include "hires.hh"
+#include "hires_internal.hh"
+#include "runstats.hh"
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <format>
+#include <iterator>
+#include <limits>
+#include <ranges>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+
+namespace hires_internal {
+
+// ── distance table
+// ────────────────────────────────────────────────────────────
+
+/// Call \p fn with every row in [0, \p rows), distributed over \p jobs threads.
+template <typename Fn> void parallel_rows(unsigned rows, unsigned jobs, const Fn &fn) {
+  std::atomic<unsigned> next{ 0 };
+  auto worker = [&]() {
+    for(unsigned row = next++; row < rows; row = next++) {
+      fn(row);
+    }
+  };
+  std::vector<std::thread> pool;
+  for(unsigned j = 1; j < std::min(jobs, rows); ++j) {
+    pool.emplace_back(worker);
+  }
+  worker();
+  for(auto &t : pool) {
+    t.join();
+  }
+}
+
+[[nodiscard]] DistanceTable distance_table(const Canvas &img, const C64Palette &palette, unsigned jobs) {
+  DistanceTable ret(img.width, img.height);
+  parallel_rows(img.height, jobs, [&](unsigned y) {
+    for(int c = 0; c < NCOLORS; ++c) {
+      double *dist = ret.row(c, 0, y);
+      for(unsigned x = 0; x < img.width; ++x) {
+        dist[x] = col_dist(img.at(x, y), palette[c]);
+      }
+    }
+  });
+  return ret;
+}
+
+// ── block quantisation helpers
+// ────────────────────────────────────────────────
+
+/// The colour pair with the smallest block_error() for the strip at \p x, \p y.
+template <typename T>
+[[nodiscard]] std::pair<int, int> best_pair(const BasicDistanceTable<T> &table, unsigned x, unsigned y,
+                                            unsigned lines) noexcept {
+  double best_err = std::numeric_limits<double>::infinity();
+  int best_i = 0, best_j = 1;
+  for(int i : std::views::iota(0, NCOLORS)) {
+    for(int j : std::views::iota(i + 1, NCOLORS)) {
+      if(const double e = block_error(table, x, y, lines, i, j, best_err); e < best_err) {
+        std::tie(best_i, best_j, best_err) = std::tuple{ i, j, e };
+      }
+    }
+  }
+  return { best_i, best_j };
+}
+
+/**
+ * \brief The best colour pair of every strip of \p lines pixel rows.
+ *
+ * \param table distances of the canvas
+ * \param lines height of the strips, BLK for whole blocks
+ * \param jobs threads searching the rows of strips
+ * \return pairs left to right and top to bottom, (height / lines) × (width / BLK)
+ */
+template <typename T>
+[[nodiscard]] std::vector<std::pair<int, int> > strip_pairs(const BasicDistanceTable<T> &table, unsigned lines,
+                                                           unsigned jobs) {
+  const unsigned BW = table.width / BLK;
+  const unsigned rows = table.height / lines;
+  std::vector<std::pair<int, int> > ret(rows * BW);
+  parallel_rows(rows, jobs, [&](unsigned row) {
+    for(unsigned bx = 0; bx < BW; ++bx) {
+      ret[row * BW + bx] = best_pair(table, bx * BLK, row * lines, lines);
+    }
+  });
+  return ret;
+}
+
+// ── colour pair optimisation
+// ──────────────────────────────────────────────
+
+/// A colour pair of a block and its block_error().
+struct PairCandidate {
+  int idx0, idx1;
+  double error;
+};
+
+/**
+ * \brief The best \p count pairs of the strip at \p x, \p y within \p tolerance.
+ *
+ * \return pairs by increasing error, the first one being the best_pair();
+ *         only pairs whose error exceeds the best by at most the factor
+ *         1 + \p tolerance are kept
+ */
+template <typename T>
+[[nodiscard]] std::vector<PairCandidate> pair_candidates(const BasicDistanceTable<T> &table, unsigned x, unsigned y,
+                                                         unsigned lines, double tolerance, unsigned count) {
+  // The best n pairs so far, sorted. The worst of them and the tolerance
+  // over the best bound block_error(). The vector is not grown in the loop,
+  // which keeps the loop tight.
+  std::vector<PairCandidate> ret(count);
+  unsigned n = 0;
+  double best = std::numeric_limits<double>::infinity();
+  for(int i : std::views::iota(0, NCOLORS)) {
+    for(int j : std::views::iota(i + 1, NCOLORS)) {
+      const double limit = best * (1.0 + tolerance);
+      const double bound = n < count ? limit : std::min(limit, ret[n - 1].error);
+      const double e = block_error(table, x, y, lines, i, j, bound);
+      if(e >= bound) {
+        continue;
+      }
+      best = std::min(best, e);
+      // Behind the pairs with the same error, they come first in the order of the search.
+      unsigned k = n < count ? n++ : n - 1;
+      for(; k > 0 && ret[k - 1].error > e; --k) {
+        ret[k] = ret[k - 1];
+      }
+      ret[k] = { i, j, e };
+    }
+  }
+  ret.resize(n);
+  const double limit = best * (1.0 + tolerance);
+  std::erase_if(ret, [limit](const PairCandidate &c) { return c.error > limit; });
+  return ret;
+}
+
+/**
+ * \brief Choose the block colours for the fewest changes of the screen RAM byte.
+ *
+ * The blocks are taken in the order of the file, left to right and row
+ * by row, and every block may use one of its pair_candidates(). Dynamic
+ * programming over this sequence finds the choice with the fewest
+ * changes from one block's pair to the next and, among those, the
+ * smallest total error. The cost is O(blocks × count²).
+ *
+ * \param table distances of the canvas
+ * \param pairs greedy pairs of the blocks, replaced by the chosen ones
+ * \param tolerance accepted relative error increase per block
+ * \param count candidates per block
+ * \param jobs threads computing the candidates
+ * \return number of changes of the colour pair in the result
+ */
+template <typename T>
+unsigned optimise_pairs(const BasicDistanceTable<T> &table, std::vector<std::pair<int, int> > &pairs, double tolerance,
+                        unsigned count, unsigned jobs) {
+  const unsigned BW = table.width / BLK;
+  const auto blocks = static_cast<unsigned>(pairs.size());
+  std::vector<std::vector<PairCandidate> > candidates(blocks);
+  parallel_rows(blocks / BW, jobs, [&](unsigned by) {
+    for(unsigned bx = 0; bx < BW; ++bx) {
+      candidates[by * BW + bx] = pair_candidates(table, bx * BLK, by * BLK, BLK, tolerance, count);
+    }
+  });
+
+  /// Best path ending in a candidate: changes first, then error.
+  struct Path {
+    unsigned changes = std::numeric_limits<unsigned>::max();
+    double error = std::numeric_limits<double>::infinity();
+    unsigned from = 0; ///< Candidate of the previous block
+  };
+  auto shorter = [](const Path &a, const Path &b) { return std::tie(a.changes, a.error) < std::tie(b.changes, b.error); };
+
+  std::vector<std::vector<Path> > paths(blocks);
+  for(const PairCandidate &c : candidates[0]) {
+    paths[0].push_back({ 0, c.error, 0 });
+  }
+  for(unsigned i = 1; i < blocks; ++i) {
+    for(const PairCandidate &c : candidates[i]) {
+      Path best;
+      for(unsigned p = 0; p < candidates[i - 1].size(); ++p) {
+        const PairCandidate &prev = candidates[i - 1][p];
+        const bool change = prev.idx0 != c.idx0 || prev.idx1 != c.idx1;
+        const Path path{ paths[i - 1][p].changes + (change ? 1u : 0u), paths[i - 1][p].error + c.error, p };
+        if(shorter(path, best)) {
+          best = path;
+        }
+      }
+      paths[i].push_back(best);
+    }
+  }
+
+  auto last = std::ranges::min_element(paths[blocks - 1], shorter);
+  const unsigned changes = last->changes;
+  auto choice = static_cast<unsigned>(std::distance(paths[blocks - 1].begin(), last));
+  for(unsigned i = blocks; i-- > 0;) {
+    const PairCandidate &c = candidates[i][choice];
+    pairs[i] = { c.idx0, c.idx1 };
+    choice = paths[i][choice].from;
+  }
+  return changes;
+}
+
+/// The colour pairs of all strips, optimised if requested (hires only).
+template <typename T>
+[[nodiscard]] std::vector<std::pair<int, int> > search_pairs(const BasicDistanceTable<T> &table,
+                                                            const PairSearch &search) {
+  auto pairs = strip_pairs(table, search.lines, search.jobs);
+  if(search.tolerance > 0 && search.lines == BLK) {
+    count_stat("pair changes", optimise_pairs(table, pairs, search.tolerance, search.candidates, search.jobs));
+  }
+  return pairs;
+}
+
+[[nodiscard]] std::pair<std::vector<bool>, double>
+quantise_block(Canvas &img, const C64Palette &palette, unsigned x_, unsigned y_, int cidx0,
+               int cidx1, std::ostream *verbose) {
+  const RGB col0 = palette[cidx0];
+  const RGB col1 = palette[cidx1];
+  std::vector<bool> bitmap;
+
+  bitmap.reserve(BLK * BLK);
+  double total = 0.0;
+  for(unsigned dy = 0; dy < BLK; ++dy) {
+    for(unsigned dx = 0; dx < BLK; ++dx) {
+      RGB &col = img.at(x_ + dx, y_ + dy);
+      const double c0dist = col_dist(col, col0);
+      const double c1dist = col_dist(col, col1);
+      const bool usefg = c1dist < c0dist;
+      if(verbose) {
+        *verbose << std::format("\t{} {} {:9.4e} {:9.4e} {}\n", dx, dy, c0dist, c1dist, usefg);
+      }
+      bitmap.push_back(usefg);
+      total += usefg ? c1dist : c0dist;
+      col = usefg ? col1 : col0;
+    }
+  }
+  return { std::move(bitmap), total };
+}
+
+// ── nearest-colour quantisation pass ─────────────────────────────────────────
+
+
+/*! \brief handle the image block wise
+ *
+ * The blocks of 8*8 pixel are handled from left to right and top to
+ * bottom. First the colours with the lowest error are selected for
+ * foreground and background and then the block is quantised. A list
+ * of blocks is returned.
+ *
+ * \param img the image to handle
+ * \param palette palette to match against
+ * \param verbose receives some diagnostic information per block if set
+ * \param search threads and optimisation of the colour pair search
+ */
+[[nodiscard]] std::list<CharBlock> handle_block_wise(Canvas &img, const C64Palette &palette,
+                                                     std::ostream *verbose, const PairSearch &search) {
+  std::list<CharBlock> blocks;
+  const auto pairs = search_pairs(distance_table(img, palette, search.jobs), search);
+
+  for(unsigned y = 0; y < img.height; y += BLK) {
+    for(unsigned x = 0; x < img.width; x += BLK) {
+      const auto [best_i, best_j] = pairs[(y / BLK) * (img.width / BLK) + x / BLK];
+      auto [bitmap, err] = quantise_block(img, palette, x, y, best_i, best_j, verbose);
+      if(verbose) {
+        *verbose << std::format("Block at X={:3d} Y={:3d} has colors {} and {}, error is {:13.6e}\n", x, y, best_i, best_j, err);
+        for(const auto &row : bitmap | std::views::chunk(BLK)) {
+          *verbose << '\t';
+          for(bool b : row) {
+            *verbose << (b ? '#' : '.') << ' ';
+          }
+          *verbose << '\n';
+        }
+      }
+      blocks.push_back({ best_i, best_j, std::move(bitmap), {} });
+    }
+  }
+  return blocks;
+}
+
+/*! \brief handle the image strip wise for FLI
+ *
+ * Like handle_block_wise(), but every \p lines pixel rows of a block
+ * get their own colour pair.
+ *
+ * \param img the image to handle
+ * \param palette palette to match against
+ * \param search pixel rows per colour pair (1, 2 or 4) and threads
+ */
+[[nodiscard]] std::list<CharBlock> handle_strip_wise(Canvas &img, const C64Palette &palette,
+                                                     const PairSearch &search) {
+  const unsigned lines = search.lines;
+  const DistanceTable table = distance_table(img, palette, search.jobs);
+  const auto pairs = search_pairs(table, search);
+  const unsigned BW = img.width / BLK;
+  std::list<CharBlock> blocks;
+
+  for(unsigned y = 0; y < img.height; y += BLK) {
+    for(unsigned x = 0; x < img.width; x += BLK) {
+      CharBlock block;
+      block.data.reserve(BLK * BLK);
+      for(unsigned dy = 0; dy < BLK; ++dy) {
+        const auto [cidx0, cidx1] = pairs[(y + dy) / lines * BW + x / BLK];
+        block.line_colours.emplace_back(cidx0, cidx1);
+        const double *dist0 = table.row(cidx0, x, y + dy);
+        const double *dist1 = table.row(cidx1, x, y + dy);
+        for(unsigned dx = 0; dx < BLK; ++dx) {
+          const bool usefg = dist1[dx] < dist0[dx];
+          block.data.push_back(usefg);
+          img.at(x + dx, y + dy) = palette[usefg ? cidx1 : cidx0];
+        }
+      }
+      std::tie(block.idx0, block.idx1) = block.line_colours.front();
+      blocks.push_back(std::move(block));
+    }
+  }
+  return blocks;
+}
+
+// ── dithering passes
+// ──────────────────────────────────────────────────────────
+
+constexpr std::array<KernelEntry, 12> STUCKI_ENTRIES{ {
+  { 1, 0, 8 },
+  { 2, 0, 4 },
+  { -2, 1, 2 },
+  { -1, 1, 4 },
+  { 0, 1, 8 },
+  { 1, 1, 4 },
+  { 2, 1, 2 },
+  { -2, 2, 1 },
+  { -1, 2, 2 },
+  { 0, 2, 4 },
+  { 1, 2, 2 },
+  { 2, 2, 1 },
+} };
+/// Floyd–Steinberg: four neighbours, serpentine rows against directional artefacts.
+constexpr std::array<KernelEntry, 4> FLOYD_STEINBERG_ENTRIES{ {
+  { 1, 0, 7 },
+  { -1, 1, 3 },
+  { 0, 1, 5 },
+  { 1, 1, 1 },
+} };
+/// Atkinson: six neighbours get 1/8 each, a quarter of the error is dropped.
+constexpr std::array<KernelEntry, 6> ATKINSON_ENTRIES{ {
+  { 1, 0, 1 },
+  { 2, 0, 1 },
+  { -1, 1, 1 },
+  { 0, 1, 1 },
+  { 1, 1, 1 },
+  { 0, 2, 1 },
+} };
+
+const DiffusionKernel STUCKI{ STUCKI_ENTRIES, 42.0, false };
+const DiffusionKernel FLOYD_STEINBERG{ FLOYD_STEINBERG_ENTRIES, 16.0, true };
+const DiffusionKernel ATKINSON{ ATKINSON_ENTRIES, 8.0, false };
+
+/**
+ * \brief Error diffusion constrained to the colour pairs.
+ *
+ * Every pixel of \p source plus the error diffused to it is matched
+ * against the two colours of its strip, the chosen colour is written to
+ * \p img (which may be \p source) and the quantisation error is spread
+ * over the neighbours given by \p kernel.
+ *
+ * With \p qerr the quantisation error of every pixel is recorded, and
+ * only the rows [\p first_row, \p end_row) may be diffused: the error
+ * of the rows above is taken from \p qerr, the error spread below
+ * \p end_row is dropped.
+ */
+void diffuse(const Canvas &source, Canvas &img, const C64Palette &palette, const StripColours &colours,
+             std::vector<std::uint8_t> &bits, const DiffusionKernel &kernel,
+             std::vector<std::array<double, 3> > *qerr = nullptr, unsigned first_row = 0,
+             unsigned end_row = std::numeric_limits<unsigned>::max()) {
+  const unsigned W = img.width;
+  const unsigned reach = kernel.reach();
+  end_row = std::min(end_row, img.height);
+  if(qerr) {
+    qerr->resize(W * img.height);
+  }
+  assert(first_row == 0 || qerr);
+
+  // The error buffer covers the rows from first_row on, with a margin on
+  // all sides so that the kernel is applied without bounds checks; what
+  // lands there is dropped.
+  int pad = 0;
+  for(const auto &[dx, dy, w] : kernel.entries) {
+    pad = std::max(pad, std::abs(dx));
+  }
+  const int stride = static_cast<int>(W) + 2 * pad;
+  const unsigned top = first_row - std::min(first_row, reach);
+  std::vector<std::array<double, 3> > err(stride * (end_row - top + reach), { 0.0, 0.0, 0.0 });
+  auto err_at = [&](int x, unsigned y) -> std::array<double, 3> & { return err[(y - top) * stride + x + pad]; };
+
+  // Offsets in err of the kernel entries, for rows left to right and right to left.
+  struct Tap {
+    int forward, reverse;
+    double weight;
+  };
+  std::vector<Tap> taps;
+  for(const auto &[dx, dy, w] : kernel.entries) {
+    taps.push_back({ dy * stride + dx, dy * stride - dx, static_cast<double>(w) / kernel.divisor });
+  }
+
+  // Spreads the error of the pixel at x, y.
+  auto spread = [&](unsigned x, unsigned y, const std::array<double, 3> &e) {
+    const bool reverse = kernel.serpentine && y % 2 == 1;
+    auto *from = &err_at(static_cast<int>(x), y);
+    for(const Tap &tap : taps) {
+      auto &ne = from[reverse ? tap.reverse : tap.forward];
+      ne[0] += e[0] * tap.weight;
+      ne[1] += e[1] * tap.weight;
+      ne[2] += e[2] * tap.weight;
+    }
+  };
+
+  for(unsigned y = top; y < first_row; ++y) {
+    for(unsigned x = 0; x < W; ++x) {
+      spread(x, y, (*qerr)[y * W + x]);
+    }
+  }
+
+  for(unsigned y = first_row; y < end_row; ++y) {
+    const bool reverse = kernel.serpentine && y % 2 == 1;
+    for(unsigned i = 0; i < W; ++i) {
+      const unsigned x = reverse ? W - 1 - i : i;
+      const auto [cidx0, cidx1] = colours.at(x, y);
+      const RGB &pal0 = palette[cidx0];
+      const RGB &pal1 = palette[cidx1];
+
+      const RGB &orig = source.at(x, y);
+      const auto &e = err_at(x, y);
+      const RGB corrected{
+        std::clamp(orig[0] + e[0], 0.0, 1.0),
+        std::clamp(orig[1] + e[1], 0.0, 1.0),
+        std::clamp(orig[2] + e[2], 0.0, 1.0),
+      };
+
+      const bool use1 = col_dist(corrected, pal1) < col_dist(corrected, pal0);
+      const RGB &chosen = use1 ? pal1 : pal0;
+
+      bits[y * W + x] = use1;
+      img.at(x, y) = chosen;
+
+      const std::array<double, 3> quantised{
+        corrected[0] - chosen[0],
+        corrected[1] - chosen[1],
+        corrected[2] - chosen[2],
+      };
+      if(qerr) {
+        (*qerr)[y * W + x] = quantised;
+      }
+      spread(x, y, quantised);
+    }
+  }
+}
+
+void dither_stucki(Canvas &img, const C64Palette &palette, const StripColours &colours,
+                   std::vector<std::uint8_t> &bits, unsigned) {
+  diffuse(img, img, palette, colours, bits, STUCKI);
+}
+
+void dither_floyd_steinberg(Canvas &img, const C64Palette &palette, const StripColours &colours,
+                            std::vector<std::uint8_t> &bits, unsigned) {
+  diffuse(img, img, palette, colours, bits, FLOYD_STEINBERG);
+}
+
+void dither_atkinson(Canvas &img, const C64Palette &palette, const StripColours &colours,
+                     std::vector<std::uint8_t> &bits, unsigned) {
+  diffuse(img, img, palette, colours, bits, ATKINSON);
+}
+
+/**
+ * \brief Ordered dithering with a threshold map, constrained to the colour pairs.
+ *
+ * Every pixel is projected onto the line from the first to the second
+ * colour of its strip and gets the second colour if its position on the
+ * line exceeds the threshold of the map at the pixel. With a threshold
+ * of ½ this is the nearest colour. No pixel depends on another, so the
+ * rows are dithered in parallel and the inner loop has no branches on
+ * neighbouring results.
+ *
+ * \param map the thresholds
+ */
+void ordered(Canvas &img, const C64Palette &palette, const StripColours &colours, std::vector<std::uint8_t> &bits,
+             unsigned jobs, const ThresholdMap &map) {
+  const unsigned size = map.size;
+  parallel_rows(img.height, jobs, [&](unsigned y) {
+    const std::uint8_t *thresholds = map.thresholds + (y % size) * size;
+    for(unsigned x = 0; x < img.width; ++x) {
+      const auto [cidx0, cidx1] = colours.at(x, y);
+      const RGB &pal0 = palette[cidx0];
+      const RGB &pal1 = palette[cidx1];
+      RGB &col = img.at(x, y);
+      double dot = 0.0;
+      double len2 = 0.0;
+      for(unsigned c = 0; c < 3; ++c) {
+        const double d = pal1[c] - pal0[c];
+        dot += (col[c] - pal0[c]) * d;
+        len2 += d * d;
+      }
+      const double threshold = (thresholds[x % size] + 0.5) / map.levels;
+      const bool use1 = dot > threshold * len2 && len2 > 0.0;
+      bits[y * img.width + x] = use1;
+      col = use1 ? pal1 : pal0;
+    }
+  });
+}
+
+/// Bayer threshold matrices (recursive index matrices).
+constexpr std::array<std::uint8_t, 16> BAYER4{
+  0, 8, 2, 10,
+  12, 4, 14, 6,
+  3, 11, 1, 9,
+  15, 7, 13, 5,
+};
+constexpr std::array<std::uint8_t, 64> BAYER8{
+  0, 32, 8, 40, 2, 34, 10, 42,
+  48, 16, 56, 24, 50, 18, 58, 26,
+  12, 44, 4, 36, 14, 46, 6, 38,
+  60, 28, 52, 20, 62, 30, 54, 22,
+  3, 35, 11, 43, 1, 33, 9, 41,
+  51, 19, 59, 27, 49, 17, 57, 25,
+  15, 47, 7, 39, 13, 45, 5, 37,
+  63, 31, 55, 23, 61, 29, 53, 21,
+};
+
+/**
+ * \brief A 32×32 blue noise tile with 256 levels.
+ *
+ * Generated with Ulichney's void-and-cluster method (Gaussian σ = 1.5
+ * on the torus), so it tiles without seams. Unlike the Bayer matrices
+ * it has no regular structure, only high frequencies.
+ */
+constexpr std::array<std::uint8_t, 32 * 32> BLUE_NOISE{
+   79, 162, 128,  45, 253, 148, 199, 107, 132,  86, 240, 195, 162, 252, 190, 126,
+    9, 180, 217, 114,  11,  47, 205,  62,   7, 241, 155, 228, 130,  68, 187, 106,
+  210,   4, 193,  74, 215,   9,  41, 244,  53, 154,  71, 136,   7,  84,  42, 104,
+  243,  88,  50, 171, 195,  92, 236, 106, 134, 208, 115, 182,   2, 255, 140,  25,
+  123, 150, 229, 109, 172, 138,  96, 182, 216,  13, 228,  36, 112, 217, 143, 200,
+   66, 163, 135,  19, 249, 155,  27, 177,  42,  87,  26,  59, 100, 161,  45, 236,
+   65,  36,  92,  20,  50, 204,  67,  29, 127, 103, 165, 192, 239,  59, 176,  14,
+  233,  32, 220, 109,  55, 127,  76, 227, 144, 245, 170, 202, 223,  75, 194,  95,
+  170, 250, 189, 159, 239, 112, 226, 161,  76, 209,  48,  87, 147,  26, 123,  81,
+  153,  98, 194,  73, 179, 212,   3, 193,  64,  13, 110, 141,  34, 125,  10, 217,
+   26, 137,  57, 122,  82,   1, 144, 188,  17, 254, 131,   3, 183, 102, 250, 212,
+   53, 127,   6, 245,  35, 148, 116,  97, 165, 211,  79,  51, 248, 185, 153, 113,
+   82, 205,  12, 221, 197,  41, 245,  56, 110, 172,  66, 235, 203,  69, 160,  37,
+  190, 230, 169, 140,  87, 225,  47, 253,  27, 121, 231, 174,  20,  91,  58, 242,
+  179, 101, 164,  72, 150, 102, 134,  88, 198,  33, 155,  98,  44, 134,   9, 117,
+   91,  23,  63, 108,  17, 199, 156,  77, 186,  40, 151, 100, 199, 131, 212,  42,
+  128, 228,  47, 243,  18, 176, 213,  14, 233, 119, 216,  21, 226, 168, 207, 241,
+  177, 149, 210, 237, 182,  59, 129,  14, 222, 133,  63,   5, 233,  71, 157,   8,
+   78,  29, 139, 114, 192,  37,  75, 158,  51, 145,  73, 188, 113,  85,  31,  69,
+   45, 129,  81,  38, 121,  96, 242, 164,  93, 196, 247, 167, 115,  32, 187, 236,
+  196, 170, 213,  93,  63, 225, 122, 247, 185,  93,   4, 251,  50, 139, 231, 109,
+  199, 255,  18, 162, 229,   0, 207,  33,  54, 111,  25,  79, 220, 143,  54, 109,
+  149,  65,   6, 255, 163, 143,   9, 105,  30, 208, 126, 154, 176,  15, 191, 157,
+    8,  94, 181,  57, 142, 177,  73, 138, 184, 214, 153,  46, 181,  94, 251,  22,
+   85, 202, 130,  51,  28, 198,  85, 219, 160,  45, 227,  66,  97, 215,  78,  55,
+  137, 221, 118, 206,  90,  43, 116, 249,  82,   8, 237, 132, 208,   1, 124, 216,
+   36, 103, 224, 183, 116, 237,  56, 131,  72, 180, 108,  26, 237,  40, 118, 243,
+  168,  38,  71, 238,  24, 193, 227,  17, 166, 123,  99,  68,  35, 158,  60, 178,
+  246,  15, 151,  71,  94, 169,  22, 190, 234,   7, 143, 197, 164, 135, 203,  21,
+   98, 189,   5, 135, 167, 106, 145,  67, 218,  52, 202, 185, 245,  89, 226, 137,
+  118, 167,  43, 241,   0, 212, 152,  40, 118,  88, 253,  58,  80,   1, 179,  61,
+  214, 148, 251,  81,  56, 210,  37,  97, 179,  30, 146,  13, 112, 170,  18,  75,
+   55, 221, 194, 138, 121,  60, 247, 101, 208, 169,  24, 124, 227, 105, 246,  86,
+  127,  48, 107, 175, 229,  12, 159, 235, 129, 254,  83, 216, 134,  46, 206, 188,
+    7,  87, 105,  28, 204,  84, 141,  11,  66, 147, 219,  49, 175, 144,  38, 157,
+  234,  29, 200,  19, 125,  89, 195,  74,   2, 108, 165,  34,  72, 240,  98, 154,
+  128, 252,  64, 178, 230,  44, 173, 200, 238,  34,  83, 196,  17,  69, 201,  11,
+  185,  78, 222, 156,  62, 248, 141,  49, 184, 209,  58, 233, 186, 146,  27, 217,
+   35, 191, 145,  15, 159, 110,  22, 125,  95, 186, 136, 107, 248, 130, 222,  97,
+  119,  53, 137,  95, 183,  27, 111, 220,  23, 152,  90, 126,   8, 114,  59, 171,
+   73, 115, 236,  52,  90, 250, 215,  60, 156,   3, 223,  55, 163,  89,  44, 158,
+  254, 172,   2, 238,  43, 214, 173,  84, 132, 230,  31, 168, 204, 247,  92, 230,
+  161,   3,  99, 206, 136,  74, 184,  35, 244,  72, 171,  30, 205,   6, 191,  67,
+   31, 209, 111, 198,  74, 148,   6, 240,  65, 106, 188,  51,  76, 151,  20, 195,
+   47, 223, 183,  33, 171,  10, 147, 114, 194, 132, 102, 242, 115, 142, 235, 104,
+  139,  85,  20, 164, 128, 101,  54, 162, 203,  14, 252, 120, 222,  41, 105, 131,
+   83, 150,  65, 124, 239,  49, 219,  86,  21, 213,  42,  80, 182,  60,  24, 215,
+  175, 241,  56, 225,  32, 251, 197, 119,  39, 142,  86, 158,   4, 181, 239, 203,
+  117, 254,  21, 210,  80, 108, 165, 235,  64, 174, 152,  10, 229, 160, 126,  77,
+   40, 121, 154, 191,  91, 176,  16,  78, 231, 178,  61, 211,  99, 139,  68,  15,
+   38, 177, 100, 144, 192,  32, 133,   2,  96, 253, 122, 200,  99,  48, 250, 196,
+    5, 206,  70,  12, 138,  67, 150, 207, 103,  19, 242,  31, 192,  46, 168, 218,
+  156, 232,  57,  11, 246,  62, 180, 205, 146,  54,  28,  70, 218,  18, 145,  92,
+  166, 102, 246, 117, 223,  36, 244, 122,  49, 163, 133, 111,  77, 249, 125,  91,
+   70, 130, 202, 166,  88, 120, 231,  43, 110, 221, 189, 133, 169, 113, 186,  61,
+  228,  33, 147,  52, 201,  95, 180,   1, 226,  89, 198, 220, 152,  24, 204,   0,
+  189,  29, 112,  44, 224, 155,  23,  80, 175,  12,  90, 240,  39,  79, 244,  16,
+  120, 213,  82, 173,  19, 157,  64, 140, 187,  68,  10,  39,  62, 181, 104, 225,
+  153, 249,  75, 211,   5, 104, 197, 136, 248, 159,  61, 149,   0, 201, 135,  46,
+  161, 190,   4, 129, 238, 107, 214,  41, 113, 252, 174, 124, 234,  81, 141,  52,
+   16,  96, 174, 140, 187,  53, 234,  69,  37, 117, 209, 101, 224, 173,  94, 232,
+   70, 103, 255,  58, 184,  28,  84, 232,  23, 146, 100, 211, 160,  13, 243, 119,
+  219,  57, 232,  25, 116,  83, 166,  16, 218, 178,  22,  48, 120,  63,  25, 151,
+  207,  34, 142,  77, 224, 149, 123, 167, 193,  76,  50,  30,  93, 201,  39, 172,
+};
+
+const ThresholdMap BAYER4_MAP{ BAYER4.data(), 4, 16 };
+const ThresholdMap BAYER8_MAP{ BAYER8.data(), 8, 64 };
+const ThresholdMap BLUE_NOISE_MAP{ BLUE_NOISE.data(), 32, 256 };
+
+void dither_bayer4(Canvas &img, const C64Palette &palette, const StripColours &colours,
+                   std::vector<std::uint8_t> &bits, unsigned jobs) {
+  ordered(img, palette, colours, bits, jobs, BAYER4_MAP);
+}
+
+void dither_bayer8(Canvas &img, const C64Palette &palette, const StripColours &colours,
+                   std::vector<std::uint8_t> &bits, unsigned jobs) {
+  ordered(img, palette, colours, bits, jobs, BAYER8_MAP);
+}
+
+void dither_blue_noise(Canvas &img, const C64Palette &palette, const StripColours &colours,
+                       std::vector<std::uint8_t> &bits, unsigned jobs) {
+  ordered(img, palette, colours, bits, jobs, BLUE_NOISE_MAP);
+}
+
+/// The kernel of an error diffusion \p dither, nullptr for the others.
+[[nodiscard]] const DiffusionKernel *diffusion_kernel(Dither dither) noexcept {
+  switch(dither) {
+  case Dither::stucki:
+    return &STUCKI;
+  case Dither::floyd_steinberg:
+    return &FLOYD_STEINBERG;
+  case Dither::atkinson:
+    return &ATKINSON;
+  default:
+    return nullptr;
+  }
+}
+
+/// The threshold map of an ordered \p dither, nullptr for the others.
+[[nodiscard]] const ThresholdMap *threshold_map(Dither dither) noexcept {
+  switch(dither) {
+  case Dither::bayer4:
+    return &BAYER4_MAP;
+  case Dither::bayer8:
+    return &BAYER8_MAP;
+  case Dither::blue_noise:
+    return &BLUE_NOISE_MAP;
+  default:
+    return nullptr;
+  }
+}
+
+/// The engine of \p dither.
+[[nodiscard]] DitherEngine dither_engine(Dither dither) {
+  switch(dither) {
+  case Dither::stucki:
+    return dither_stucki;
+  case Dither::floyd_steinberg:
+    return dither_floyd_steinberg;
+  case Dither::atkinson:
+    return dither_atkinson;
+  case Dither::bayer4:
+    return dither_bayer4;
+  case Dither::bayer8:
+    return dither_bayer8;
+  case Dither::blue_noise:
+    return dither_blue_noise;
+  case Dither::none:
+    break;
+  }
+  throw std::invalid_argument("no dithering engine selected");
+}
+
+/// The CharBlocks of a dithered canvas from its decisions and colour pairs.
+[[nodiscard]] std::list<CharBlock> assemble_blocks(const std::vector<std::uint8_t> &bits, const StripColours &colours,
+                                                   unsigned width, unsigned height) {
+  const unsigned lines = colours.lines;
+  std::list<CharBlock> blocks;
+  for(unsigned y = 0; y < height; y += BLK) {
+    for(unsigned x = 0; x < width; x += BLK) {
+      CharBlock block{ 0, 0, {}, {} };
+      block.data.reserve(BLK * BLK);
+      for(unsigned dy = 0; dy < BLK; ++dy) {
+        for(unsigned dx = 0; dx < BLK; ++dx) {
+          block.data.push_back(bits[(y + dy) * width + x + dx] != 0);
+        }
+        if(lines < BLK) {
+          block.line_colours.push_back(colours.at(x, y + dy));
+        }
+      }
+      std::tie(block.idx0, block.idx1) = colours.at(x, y);
+      blocks.push_back(std::move(block));
+    }
+  }
+  return blocks;
+}
+
+/*! \brief Dither the image within the colour pairs of the blocks
+ *
+ * The colour pairs are chosen as without dithering, then \p engine
+ * decides the pixels.
+ *
+ * \param img the image to handle
+ * \param palette palette to match against
+ * \param engine the dithering engine
+ * \param search pixel rows per colour pair, threads and optimisation of the
+ *        colour pair search
+ */
+[[nodiscard]] std::list<CharBlock> handle_dithered(Canvas &img, const C64Palette &palette, DitherEngine engine,
+                                                   const PairSearch &search = {}) {
+  const auto block_colors = search_pairs(distance_table(img, palette, search.jobs), search);
+  const StripColours colours{ block_colors, search.lines, img.width / BLK };
+
+  std::vector<std::uint8_t> bits(img.pixels.size());
+  engine(img, palette, colours, bits, search.jobs);
+  return assemble_blocks(bits, colours, img.width, img.height);
+}
+
+/// Relative error increase over the best pair of the source up to which a pair is a candidate.
+inline constexpr double REFINE_TOLERANCE = 0.1;
+/// Relative error decrease needed to replace the pair of a strip, against oscillation.
+inline constexpr double REFINE_MARGIN = 0.02;
+/// Change of a quantisation error component which makes the neighbouring strips dirty.
+inline constexpr double REFINE_EPSILON = 1.0 / 256;
+
+/*! \brief Error diffusion alternating with a new choice of the colour pairs
+ *
+ * The strip rows are handled from top to bottom. The pair of every strip
+ * is chosen again, among the pairs within REFINE_TOLERANCE of the best
+ * one for the source (at most search.candidates), for its source pixels
+ * plus the error the diffusion carries into the strip from outside: in
+ * the first pass only the error from the rows above, then the row is
+ * diffused and each further pass also takes the error from the strips
+ * to the left and right. The error a strip spreads within itself is
+ * left out, it depends on the pair being chosen, and a pair is only
+ * replaced by one with an error smaller by REFINE_MARGIN, otherwise the
+ * choices oscillate. If a pair changed, the row is diffused again and
+ * the next pass follows, up to \p passes.
+ *
+ * The rows above are final, so a pass only diffuses one strip row again,
+ * and only the dirty strips are searched: after the row was diffused
+ * again, a strip is dirty if the quantisation error changed by more than
+ * REFINE_EPSILON in the columns of a neighbour which spread into it.
+ *
+ * \param img the image to handle
+ * \param palette palette to match against
+ * \param kernel the error diffusion
+ * \param search pixel rows per colour pair, threads and candidates per strip
+ * \param passes largest number of passes per strip row
+ */
+[[nodiscard]] std::list<CharBlock> handle_refined(Canvas &img, const C64Palette &palette,
+                                                  const DiffusionKernel &kernel, const PairSearch &search,
+                                                  unsigned passes) {
+  const unsigned W = img.width;
+  const unsigned lines = search.lines;
+  const unsigned BW = W / BLK;
+  const unsigned rows = img.height / lines;
+  const Canvas source = img;
+
+  std::vector<std::vector<PairCandidate> > candidates(rows * BW);
+  {
+    const DistanceTable table = distance_table(img, palette, search.jobs);
+    parallel_rows(rows, search.jobs, [&](unsigned row) {
+      for(unsigned bx = 0; bx < BW; ++bx) {
+        candidates[row * BW + bx] =
+                pair_candidates(table, bx * BLK, row * lines, lines, REFINE_TOLERANCE, search.candidates);
+      }
+    });
+  }
+  std::vector<std::pair<int, int> > pairs;
+  pairs.reserve(candidates.size());
+  for(const auto &strip : candidates) {
+    pairs.emplace_back(strip.front().idx0, strip.front().idx1);
+  }
+  const StripColours colours{ pairs, lines, BW };
+
+  std::vector<std::uint8_t> bits(img.pixels.size());
+  std::vector<std::array<double, 3> > qerr;
+
+  // Pixels of a strip which get error from outside of it: the pixel, the
+  // offset of the source pixel from the strip and the weight. Before the
+  // strip row was diffused only the error from the rows above counts; the
+  // kernel is mirrored in odd rows of a serpentine diffusion.
+  struct Inflow {
+    unsigned pixel;
+    int sx, sy;
+    double weight;
+  };
+  std::array<std::vector<Inflow>, 4> inflows; // [odd first row][diffused]
+  for(unsigned variant = 0; variant < inflows.size(); ++variant) {
+    const bool odd = variant & 2;
+    const bool diffused = variant & 1;
+    for(unsigned dy = 0; dy < lines; ++dy) {
+      for(unsigned dx = 0; dx < BLK; ++dx) {
+        for(const auto &[kx, ky, w] : kernel.entries) {
+          const int sy = static_cast<int>(dy) - ky;
+          const bool reverse = kernel.serpentine && (sy + (odd ? 1 : 0)) % 2 != 0;
+          const int sx = static_cast<int>(dx) - (reverse ? -kx : kx);
+          if(sy >= 0 && (!diffused || (sx >= 0 && sx < static_cast<int>(BLK)))) {
+            continue;
+          }
+          inflows[variant].push_back({ dy * BLK + dx, sx, sy, static_cast<double>(w) / kernel.divisor });
+        }
+      }
+    }
+  }
+
+  // Source plus the error from outside the strip of the pixels of strip i.
+  std::vector<RGB> target(lines * BLK);
+  auto fill_target = [&](unsigned i, bool diffused) {
+    const unsigned x0 = i % BW * BLK;
+    const unsigned y0 = i / BW * lines;
+    for(unsigned p = 0; p < target.size(); ++p) {
+      target[p] = source.at(x0 + p % BLK, y0 + p / BLK);
+    }
+    for(const Inflow &in : inflows[(y0 % 2) * 2 + (diffused ? 1 : 0)]) {
+      const int sx = static_cast<int>(x0) + in.sx;
+      const int sy = static_cast<int>(y0) + in.sy;
+      if(sx < 0 || sx >= static_cast<int>(W) || sy < 0) {
+        continue;
+      }
+      const auto &q = qerr[sy * W + sx];
+      RGB &t = target[in.pixel];
+      t[0] += q[0] * in.weight;
+      t[1] += q[1] * in.weight;
+      t[2] += q[2] * in.weight;
+    }
+    for(RGB &t : target) {
+      t = { std::clamp(t[0], 0.0, 1.0), std::clamp(t[1], 0.0, 1.0), std::clamp(t[2], 0.0, 1.0) };
+    }
+  };
+  // Distances of the target to the colours of the candidates, computed on first use.
+  std::vector<double> dist(NCOLORS * target.size());
+  std::bitset<NCOLORS> known;
+  auto distances = [&](int c) {
+    double *ret = &dist[c * target.size()];
+    if(!known[c]) {
+      for(unsigned p = 0; p < target.size(); ++p) {
+        ret[p] = col_dist(target[p], palette[c]);
+      }
+      known[c] = true;
+    }
+    return ret;
+  };
+  auto error = [&](int i, int j) {
+    const double *di = distances(i);
+    const double *dj = distances(j);
+    double total = 0.0;
+    for(unsigned p = 0; p < target.size(); ++p) {
+      total += std::min(di[p], dj[p]);
+    }
+    return total;
+  };
+
+  // Columns at the sides of a strip which spread error into the neighbours.
+  unsigned side = 0;
+  for(const auto &[kx, ky, w] : kernel.entries) {
+    side = std::max<unsigned>(side, std::abs(kx));
+  }
+  std::vector<std::uint8_t> dirty(BW);
+  unsigned refined = 0;
+  unsigned rediffused = 0;
+  // Choose the pairs of the dirty strips of a row again, true if one changed.
+  auto refine_row = [&](unsigned row, bool diffused) {
+    bool changed = false;
+    for(unsigned bx = 0; bx < BW; ++bx) {
+      const unsigned i = row * BW + bx;
+      if(!dirty[bx] || candidates[i].size() == 1) {
+        continue;
+      }
+      ++refined;
+      fill_target(i, diffused);
+      known.reset();
+      auto &pair = pairs[i];
+      double best_err = error(pair.first, pair.second) * (1.0 - REFINE_MARGIN);
+      auto best = pair;
+      for(const PairCandidate &c : candidates[i]) {
+        if(const double e = error(c.idx0, c.idx1); e < best_err) {
+          best = { c.idx0, c.idx1 };
+          best_err = e;
+        }
+      }
+      if(best != pair) {
+        pair = best;
+        changed = true;
+      }
+    }
+    return changed;
+  };
+  // Diffuse a row again; a strip is dirty if the error at the facing side of a neighbour changed.
+  std::vector<std::array<double, 3> > previous(lines * W);
+  auto rediffuse_row = [&](unsigned row) {
+    const auto first = qerr.begin() + row * lines * W;
+    std::copy(first, first + lines * W, previous.begin());
+    diffuse(source, img, palette, colours, bits, kernel, &qerr, row * lines, (row + 1) * lines);
+    ++rediffused;
+    auto side_changed = [&](unsigned x0) {
+      for(unsigned p = 0; p < lines * W; p += W) {
+        for(unsigned x = x0; x < x0 + side; ++x) {
+          const auto &a = previous[p + x];
+          const auto &b = first[p + x];
+          if(std::abs(a[0] - b[0]) > REFINE_EPSILON || std::abs(a[1] - b[1]) > REFINE_EPSILON ||
+             std::abs(a[2] - b[2]) > REFINE_EPSILON) {
+            return true;
+          }
+        }
+      }
+      return false;
+    };
+    for(unsigned bx = 0; bx < BW; ++bx) {
+      dirty[bx] = (bx > 0 && side_changed(bx * BLK - side)) || (bx + 1 < BW && side_changed((bx + 1) * BLK));
+    }
+  };
+
+  for(unsigned row = 0; row < rows; ++row) {
+    // First with the error from above, then with the error of the strips of the row.
+    std::fill(dirty.begin(), dirty.end(), 1);
+    refine_row(row, false);
+    diffuse(source, img, palette, colours, bits, kernel, &qerr, row * lines, (row + 1) * lines);
+    std::fill(dirty.begin(), dirty.end(), 1);
+    for(unsigned pass = 1; pass < passes && refine_row(row, true); ++pass) {
+      rediffuse_row(row);
+    }
+  }
+  count_stat("refined strips", refined);
+  count_stat("rediffused strip rows", rediffused);
+  return assemble_blocks(bits, colours, W, img.height);
+}
+
+// ── integer pipeline
+// ──────────────────────────────────────────────────────────
+
+/// Steps of the distances in a DistanceTable16 per 8-bit step; the largest distance, √3 × 255, fits 16 bits.
+inline constexpr float DIST_SCALE = 128.0f;
+/// Fractional bits of the pixels and errors of the integer error diffusion.
+inline constexpr int ERR_BITS = 6;
+/// Fractional bits of the kernel weights of the integer error diffusion.
+inline constexpr int WEIGHT_BITS = 15;
+
+/// \p palette with 8 bits per channel; exact, the palettes are 8-bit values divided by 255.
+[[nodiscard]] Palette8 palette8(const C64Palette &palette) noexcept {
+  Palette8 ret{};
+  for(int i = 0; i < NCOLORS; ++i) {
+    for(unsigned c = 0; c < 3; ++c) {
+      ret[i][c] = static_cast<std::uint8_t>(std::lround(palette[i][c] * 255.0));
+    }
+  }
+  return ret;
+}
+
+/// Squared Euclidean distance of two 8-bit colours.
+[[nodiscard]] std::int32_t sq_dist(const RGB8 &a, const RGB8 &b) noexcept {
+  std::int32_t ret = 0;
+  for(unsigned c = 0; c < 3; ++c) {
+    const std::int32_t d = a[c] - b[c];
+    ret += d * d;
+  }
+  return ret;
+}
+
+[[nodiscard]] DistanceTable16 distance_table(const Canvas8 &img, const Palette8 &palette, unsigned jobs) {
+  DistanceTable16 ret(img.width, img.height);
+  parallel_rows(img.height, jobs, [&](unsigned y) {
+    for(int c = 0; c < NCOLORS; ++c) {
+      std::uint16_t *dist = ret.row(c, 0, y);
+      for(unsigned x = 0; x < img.width; ++x) {
+        const float d = std::sqrt(static_cast<float>(sq_dist(img.at(x, y), palette[c])));
+        dist[x] = static_cast<std::uint16_t>(d * DIST_SCALE + 0.5f);
+      }
+    }
+  });
+  return ret;
+}
+
+/// Every pixel gets the nearest of the two colours of its strip.
+void nearest8(Canvas8 &img, const Palette8 &palette, const StripColours &colours, std::vector<std::uint8_t> &bits,
+              unsigned jobs) {
+  parallel_rows(img.height, jobs, [&](unsigned y) {
+    for(unsigned x = 0; x < img.width; ++x) {
+      const auto [cidx0, cidx1] = colours.at(x, y);
+      RGB8 &col = img.at(x, y);
+      const bool use1 = sq_dist(col, palette[cidx1]) < sq_dist(col, palette[cidx0]);
+      bits[y * img.width + x] = use1;
+      col = palette[use1 ? cidx1 : cidx0];
+    }
+  });
+}
+
+/// ordered() with integer arithmetic.
+void ordered8(Canvas8 &img, const Palette8 &palette, const StripColours &colours, std::vector<std::uint8_t> &bits,
+              unsigned jobs, const ThresholdMap &map) {
+  const unsigned size = map.size;
+  parallel_rows(img.height, jobs, [&](unsigned y) {
+    const std::uint8_t *thresholds = map.thresholds + (y % size) * size;
+    for(unsigned x = 0; x < img.width; ++x) {
+      const auto [cidx0, cidx1] = colours.at(x, y);
+      const RGB8 &pal0 = palette[cidx0];
+      const RGB8 &pal1 = palette[cidx1];
+      RGB8 &col = img.at(x, y);
+      std::int32_t dot = 0;
+      std::int32_t len2 = 0;
+      for(unsigned c = 0; c < 3; ++c) {
+        const std::int32_t d = pal1[c] - pal0[c];
+        dot += (col[c] - pal0[c]) * d;
+        len2 += d * d;
+      }
+      // dot / len2 > (threshold + ½) / levels without the division.
+      const bool use1 = std::int64_t{ 2 } * dot * map.levels > (2 * thresholds[x % size] + 1) * std::int64_t{ len2 } &&
+                        len2 > 0;
+      bits[y * img.width + x] = use1;
+      col = use1 ? pal1 : pal0;
+    }
+  });
+}
+
+/**
+ * \brief diffuse() in fixed point.
+ *
+ * Pixels and errors have ERR_BITS fractional bits and the error buffer
+ * holds std::int16_t, 6 bytes per pixel instead of 24. The corrected
+ * pixels are clamped to the colour cube, so no error exceeds 255 steps,
+ * and neither does the weighted sum reaching a pixel. The weights have
+ * WEIGHT_BITS fractional bits and every spread error is rounded.
+ */
+void diffuse8(Canvas8 &img, const Palette8 &palette, const StripColours &colours, std::vector<std::uint8_t> &bits,
+              const DiffusionKernel &kernel) {
+  using Error = std::array<std::int16_t, 3>;
+  constexpr std::int32_t MAX = 255 << ERR_BITS;
+  constexpr std::int32_t HALF = 1 << (WEIGHT_BITS - 1);
+  const unsigned W = img.width;
+
+  int pad = 0;
+  for(const auto &[dx, dy, w] : kernel.entries) {
+    pad = std::max(pad, std::abs(dx));
+  }
+  const int stride = static_cast<int>(W) + 2 * pad;
+  std::vector<Error> err(stride * (img.height + kernel.reach()), Error{});
+
+  struct Tap {
+    int forward, reverse;
+    std::int32_t weight;
+  };
+  std::vector<Tap> taps;
+  for(const auto &[dx, dy, w] : kernel.entries) {
+    taps.push_back({ dy * stride + dx, dy * stride - dx,
+                     static_cast<std::int32_t>(std::lround(std::ldexp(w / kernel.divisor, WEIGHT_BITS))) });
+  }
+
+  for(unsigned y = 0; y < img.height; ++y) {
+    const bool reverse = kernel.serpentine && y % 2 == 1;
+    for(unsigned i = 0; i < W; ++i) {
+      const unsigned x = reverse ? W - 1 - i : i;
+      const auto [cidx0, cidx1] = colours.at(x, y);
+      const RGB8 &pal0 = palette[cidx0];
+      const RGB8 &pal1 = palette[cidx1];
+
+      Error *from = &err[y * stride + x + pad];
+      RGB8 &col = img.at(x, y);
+      std::array<std::int32_t, 3> corrected;
+      std::int32_t dist0 = 0;
+      std::int32_t dist1 = 0;
+      for(unsigned c = 0; c < 3; ++c) {
+        corrected[c] = std::clamp((col[c] << ERR_BITS) + (*from)[c], 0, MAX);
+        const std::int32_t d0 = corrected[c] - (pal0[c] << ERR_BITS);
+        const std::int32_t d1 = corrected[c] - (pal1[c] << ERR_BITS);
+        dist0 += d0 * d0;
+        dist1 += d1 * d1;
+      }
+
+      const bool use1 = dist1 < dist0;
+      const RGB8 &chosen = use1 ? pal1 : pal0;
+      bits[y * W + x] = use1;
+      col = chosen;
+
+      const std::int32_t q0 = corrected[0] - (chosen[0] << ERR_BITS);
+      const std::int32_t q1 = corrected[1] - (chosen[1] << ERR_BITS);
+      const std::int32_t q2 = corrected[2] - (chosen[2] << ERR_BITS);
+      for(const Tap &tap : taps) {
+        Error &ne = from[reverse ? tap.reverse : tap.forward];
+        ne[0] = static_cast<std::int16_t>(ne[0] + ((q0 * tap.weight + HALF) >> WEIGHT_BITS));
+        ne[1] = static_cast<std::int16_t>(ne[1] + ((q1 * tap.weight + HALF) >> WEIGHT_BITS));
+        ne[2] = static_cast<std::int16_t>(ne[2] + ((q2 * tap.weight + HALF) >> WEIGHT_BITS));
+      }
+    }
+  }
+}
+
+/*! \brief Convert in the integer pipeline
+ *
+ * The counterpart of handle_block_wise(), handle_strip_wise() and
+ * handle_dithered() for \p dither. The colour pairs are searched in a
+ * DistanceTable16, whose rounding can change the choice between two
+ * pairs with nearly the same error; the pixels are decided with exact
+ * squared distances.
+ *
+ * \param img the image to handle
+ * \param palette palette to match against
+ * \param dither the dithering
+ * \param search pixel rows per colour pair, threads and optimisation of the
+ *        colour pair search
+ */
+[[nodiscard]] std::list<CharBlock> handle_integer(Canvas8 &img, const Palette8 &palette, Dither dither,
+                                                  const PairSearch &search) {
+  const auto pairs = search_pairs(distance_table(img, palette, search.jobs), search);
+  const StripColours colours{ pairs, search.lines, img.width / BLK };
+
+  std::vector<std::uint8_t> bits(img.pixels.size());
+  if(const DiffusionKernel *kernel = diffusion_kernel(dither)) {
+    diffuse8(img, palette, colours, bits, *kernel);
+  } else if(const ThresholdMap *map = threshold_map(dither)) {
+    ordered8(img, palette, colours, bits, search.jobs, *map);
+  } else {
+    nearest8(img, palette, colours, bits, search.jobs);
+  }
+  return assemble_blocks(bits, colours, img.width, img.height);
+}
+
+// ── size estimate
+// ─────────────────────────────────────────────────────────────
+
+/**
+ * \brief Size of \p data in a simple run-length encoding.
+ *
+ * Runs of three or more equal bytes (up to 255) take three bytes:
+ * escape, count and value. Other bytes are copied.
+ */
+[[nodiscard]] std::size_t rle_size(const std::string &data) noexcept {
+  std::size_t size = 0;
+  for(std::size_t i = 0; i < data.size();) {
+    std::size_t run = 1;
+    while(i + run < data.size() && run < 255 && data[i + run] == data[i]) {
+      ++run;
+    }
+    size += run >= 3 ? 3 : run;
+    i += run;
+  }
+  return size;
+}
+
+template std::vector<std::pair<int, int> > strip_pairs(const DistanceTable &, unsigned, unsigned);
+template std::vector<std::pair<int, int> > strip_pairs(const DistanceTable16 &, unsigned, unsigned);
+template unsigned optimise_pairs(const DistanceTable &, std::vector<std::pair<int, int> > &, double, unsigned, unsigned);
+template unsigned optimise_pairs(const DistanceTable16 &, std::vector<std::pair<int, int> > &, double, unsigned,
+                                 unsigned);
+
+} // namespace hires_internal
+
+using namespace hires_internal;
+
+const std::map<std::string, Dither> dither_registry{
+  { "none", Dither::none },
+  { "stucki", Dither::stucki },
+  { "floyd-steinberg", Dither::floyd_steinberg },
+  { "atkinson", Dither::atkinson },
+  { "bayer4", Dither::bayer4 },
+  { "bayer8", Dither::bayer8 },
+  { "blue-noise", Dither::blue_noise },
+};
+
+std::string dither_names() {
+  std::string ret;
+  for(const auto &[name, _] : dither_registry) {
+    if(!ret.empty()) {
+      ret += ", ";
+    }
+    ret += name;
+  }
+  return ret;
+}
+
+HiresBitmap convert_hires(const ImageBuffer &img, const HiresOptions &opts) {
+  if(img.width < HIRES_W || img.height < HIRES_H) {
+    throw std::invalid_argument(
+            std::format("wrong picture size ({}x{})", img.width, img.height));
+  }
+  if(opts.fli_lines != 0 && BLK % opts.fli_lines != 0) {
+    throw std::invalid_argument(std::format("FLI needs 1, 2 or 4 lines per colour pair, not {}", opts.fli_lines));
+  }
+  if(opts.pair_tolerance < 0 || opts.pair_candidates == 0) {
+    throw std::invalid_argument("the pair optimisation needs a tolerance >= 0 and at least one candidate");
+  }
+  if(opts.pair_tolerance > 0 && opts.fli_lines != 0) {
+    throw std::invalid_argument("the pair optimisation is not available for FLI");
+  }
+  if(opts.refine_passes > 0 && !is_error_diffusion(opts.dither)) {
+    throw std::invalid_argument("the pair refinement needs an error diffusion (stucki, floyd-steinberg or atkinson)");
+  }
+  if(opts.refine_passes > 0 && opts.pair_tolerance > 0) {
+    throw std::invalid_argument("the pair refinement cannot be combined with the pair optimisation");
+  }
+  if(opts.refine_passes > 0 && opts.integer) {
+    throw std::invalid_argument("the pair refinement is not available in the integer pipeline");
+  }
+  const PairSearch search{ opts.fli_lines == 0 ? BLK : opts.fli_lines, std::max(1u, opts.jobs), opts.pair_tolerance,
+                           opts.pair_candidates };
+  const unsigned lines = search.lines;
+  StageTimer resize_timer(Stage::resize);
+  const ImageBuffer rgb = to_rgb(crop_image(img, 0, 0, HIRES_W, HIRES_H));
+  HiresBitmap ret;
+  ret.image.width = HIRES_W;
+  ret.image.height = HIRES_H;
+  ret.image.format = PixelFormat::rgb;
+  ret.image.pixels.resize(ret.image.stride() * HIRES_H);
+  const Stage stage = opts.dither != Dither::none ? Stage::dither : Stage::quantise;
+
+  if(opts.integer) {
+    Canvas8 canvas{ HIRES_W, HIRES_H, std::vector<RGB8>(HIRES_W * HIRES_H) };
+    for(std::size_t i = 0; i < canvas.pixels.size(); ++i) {
+      for(unsigned c = 0; c < 3; ++c) {
+        canvas.pixels[i][c] = rgb.pixels[3 * i + c];
+      }
+    }
+    resize_timer.stop();
+    {
+      const StageTimer timer(stage);
+      ret.blocks = handle_integer(canvas, palette8(*opts.palette), opts.dither, search);
+    }
+    for(std::size_t i = 0; i < canvas.pixels.size(); ++i) {
+      for(unsigned c = 0; c < 3; ++c) {
+        ret.image.pixels[3 * i + c] = canvas.pixels[i][c];
+      }
+    }
+  } else {
+    Canvas canvas{ HIRES_W, HIRES_H, std::vector<RGB>(HIRES_W * HIRES_H) };
+    for(std::size_t i = 0; i < canvas.pixels.size(); ++i) {
+      for(unsigned c = 0; c < 3; ++c) {
+        canvas.pixels[i][c] = rgb.pixels[3 * i + c] / 255.0;
+      }
+    }
+    resize_timer.stop();
+    {
+      const StageTimer timer(stage);
+      if(opts.refine_passes > 0) {
+        ret.blocks = handle_refined(canvas, *opts.palette, *diffusion_kernel(opts.dither), search, opts.refine_passes);
+      } else if(opts.dither != Dither::none) {
+        ret.blocks = handle_dithered(canvas, *opts.palette, dither_engine(opts.dither), search);
+      } else if(opts.fli_lines != 0) {
+        ret.blocks = handle_strip_wise(canvas, *opts.palette, search);
+      } else {
+        ret.blocks = handle_block_wise(canvas, *opts.palette, opts.verbose, search);
+      }
+    }
+    for(std::size_t i = 0; i < canvas.pixels.size(); ++i) {
+      for(unsigned c = 0; c < 3; ++c) {
+        ret.image.pixels[3 * i + c] = static_cast<std::uint8_t>(canvas.pixels[i][c] * 255.0 + 0.5);
+      }
+    }
+  }
+  count_stat("blocks", ret.blocks.size());
+  if(opts.fli_lines != 0) {
+    count_stat("strips", HIRES_H / lines * (HIRES_W / BLK));
+  }
+  return ret;
+}
+
+void write_char_blocks(const std::list<CharBlock> &blocks, std::ostream &out,
+                       unsigned short addr) {
+  const StageTimer timer(Stage::write);
+  CharBlock blk; // Used for assignment and handling the inversion.
+  std::list<char> colours; // Store the colour blocks here.
+
+  out << static_cast<char>(addr & 0xFF) << static_cast<char>(addr >> 8);
+  // For checking if last blocks colours are just swapped, this helps
+  // in compressing the image.
+  int last0 = -1;
+  int last1 = -1;
+  for(const CharBlock &blkiterator : blocks) {
+    if(!blkiterator.line_colours.empty()) {
+      throw std::invalid_argument("FLI blocks have to be written with write_fli_blocks()");
+    }
+    blk = blkiterator;
+    assert(blk.data.size() == BLK * BLK);
+    if(last0 == blk.idx1 && last1 == blk.idx0) {
+      blk.swap_colours();
+    }
+    if(blk.all_equal()) {
+      if(last0 == blk.idx1 || last1 == blk.idx0) {
+	blk.swap_colours();
+      }
+      // Now just set the colours to be equal to last blocks colours. Improves compression!
+      blk.idx0 = last0;
+      blk.idx1 = last1;
+    }
+    for(auto row : blk.data | std::views::chunk(BLK)) {
+      uint8_t byte = 0;
+      for(bool bit : row) {
+        byte = static_cast<uint8_t>((byte << 1) | (bit ? 1u : 0u));
+      }
+      out << static_cast<char>(byte);
+    }
+    last0 = blk.idx0;
+    last1 = blk.idx1;
+    colours.push_back(static_cast<char>((blk.idx1 << 4) | blk.idx0));
+  }
+
+  for(char col : colours) {
+    out << col;
+  }
+}
+
+void write_fli_blocks(const std::list<CharBlock> &blocks, std::ostream &out, unsigned short addr) {
+  const StageTimer timer(Stage::write);
+  constexpr unsigned SCREEN_SIZE = 0x400; // Screen RAMs are 1 KiB apart.
+  constexpr unsigned CELLS = (HIRES_W / BLK) * (HIRES_H / BLK);
+  if(blocks.size() != CELLS) {
+    throw std::invalid_argument(std::format("an FLI bitmap needs {} blocks, not {}", CELLS, blocks.size()));
+  }
+  std::vector<char> screens(BLK * SCREEN_SIZE, 0);
+  std::vector<char> bitmap;
+  bitmap.reserve(CELLS * BLK);
+
+  unsigned cell = 0;
+  for(const CharBlock &blk : blocks) {
+    if(blk.line_colours.size() != BLK) {
+      throw std::invalid_argument("write_fli_blocks() needs the colours of every pixel row");
+    }
+    assert(blk.data.size() == BLK * BLK);
+    for(unsigned row = 0; row < BLK; ++row) {
+      const auto [cidx0, cidx1] = blk.line_colours[row];
+      screens[row * SCREEN_SIZE + cell] = static_cast<char>((cidx1 << 4) | cidx0);
+      uint8_t byte = 0;
+      for(unsigned dx = 0; dx < BLK; ++dx) {
+        byte = static_cast<uint8_t>((byte << 1) | (blk.data[row * BLK + dx] ? 1u : 0u));
+      }
+      bitmap.push_back(static_cast<char>(byte));
+    }
+    ++cell;
+  }
+
+  out << static_cast<char>(addr & 0xFF) << static_cast<char>(addr >> 8);
+  out.write(screens.data(), static_cast<std::streamsize>(screens.size()));
+  out.write(bitmap.data(), static_cast<std::streamsize>(bitmap.size()));
+}
+
+HiresMeasure measure_hires(const ImageBuffer &img, const HiresBitmap &bitmap) {
+  HiresMeasure ret;
+  const ImageBuffer source = to_rgb(crop_image(img, 0, 0, HIRES_W, HIRES_H));
+  for(std::size_t i = 0; i < source.pixels.size(); i += 3) {
+    RGB a, b;
+    for(unsigned c = 0; c < 3; ++c) {
+      a[c] = source.pixels[i + c] / 255.0;
+      b[c] = bitmap.image.pixels[i + c] / 255.0;
+    }
+    ret.error += col_dist(a, b);
+  }
+
+  constexpr unsigned CELLS = (HIRES_W / BLK) * (HIRES_H / BLK);
+  std::ostringstream out;
+  const bool fli = !bitmap.blocks.empty() && !bitmap.blocks.front().line_colours.empty();
+  // Offsets of the screen RAMs in the written file.
+  std::vector<std::size_t> screens;
+  if(fli) {
+    write_fli_blocks(bitmap.blocks, out);
+    for(unsigned row = 0; row < BLK; ++row) {
+      screens.push_back(2 + row * 0x400);
+    }
+  } else {
+    write_char_blocks(bitmap.blocks, out);
+    screens.push_back(2 + CELLS * BLK);
+  }
+  const std::string data = out.str();
+  for(const std::size_t screen : screens) {
+    for(unsigned cell = 1; cell < CELLS && screen + cell < data.size(); ++cell) {
+      ret.colour_changes += data[screen + cell] != data[screen + cell - 1];
+    }
+  }
+  ret.raw_size = data.size();
+  ret.packed_size = rle_size(data);
+  return ret;
+}
@@ -0,0 +1,213 @@
+#ifndef __HIRES_HH_2026__
+#define __HIRES_HH_2026__
+/*! \file hires.hh
+ *  \brief Conversion of an image to a C64 hires bitmap.
+ *
+ * The image is cropped to 320×200 pixels and every 8×8 pixel block is
+ * quantised to the two best-matching colours of a C64 palette, the
+ * pair being chosen by exhaustive error minimisation. The pixels then
+ * get the nearest of the two colours or are dithered within the pair
+ * (HiresOptions::dither):
+ * - error diffusion: Stucki, Floyd–Steinberg (serpentine) or Atkinson;
+ * - ordered: Bayer 4×4 or 8×8 or a blue noise tile; every pixel is
+ *   decided on its own, so these run in parallel.
+ *
+ * In FLI mode (HiresOptions::fli_lines) the colour pair may change every
+ * line or every second line of a block: the pairs are chosen per 8×1 or
+ * 8×2 strip and written as eight screen RAMs plus the bitmap (AFLI).
+ * The pair search reads a table of the distances of every pixel to the
+ * sixteen palette colours and runs in HiresOptions::jobs threads.
+ *
+ * The colour pair of each block is normally the one with the smallest
+ * error. With HiresOptions::pair_tolerance the pairs are instead chosen
+ * for the whole bitmap: among the best pairs of every block whose error
+ * is within the tolerance, the sequence with the fewest changes of the
+ * screen RAM byte is taken, which makes the data easier to crunch.
+ * measure_hires() reports the resulting error and size.
+ *
+ * The pairs are chosen for the source image, but error diffusion
+ * changes the pixels they are applied to. HiresOptions::refine_passes
+ * alternates diffusion and a new choice of the pairs for the pixels plus
+ * the error diffused into them, one block row after the other; only
+ * blocks whose incoming error changed are searched again.
+ *
+ * With HiresOptions::integer the conversion keeps the 8-bit pixels of
+ * the input and computes integer squared distances; error diffusion
+ * stores its error as 16-bit fixed point. The colour decisions are those
+ * of the double precision pipeline except where two choices are within
+ * the rounding of the integer distances.
+ *
+ * This is the core of graphconv. Everything works on memory buffers and
+ * the palette is passed explicitly, so several conversions with
+ * different palettes can run concurrently.
+ */
+#include "c64palette.hh"
+#include "imageload.hh"
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+inline constexpr unsigned HIRES_W = 320; ///< C64 hires bitmap width in pixels
+inline constexpr unsigned HIRES_H = 200; ///< C64 hires bitmap height in pixels
+
+/**
+ * \brief One 8×8 character block with its two palette colours.
+ *
+ * \c idx0 and \c idx1 index into the palette (0–15).
+ * \c data holds 64 per-pixel colour decisions in row-major order:
+ * \c false → colour \c idx0, \c true → colour \c idx1.
+ *
+ * FLI blocks have a colour pair per pixel row in \c line_colours; the
+ * bits of a row then select from its pair, and \c idx0 and \c idx1 are
+ * the pair of the first row.
+ */
+struct CharBlock {
+  int idx0, idx1;         ///< Palette indices for the bit-0 and bit-1 colours
+  std::vector<bool> data; ///< Per-pixel colour assignment (exactly 64 elements)
+  std::vector<std::pair<int, int> > line_colours; ///< FLI: pair of each of the 8 rows, empty otherwise
+
+  void swap_colours() {
+    std::swap(idx0, idx1);
+    for(auto &[c0, c1] : line_colours) {
+      std::swap(c0, c1);
+    }
+    // Here `auto &&` has to be used as a vector implements the
+    // specialisation for bool with proxy objects, a `bool &` will
+    // give an error.
+    for(auto &&b : data) {
+       b = !b;
+    }
+  }
+  bool all_equal() const {
+    /*
+     * Nice trick: identity just returns the first element given so if
+     * the first element is false, it returns false, if it is true it
+     * returns true. Then the algorithm can check if all other
+     * elements are the same.
+     */
+    return std::all_of(data.begin(), data.end(), std::identity());
+  }
+};
+
+/// Dithering of a hires conversion.
+enum class Dither {
+  none,            ///< Nearest of the two block colours
+  stucki,          ///< Stucki error diffusion
+  floyd_steinberg, ///< Floyd–Steinberg error diffusion, serpentine
+  atkinson,        ///< Atkinson error diffusion (¾ of the error)
+  bayer4,          ///< Ordered, 4×4 Bayer matrix
+  bayer8,          ///< Ordered, 8×8 Bayer matrix
+  blue_noise,      ///< Ordered, 32×32 blue noise tile
+};
+
+/// True for the error diffusions, the dithers --refine works with.
+[[nodiscard]] constexpr bool is_error_diffusion(Dither dither) noexcept {
+  return dither == Dither::stucki || dither == Dither::floyd_steinberg || dither == Dither::atkinson;
+}
+
+/// Registry: map dither name → Dither, for the command line.
+extern const std::map<std::string, Dither> dither_registry;
+
+/*! \brief Comma separated list of all dither names, for help texts. */
+std::string dither_names();
+
+/**
+ * \brief Parameters of a hires conversion.
+ */
+struct HiresOptions {
+  const C64Palette *palette = &palette_grafx2; ///< Palette to match against
+  Dither dither = Dither::none;                ///< Dithering within the block colours
+  std::ostream *verbose = nullptr;             ///< Per-block diagnostics (nearest-colour mode, not integer)
+  unsigned fli_lines = 0;                      ///< FLI: raster lines per colour pair (1, 2 or 4), 0 for hires
+  unsigned jobs = 1;                           ///< Threads of the colour pair search
+  double pair_tolerance = 0;                   ///< Pair optimisation: accepted error increase per block (0.05 = 5 %), 0 = off
+  unsigned pair_candidates = 8;                ///< Pair optimisation: best pairs considered per block
+  unsigned refine_passes = 0;                  ///< Error diffusion: passes choosing the pairs again, 0 = off
+  bool integer = false;                        ///< 8-bit pixels and integer arithmetic instead of doubles
+};
+
+/**
+ * \brief A converted hires bitmap.
+ */
+struct HiresBitmap {
+  std::list<CharBlock> blocks; ///< 40×25 blocks, left to right and top to bottom
+  ImageBuffer image;           ///< The quantised 320×200 image (RGB)
+};
+
+/**
+ * \brief Convert the top-left 320×200 pixels of an image.
+ *
+ * \param img source image in any pixel format
+ * \param opts palette and quantisation mode
+ * \return blocks and the quantised image
+ * \throw std::invalid_argument if the image is smaller than 320×200,
+ *        opts.fli_lines is not 0, 1, 2 or 4, the pair optimisation
+ *        options are invalid or combined with FLI, or the refinement is
+ *        requested without error diffusion, with the optimisation or in
+ *        the integer pipeline
+ */
+HiresBitmap convert_hires(const ImageBuffer &img, const HiresOptions &opts);
+
+/**
+ * \brief Quality and size figures of a converted bitmap.
+ */
+struct HiresMeasure {
+  double error = 0;            ///< Sum of the RGB distances of all pixels to the source image
+  unsigned colour_changes = 0; ///< Screen RAM bytes differing from their predecessor
+  std::size_t raw_size = 0;    ///< Size of the written file
+  std::size_t packed_size = 0; ///< Size of the written file after run-length encoding
+};
+
+/**
+ * \brief Compare a conversion with its source and estimate its packed size.
+ *
+ * The bitmap is serialised like graphconv writes it (write_char_blocks()
+ * or write_fli_blocks()). The packed size is that of a simple run-length
+ * encoding, in which runs of three or more equal bytes take three bytes;
+ * it is an estimate of what a cruncher gains, not the size of any
+ * particular packer.
+ *
+ * \param img the image given to convert_hires()
+ * \param bitmap its result
+ */
+HiresMeasure measure_hires(const ImageBuffer &img, const HiresBitmap &bitmap);
+
+/**
+ * \brief Serialise a list of CharBlocks to a raw C64 bitmap stream.
+ *
+ * Output layout:
+ *  - 2-byte little-endian load address
+ *  - Bitmap section: 8 bytes per block, one bit per pixel,
+ *    left-to-right / top-to-bottom (320×200÷8 = 8 000 bytes)
+ *  - Colour attribute section: one byte per block,
+ *    high nybble = idx1, low nybble = idx0 (40×25 = 1 000 bytes)
+ */
+void write_char_blocks(const std::list<CharBlock> &blocks, std::ostream &out,
+                       unsigned short addr = 0x2000);
+
+/**
+ * \brief Serialise FLI blocks to an AFLI file.
+ *
+ * Output layout:
+ *  - 2-byte little-endian load address
+ *  - Eight screen RAMs of 1 024 bytes, screen \c n holding the colours
+ *    of pixel row \c n of every block (high nybble = bit-1 colour),
+ *    1 000 bytes each followed by 24 zero bytes
+ *  - Bitmap section as in write_char_blocks(), at \p addr + 0x2000
+ *
+ * The display code switches the screen RAM on every raster line. The
+ * leftmost three blocks are hidden by the FLI bug on real hardware;
+ * they are converted like all others.
+ *
+ * \throw std::invalid_argument if a block has no line colours
+ */
+void write_fli_blocks(const std::list<CharBlock> &blocks, std::ostream &out,
+                      unsigned short addr = 0x4000);
+
+#endif
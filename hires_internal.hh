@@ -0,0 +1,262 @@
+#ifndef __HIRES_INTERNAL_HH_2026__
+#define __HIRES_INTERNAL_HH_2026__
+/*! \file hires_internal.hh
+ *  \brief Internals of hires.cc for c64gfxbench.
+ *
+ * The types, passes and dithering engines of the hires conversion which
+ * the benchmarks measure on their own. They are no part of the library
+ * interface, which is hires.hh; the functions are documented at their
+ * definitions in hires.cc.
+ */
+#include "hires.hh"
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <list>
+#include <ostream>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace hires_internal {
+
+inline constexpr unsigned BLK = 8; ///< Character block side length in pixels
+
+/// RGB colour in the [0,1]³ cube.
+using RGB = std::array<double, 3>;
+
+/**
+ * \brief The image being quantised, one RGB triple per pixel.
+ *
+ * Quantised pixels are written back, so after the conversion the canvas
+ * holds the image as the C64 shows it.
+ */
+struct Canvas {
+  unsigned width = 0;
+  unsigned height = 0;
+  std::vector<RGB> pixels;
+
+  [[nodiscard]] const RGB &at(unsigned x, unsigned y) const { return pixels[y * width + x]; }
+  [[nodiscard]] RGB &at(unsigned x, unsigned y) { return pixels[y * width + x]; }
+};
+
+/**
+ * \brief Euclidean distance between two RGB colours in the [0,1]³ cube.
+ */
+[[nodiscard]] inline double col_dist(const RGB &a, const RGB &b) noexcept {
+  return std::sqrt(std::pow(a[0] - b[0], 2) +
+                   std::pow(a[1] - b[1], 2) +
+                   std::pow(a[2] - b[2], 2));
+}
+
+// ── distance table ───────────────────────────────────────────────────────────
+
+/**
+ * \brief Distances of every pixel of a canvas to the palette colours.
+ *
+ * The colour pair search evaluates 120 pairs per block; with the table
+ * col_dist() is computed once per pixel and colour instead of twice per
+ * pixel and pair, and the search only adds up minima. The table has a
+ * plane per colour, so the distances of a strip row to a colour are
+ * adjacent and block_error() takes the minima of two rows element by
+ * element, which the compiler vectorises.
+ *
+ * \tparam T double for the distances in the [0,1]³ cube, std::uint16_t
+ *         for the integer pipeline (see DistanceTable16)
+ */
+template <typename T> struct BasicDistanceTable {
+  unsigned width = 0;
+  unsigned height = 0;
+  std::array<std::vector<T>, NCOLORS> planes; ///< Row-major distances to every colour
+
+  BasicDistanceTable(unsigned w, unsigned h) : width(w), height(h) {
+    for(auto &plane : planes) {
+      plane.resize(w * h);
+    }
+  }
+
+  /// The distances to colour \p c from the pixel at \p x, \p y on to the right.
+  [[nodiscard]] const T *row(int c, unsigned x, unsigned y) const { return planes[c].data() + y * width + x; }
+  [[nodiscard]] T *row(int c, unsigned x, unsigned y) { return planes[c].data() + y * width + x; }
+};
+
+using DistanceTable = BasicDistanceTable<double>;
+/// Distances in 1/DIST_SCALE of an 8-bit step, for the integer pipeline.
+using DistanceTable16 = BasicDistanceTable<std::uint16_t>;
+
+[[nodiscard]] DistanceTable distance_table(const Canvas &img, const C64Palette &palette, unsigned jobs);
+
+// ── colour pairs ─────────────────────────────────────────────────────────────
+
+/**
+ * \brief Error of the colour pair for the strip of \p lines rows of the block at \p x_, \p y_.
+ *
+ * The sum stops after the row in which it reaches \p bound, since the
+ * pair cannot be better than the one which set the bound anyway.
+ */
+template <typename T>
+[[nodiscard]] double block_error(const BasicDistanceTable<T> &table, unsigned x_, unsigned y_, unsigned lines,
+                                 int cidx0, int cidx1,
+                                 double bound = std::numeric_limits<double>::infinity()) noexcept {
+  assert(cidx0 < NCOLORS && cidx1 < NCOLORS);
+  // Integer distances are added up exactly, 64 of them fit easily, and
+  // compared with the bound rounded up.
+  using Sum = std::conditional_t<std::is_floating_point_v<T>, double, std::uint32_t>;
+  Sum limit = std::numeric_limits<Sum>::max();
+  if constexpr(std::is_floating_point_v<T>) {
+    limit = bound;
+  } else if(bound < limit) {
+    limit = static_cast<Sum>(std::ceil(bound));
+  }
+  Sum total = 0;
+  for(unsigned dy = 0; dy < lines && total < limit; ++dy) {
+    const T *row0 = table.row(cidx0, x_, y_ + dy);
+    const T *row1 = table.row(cidx1, x_, y_ + dy);
+    for(unsigned dx = 0; dx < BLK; ++dx) {
+      total += std::min(row0[dx], row1[dx]);
+    }
+  }
+  return total;
+}
+
+template <typename T>
+[[nodiscard]] std::vector<std::pair<int, int> > strip_pairs(const BasicDistanceTable<T> &table, unsigned lines,
+                                                           unsigned jobs);
+
+template <typename T>
+unsigned optimise_pairs(const BasicDistanceTable<T> &table, std::vector<std::pair<int, int> > &pairs, double tolerance,
+                        unsigned count, unsigned jobs);
+
+/// Parameters of the colour pair search of a conversion pass.
+struct PairSearch {
+  unsigned lines = BLK;    ///< Pixel rows per colour pair, BLK for hires
+  unsigned jobs = 1;       ///< Threads of the search
+  double tolerance = 0;    ///< optimise_pairs() tolerance, 0 for the greedy pairs
+  unsigned candidates = 8; ///< optimise_pairs() candidates per block
+};
+
+// ── conversion passes ────────────────────────────────────────────────────────
+
+[[nodiscard]] std::list<CharBlock> handle_block_wise(Canvas &img, const C64Palette &palette,
+                                                     std::ostream *verbose, const PairSearch &search = {});
+
+[[nodiscard]] std::list<CharBlock> handle_strip_wise(Canvas &img, const C64Palette &palette,
+                                                     const PairSearch &search);
+
+// ── dithering ────────────────────────────────────────────────────────────────
+
+/**
+ * \brief The colour pairs of the strips of a canvas, as search_pairs() returns them.
+ */
+struct StripColours {
+  const std::vector<std::pair<int, int> > &pairs;
+  unsigned lines; ///< Pixel rows per colour pair
+  unsigned bw;    ///< Blocks per row
+
+  [[nodiscard]] std::pair<int, int> at(unsigned x, unsigned y) const { return pairs[(y / lines) * bw + x / BLK]; }
+};
+
+/**
+ * \brief A dithering engine.
+ *
+ * Decides every pixel of \p img between the two colours of its strip,
+ * writes the chosen colour back into \p img and the decision into
+ * \p bits (row-major, 1 for the second colour of the pair). Engines
+ * whose rows are independent use \p jobs threads.
+ */
+using DitherEngine = void (*)(Canvas &img, const C64Palette &palette, const StripColours &colours,
+                              std::vector<std::uint8_t> &bits, unsigned jobs);
+
+/// Offset (dx, dy) and weight of an error diffusion kernel entry.
+using KernelEntry = std::tuple<int, int, int>;
+
+/**
+ * \brief An error diffusion kernel.
+ */
+struct DiffusionKernel {
+  std::span<const KernelEntry> entries; ///< Targets of the error for a row processed left to right
+  double divisor;                       ///< The weights are divided by it; if they sum up to less,
+                                        ///< part of the error is dropped (Atkinson)
+  bool serpentine;                      ///< Every second row right to left, with the kernel mirrored
+
+  /// Number of rows below a pixel which receive its error.
+  [[nodiscard]] int reach() const {
+    int ret = 0;
+    for(const auto &[dx, dy, w] : entries) {
+      ret = std::max(ret, dy);
+    }
+    return ret;
+  }
+};
+
+/// Stucki, the error diffusion of --stucki.
+extern const DiffusionKernel STUCKI;
+
+void dither_stucki(Canvas &img, const C64Palette &palette, const StripColours &colours,
+                   std::vector<std::uint8_t> &bits, unsigned jobs);
+void dither_floyd_steinberg(Canvas &img, const C64Palette &palette, const StripColours &colours,
+                            std::vector<std::uint8_t> &bits, unsigned jobs);
+void dither_atkinson(Canvas &img, const C64Palette &palette, const StripColours &colours,
+                     std::vector<std::uint8_t> &bits, unsigned jobs);
+void dither_bayer4(Canvas &img, const C64Palette &palette, const StripColours &colours,
+                   std::vector<std::uint8_t> &bits, unsigned jobs);
+void dither_bayer8(Canvas &img, const C64Palette &palette, const StripColours &colours,
+                   std::vector<std::uint8_t> &bits, unsigned jobs);
+void dither_blue_noise(Canvas &img, const C64Palette &palette, const StripColours &colours,
+                       std::vector<std::uint8_t> &bits, unsigned jobs);
+
+/// A square tile of thresholds of an ordered dithering.
+struct ThresholdMap {
+  const std::uint8_t *thresholds; ///< \c size × \c size thresholds, row-major, in [0, \c levels)
+  unsigned size;
+  unsigned levels;
+};
+
+[[nodiscard]] const DiffusionKernel *diffusion_kernel(Dither dither) noexcept;
+[[nodiscard]] const ThresholdMap *threshold_map(Dither dither) noexcept;
+
+[[nodiscard]] std::list<CharBlock> handle_refined(Canvas &img, const C64Palette &palette,
+                                                  const DiffusionKernel &kernel, const PairSearch &search,
+                                                  unsigned passes);
+
+// ── integer pipeline ─────────────────────────────────────────────────────────
+
+/// RGB colour with 8 bits per channel.
+using RGB8 = std::array<std::uint8_t, 3>;
+
+/// A palette with 8 bits per channel.
+using Palette8 = std::array<RGB8, NCOLORS>;
+
+/**
+ * \brief The image being quantised in the integer pipeline.
+ *
+ * Like Canvas, but with the 8-bit values of the input: 3 bytes per pixel
+ * instead of 24.
+ */
+struct Canvas8 {
+  unsigned width = 0;
+  unsigned height = 0;
+  std::vector<RGB8> pixels;
+
+  [[nodiscard]] const RGB8 &at(unsigned x, unsigned y) const { return pixels[y * width + x]; }
+  [[nodiscard]] RGB8 &at(unsigned x, unsigned y) { return pixels[y * width + x]; }
+};
+
+[[nodiscard]] Palette8 palette8(const C64Palette &palette) noexcept;
+[[nodiscard]] DistanceTable16 distance_table(const Canvas8 &img, const Palette8 &palette, unsigned jobs);
+
+void ordered8(Canvas8 &img, const Palette8 &palette, const StripColours &colours, std::vector<std::uint8_t> &bits,
+              unsigned jobs, const ThresholdMap &map);
+void diffuse8(Canvas8 &img, const Palette8 &palette, const StripColours &colours, std::vector<std::uint8_t> &bits,
+              const DiffusionKernel &kernel);
+
+[[nodiscard]] std::list<CharBlock> handle_integer(Canvas8 &img, const Palette8 &palette, Dither dither,
+                                                  const PairSearch &search);
+
+} // namespace hires_internal
+
+#endif
@@ -0,0 +1,384 @@
+#include "imageload.hh"
+#include "runstats.hh"
+#include <algorithm>
+#include <cctype>
+#include <csetjmp>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <png.h>
+#include <stdexcept>
+
+namespace {
+
+// ── PNG ───────────────────────────────────────────────────────────────────────
+
+/// Input position in the PNG data; frees the libpng structures.
+struct PngReader {
+  std::span<const std::uint8_t> data;
+  std::size_t pos = 0;
+  png_structp png = nullptr;
+  png_infop info = nullptr;
+
+  ~PngReader() {
+    png_destroy_read_struct(&png, info ? &info : nullptr, nullptr);
+  }
+};
+
+/// libpng read callback taking the bytes from PngReader::data.
+void read_png_data(png_structp png, png_bytep out, png_size_t length) {
+  auto *reader = static_cast<PngReader *>(png_get_io_ptr(png));
+  if(length > reader->data.size() - reader->pos) {
+    png_error(png, "truncated PNG data");
+  }
+  std::memcpy(out, reader->data.data() + reader->pos, length);
+  reader->pos += length;
+}
+
+/// Largest accepted PNG width and height in pixels.
+inline constexpr png_uint_32 MAX_PNG_SIDE = 16384;
+/// Largest ratio of inflated to deflated data, deflate does not compress better than 1032:1.
+inline constexpr std::uint64_t DEFLATE_MAX_RATIO = 1032;
+
+/*! \brief Read the PNG header, like decode_png() a frame which libpng may longjmp out of.
+ *
+ * \return false on a libpng error
+ */
+bool read_png_info(PngReader &reader) {
+  if(setjmp(png_jmpbuf(reader.png))) {
+    return false;
+  }
+  png_set_read_fn(reader.png, &reader, read_png_data);
+  png_read_info(reader.png, reader.info);
+  return true;
+}
+
+/*! \brief Reject a PNG header whose image cannot be in the file.
+ *
+ * The image buffer is allocated from the header before the compressed
+ * data is read, so a forged header of a few bytes could request
+ * gigabytes. The filtered rows, one byte per row more than the raw
+ * pixels, have to fit into the file at the best deflate ratio, and no
+ * side may exceed MAX_PNG_SIDE.
+ */
+void check_png_size(const PngReader &reader) {
+  const png_uint_32 width = png_get_image_width(reader.png, reader.info);
+  const png_uint_32 height = png_get_image_height(reader.png, reader.info);
+  if(width > MAX_PNG_SIDE || height > MAX_PNG_SIDE) {
+    throw std::runtime_error(
+            std::format("PNG image of {}x{} pixels is too large, at most {} per side", width, height, MAX_PNG_SIDE));
+  }
+  const std::uint64_t filtered = std::uint64_t{ height } * (png_get_rowbytes(reader.png, reader.info) + 1);
+  if(filtered > reader.data.size() * DEFLATE_MAX_RATIO) {
+    throw std::runtime_error("truncated PNG file");
+  }
+}
+
+/*! \brief Read the image data, the part of load_png() which libpng may longjmp out of.
+ *
+ * Only trivially destructible locals live in this frame; \p img and
+ * \p rows belong to the caller. read_png_info() has read the header.
+ *
+ * \return false on a libpng error
+ */
+bool decode_png(PngReader &reader, ImageBuffer &img, std::vector<png_bytep> &rows) {
+  if(setjmp(png_jmpbuf(reader.png))) {
+    return false;
+  }
+  const png_byte colour_type = png_get_color_type(reader.png, reader.info);
+  const png_byte bit_depth = png_get_bit_depth(reader.png, reader.info);
+  const bool trns = png_get_valid(reader.png, reader.info, PNG_INFO_tRNS);
+  img.width = png_get_image_width(reader.png, reader.info);
+  img.height = png_get_image_height(reader.png, reader.info);
+  if(bit_depth == 16) {
+    png_set_strip_16(reader.png);
+  }
+  if(bit_depth < 8) {
+    png_set_packing(reader.png);
+  }
+  if(colour_type == PNG_COLOR_TYPE_PALETTE) {
+    png_colorp plte = nullptr;
+    int count = 0;
+    png_bytep alpha = nullptr;
+    int alpha_count = 0;
+    png_get_PLTE(reader.png, reader.info, &plte, &count);
+    if(trns) {
+      png_get_tRNS(reader.png, reader.info, &alpha, &alpha_count, nullptr);
+    }
+    img.format = PixelFormat::indexed;
+    img.palette.resize(count);
+    for(int i = 0; i < count; ++i) {
+      img.palette[i] = { plte[i].red, plte[i].green, plte[i].blue,
+                         static_cast<std::uint8_t>(i < alpha_count ? alpha[i] : 255) };
+    }
+  } else if(colour_type == PNG_COLOR_TYPE_GRAY && !trns) {
+    img.format = PixelFormat::grey;
+    if(bit_depth < 8) {
+      png_set_expand_gray_1_2_4_to_8(reader.png);
+    }
+  } else {
+    png_set_expand(reader.png);
+    png_set_gray_to_rgb(reader.png);
+    img.format = (colour_type & PNG_COLOR_MASK_ALPHA) || trns ? PixelFormat::rgba : PixelFormat::rgb;
+  }
+  png_set_interlace_handling(reader.png);
+  png_read_update_info(reader.png, reader.info);
+
+  img.pixels.resize(img.stride() * img.height);
+  rows.resize(img.height);
+  for(unsigned y = 0; y < img.height; ++y) {
+    rows[y] = img.row(y);
+  }
+  png_read_image(reader.png, rows.data());
+  png_read_end(reader.png, nullptr);
+  return true;
+}
+
+/*! \brief Decode a PNG file.
+ *
+ * Palette images keep their indices (bit depths below 8 are unpacked),
+ * grey images stay grey, everything else becomes RGB or RGBA. 16-bit
+ * channels are reduced to 8 bits and tRNS chunks become alpha.
+ */
+ImageBuffer load_png(std::span<const std::uint8_t> data) {
+  PngReader reader;
+  reader.data = data;
+  reader.png = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+  if(reader.png) {
+    reader.info = png_create_info_struct(reader.png);
+  }
+  if(!reader.info) {
+    throw std::runtime_error("cannot initialise libpng");
+  }
+  if(!read_png_info(reader)) {
+    throw std::runtime_error("not a valid PNG file");
+  }
+  check_png_size(reader);
+  ImageBuffer img;
+  std::vector<png_bytep> rows;
+  if(!decode_png(reader, img, rows)) {
+    throw std::runtime_error("not a valid PNG file");
+  }
+  return img;
+}
+
+// ── PNM ───────────────────────────────────────────────────────────────────────
+
+/// Read the next decimal header value, skipping white space and comments.
+unsigned pnm_value(std::span<const std::uint8_t> data, std::size_t &pos) {
+  while(pos < data.size()) {
+    if(data[pos] == '#') {
+      while(pos < data.size() && data[pos] != '\n') {
+        ++pos;
+      }
+    } else if(std::isspace(data[pos])) {
+      ++pos;
+    } else {
+      break;
+    }
+  }
+  if(pos >= data.size() || !std::isdigit(data[pos])) {
+    throw std::runtime_error("malformed PNM header");
+  }
+  unsigned value = 0;
+  while(pos < data.size() && std::isdigit(data[pos])) {
+    const unsigned digit = data[pos++] - '0';
+    if(value > (std::numeric_limits<unsigned>::max() - digit) / 10) {
+      throw std::runtime_error("PNM header value out of range");
+    }
+    value = value * 10 + digit;
+  }
+  return value;
+}
+
+/*! \brief Decode a PBM, PGM or PPM file (plain or raw).
+ *
+ * Bitmaps and grey maps become grey images (set bits are black), pixmaps
+ * become RGB. Samples with a maximum value other than 255 are scaled.
+ */
+ImageBuffer load_pnm(std::span<const std::uint8_t> data) {
+  const char kind = static_cast<char>(data[1]);
+  const bool plain = kind <= '3';
+  const bool bitmap = kind == '1' || kind == '4';
+  ImageBuffer img;
+  std::size_t pos = 2;
+
+  img.width = pnm_value(data, pos);
+  img.height = pnm_value(data, pos);
+  const unsigned maxval = bitmap ? 1 : pnm_value(data, pos);
+  if(maxval == 0 || maxval > 65535) {
+    throw std::runtime_error("malformed PNM header");
+  }
+  img.format = (kind == '3' || kind == '6') ? PixelFormat::rgb : PixelFormat::grey;
+  if(!plain) {
+    ++pos; // single white space character between header and raster
+  }
+  // The raster has to be in the file before it is allocated, so that a
+  // forged header cannot request gigabytes. A plain sample takes at least
+  // one byte.
+  const unsigned bytes = maxval > 255 ? 2 : 1;
+  const std::uint64_t row_bytes = !plain && bitmap ? (std::uint64_t{ img.width } + 7) / 8
+                                                   : std::uint64_t{ img.stride() } * (plain ? 1 : bytes);
+  const std::size_t available = pos < data.size() ? data.size() - pos : 0;
+  if(row_bytes != 0 && img.height > available / row_bytes) {
+    throw std::runtime_error("truncated PNM file");
+  }
+  img.pixels.resize(img.stride() * img.height);
+
+  auto scale = [maxval](unsigned v) {
+    return static_cast<std::uint8_t>(maxval == 255 ? v : (v * 255 + maxval / 2) / maxval);
+  };
+  const std::size_t samples = img.pixels.size();
+  if(plain) {
+    for(std::size_t i = 0; i < samples; ++i) {
+      if(bitmap) {
+        while(pos < data.size() && std::isspace(data[pos])) {
+          ++pos;
+        }
+        if(pos >= data.size()) {
+          throw std::runtime_error("truncated PNM file");
+        }
+        img.pixels[i] = data[pos++] == '1' ? 0 : 255;
+      } else {
+        img.pixels[i] = scale(std::min(pnm_value(data, pos), maxval));
+      }
+    }
+  } else if(bitmap) {
+    for(unsigned y = 0; y < img.height; ++y) {
+      for(unsigned x = 0; x < img.width; ++x) {
+        const bool set = (data[pos + y * row_bytes + x / 8] >> (7 - x % 8)) & 1;
+        img.row(y)[x] = set ? 0 : 255;
+      }
+    }
+  } else {
+    for(std::size_t i = 0; i < samples; ++i) {
+      const std::uint8_t *s = &data[pos + i * bytes];
+      img.pixels[i] = scale(bytes == 2 ? (s[0] << 8) | s[1] : s[0]);
+    }
+  }
+  return img;
+}
+
+/// True if \p data starts with the PNG signature.
+bool is_png(std::span<const std::uint8_t> data) {
+  static constexpr std::uint8_t png_signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+  return data.size() >= sizeof png_signature && std::memcmp(data.data(), png_signature, sizeof png_signature) == 0;
+}
+
+/// True if \p data starts with a PBM, PGM or PPM magic number.
+bool is_pnm(std::span<const std::uint8_t> data) {
+  return data.size() >= 2 && data[0] == 'P' && data[1] >= '1' && data[1] <= '6';
+}
+
+} // namespace
+
+ImageBuffer load_image(const std::string &path) {
+  const StageTimer timer(Stage::load);
+  std::ifstream in(path, std::ios::binary);
+  if(!in) {
+    throw std::runtime_error(std::format("cannot open '{}'", path));
+  }
+  const std::vector<std::uint8_t> data{ std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>() };
+  if(!is_png(data) && !is_pnm(data)) {
+    return load_image_fallback(path);
+  }
+  try {
+    return decode_image(data);
+  } catch(const std::runtime_error &e) {
+    throw std::runtime_error(std::format("'{}': {}", path, e.what()));
+  }
+}
+
+ImageBuffer decode_image(std::span<const std::uint8_t> data) {
+  if(is_png(data)) {
+    return load_png(data);
+  }
+  if(is_pnm(data)) {
+    return load_pnm(data);
+  }
+  return decode_image_fallback(data);
+}
+
+ImageBuffer to_rgba(const ImageBuffer &img) {
+  if(img.format == PixelFormat::rgba) {
+    return img;
+  }
+  ImageBuffer ret;
+  ret.width = img.width;
+  ret.height = img.height;
+  ret.format = PixelFormat::rgba;
+  ret.pixels.resize(static_cast<std::size_t>(img.width) * img.height * 4);
+  const std::size_t count = static_cast<std::size_t>(img.width) * img.height;
+  for(std::size_t i = 0; i < count; ++i) {
+    std::uint8_t *out = &ret.pixels[4 * i];
+    switch(img.format) {
+    case PixelFormat::indexed: {
+      const std::uint8_t idx = img.pixels[i];
+      const auto &entry = idx < img.palette.size() ? img.palette[idx] : std::array<std::uint8_t, 4>{ 0, 0, 0, 255 };
+      std::memcpy(out, entry.data(), 4);
+      break;
+    }
+    case PixelFormat::grey:
+      out[0] = out[1] = out[2] = img.pixels[i];
+      out[3] = 255;
+      break;
+    default:
+      std::memcpy(out, &img.pixels[3 * i], 3);
+      out[3] = 255;
+      break;
+    }
+  }
+  return ret;
+}
+
+ImageBuffer to_rgb(const ImageBuffer &img) {
+  if(img.format == PixelFormat::rgb) {
+    return img;
+  }
+  const ImageBuffer rgba = to_rgba(img);
+  ImageBuffer ret;
+  ret.width = img.width;
+  ret.height = img.height;
+  ret.format = PixelFormat::rgb;
+  ret.pixels.resize(static_cast<std::size_t>(img.width) * img.height * 3);
+  for(std::size_t i = 0; i < ret.pixels.size() / 3; ++i) {
+    std::memcpy(&ret.pixels[3 * i], &rgba.pixels[4 * i], 3);
+  }
+  return ret;
+}
+
+ImageBuffer to_grey(const ImageBuffer &img) {
+  if(img.format == PixelFormat::grey) {
+    return img;
+  }
+  const ImageBuffer rgba = to_rgba(img);
+  ImageBuffer ret;
+  ret.width = img.width;
+  ret.height = img.height;
+  ret.format = PixelFormat::grey;
+  ret.pixels.resize(static_cast<std::size_t>(img.width) * img.height);
+  for(std::size_t i = 0; i < ret.pixels.size(); ++i) {
+    const std::uint8_t *p = &rgba.pixels[4 * i];
+    ret.pixels[i] = static_cast<std::uint8_t>((299 * p[0] + 587 * p[1] + 114 * p[2] + 500) / 1000);
+  }
+  return ret;
+}
+
+ImageBuffer crop_image(const ImageBuffer &img, unsigned x, unsigned y, unsigned width, unsigned height) {
+  if(x + width > img.width || y + height > img.height) {
+    throw std::invalid_argument(std::format("cannot cut {}x{} at {},{} out of a {}x{} image",
+                                            width, height, x, y, img.width, img.height));
+  }
+  ImageBuffer ret;
+  ret.width = width;
+  ret.height = height;
+  ret.format = img.format;
+  ret.palette = img.palette;
+  ret.pixels.resize(ret.stride() * height);
+  for(unsigned row = 0; row < height; ++row) {
+    std::memcpy(ret.row(row), img.row(y + row) + x * img.channels(), ret.stride());
+  }
+  return ret;
+}
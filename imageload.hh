@@ -0,0 +1,107 @@
+#ifndef __IMAGELOAD_HH_2026__
+#define __IMAGELOAD_HH_2026__
+/*! \file imageload.hh
+ *  \brief Lightweight image loading shared by all converters.
+ *
+ * PNG (via libpng) and PNM (P1–P6, built in) files are decoded directly
+ * into an ImageBuffer. Every other format is handed to Magick++ (see
+ * load_image_fallback()), so the ImageMagick start-up cost is only paid
+ * for files which really need it.
+ *
+ * Indexed PNGs keep their palette indices, which the sprite converter
+ * depends on; all other images are grey, RGB or RGBA.
+ *
+ * decode_image() does the same for a file which is already in memory,
+ * so a server linking libc64gfx never has to write temporary files.
+ */
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+/// Layout of the pixels of an ImageBuffer.
+enum class PixelFormat {
+  indexed, ///< One palette index per pixel, see ImageBuffer::palette
+  grey,    ///< One 8-bit grey value per pixel
+  rgb,     ///< Three bytes (R, G, B) per pixel
+  rgba,    ///< Four bytes (R, G, B, A) per pixel
+};
+
+/*! \brief A decoded image with 8 bits per channel.
+ *
+ * The pixels are stored row by row without padding.
+ */
+struct ImageBuffer {
+  unsigned width = 0;
+  unsigned height = 0;
+  PixelFormat format = PixelFormat::rgb;
+  std::vector<std::array<std::uint8_t, 4> > palette; ///< RGBA palette (indexed images only)
+  std::vector<std::uint8_t> pixels;
+
+  /// Bytes per pixel.
+  [[nodiscard]] unsigned channels() const noexcept {
+    switch(format) {
+    case PixelFormat::rgb:
+      return 3;
+    case PixelFormat::rgba:
+      return 4;
+    default:
+      return 1;
+    }
+  }
+  /// Bytes per row.
+  [[nodiscard]] std::size_t stride() const noexcept { return static_cast<std::size_t>(width) * channels(); }
+  /// Pointer to the first pixel of row \p y.
+  [[nodiscard]] const std::uint8_t *row(unsigned y) const noexcept { return pixels.data() + y * stride(); }
+  [[nodiscard]] std::uint8_t *row(unsigned y) noexcept { return pixels.data() + y * stride(); }
+};
+
+/*! \brief Load an image file.
+ *
+ * The file type is detected from its signature, not from the file name.
+ *
+ * \param path image file
+ * \return decoded image
+ * \throw std::runtime_error if the file cannot be read or decoded
+ */
+ImageBuffer load_image(const std::string &path);
+
+/*! \brief Decode an image file held in memory.
+ *
+ * \param data complete contents of an image file
+ * \return decoded image
+ * \throw std::runtime_error if the data cannot be decoded
+ */
+ImageBuffer decode_image(std::span<const std::uint8_t> data);
+
+/*! \brief Load an image with Magick++ (any format ImageMagick supports).
+ *
+ * Defined in imageload_magick.cc (part of libc64gfx). Tools which use
+ * Magick++ for nothing else link imageload_plain.cc instead, whose
+ * fallback rejects the file, and can only read PNG and PNM files.
+ *
+ * \return RGBA image
+ */
+ImageBuffer load_image_fallback(const std::string &path);
+
+/*! \brief Decode an image in memory with Magick++, see load_image_fallback(). */
+ImageBuffer decode_image_fallback(std::span<const std::uint8_t> data);
+
+/*! \brief Convert an image to RGB (alpha is dropped). */
+ImageBuffer to_rgb(const ImageBuffer &img);
+
+/*! \brief Convert an image to RGBA. */
+ImageBuffer to_rgba(const ImageBuffer &img);
+
+/*! \brief Convert an image to grey values (Rec. 601 luma). */
+ImageBuffer to_grey(const ImageBuffer &img);
+
+/*! \brief Cut out a rectangle.
+ *
+ * \throw std::invalid_argument if the rectangle is not inside the image
+ */
+ImageBuffer crop_image(const ImageBuffer &img, unsigned x, unsigned y, unsigned width, unsigned height);
+
+#endif
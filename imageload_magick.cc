@@ -0,0 +1,25 @@
+#include "imageload.hh"
+#include <Magick++.h>
+
+namespace {
+
+/// Copy the pixels of a Magick++ image into an RGBA buffer.
+ImageBuffer from_magick(Magick::Image img) {
+  ImageBuffer ret;
+  ret.width = static_cast<unsigned>(img.columns());
+  ret.height = static_cast<unsigned>(img.rows());
+  ret.format = PixelFormat::rgba;
+  ret.pixels.resize(ret.stride() * ret.height);
+  img.write(0, 0, ret.width, ret.height, "RGBA", Magick::CharPixel, ret.pixels.data());
+  return ret;
+}
+
+} // namespace
+
+ImageBuffer load_image_fallback(const std::string &path) {
+  return from_magick(Magick::Image(path));
+}
+
+ImageBuffer decode_image_fallback(std::span<const std::uint8_t> data) {
+  return from_magick(Magick::Image(Magick::Blob(data.data(), data.size())));
+}
@@ -0,0 +1,15 @@
+#include "imageload.hh"
+#include <format>
+#include <stdexcept>
+
+// Fallback for the tools which only read PNG and PNM. Linking this object
+// before libc64gfx.a keeps imageload_magick.o, and with it the ImageMagick
+// libraries, out of the program.
+
+ImageBuffer load_image_fallback(const std::string &path) {
+  throw std::runtime_error(std::format("'{}' is not a PNG or PNM file, convert it to PNG first", path));
+}
+
+ImageBuffer decode_image_fallback(std::span<const std::uint8_t>) {
+  throw std::runtime_error("not a PNG or PNM file");
+}
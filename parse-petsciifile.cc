@@ -1,9 +1,12 @@
 #include "parse-petsciifile.hh"
 #include "petsciiframes.hh"
+#include "runstats.hh"
 #include "cpp-peglib/peglib.h"
+#include <cstdio>
 #include <iostream>
 
 FrameArray parse_file(std::istream &inp) {
+  const StageTimer timer(Stage::parse);
   std::vector<Frame> frames;
   int width = -1;
   int height = -1;
@@ -91,3 +94,25 @@ FrameArray parse_file(std::istream &inp) {
   }
   throw std::logic_error("never reached");
 }
+
+FrameArray read_binary_frames(std::istream &inp) {
+  const StageTimer timer(Stage::parse);
+  const std::size_t cells = WIDTH * HEIGHT;
+  const std::size_t framesize = 2 + 2 * cells;
+  std::vector<Frame> frames;
+  std::vector<char> buffer(framesize);
+
+  while(inp.read(buffer.data(), framesize)) {
+    std::vector<int> data(buffer.size());
+    for(std::size_t i = 0; i < buffer.size(); ++i) {
+      data[i] = static_cast<unsigned char>(buffer[i]);
+    }
+    char name[16];
+    std::snprintf(name, sizeof(name), "_frame%04zu", frames.size());
+    frames.emplace_back(name, data);
+  }
+  if(inp.gcount() != 0) {
+    throw std::invalid_argument("incomplete frame at end of binary input");
+  }
+  return FrameArray{WIDTH, HEIGHT, frames};
+}
@@ -6,5 +6,16 @@
 
 FrameArray parse_file(std::istream &inp);
 
+/*! \brief read a binary frame stream
+ *
+ * The stream holds complete 40*25 frames as written by Frame::save()
+ * (border, background, characters, colours). The frames are named
+ * _frame0000, _frame0001, ...
+ *
+ * \param inp input stream
+ * \return all frames of the stream
+ */
+FrameArray read_binary_frames(std::istream &inp);
+
 
 #endif
@@ -0,0 +1,441 @@
+#include "petscii.hh"
+#include "runstats.hh"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+
+namespace {
+
+/**
+ * \brief Threshold mask and foreground coverage of one grey cell.
+ *
+ * \param grey row-major 8-bit grey values
+ * \param width image width in pixels
+ * \param cx cell column
+ * \param cy cell row
+ * \param threshold pixels darker than this are foreground
+ * \param mask receives the thresholded cell
+ * \param coverage receives the inverted grey values
+ */
+void grey_cell(const std::vector<std::uint8_t> &grey, unsigned width, unsigned cx, unsigned cy,
+               std::uint8_t threshold, GlyphWord &mask, CellValues &coverage) {
+  mask = 0;
+  for(unsigned y = 0; y < CELL; ++y) {
+    const std::uint8_t *row = grey.data() + (cy * CELL + y) * width + cx * CELL;
+    for(unsigned x = 0; x < CELL; ++x) {
+      mask = (mask << 1) | (row[x] < threshold ? 1u : 0u);
+      coverage[y * CELL + x] = static_cast<std::uint8_t>(255 - row[x]);
+    }
+  }
+}
+
+/**
+ * \brief Palette scaled to 8-bit integer RGB.
+ */
+[[nodiscard]] std::array<std::array<int, 3>, NCOLORS> palette8(const C64Palette &palette) {
+  std::array<std::array<int, 3>, NCOLORS> ret;
+  for(int c = 0; c < NCOLORS; ++c) {
+    for(unsigned k = 0; k < 3; ++k) {
+      ret[c][k] = static_cast<int>(palette[c][k] * 255.0 + 0.5);
+    }
+  }
+  return ret;
+}
+
+/**
+ * \brief Squared distance between an 8-bit RGB pixel and a palette colour.
+ */
+[[nodiscard]] inline int rgb_dist(const std::uint8_t *rgb, const std::array<int, 3> &pal) noexcept {
+  int d = 0;
+  for(unsigned k = 0; k < 3; ++k) {
+    const int diff = rgb[k] - pal[k];
+    d += diff * diff;
+  }
+  return d;
+}
+
+} // namespace
+
+unsigned quad_pattern(unsigned code) {
+  const auto it = std::find(screen_code_blocks.begin(), screen_code_blocks.end(), code);
+  return it == screen_code_blocks.end() ? 0 : static_cast<unsigned>(std::distance(screen_code_blocks.begin(), it));
+}
+
+// ── glyph matching ────────────────────────────────────────────────────────────
+
+std::array<GlyphWord, 256> charset_from_rom(std::span<const std::uint8_t> rom, bool lowercase) {
+  if(rom.size() != 2048 && rom.size() != 4096) {
+    throw std::invalid_argument(std::format("charset has {} bytes, expected 2048 or 4096", rom.size()));
+  }
+  if(lowercase && rom.size() == 2048) {
+    throw std::invalid_argument("charset has 2048 bytes, the lower case set needs the 4096 byte ROM");
+  }
+  const std::size_t offset = lowercase ? 2048 : 0;
+  std::array<GlyphWord, 256> glyphs;
+  for(unsigned i = 0; i < glyphs.size(); ++i) {
+    glyphs[i] = glyph_from_bytes(&rom[offset + i * 8]);
+  }
+  return glyphs;
+}
+
+std::array<GlyphWord, 256> load_charset(const std::string &path, bool lowercase) {
+  std::ifstream in(path, std::ios::binary);
+  const std::vector<std::uint8_t> rom((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  try {
+    return charset_from_rom(rom, lowercase);
+  } catch(const std::invalid_argument &e) {
+    throw std::invalid_argument(std::format("'{}': {}", path, e.what()));
+  }
+}
+
+CellValues blur_cell(const CellValues &in) {
+  CellValues out;
+  for(int y = 0; y < static_cast<int>(CELL); ++y) {
+    for(int x = 0; x < static_cast<int>(CELL); ++x) {
+      unsigned sum = 0;
+      for(int dy = -1; dy <= 1; ++dy) {
+        for(int dx = -1; dx <= 1; ++dx) {
+          const int sx = std::clamp(x + dx, 0, static_cast<int>(CELL) - 1);
+          const int sy = std::clamp(y + dy, 0, static_cast<int>(CELL) - 1);
+          sum += in[sy * CELL + sx] * ((dx == 0 ? 2u : 1u) * (dy == 0 ? 2u : 1u));
+        }
+      }
+      out[y * CELL + x] = static_cast<std::uint8_t>(sum / 16);
+    }
+  }
+  return out;
+}
+
+// ── image scanning ────────────────────────────────────────────────────────────
+
+PetsciiScreen scan_image_quads(const std::vector<std::uint8_t> &grey, unsigned width, unsigned height,
+                               std::uint8_t threshold) {
+  PetsciiScreen ret;
+  ret.columns = width / 2;
+  ret.rows = height / 2;
+  for(unsigned row = 0; row + 1 < height; row += 2) {
+    const std::uint8_t *top = grey.data() + static_cast<std::size_t>(row) * width;
+    const std::uint8_t *bottom = top + width;
+    for(unsigned col = 0; col + 1 < width; col += 2) {
+      /*
+       * Sample the four pixels of the 2×2 quad:
+       *   tl tr
+       *   bl br
+       *
+       * Dark pixels are foreground, so they are the "set" bits.
+       */
+      const bool tl = top[col] < threshold;
+      const bool tr = top[col + 1] < threshold;
+      const bool bl = bottom[col] < threshold;
+      const bool br = bottom[col + 1] < threshold;
+
+      const unsigned idx = (tl << 3) | (tr << 2) | (bl << 1) | br;
+      ret.chars.push_back(screen_code_blocks[idx]);
+      ret.pixels.push_back(static_cast<std::uint8_t>(idx));
+    }
+  }
+  ret.errors.assign(ret.chars.size(), 0);
+  ret.width = ret.columns;
+  return ret;
+}
+
+PetsciiScreen scan_image_glyphs(const std::vector<std::uint8_t> &grey, unsigned width, unsigned height,
+                              std::uint8_t threshold, const GlyphMatcher &matcher, bool perceptual) {
+  PetsciiScreen ret;
+  ret.columns = width / CELL;
+  ret.rows = height / CELL;
+  ret.chars.reserve(ret.columns * ret.rows);
+  for(unsigned cy = 0; cy < ret.rows; ++cy) {
+    for(unsigned cx = 0; cx < ret.columns; ++cx) {
+      GlyphWord mask;
+      CellValues coverage;
+      grey_cell(grey, width, cx, cy, threshold, mask, coverage);
+      if(perceptual) {
+        const unsigned code = matcher.match_perceptual(coverage);
+        ret.chars.push_back(static_cast<std::uint8_t>(code));
+        ret.errors.push_back(matcher.perceptual_error(coverage, code));
+      } else {
+        const unsigned code = matcher.match(mask);
+        ret.chars.push_back(static_cast<std::uint8_t>(code));
+        ret.errors.push_back(glyph_distance(mask, matcher.glyph(code)));
+      }
+    }
+  }
+  ret.width = width;
+  ret.pixels = grey;
+  return ret;
+}
+
+/**
+ * \brief Convert RGB values into screen codes and per-cell colours.
+ *
+ * Every pixel is compared with the background colour and each candidate
+ * foreground colour (the colours which are nearest to at least one pixel
+ * of the cell). For each candidate the best glyph is matched against the
+ * pixels closer to the candidate than to the background; the candidate
+ * whose rendered cell has the smallest colour error wins.
+ *
+ * \param rgb row-major interleaved 8-bit RGB values
+ * \param width image width in pixels (whole cells are converted)
+ * \param height image height in pixels
+ * \param palette palette to match against
+ * \param background fixed background colour, most frequent colour if empty
+ * \param matcher glyph matcher
+ * \param perceptual use the blurred error for the glyph choice
+ */
+PetsciiScreen scan_image_glyphs_colour(const std::vector<std::uint8_t> &rgb, unsigned width, unsigned height,
+                                     const C64Palette &palette, std::optional<int> background,
+                                     const GlyphMatcher &matcher, bool perceptual) {
+  PetsciiScreen ret;
+  ret.columns = width / CELL;
+  ret.rows = height / CELL;
+
+  // Squared 8-bit distances of every pixel to every palette colour.
+  const auto pal8 = palette8(palette);
+  std::vector<std::array<int, NCOLORS> > dist(static_cast<std::size_t>(width) * height);
+  std::vector<std::uint8_t> nearest(dist.size());
+  std::array<unsigned, NCOLORS> histogram{};
+  for(std::size_t i = 0; i < dist.size(); ++i) {
+    for(int c = 0; c < NCOLORS; ++c) {
+      dist[i][c] = rgb_dist(&rgb[3 * i], pal8[c]);
+    }
+    nearest[i] = static_cast<std::uint8_t>(std::distance(dist[i].begin(), std::min_element(dist[i].begin(), dist[i].end())));
+    ++histogram[nearest[i]];
+  }
+  ret.background = background.value_or(
+    static_cast<int>(std::distance(histogram.begin(), std::max_element(histogram.begin(), histogram.end()))));
+  const int bg = ret.background;
+
+  for(unsigned cy = 0; cy < ret.rows; ++cy) {
+    for(unsigned cx = 0; cx < ret.columns; ++cx) {
+      // Distances of the cell, one contiguous row of 64 pixels per colour.
+      std::array<std::array<int, CELL * CELL>, NCOLORS> cell;
+      unsigned present = 0; // Bit set of candidate colours.
+      for(unsigned y = 0; y < CELL; ++y) {
+        for(unsigned x = 0; x < CELL; ++x) {
+          const std::size_t idx = (cy * CELL + y) * width + cx * CELL + x;
+          for(int c = 0; c < NCOLORS; ++c) {
+            cell[c][y * CELL + x] = dist[idx][c];
+          }
+          present |= 1u << nearest[idx];
+        }
+      }
+      present &= ~(1u << bg);
+
+      const auto &db = cell[bg];
+      unsigned best_code = matcher.match(0);
+      int best_colour = bg;
+      long best_err = 0; // Every pixel shows the background.
+      for(int d : db) {
+        best_err += d;
+      }
+      for(int c = 0; c < NCOLORS; ++c) {
+        if((present & (1u << c)) == 0) {
+          continue;
+        }
+        const auto &dc = cell[c];
+        unsigned code;
+        if(perceptual) {
+          CellValues coverage;
+          for(unsigned p = 0; p < CELL * CELL; ++p) {
+            coverage[p] = static_cast<std::uint8_t>(dc[p] + db[p] == 0 ? 0 : 255L * db[p] / (dc[p] + db[p]));
+          }
+          code = matcher.match_perceptual(coverage);
+        } else {
+          GlyphWord mask = 0;
+          for(unsigned p = 0; p < CELL * CELL; ++p) {
+            mask = (mask << 1) | (dc[p] < db[p] ? 1u : 0u);
+          }
+          code = matcher.match(mask);
+        }
+        const GlyphWord g = matcher.glyph(code);
+        long err = 0;
+        for(unsigned p = 0; p < CELL * CELL; ++p) {
+          err += (g >> (63 - p)) & 1 ? dc[p] : db[p];
+        }
+        if(err < best_err) {
+          std::tie(best_code, best_colour, best_err) = std::tuple{ code, c, err };
+        }
+      }
+      ret.chars.push_back(static_cast<std::uint8_t>(best_code));
+      ret.colours.push_back(static_cast<std::uint8_t>(best_colour));
+      ret.errors.push_back(best_err);
+    }
+  }
+  ret.width = width;
+  ret.pixels = rgb;
+  return ret;
+}
+
+// ── whole images and sequences ───────────────────────────────────────────────
+
+PetsciiScreen convert_petscii(const ImageBuffer &img, const ConvertOptions &opts) {
+  if(img.width > opts.max_width() || img.height > opts.max_height()) {
+    throw std::invalid_argument(std::format("image of {}x{} pixels does not fit within {}x{}", img.width,
+                                            img.height, opts.max_width(), opts.max_height()));
+  }
+  const StageTimer timer(Stage::quantise);
+  const auto threshold = static_cast<std::uint8_t>(opts.threshold * 255.0 + 0.5);
+  if(opts.matcher && opts.colour) {
+    return scan_image_glyphs_colour(to_rgb(img).pixels, img.width, img.height, *opts.palette, opts.background,
+                                    *opts.matcher, opts.perceptual);
+  }
+  const std::vector<std::uint8_t> &grey = img.format == PixelFormat::grey ? img.pixels : to_grey(img).pixels;
+  if(!opts.matcher) {
+    return scan_image_quads(grey, img.width, img.height, threshold);
+  }
+  return scan_image_glyphs(grey, img.width, img.height, threshold, *opts.matcher, opts.perceptual);
+}
+
+std::vector<PetsciiScreen> convert_frames(std::size_t count, const std::function<ImageBuffer(std::size_t)> &frame,
+                                          const ConvertOptions &opts, unsigned jobs) {
+  std::vector<PetsciiScreen> screens(count);
+  std::atomic<std::size_t> next{0};
+  std::exception_ptr error;
+  std::mutex error_mutex;
+  auto worker = [&]() {
+    for (std::size_t i = next++; i < count; i = next++) {
+      try {
+        screens[i] = convert_petscii(frame(i), opts);
+      } catch(...) {
+        const std::lock_guard lock(error_mutex);
+        if(!error) {
+          error = std::current_exception();
+        }
+        next = count; // Stop the other workers.
+      }
+    }
+  };
+  std::vector<std::thread> pool;
+  for (unsigned j = 1; j < jobs; ++j) {
+    pool.emplace_back(worker);
+  }
+  worker();
+  for (auto &t : pool) {
+    t.join();
+  }
+  if(error) {
+    std::rethrow_exception(error);
+  }
+  return screens;
+}
+
+long cell_error(const PetsciiScreen &screen, const ConvertOptions &opts, unsigned cell, unsigned code, int colour) {
+  const unsigned cx = cell % screen.columns;
+  const unsigned cy = cell / screen.columns;
+
+  if (!opts.matcher) {
+    return glyph_distance(screen.pixels[cell], quad_pattern(code));
+  }
+  const GlyphWord g = opts.matcher->glyph(code);
+  if (opts.colour) {
+    const auto pal8 = palette8(*opts.palette);
+    long err = 0;
+    for (unsigned p = 0; p < CELL * CELL; ++p) {
+      const std::size_t idx = (cy * CELL + p / CELL) * screen.width + cx * CELL + p % CELL;
+      err += rgb_dist(&screen.pixels[3 * idx], pal8[(g >> (63 - p)) & 1 ? colour : screen.background]);
+    }
+    return err;
+  }
+  GlyphWord mask;
+  CellValues coverage;
+  grey_cell(screen.pixels, screen.width, cx, cy, static_cast<std::uint8_t>(opts.threshold * 255.0 + 0.5), mask, coverage);
+  return opts.perceptual ? opts.matcher->perceptual_error(coverage, code) : glyph_distance(mask, g);
+}
+
+TemporalStats stabilise_frames(std::vector<PetsciiScreen> &screens, const ConvertOptions &opts, const TemporalOptions &temporal) {
+  const StageTimer timer(Stage::diff);
+  TemporalStats stats;
+
+  for (std::size_t f = 1; f < screens.size(); ++f) {
+    const PetsciiScreen &prev = screens[f - 1];
+    PetsciiScreen &next = screens[f];
+    if (prev.chars.size() != next.chars.size() || prev.background != next.background) {
+      continue; // Not comparable, every cell changes anyway.
+    }
+    const bool coloured = !next.colours.empty();
+    std::vector<std::pair<long, unsigned> > changes; // (improvement, cell)
+    for (unsigned cell = 0; cell < next.chars.size(); ++cell) {
+      const int prev_colour = coloured ? prev.colours[cell] : 0;
+      if (prev.chars[cell] == next.chars[cell] && (!coloured || prev_colour == next.colours[cell])) {
+        continue;
+      }
+      ++stats.before;
+      const long keep_err = cell_error(next, opts, cell, prev.chars[cell], prev_colour);
+      const long gain = keep_err - next.errors[cell];
+      if (gain > temporal.hysteresis) {
+        changes.emplace_back(gain, cell);
+      } else {
+        next.chars[cell] = prev.chars[cell];
+        if (coloured) {
+          next.colours[cell] = prev.colours[cell];
+        }
+        next.errors[cell] = keep_err;
+      }
+    }
+    if (temporal.delta_budget && changes.size() > *temporal.delta_budget) {
+      // Stable order: among equal improvements the first cell wins.
+      std::stable_sort(changes.begin(), changes.end(),
+                       [](const auto &a, const auto &b) { return a.first > b.first; });
+      for (std::size_t i = *temporal.delta_budget; i < changes.size(); ++i) {
+        const unsigned cell = changes[i].second;
+        next.errors[cell] += changes[i].first;
+        next.chars[cell] = prev.chars[cell];
+        if (coloured) {
+          next.colours[cell] = prev.colours[cell];
+        }
+      }
+      changes.resize(*temporal.delta_budget);
+    }
+    stats.after += changes.size();
+  }
+  return stats;
+}
+
+Frame to_frame(const PetsciiScreen &screen, const std::string &name, int border, int background, int foreground) {
+  std::vector<int> data(2 + 2 * WIDTH * HEIGHT);
+  const bool coloured = !screen.colours.empty();
+  data[0] = border;
+  data[1] = coloured ? screen.background : background;
+  for (unsigned row = 0; row < HEIGHT; ++row) {
+    for (unsigned col = 0; col < WIDTH; ++col) {
+      const unsigned cell = row * WIDTH + col;
+      const bool inside = row < screen.rows && col < screen.columns;
+      const unsigned src = row * screen.columns + col;
+      data[2 + cell] = inside ? screen.chars[src] : 32;
+      data[2 + WIDTH * HEIGHT + cell] = (inside && coloured) ? screen.colours[src] : foreground;
+    }
+  }
+  return Frame(name, data);
+}
+
+/**
+ * \brief Write frames in the C array format read by petsciiconvert.
+ */
+void write_frames_c(const std::vector<Frame> &frames, std::ostream &out) {
+  const StageTimer timer(Stage::write);
+  for (const auto &frame : frames) {
+    out << std::format("unsigned char {}[]={{// border,bg,chars,colors\n{},{},\n", frame.name,
+                       frame.border, frame.background);
+    const std::vector<int> *parts[] = { &frame.chars, &frame.colors };
+    for (unsigned part = 0; part < 2; ++part) {
+      const auto &values = *parts[part];
+      for (std::size_t i = 0; i < values.size(); ++i) {
+        const bool last = part == 1 && i + 1 == values.size();
+        out << values[i] << (last ? "" : ",");
+        if (i % WIDTH == WIDTH - 1) {
+          out << '\n';
+        }
+      }
+    }
+    out << "};\n";
+  }
+  out << std::format("// META: {} {} C64 upper\n", WIDTH, HEIGHT);
+}
@@ -0,0 +1,393 @@
+#ifndef __PETSCII_HH_2026__
+#define __PETSCII_HH_2026__
+/*! \file petscii.hh
+ *  \brief Conversion of images to C64 screen codes (the core of petscii80x50).
+ *
+ * Two modes are available:
+ * - quad blocks: every 2×2 pixel quad of an image of at most 80×50
+ *   pixels is mapped to the C64 block character with the same lit
+ *   quadrants;
+ * - glyphs: every 8×8 cell of an image of at most 320×200 pixels is
+ *   matched against the 256 glyphs of a character ROM, optionally with
+ *   a foreground colour per cell.
+ *
+ * Sequences of frames can be converted in parallel and stabilised over
+ * time, see convert_frames() and stabilise_frames(). Images have to be
+ * scaled to the size of the mode by the caller.
+ *
+ * \note The mapping produces \b screen codes, not PETSCII codes.
+ */
+#include "c64palette.hh"
+#include "glyph.hh"
+#include "imageload.hh"
+#include "petsciiframes.hh"
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <string>
+#include <vector>
+
+// ── constants ─────────────────────────────────────────────────────────────────
+
+/// Maximum image width accepted without resizing (one C64 screen column = 2 px).
+inline constexpr unsigned MAX_W = 80;
+/// Maximum image height accepted without resizing (one C64 screen row = 2 px).
+inline constexpr unsigned MAX_H = 50;
+
+/// Screen width in pixels used by the glyph mode.
+inline constexpr unsigned GLYPH_W = 320;
+/// Screen height in pixels used by the glyph mode.
+inline constexpr unsigned GLYPH_H = 200;
+/// Cell side length in pixels.
+inline constexpr unsigned CELL = 8;
+
+/// Default luminance threshold for the 1-bit conversion (0.0–1.0).
+inline constexpr double DEFAULT_THRESHOLD = 0.5;
+
+// ── screen-code lookup table ──────────────────────────────────────────────────
+
+/**
+ * \brief C64 screen codes for the 16 possible 2×2 pixel block patterns.
+ *
+ * Each 2×2 quad is mapped to a 4-bit index by treating the four pixels as
+ * binary digits arranged as:
+ *
+ * ```
+ *   bit 3 (MSB)  bit 2
+ *   bit 1        bit 0 (LSB)
+ * ```
+ *
+ * A pixel that is \e on (foreground) contributes a 1 bit.
+ * The resulting index selects the screen code of the C64 block character
+ * whose filled quadrants match the lit pixels.
+ *
+ * \note These are \b screen codes (the raw values written to screen RAM),
+ *       not PETSCII character codes.
+ */
+inline constexpr std::array<unsigned char, 16> screen_code_blocks {{
+  /* 0b0000 */  32, ///< ' '  — blank
+  /* 0b0001 */ 108, ///< ▗   — bottom-right
+  /* 0b0010 */ 123, ///< ▖   — bottom-left
+  /* 0b0011 */  98, ///< ▄   — bottom half
+  /* 0b0100 */ 124, ///< ▝   — top-right
+  /* 0b0101 */ 225, ///< ▐   — right half
+  /* 0b0110 */ 255, ///< ▞   — diagonal (top-right + bottom-left)
+  /* 0b0111 */ 254, ///< ▟   — all except top-left
+  /* 0b1000 */ 126, ///< ▘   — top-left
+  /* 0b1001 */ 127, ///< ▚   — diagonal (top-left + bottom-right)
+  /* 0b1010 */  97, ///< ▌   — left half
+  /* 0b1011 */ 252, ///< ▙   — all except top-right
+  /* 0b1100 */ 226, ///< ▀   — top half
+  /* 0b1101 */ 251, ///< ▜   — all except bottom-left
+  /* 0b1110 */ 236, ///< ▛   — all except bottom-right
+  /* 0b1111 */ 224, ///< █   — full block
+}};
+
+/**
+ * \brief 2×2 pattern (index into screen_code_blocks) of a block screen code.
+ *
+ * \return the pattern, or 0 (blank) for codes which are no block character
+ */
+[[nodiscard]] unsigned quad_pattern(unsigned code);
+
+// ── glyph matching ────────────────────────────────────────────────────────────
+
+/// 64 per-pixel values of one 8×8 cell in row-major order.
+using CellValues = std::array<std::uint8_t, CELL * CELL>;
+
+/**
+ * \brief Take one 256-glyph set from a character ROM dump.
+ *
+ * Accepts 2 KiB (one set) or the 4 KiB C64 character ROM; in the
+ * latter case the upper case set is the first half and the lower case
+ * set the second half.
+ *
+ * \param rom ROM contents
+ * \param lowercase select the lower case set of a 4 KiB ROM
+ * \return glyphs indexed by screen code
+ * \throw std::invalid_argument if the size is neither 2048 nor 4096 bytes,
+ *        or with \p lowercase if it is 2048 bytes
+ */
+std::array<GlyphWord, 256> charset_from_rom(std::span<const std::uint8_t> rom, bool lowercase);
+
+/**
+ * \brief Load one 256-glyph set from a character ROM file, see charset_from_rom().
+ */
+std::array<GlyphWord, 256> load_charset(const std::string &path, bool lowercase);
+
+/**
+ * \brief Blur the values of one cell with a 3×3 binomial kernel.
+ *
+ * Pixels outside the cell are clamped to the nearest edge pixel.
+ */
+CellValues blur_cell(const CellValues &in);
+
+/**
+ * \brief Finds the best glyph of a character set for a cell.
+ *
+ * Both metrics work on a flat array of all glyphs so the inner loops
+ * are branch-free and can be vectorised by the compiler: the Hamming
+ * distance is one XOR and one popcount per glyph, the perceptual error
+ * a sum of absolute differences over 64 bytes.
+ */
+class GlyphMatcher {
+  std::array<GlyphWord, 256> glyphs;
+  std::vector<CellValues> blurred; ///< Blurred glyphs, set pixels are 255
+
+public:
+  explicit GlyphMatcher(const std::array<GlyphWord, 256> &glyphs_) : glyphs(glyphs_), blurred(glyphs_.size()) {
+    for(unsigned i = 0; i < glyphs.size(); ++i) {
+      CellValues plain;
+      for(unsigned p = 0; p < plain.size(); ++p) {
+        plain[p] = (glyphs[i] >> (63 - p)) & 1 ? 255 : 0;
+      }
+      blurred[i] = blur_cell(plain);
+    }
+  }
+
+  /// Glyph bits of screen code \p code.
+  [[nodiscard]] GlyphWord glyph(unsigned code) const { return glyphs[code]; }
+
+  /**
+   * \brief Screen code with the smallest Hamming distance to \p mask.
+   */
+  [[nodiscard]] unsigned match(GlyphWord mask) const {
+    return nearest_glyph(glyphs.data(), glyphs.size(), mask);
+  }
+
+  /**
+   * \brief Screen code with the smallest blurred difference to a cell.
+   *
+   * \param coverage per-pixel foreground coverage (255 = foreground)
+   */
+  [[nodiscard]] unsigned match_perceptual(const CellValues &coverage) const {
+    const CellValues cell = blur_cell(coverage);
+    unsigned best = 0;
+    unsigned best_err = std::numeric_limits<unsigned>::max();
+    for(unsigned i = 0; i < blurred.size(); ++i) {
+      if(const unsigned err = sad(cell, blurred[i]); err < best_err) {
+        best = i;
+        best_err = err;
+      }
+    }
+    return best;
+  }
+
+  /**
+   * \brief Blurred difference between a cell and screen code \p code.
+   *
+   * \param coverage per-pixel foreground coverage (255 = foreground)
+   */
+  [[nodiscard]] unsigned perceptual_error(const CellValues &coverage, unsigned code) const {
+    return sad(blur_cell(coverage), blurred[code]);
+  }
+
+private:
+  /// Sum of absolute differences of two cells.
+  static unsigned sad(const CellValues &a, const CellValues &b) {
+    unsigned err = 0;
+    for(unsigned p = 0; p < a.size(); ++p) {
+      err += static_cast<unsigned>(std::abs(static_cast<int>(a[p]) - static_cast<int>(b[p])));
+    }
+    return err;
+  }
+};
+
+/**
+ * \brief Result of a conversion: screen codes and optional colours.
+ */
+struct PetsciiScreen {
+  unsigned columns = 0;              ///< Cells per row
+  unsigned rows = 0;                 ///< Cell rows
+  int background = 0;                ///< Background colour
+  std::vector<std::uint8_t> chars;   ///< Screen codes
+  std::vector<std::uint8_t> colours; ///< Colour RAM, empty in mono mode
+  /**
+   * Error of the chosen glyph per cell, in the unit of the mode: differing
+   * pixels (quad blocks, Hamming), blurred grey difference (--perceptual)
+   * or summed squared 8-bit RGB distance (--colour).
+   */
+  std::vector<long> errors;
+  unsigned width = 0;                ///< Width of the source pixels
+  /**
+   * Source the cells were matched against, kept to score other glyphs
+   * later: one 2×2 pattern per cell (quad blocks), grey values or RGB
+   * values.
+   */
+  std::vector<std::uint8_t> pixels;
+};
+
+/**
+ * \brief Convert grey values into block characters.
+ *
+ * Every 2×2 pixel quad is mapped to a 4-bit index (top-left = MSB,
+ * bottom-right = LSB, pixels darker than \p threshold are set bits),
+ * which selects the screen code in \c screen_code_blocks. A trailing
+ * odd row or column is ignored.
+ *
+ * \param grey row-major 8-bit grey values
+ * \param width image width in pixels
+ * \param height image height in pixels
+ * \param threshold grey threshold (0–255)
+ */
+PetsciiScreen scan_image_quads(const std::vector<std::uint8_t> &grey, unsigned width, unsigned height,
+                               std::uint8_t threshold);
+
+/**
+ * \brief Convert grey values into screen codes.
+ *
+ * Pixels darker than \p threshold are foreground (set bits), matching
+ * the quad block mode.
+ *
+ * \param grey row-major 8-bit grey values
+ * \param width image width in pixels (whole cells are converted)
+ * \param height image height in pixels
+ * \param threshold grey threshold (0–255)
+ * \param matcher glyph matcher
+ * \param perceptual use the blurred error instead of the Hamming distance
+ */
+PetsciiScreen scan_image_glyphs(const std::vector<std::uint8_t> &grey, unsigned width, unsigned height,
+                              std::uint8_t threshold, const GlyphMatcher &matcher, bool perceptual);
+
+/**
+ * \brief Convert RGB values into screen codes and per-cell colours.
+ *
+ * Every pixel is compared with the background colour and each candidate
+ * foreground colour (the colours which are nearest to at least one pixel
+ * of the cell). For each candidate the best glyph is matched against the
+ * pixels closer to the candidate than to the background; the candidate
+ * whose rendered cell has the smallest colour error wins.
+ *
+ * \param rgb row-major interleaved 8-bit RGB values
+ * \param width image width in pixels (whole cells are converted)
+ * \param height image height in pixels
+ * \param palette palette to match against
+ * \param background fixed background colour, most frequent colour if empty
+ * \param matcher glyph matcher
+ * \param perceptual use the blurred error for the glyph choice
+ */
+PetsciiScreen scan_image_glyphs_colour(const std::vector<std::uint8_t> &rgb, unsigned width, unsigned height,
+                                     const C64Palette &palette, std::optional<int> background,
+                                     const GlyphMatcher &matcher, bool perceptual);
+
+// ── whole images and sequences ───────────────────────────────────────────────
+
+/**
+ * \brief Everything needed to convert one image.
+ */
+struct ConvertOptions {
+  double threshold = DEFAULT_THRESHOLD;  ///< Luminance threshold (0.0–1.0)
+  const GlyphMatcher *matcher = nullptr; ///< Glyph mode if set, quad blocks otherwise
+  bool perceptual = false;               ///< Blurred error for the glyph choice
+  bool colour = false;                   ///< Per-cell foreground colour (glyph mode)
+  const C64Palette *palette = &palette_grafx2; ///< Palette for the colour mode
+  std::optional<int> background;         ///< Fixed background colour
+
+  /// Largest image width of the selected mode.
+  [[nodiscard]] unsigned max_width() const { return matcher ? GLYPH_W : MAX_W; }
+  /// Largest image height of the selected mode.
+  [[nodiscard]] unsigned max_height() const { return matcher ? GLYPH_H : MAX_H; }
+};
+
+/**
+ * \brief Convert one image in the mode selected by \p opts.
+ *
+ * Grey images are used as they are, other images are converted to grey
+ * values (or RGB in the colour mode) first.
+ *
+ * \param img image of at most max_width() × max_height() pixels
+ * \param opts conversion options
+ * \throw std::invalid_argument if the image is too large for the mode
+ */
+PetsciiScreen convert_petscii(const ImageBuffer &img, const ConvertOptions &opts);
+
+/**
+ * \brief Convert frames in parallel.
+ *
+ * \p frame is called from the worker threads, once per frame index, and
+ * has to return the image of that frame; it may load or scale the image
+ * itself, so that this work is spread over the threads as well.
+ *
+ * If a callback or a conversion throws, the remaining frames are
+ * skipped and the first exception is rethrown.
+ *
+ * \param count number of frames
+ * \param frame callback returning the image of frame \p i
+ * \param opts conversion options
+ * \param jobs number of worker threads
+ * \return converted screens in frame order
+ */
+std::vector<PetsciiScreen> convert_frames(std::size_t count, const std::function<ImageBuffer(std::size_t)> &frame,
+                                          const ConvertOptions &opts, unsigned jobs);
+
+/**
+ * \brief Error of showing \p code in \p colour in one cell of a screen.
+ *
+ * Uses the source pixels kept in \p screen and the metric of the mode
+ * the screen was converted with, so the result is comparable with
+ * \c screen.errors.
+ *
+ * \param screen converted screen
+ * \param opts options the screen was converted with
+ * \param cell cell index (row-major)
+ * \param code screen code
+ * \param colour foreground colour (ignored without colours)
+ */
+long cell_error(const PetsciiScreen &screen, const ConvertOptions &opts, unsigned cell, unsigned code, int colour);
+
+/**
+ * \brief Options for the temporally coherent sequence conversion.
+ */
+struct TemporalOptions {
+  long hysteresis = -1;                ///< Minimum improvement for a change, negative = off
+  std::optional<unsigned> delta_budget; ///< Maximum number of changed cells per frame
+};
+
+/**
+ * \brief Number of changed cells of a sequence before and after stabilise_frames().
+ */
+struct TemporalStats {
+  unsigned long before = 0; ///< Changed cells of all frames as converted
+  unsigned long after = 0;  ///< Changed cells of all frames after filtering
+};
+
+/**
+ * \brief Reduce flicker between consecutive frames.
+ *
+ * Frames are visited in order. A cell keeps the glyph (and colour) of the
+ * previous frame unless the newly chosen glyph improves the cell error by
+ * more than the hysteresis margin. With a delta budget only the cells
+ * with the largest improvements change, the others keep their previous
+ * content. Fewer changed cells mean shorter deltas for petsciiconvert.
+ *
+ * \param screens converted frames, modified in place
+ * \param opts options the frames were converted with
+ * \param temporal hysteresis margin and delta budget
+ * \return number of changed cells
+ */
+TemporalStats stabilise_frames(std::vector<PetsciiScreen> &screens, const ConvertOptions &opts, const TemporalOptions &temporal);
+
+/**
+ * \brief Build a 40×25 petsciiconvert frame from a converted screen.
+ *
+ * Smaller screens are padded with spaces in the foreground colour.
+ *
+ * \param screen converted screen
+ * \param name frame name
+ * \param border border colour
+ * \param background background colour (used unless the screen has colours)
+ * \param foreground colour of all cells if the screen has no colours
+ */
+Frame to_frame(const PetsciiScreen &screen, const std::string &name, int border, int background, int foreground);
+
+/**
+ * \brief Write frames in the C array format read by petsciiconvert.
+ */
+void write_frames_c(const std::vector<Frame> &frames, std::ostream &out);
+
+#endif
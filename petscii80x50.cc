@@ -9,108 +9,106 @@
  * The output is a raw byte stream of screen codes, one character per 2×2
  * pixel region, suitable for POKE-ing directly into C64 screen RAM.
  *
+ * With \c --charset a high-quality glyph mode is used instead: the image is
+ * fitted into 320×200 pixels and every 8×8 cell is matched against all 256
+ * glyphs of a character ROM (upper or lower case set). The best glyph is
+ * the one with the smallest Hamming distance to the thresholded cell, or
+ * with \c --perceptual the smallest difference after a 3×3 blur. With
+ * \c --colour every cell also gets its own foreground colour in front of
+ * a common background colour, and the colour RAM follows the screen codes
+ * in the output.
+ *
+ * Several images (or a multi-frame image such as an animated GIF) can be
+ * converted as a sequence with \c --sequence. The frames are converted in
+ * parallel and written in the C array format read by petsciiconvert, or
+ * with \c --binary-frames as a binary frame stream which petsciiconvert
+ * reads with \c --binary-input.
+ *
+ * The conversion itself is done by libc64gfx (see petscii.hh); this
+ * program loads and scales the images with Magick++. --stats prints the
+ * time spent per stage on stderr (see runstats.hh).
+ *
  * \note The mapping currently produces \b screen codes, not PETSCII codes.
  *       These are numerically different for many characters.  A future
  *       \c --petscii flag should add a translation pass before output.
  *
- * Build dependencies: Magick++, CLI11
+ * Build dependencies: libc64gfx, Magick++, CLI11
  * Requires: C++23 (-std=c++23)
  */
 
-#include <array>
+#include "c64palette.hh"
+#include "petscii.hh"
+#include "petsciiframes.hh"
+#include "runstats.hh"
+#include <algorithm>
+#include <cstdint>
 #include <format>
 #include <iostream>
-#include <ostream>
+#include <list>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include <Magick++.h>
 #include <CLI/CLI.hpp>
 
-// ── constants ─────────────────────────────────────────────────────────────────
-
-/// Maximum image width accepted without resizing (one C64 screen column = 2 px).
-inline constexpr unsigned MAX_W = 80;
-/// Maximum image height accepted without resizing (one C64 screen row = 2 px).
-inline constexpr unsigned MAX_H = 50;
-
-/// Default luminance threshold for the 1-bit conversion (0.0–1.0).
-inline constexpr double DEFAULT_THRESHOLD = 0.5;
-
-// ── screen-code lookup table ──────────────────────────────────────────────────
+// ── image loading ─────────────────────────────────────────────────────────────
 
 /**
- * \brief C64 screen codes for the 16 possible 2×2 pixel block patterns.
+ * \brief Load all frames of all input files.
  *
- * Each 2×2 quad is mapped to a 4-bit index by treating the four pixels as
- * binary digits arranged as:
- *
- * ```
- *   bit 3 (MSB)  bit 2
- *   bit 1        bit 0 (LSB)
- * ```
- *
- * A pixel that is \e on (foreground) contributes a 1 bit.
- * The resulting index selects the screen code of the C64 block character
- * whose filled quadrants match the lit pixels.
- *
- * \note These are \b screen codes (the raw values written to screen RAM),
- *       not PETSCII character codes.  See the file-level note.
+ * Multi-frame files (e.g. animated GIFs) are coalesced so that every
+ * frame is a complete image.
  */
-constexpr std::array<unsigned char, 16> screen_code_blocks {{
-  /* 0b0000 */  32, ///< ' '  — blank
-  /* 0b0001 */ 108, ///< ▗   — bottom-right
-  /* 0b0010 */ 123, ///< ▖   — bottom-left
-  /* 0b0011 */  98, ///< ▄   — bottom half
-  /* 0b0100 */ 124, ///< ▝   — top-right
-  /* 0b0101 */ 225, ///< ▐   — right half
-  /* 0b0110 */ 255, ///< ▞   — diagonal (top-right + bottom-left)
-  /* 0b0111 */ 254, ///< ▟   — all except top-left
-  /* 0b1000 */ 126, ///< ▘   — top-left
-  /* 0b1001 */ 127, ///< ▚   — diagonal (top-left + bottom-right)
-  /* 0b1010 */  97, ///< ▌   — left half
-  /* 0b1011 */ 252, ///< ▙   — all except top-right
-  /* 0b1100 */ 226, ///< ▀   — top half
-  /* 0b1101 */ 251, ///< ▜   — all except bottom-left
-  /* 0b1110 */ 236, ///< ▛   — all except bottom-right
-  /* 0b1111 */ 224, ///< █   — full block
-}};
-
-// ── image scanning ────────────────────────────────────────────────────────────
+std::vector<Magick::Image> load_frames(const std::vector<std::string> &files) {
+  const StageTimer timer(Stage::load);
+  std::vector<Magick::Image> frames;
+  for (const auto &file : files) {
+    std::list<Magick::Image> images;
+    Magick::readImages(&images, file);
+    if (images.size() > 1) {
+      std::list<Magick::Image> coalesced;
+      Magick::coalesceImages(&coalesced, images.begin(), images.end());
+      images.swap(coalesced);
+    }
+    frames.insert(frames.end(), images.begin(), images.end());
+  }
+  return frames;
+}
 
 /**
- * \brief Convert a thresholded image to C64 screen-code block characters.
+ * \brief Resize an image to fit the mode and take its pixels.
  *
- * Iterates over the image in 2×2 pixel steps.  For each quad the four pixel
- * luminances are read as mono (1-bit) values; the four bits are packed into a
- * nibble (top-left = MSB, bottom-right = LSB) and used as an index into
- * \c screen_code_blocks.  The resulting screen code byte is written to \p out.
+ * The image is resized to fit the mode (80×50 for quad blocks, 320×200
+ * for glyphs). Only the image itself is modified, so distinct images can
+ * be prepared concurrently.
  *
- * The image must already have been thresholded to a 1-bit (mono) state.
- * Its dimensions must be even in both axes; any trailing odd row or column
- * is silently ignored.
- *
- * \param img  Source image (read-only, must be mono/thresholded).
- * \param out  Destination byte stream for the screen code output.
+ * \param img image, resized in place
+ * \param opts conversion options
+ * \param verbose report resizing on stderr
+ * \return grey values, or RGB values in the colour mode
  */
-void scan_image(const Magick::Image &img, std::ostream &out) {
-  for (unsigned row = 0; row + 1 < img.rows(); row += 2) {
-    for (unsigned col = 0; col + 1 < img.columns(); col += 2) {
-      /*
-       * Sample the four pixels of the 2×2 quad:
-       *   tl tr
-       *   bl br
-       *
-       * ColorMono::mono() returns true for white (background) and false for
-       * black (foreground), so we negate to treat dark pixels as "set" bits.
-       */
-      const bool tl = !Magick::ColorMono(img.pixelColor(col,     row    )).mono();
-      const bool tr = !Magick::ColorMono(img.pixelColor(col + 1, row    )).mono();
-      const bool bl = !Magick::ColorMono(img.pixelColor(col,     row + 1)).mono();
-      const bool br = !Magick::ColorMono(img.pixelColor(col + 1, row + 1)).mono();
-
-      const unsigned idx = (tl << 3) | (tr << 2) | (bl << 1) | br;
-      out.put(static_cast<char>(screen_code_blocks[idx]));
+ImageBuffer fit_image(Magick::Image &img, const ConvertOptions &opts, bool verbose) {
+  const StageTimer timer(Stage::resize);
+  const unsigned max_w = opts.max_width();
+  const unsigned max_h = opts.max_height();
+
+  if (img.columns() > max_w || img.rows() > max_h) {
+    if (verbose) {
+      std::cerr << std::format("Resizing image from {}x{} to fit within {}x{}.\n",
+                               img.columns(), img.rows(), max_w, max_h);
     }
+    img.resize(Magick::Geometry(max_w, max_h));
   }
+  ImageBuffer buf;
+  buf.width  = img.columns();
+  buf.height = img.rows();
+  buf.format = (opts.matcher && opts.colour) ? PixelFormat::rgb : PixelFormat::grey;
+  buf.pixels.resize(buf.stride() * buf.height);
+  img.write(0, 0, buf.width, buf.height, buf.format == PixelFormat::rgb ? "RGB" : "I",
+            Magick::CharPixel, buf.pixels.data());
+  return buf;
 }
 
 // ── entry point ───────────────────────────────────────────────────────────────
@@ -128,43 +126,145 @@ void scan_image(const Magick::Image &img, std::ostream &out) {
 int main(int argc, char **argv) {
   CLI::App app{"petscii80x50 – convert an image to C64 screen-code block characters"};
 
-  std::string input_file;
-  double threshold   = DEFAULT_THRESHOLD;
+  std::vector<std::string> input_files;
+  ConvertOptions opts;
   bool   display_gfx = false;
   std::optional<unsigned short> load_address;
+  std::optional<std::string> charset_file;
+  bool   lowercase   = false;
+  std::string palette_name = "grafx2";
+  bool   sequence    = false;
+  bool   binary_frames = false;
+  std::string frame_name = "frame";
+  int    border      = 14;
+  int    background  = 6;
+  int    foreground  = 14;
+  unsigned jobs      = std::max(1u, std::thread::hardware_concurrency());
+  TemporalOptions temporal;
+  std::string stats_format;
 
-  app.add_option("file", input_file, "Input image file to convert")
+  app.add_option("file", input_files, "Input image file(s) to convert")
      ->required()
      ->check(CLI::ExistingFile);
-  app.add_option("--threshold,-t", threshold,
+  app.add_option("--threshold,-t", opts.threshold,
                  std::format("Luminance threshold for 1-bit conversion "
                              "(0.0–1.0, default {:.1f})", DEFAULT_THRESHOLD))
      ->check(CLI::Range(0.0, 1.0));
   app.add_flag("--display,-d", display_gfx,
                "Display the thresholded image on screen before converting");
   app.add_flag("--load-address", load_address, "prepend a load address to the output");
+  CLI::Option *charset_opt = app.add_option("--charset", charset_file,
+                                            "Character ROM (2 or 4 KiB); enables the 320x200 glyph mode")
+     ->check(CLI::ExistingFile);
+  app.add_flag("--lowercase", lowercase,
+               "Use the lower case set of a 4 KiB character ROM")
+     ->needs(charset_opt);
+  app.add_flag("--perceptual", opts.perceptual,
+               "Choose glyphs by blurred difference instead of Hamming distance");
+  app.add_flag("--colour", opts.colour,
+               "Choose a foreground colour per cell, colour RAM follows the screen codes");
+  app.add_option("--palette", palette_name,
+                 std::format("C64 colour palette for --colour (default: grafx2).\n"
+                             "Available palettes: {}", palette_names()))
+     ->check(CLI::IsMember(palette_registry));
+  app.add_option("--background,-b", opts.background,
+                 "Background colour for --colour (0–15), default is the most frequent colour")
+     ->check(CLI::Range(0, NCOLORS - 1));
+  app.add_flag("--sequence,-s", sequence,
+               "Convert all frames of all files into a petsciiconvert animation on stdout "
+               "(implied by more than one file)");
+  app.add_flag("--binary-frames", binary_frames,
+               "Write the sequence as binary frames (petsciiconvert --binary-input)");
+  app.add_option("--frame-name", frame_name, "Name prefix of the frames in a sequence (default: frame)");
+  app.add_option("--border", border, "Border colour of the frames in a sequence (default 14)")
+     ->check(CLI::Range(0, NCOLORS - 1));
+  app.add_option("--frame-background", background,
+                 "Background colour of the frames in a sequence without --colour (default 6)")
+     ->check(CLI::Range(0, NCOLORS - 1));
+  app.add_option("--foreground", foreground,
+                 "Character colour of the frames in a sequence without --colour (default 14)")
+     ->check(CLI::Range(0, NCOLORS - 1));
+  app.add_option("--jobs,-j", jobs, "Number of frames converted in parallel")
+     ->check(CLI::Range(1u, 256u));
+  app.add_option("--hysteresis", temporal.hysteresis,
+                 "Keep the previous glyph of a cell unless the new one reduces the error by more "
+                 "than this margin (differing pixels, or the error unit of --perceptual/--colour)")
+     ->check(CLI::NonNegativeNumber);
+  app.add_option("--delta-budget", temporal.delta_budget,
+                 "Maximum number of changed cells per frame of a sequence");
+  app.add_flag("--stats{table}", stats_format,
+               "Print the time per stage, counters and memory use on stderr "
+               "(--stats=json for one line of JSON)")
+     ->check(CLI::IsMember({"table", "json"}));
 
   CLI11_PARSE(app, argc, argv);
+  const StatsReport report("petscii80x50", stats_format, std::cerr);
 
-  Magick::Image img(input_file);
+  opts.palette = palette_registry.at(palette_name);
+  std::optional<GlyphMatcher> matcher;
+  if (charset_file) {
+    try {
+      matcher.emplace(load_charset(*charset_file, lowercase));
+    } catch (const std::invalid_argument &e) {
+      std::cerr << std::format("Cannot load the character ROM: {}\n", e.what());
+      return 1;
+    }
+    opts.matcher = &*matcher;
+  }
 
-  /* Resize down if the image is larger than the maximum accepted dimensions */
-  if (img.columns() > MAX_W || img.rows() > MAX_H) {
-    std::cerr << std::format("Resizing image from {}x{} to fit within {}x{}.\n",
-                             img.columns(), img.rows(), MAX_W, MAX_H);
-    img.resize(Magick::Geometry(MAX_W, MAX_H));
+  if (sequence || binary_frames || input_files.size() > 1) {
+    std::vector<Magick::Image> images = load_frames(input_files);
+    std::cerr << std::format("Converting {} frames with {} threads.\n", images.size(), jobs);
+    std::vector<PetsciiScreen> screens = convert_frames(images.size(), [&](std::size_t i) {
+      ImageBuffer buf = fit_image(images[i], opts, false);
+      images[i] = Magick::Image(); // Release the pixels early.
+      return buf;
+    }, opts, jobs);
+    if ((temporal.hysteresis >= 0 || temporal.delta_budget) && screens.size() > 1) {
+      const TemporalStats stats = stabilise_frames(screens, opts, temporal);
+      std::cerr << std::format("Changed cells per frame: {:.1f} before, {:.1f} after temporal filtering.\n",
+                               static_cast<double>(stats.before) / (screens.size() - 1),
+                               static_cast<double>(stats.after) / (screens.size() - 1));
+    }
+    count_stat("frames", screens.size());
+    std::vector<Frame> frames;
+    for (std::size_t i = 0; i < screens.size(); ++i) {
+      frames.push_back(to_frame(screens[i], std::format("{}{:04}", frame_name, i), border, background, foreground));
+    }
+    if (binary_frames) {
+      const StageTimer timer(Stage::write);
+      for (const auto &frame : frames) {
+        frame.save(std::cout);
+      }
+    } else {
+      write_frames_c(frames, std::cout);
+    }
+    return 0;
   }
 
-  img.threshold(threshold);
+  StageTimer load_timer(Stage::load);
+  Magick::Image img(input_files.front());
+  load_timer.stop();
+  const PetsciiScreen screen = convert_petscii(fit_image(img, opts, true), opts);
 
-  if (display_gfx) img.display();
+  if (display_gfx) {
+    if (!opts.matcher) {
+      img.threshold(opts.threshold * QuantumRange);
+    }
+    img.display();
+  }
 
+  if (opts.colour && screen.colours.size() > 0) {
+    std::cerr << std::format("Background colour: {}\n", screen.background);
+  }
+  const StageTimer timer(Stage::write);
   if(load_address) {
     unsigned short loadaddress16bit = load_address.value();
     std::cerr << std::format("Prepending a load address of ${:04X}.\n", loadaddress16bit);
     std::cout << static_cast<char>(loadaddress16bit & 0xFF) << static_cast<char>(loadaddress16bit >> 8);
   }
-  scan_image(img, std::cout);
+  std::cout.write(reinterpret_cast<const char *>(screen.chars.data()), screen.chars.size());
+  std::cout.write(reinterpret_cast<const char *>(screen.colours.data()), screen.colours.size());
 
   return 0;
 }
@@ -2,11 +2,17 @@
 #include <sstream>
 #include <fstream>
 #include <string>
-#include <deque>
+#include <algorithm>
 #include <cassert>
+#include <cstdlib>
+#include <iterator>
+#include <vector>
 #include <boost/format.hpp>
+#include "codegenerator.hh"
+#include "convcache.hh"
 #include "petsciiframes.hh"
 #include "parse-petsciifile.hh"
+#include "runstats.hh"
 #include "petsciiconvert_cli.h"
 
 using std::cout;
@@ -21,6 +27,7 @@ std::vector<std::string> do_comparison(const FrameArray &framearr, bool pingpong
     auto &next = framearr[nextnum];
     cerr << boost::format("\tComparing %u (%s) to %u (%s).\n") % prevnum % prev.name % nextnum % next.name;
     auto mismatches = compare_frames(prev, next);
+    const StageTimer timer(Stage::emit);
     std::string procname = "animation_";
     procname += prev.name;
     procname += next.name;
@@ -75,8 +82,11 @@ loop%u:	  lda	%s+2+%u*40+%u,x
  * \param startaddr optionally write this start address to the output file
  * \param singfram single frame option
  * \param xorp xor with previous frame if true
+ * \return names of the written files
  */
-void mode_binary_output(const char *outputname, const FrameArray &framearr, std::optional<unsigned short> startaddr, bool singfram, bool xorp) {
+std::vector<std::string> mode_binary_output(const char *outputname, const FrameArray &framearr, std::optional<unsigned short> startaddr, bool singfram, bool xorp) {
+  const StageTimer timer(Stage::write);
+  std::vector<std::string> written;
   string basename(outputname);
   /* Write startaddr if given */
   auto writestart = [startaddr](std::ostream &out) {
@@ -104,6 +114,7 @@ void mode_binary_output(const char *outputname, const FrameArray &framearr, std:
       string outlabel(str(boost::format("%s_%04u") % basename % frame));
       labels.push_back(outlabel);
       cerr << "Writing frame " << frame << endl;
+      written.push_back(outnam);
       std::ofstream output(outnam, std::ios::binary);
       if(xorp) {
 	unsigned previousidx;
@@ -130,6 +141,7 @@ void mode_binary_output(const char *outputname, const FrameArray &framearr, std:
     cout << "\n\t.word\t0\n";
     cout << asmout.str() << endl;
   } else {
+    written.push_back(outputname);
     std::ofstream output(outputname, std::ios::binary);
     writestart(output);
     if(xorp) {
@@ -143,228 +155,10 @@ void mode_binary_output(const char *outputname, const FrameArray &framearr, std:
     }
     cout << basename << "_end = " << output.tellp() << endl;
   }
+  return written;
 }
 
 
-class CodeGenerator {
-  std::ostringstream codeout;
-  std::ostringstream dataout;
-  unsigned framecounter; //!< counter for the animation
-  unsigned labelcounter;
-  std::string animation_name; //!< name to use for this animation (to generate labels)
-  const Frame &initial_frame;
-  std::deque<std::string> exports; //!< list of labels to be exported
-
-protected:
-  CodeGenerator &opcode(const std::string &mnemonic) {
-    codeout << '\t' << mnemonic << '\n';
-    return *this;
-  }
-  CodeGenerator &opcode(boost::format &bformat) {
-    return opcode(str(bformat));
-  }
-  std::ostream &label(const std::string &name) {
-    codeout << name << ":\n";
-    return codeout;
-  }
-  std::string animlabelname(const std::string &name) {
-    std::ostringstream out;
-    out << "animation_" << animation_name << '_' << name;
-    auto ret(out.str());
-    return ret;
-  }
-  std::string animlabel(const std::string &name, bool count_frame = false) {
-    std::ostringstream out;
-    out << animlabelname(name);
-    if(count_frame) {
-      out << ++framecounter;
-    }
-    auto ret(out.str());
-    label(ret);
-    return ret;
-  }
-  std::string nextlabel(bool codelabel) {
-    auto label = str(boost::format("%s_label%04X") % animation_name % labelcounter++);
-    if(codelabel) {
-      codeout << '\n' << label << ":\n";
-    } else {
-      dataout << '\n' <<  label << ":\n";
-    }
-    return label;
-  }
-  std::ostream &outbyte(int byte) {
-    dataout << "\t.byte\t" << byte << '\n';
-    return dataout;
-  }
-  unsigned long outbytes(const std::vector<int> bytes) {
-    unsigned long count = 0;
-    for(auto i : bytes) {
-      if(count++ % 128 == 0) {
-	dataout << "\n\t.byte\t" << i;
-      } else {
-	dataout << ", " << i;
-      }
-    }
-    dataout << '\n';
-    return count;
-  }
-
-  typedef std::pair<unsigned int,unsigned int> CellRanges;
-  /*! Get ranges of deltas
-   *
-   * This is a vector of of cells or ranges of cells which need to be
-   * changed. The range is inclusive thus a single cell has identical
-   * value for the pair elements.
-   * 
-   * \param deltaarray the XORed two frames (zero = no change)
-   * \return an array of changes
-   */
-  std::vector<CellRanges> get_delta_ranges(const std::vector<int> &deltaarray) {
-    std::vector<CellRanges> ret;
-    // First fill the vector with single cells if they have changed.
-    for(unsigned i = 0; i < deltaarray.size(); ++i) {
-      if(deltaarray[i] != 0) {
-	unsigned j = i + 1; // Advance to the next cell.
-	/*
-	 * If we are still with in the bounds of the array check if
-	 * the cell is a changed cell, if so advance to the next cell.
-	 */
-	while((j < deltaarray.size()) && (deltaarray[j] != 0)) {
-	  ++j;
-	}
-	--j; // Step back, as we overstepped.
-	ret.push_back(CellRanges(std::make_pair(i, j)));
-	i = j; // Move the index to the end cell.
-      }
-    }
-    return ret;
-  }
-  
-public:
-  bool generate_jumptable; //!< set to true if jump table should be generated.
-
-  CodeGenerator(const std::string &name, const Frame &initial, bool genjumptab) :
-    framecounter(0),
-    labelcounter(0),
-    animation_name(name),
-    initial_frame(initial),
-    generate_jumptable(genjumptab) {
-  }
-  void generate(const Frame &prev, const Frame &next) {
-    Frame deltaframe(prev);
-    auto deltafun = [this](const std::vector<int> &xored, const std::vector<int> &destination, const std::string &destinationname) {
-      const std::vector<CellRanges> deltaarray = get_delta_ranges(xored);
-      auto iter = deltaarray.begin(); // Iterator to the current element in the delta (changes) array.
-      auto end = deltaarray.end();
-      int last_A_value = -1; // Last value of accumulator which was written into memory, -1 if unknown. This can be used to reduce the number of times the accumulator is loaded when the last value is known.
-      while(iter != end) {
-	auto [first, last] = *iter;
-	//std::cerr << std::distance(iter, end) << "~~~~~~~~~~~~~~~~~~~~~~ " << first << "\t" << last << std::endl;
-	if(first == last) {
-	  // Only a single cell was changed.
-	  int new_A = destination[first];
-	  if(last_A_value != new_A) {
-	    opcode(boost::format("lda #%d") % new_A);
-	  }
-	  opcode(boost::format("sta %s+%d") % destinationname % first);
-	  last_A_value = new_A;
-	} else { // Multiple consecutive cells.
-	  // Number of elements in X.
-	  opcode(boost::format("ldx #%d") % (last - first + 1));
-	  auto codelabel = nextlabel(true);
-	  auto nextit = iter;
-	  for(; nextit != end; ++nextit) { // Loop to find similar lengths.
-	    // In the first loop iteration, they are equal, of course!
-	    auto [nextfirst, nextlast] = *nextit;
-	    //std::cerr << "N: " << nextfirst << "\t" << nextlast << std::endl;
-	    if((first == nextfirst) || (last == nextlast)) {
-	      // Equal, so output this line!
-	      //std::cerr << boost::format("first=%d, last=%d, nextfirst=%d, nextlast=%d\n") % first % last % nextfirst % nextlast;
-	      auto datalabel = nextlabel(false);
-	      for(unsigned i = first; i <= last; ++i) {
-		outbyte(destination.at(i));
-	      }
-	      opcode(boost::format("lda %s-1,x") % datalabel);
-	      opcode(boost::format("sta %s-1+%d,x") % destinationname % first);
-	    } else {
-	      break; // Leave the search for matching lines.
-	    }
-	  }
-	  opcode("dex");
-	  opcode(boost::format("bne %s") % codelabel);
-	  iter = nextit; // Move iterator pass the similar length lines.
-	  last_A_value = -1; // Value is unknown.
-	  continue; // In order to avoid the iteration incrementation below.
-	}
-	++iter;
-      }
-    };
-    //
-    deltaframe ^= next; //XOR to find the changing areas.
-    auto nextanimlabel = animlabel("frame", true);
-    exports.push_back(nextanimlabel); // Generate a function label for this frame.
-    std::cerr << "\t.import \t" << nextanimlabel << std::endl;
-    if(deltaframe.background != 0) {
-      opcode(boost::format("lda #%d") % next.background)
-	.opcode("sta $d021");
-    }
-    if(deltaframe.border != 0) {
-      opcode(boost::format("lda #%d") % next.border)
-      .opcode("sta $d020");
-    }
-    deltafun(deltaframe.chars, next.chars, "ANIMATIONSCREEN");
-    deltafun(deltaframe.colors, next.colors, "$D800");
-    opcode("rts");
-  }
-  std::ostream &write(std::ostream &out) {
-    auto nextanimlabel = animlabel("init");
-    exports.push_front(nextanimlabel);
-    std::cerr << "\t.import \t" << nextanimlabel << std::endl;
-    auto framecharlabel(nextlabel(false));
-    outbytes(initial_frame.chars);
-    auto framecollabel(nextlabel(false));
-    outbytes(initial_frame.colors);
-    opcode(boost::format("lda #%d") % initial_frame.background)
-      .opcode("sta $d021");
-    opcode(boost::format("lda #%d") % initial_frame.border)
-      .opcode("sta $d020");
-    opcode("ldx #0");
-    auto looplabel(nextlabel(true));
-    codeout << boost::format(R"(.repeat 4,I
-	 lda %s+I*250,x
-	 sta ANIMATIONSCREEN+I*250,x
-	 lda %s+I*250,x
-	 sta $D800+I*250,x
-	.endrepeat
-	inx
-	cpx #250
-	bne %s
-)") % framecharlabel % framecollabel % looplabel ;
-    // And return the number of frames.
-    opcode(boost::format("lda #%d ; Number of frames, LO.") % (framecounter & 0xFF))
-      .opcode(boost::format("ldx #%d ; Number of frames, HI.") % ((framecounter >> 8) & 0xFF));
-    opcode("rts");
-    // Now write (global is used so that `cl65` works with --asm-define):
-    out << "\t.global\tANIMATIONSCREEN\n";
-    out << "\t.rodata\n";
-    out << dataout.str() << '\n';
-    out << "\t.code\n";
-    if(generate_jumptable) {
-      auto tablelabel = animlabelname("jumptable");
-      out << tablelabel << ":\n";
-      for(auto lab : exports) {
-	out << "\tjmp\t" << lab << std::endl;
-      }
-      exports.push_back(tablelabel);
-    }
-    for(auto label : exports) {
-      out << "\t.export\t" << label << '\n';
-    }
-    out << codeout.str() << '\n';
-    return out;
-  }
-};
-
 /*! Generate complete (self-contained) code for the animation
  *
  * \param framearr the array of frames
@@ -379,10 +173,41 @@ void mode_generate_code(const FrameArray &framearr, const char *codename, bool j
   for(frameidx = 0; frameidx < framearr.size() - 1; ++frameidx) {
     generator.generate(framearr[frameidx], framearr[frameidx + 1]);
   }
+  const StageTimer timer(Stage::write);
   generator.write(std::cout);
 }
 
 
+/*! Options which change the output, for the cache key
+ *
+ * \param args_info parsed command line
+ * \return one line per option
+ */
+std::string cache_options(const gengetopt_args_info &args_info) {
+  std::ostringstream out;
+  if(args_info.first_given) {
+    out << "first=" << args_info.first_arg << '\n';
+  }
+  if(args_info.last_given) {
+    out << "last=" << args_info.last_arg << '\n';
+  }
+  out << "binary-input=" << args_info.binary_input_flag << '\n';
+  out << "ping-pong=" << args_info.ping_pong_flag << '\n';
+  if(args_info.output_bin_given) {
+    out << "output-bin=" << args_info.output_bin_arg << '\n';
+  }
+  if(args_info.start_addr_given) {
+    out << "start-addr=" << args_info.start_addr_arg << '\n';
+  }
+  out << "separate-frame=" << args_info.separate_frame_given << '\n';
+  out << "xor-previous=" << args_info.xor_previous_given << '\n';
+  out << "generate-code=" << args_info.generate_code_given << '\n';
+  out << "generate-code-name=" << args_info.generate_code_name_arg << '\n';
+  out << "generate-jumptable=" << args_info.generate_jumptable_flag << '\n';
+  return out.str();
+}
+
+
 /*! main code
  *
  * \param argc number of cli arguments
@@ -400,18 +225,50 @@ int main(int argc, char **argv) {
     std::cerr << "Error while parsind command line!\n";
     return -1;
   }
+  const StatsReport report("petsciiconvert", args_info.stats_given ? args_info.stats_arg : "", cerr);
   if(args_info.inputs_num >= 1) {
-    infile.open(args_info.inputs[0]);
+    infile.open(args_info.inputs[0], std::ios::binary);
     if(!infile) {
       cerr << "Can not open file " << args_info.inputs[0] << "!\n";
       return 2;
     }
     in = &infile;
   }
+  // The whole input is read first, it is part of the cache key.
+  const std::string input{std::istreambuf_iterator<char>(*in), std::istreambuf_iterator<char>()};
+  std::optional<ConversionCache> cache;
+  std::optional<CacheKey> key;
+  const char *cache_dir = args_info.cache_dir_given ? args_info.cache_dir_arg : std::getenv("C64GFX_CACHE_DIR");
+  if(cache_dir) {
+    try {
+      cache.emplace(cache_dir, static_cast<unsigned>(std::max(1, args_info.cache_size_arg)));
+      key.emplace("petsciiconvert");
+      key->add(cache_options(args_info)).add(input);
+      if(const auto hit = cache->lookup(*key)) {
+	hit->restore(cout);
+	cerr << ";\tRestored " << hit->bytes() << " output bytes from the cache.\n";
+	if(args_info.cache_stats_flag) {
+	  cerr << format_cache_stats(cache->stats());
+	}
+	return hit->status;
+      }
+    }
+    catch(const std::exception &excp) {
+      // The cache is only an optimisation: on any error it is left out.
+      cerr << "Warning: cache not used: " << excp.what() << endl;
+      cache.reset();
+    }
+  }
+  std::optional<StreamCapture> captured;
+  if(cache) {
+    captured.emplace(cout);
+  }
+  std::istringstream parsein(input);
+  std::vector<std::string> written;
   cerr << ";\tParsing..." << std::flush;
   // Parse!
   try {
-    framearr = parse_file(*in);
+    framearr = args_info.binary_input_flag ? read_binary_frames(parsein) : parse_file(parsein);
     if(args_info.last_given) {
       if(static_cast<unsigned int>(args_info.last_arg) >= framearr.size()) {
 	cerr << "Error! Last frame bigger than available frames.\n";
@@ -434,12 +291,13 @@ int main(int argc, char **argv) {
     return 2;
   }
   cerr << "Found " << framearr.size() << " frames.\n";
+  count_stat("frames", framearr.size());
   if(args_info.output_bin_given) { // use binary output mode
     std::optional<unsigned short> startaddr;
     if(args_info.start_addr_given) {
       startaddr = args_info.start_addr_arg;
     }
-    mode_binary_output(args_info.output_bin_arg, framearr, startaddr, args_info.separate_frame_given, args_info.xor_previous_given);
+    written = mode_binary_output(args_info.output_bin_arg, framearr, startaddr, args_info.separate_frame_given, args_info.xor_previous_given);
   } if(args_info.generate_code_given) { // generate code mode
     mode_generate_code(framearr, args_info.generate_code_name_arg, args_info.generate_jumptable_flag);
   } else { // default mode is animation mode
@@ -454,5 +312,21 @@ int main(int argc, char **argv) {
       cout << "\t.export\t" << i << endl;
     }
   }
+  if(cache) {
+    try {
+      CacheEntry entry;
+      entry.out = captured->release();
+      for(const auto &name : written) {
+	entry.add_file(name);
+      }
+      cache->store(*key, entry);
+      if(args_info.cache_stats_flag) {
+	cerr << format_cache_stats(cache->stats());
+      }
+    }
+    catch(const std::exception &excp) {
+      cerr << "Warning: result not cached: " << excp.what() << endl;
+    }
+  }
   return 0;
 }
@@ -0,0 +1,162 @@
+#include "runstats.hh"
+#include <array>
+#include <format>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/resource.h>
+
+namespace runstats_detail {
+bool enabled = false;
+std::atomic<std::uint64_t> allocations{ 0 };
+std::atomic<std::uint64_t> allocated_bytes{ 0 };
+bool allocations_counted = false;
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/// Names of the stages, in the order of Stage.
+constexpr std::array<std::string_view, STAGE_COUNT> STAGE_NAMES{
+  "load", "resize", "quantise", "dither", "parse", "diff", "emit", "write"
+};
+
+/// Accumulated time of one stage.
+struct StageTotal {
+  std::atomic<std::uint64_t> calls{ 0 };
+  std::atomic<std::int64_t> nanoseconds{ 0 };
+};
+
+std::string tool_name;
+Clock::time_point start_time;
+std::array<StageTotal, STAGE_COUNT> stage_totals;
+
+/// Counters in the order of their first use.
+std::vector<std::pair<std::string, std::uint64_t> > counters;
+std::mutex counters_mutex;
+
+/// Peak resident set size in KiB.
+long peak_rss_kib() {
+  rusage usage{};
+  if(::getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+  return usage.ru_maxrss;
+}
+
+double to_ms(std::int64_t nanoseconds) {
+  return nanoseconds / 1e6;
+}
+
+void print_table(std::ostream &out, double wall_ms) {
+  out << std::format("{:<10} {:>8} {:>12} {:>7}\n", "stage", "calls", "time", "share");
+  for(unsigned i = 0; i < STAGE_COUNT; ++i) {
+    const std::uint64_t calls = stage_totals[i].calls;
+    if(calls == 0) {
+      continue;
+    }
+    const double ms = to_ms(stage_totals[i].nanoseconds);
+    out << std::format("{:<10} {:>8} {:>9.3f} ms {:>6.1f}%\n", STAGE_NAMES[i], calls, ms,
+                       wall_ms > 0 ? 100.0 * ms / wall_ms : 0.0);
+  }
+  out << std::format("{:<10} {:>8} {:>9.3f} ms\n", "total", "", wall_ms);
+  {
+    const std::lock_guard lock(counters_mutex);
+    for(const auto &[name, value] : counters) {
+      out << std::format("{:<24} {:>12}\n", name, value);
+    }
+  }
+  if(runstats_detail::allocations_counted) {
+    out << std::format("{:<24} {:>12} ({:.1f} MiB)\n", "allocations", runstats_detail::allocations.load(),
+                       runstats_detail::allocated_bytes / 1048576.0);
+  }
+  out << std::format("{:<24} {:>12.1f} MiB\n", "peak RSS", peak_rss_kib() / 1024.0);
+}
+
+void print_json(std::ostream &out, double wall_ms) {
+  out << std::format(R"({{"tool": "{}", "suite_version": "{}", "wall_ms": {:.3f}, "stages": {{)", tool_name,
+                     SUITE_VERSION, wall_ms);
+  bool first = true;
+  for(unsigned i = 0; i < STAGE_COUNT; ++i) {
+    const std::uint64_t calls = stage_totals[i].calls;
+    if(calls == 0) {
+      continue;
+    }
+    out << std::format(R"({}"{}": {{"calls": {}, "ms": {:.3f}}})", first ? "" : ", ", STAGE_NAMES[i], calls,
+                       to_ms(stage_totals[i].nanoseconds));
+    first = false;
+  }
+  out << R"(}, "counters": {)";
+  {
+    const std::lock_guard lock(counters_mutex);
+    first = true;
+    for(const auto &[name, value] : counters) {
+      out << std::format(R"({}"{}": {})", first ? "" : ", ", name, value);
+      first = false;
+    }
+  }
+  out << "}, ";
+  if(runstats_detail::allocations_counted) {
+    out << std::format(R"("allocations": {}, "allocated_bytes": {}, )", runstats_detail::allocations.load(),
+                       runstats_detail::allocated_bytes.load());
+  } else {
+    out << R"("allocations": null, "allocated_bytes": null, )";
+  }
+  out << std::format(R"("peak_rss_kib": {}}})", peak_rss_kib()) << '\n';
+}
+
+} // namespace
+
+std::string_view stage_name(Stage stage) {
+  return STAGE_NAMES.at(static_cast<unsigned>(stage));
+}
+
+void runstats_detail::add_stage_time(Stage stage, Clock::duration time) {
+  StageTotal &total = stage_totals[static_cast<unsigned>(stage)];
+  total.calls.fetch_add(1, std::memory_order_relaxed);
+  total.nanoseconds.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(time).count(),
+                              std::memory_order_relaxed);
+}
+
+void runstats_detail::add_counter(std::string_view name, std::uint64_t value) {
+  const std::lock_guard lock(counters_mutex);
+  for(auto &[counter, total] : counters) {
+    if(counter == name) {
+      total += value;
+      return;
+    }
+  }
+  counters.emplace_back(name, value);
+}
+
+void enable_stats(std::string_view tool) {
+  tool_name = tool;
+  start_time = Clock::now();
+  runstats_detail::enabled = true;
+}
+
+void print_stats(std::ostream &out, bool json) {
+  if(!runstats_detail::enabled) {
+    return;
+  }
+  const double wall_ms = to_ms(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start_time).count());
+  if(json) {
+    print_json(out, wall_ms);
+  } else {
+    print_table(out, wall_ms);
+  }
+}
+
+StatsReport::StatsReport(std::string_view tool, std::string_view format, std::ostream &output)
+  : out(output), json(format == "json") {
+  if(!format.empty()) {
+    enable_stats(tool);
+  }
+}
+
+StatsReport::~StatsReport() {
+  print_stats(out, json);
+}
@@ -0,0 +1,141 @@
+#ifndef __RUNSTATS_HH_2026__
+#define __RUNSTATS_HH_2026__
+/*! \file runstats.hh
+ *  \brief Per-stage timings and counters of a converter run (--stats).
+ *
+ * The converters divide their work into a few stages (loading, cropping
+ * and resizing, quantisation, dithering, parsing, diffing, code emission
+ * and writing). A StageTimer placed in a scope adds the time spent in it
+ * to its stage; count_stat() adds to a named counter, e.g. the number of
+ * blocks or frames. Both do nothing but test a flag until enable_stats()
+ * is called, so the instrumentation stays in release builds.
+ *
+ * print_stats() writes the collected numbers as a table or as one line
+ * of JSON, together with the wall time, the peak resident set size and,
+ * if runstats_alloc.o is linked into the program, the number of heap
+ * allocations.
+ *
+ * Timers may run in several threads at once; the time of a stage is
+ * then the sum over all threads and can exceed the wall time.
+ */
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+
+/// Stages of a conversion.
+enum class Stage : unsigned {
+  load,     ///< Reading and decoding the input
+  resize,   ///< Cropping, resizing and converting the image
+  quantise, ///< Nearest colours, colour pair search
+  dither,   ///< Error diffusion
+  parse,    ///< Parsing text input
+  diff,     ///< Comparing frames
+  emit,     ///< Generating code or data
+  write,    ///< Writing the output
+};
+
+/// Number of stages.
+inline constexpr unsigned STAGE_COUNT = static_cast<unsigned>(Stage::write) + 1;
+
+/// Name of \p stage as printed in the statistics.
+std::string_view stage_name(Stage stage);
+
+namespace runstats_detail {
+/// True after enable_stats(); only written before threads are started.
+extern bool enabled;
+/// Heap allocations, counted by runstats_alloc.o.
+extern std::atomic<std::uint64_t> allocations;
+/// Bytes of all heap allocations, counted by runstats_alloc.o.
+extern std::atomic<std::uint64_t> allocated_bytes;
+/// Set by runstats_alloc.o if it is linked into the program.
+extern bool allocations_counted;
+
+void add_stage_time(Stage stage, std::chrono::steady_clock::duration time);
+void add_counter(std::string_view name, std::uint64_t value);
+}
+
+/**
+ * \brief Start collecting statistics.
+ *
+ * Call once at the start of main(), before any thread is started.
+ *
+ * \param tool program name for the output
+ */
+void enable_stats(std::string_view tool);
+
+/// True if statistics are collected.
+inline bool stats_enabled() {
+  return runstats_detail::enabled;
+}
+
+/// Add \p value to the counter \p name; meant for outer loops, not per pixel.
+inline void count_stat(std::string_view name, std::uint64_t value = 1) {
+  if(runstats_detail::enabled) {
+    runstats_detail::add_counter(name, value);
+  }
+}
+
+/**
+ * \brief Adds the time until its destruction to a stage.
+ */
+class StageTimer {
+  Stage stage;
+  bool active;
+  std::chrono::steady_clock::time_point start;
+
+public:
+  explicit StageTimer(Stage s) : stage(s), active(runstats_detail::enabled) {
+    if(active) {
+      start = std::chrono::steady_clock::now();
+    }
+  }
+  ~StageTimer() {
+    stop();
+  }
+  StageTimer(const StageTimer &) = delete;
+  StageTimer &operator=(const StageTimer &) = delete;
+
+  /// End the measurement before the end of the scope.
+  void stop() {
+    if(active) {
+      runstats_detail::add_stage_time(stage, std::chrono::steady_clock::now() - start);
+      active = false;
+    }
+  }
+};
+
+/**
+ * \brief Write the statistics collected so far.
+ *
+ * Does nothing unless enable_stats() was called.
+ *
+ * \param out output stream, usually std::cerr
+ * \param json one line of JSON instead of a table
+ */
+void print_stats(std::ostream &out, bool json);
+
+/**
+ * \brief The --stats option of a converter.
+ *
+ * Enables the statistics if a format was given and prints them when
+ * main() returns, also on early returns like cache hits.
+ */
+class StatsReport {
+  std::ostream &out;
+  bool json;
+
+public:
+  /**
+   * \param tool program name
+   * \param format "table", "json" or empty (--stats not given)
+   * \param output stream for the statistics
+   */
+  StatsReport(std::string_view tool, std::string_view format, std::ostream &output);
+  ~StatsReport();
+  StatsReport(const StatsReport &) = delete;
+  StatsReport &operator=(const StatsReport &) = delete;
+};
+
+#endif
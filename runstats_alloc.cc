@@ -0,0 +1,59 @@
+/*! \file runstats_alloc.cc
+ *  \brief Replacement of the global operator new which counts allocations.
+ *
+ * Linked into the converters (not into libc64gfx, the replacement is a
+ * decision of the program) to report the number and size of the heap
+ * allocations with --stats. Without --stats only a flag is tested.
+ */
+#include "runstats.hh"
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+/// Tells print_stats() that allocations are counted.
+[[maybe_unused]] const bool counting_linked = (runstats_detail::allocations_counted = true);
+
+void count_allocation(std::size_t size) {
+  if(runstats_detail::enabled) {
+    runstats_detail::allocations.fetch_add(1, std::memory_order_relaxed);
+    runstats_detail::allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  }
+}
+
+} // namespace
+
+void *operator new(std::size_t size) {
+  count_allocation(size);
+  if(void *ptr = std::malloc(size == 0 ? 1 : size)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size, std::align_val_t align) {
+  count_allocation(size);
+  const auto alignment = static_cast<std::size_t>(align);
+  // aligned_alloc() needs a non-zero multiple of the alignment as size.
+  const std::size_t rounded = size == 0 ? alignment : (size + alignment - 1) / alignment * alignment;
+  if(void *ptr = std::aligned_alloc(alignment, rounded)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void *ptr, std::align_val_t) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t, std::align_val_t) noexcept {
+  std::free(ptr);
+}
@@ -18,81 +18,49 @@
  * spriteconv [COMMON OPTIONS] multi [MULTI OPTIONS] <file>
  * ```
  *
- * Build dependencies: SDL2, SDL2_image, CLI11
+ * Sprites are kept as packed 64-byte records (see \c SpriteBytes) built
+ * directly from the sheet rows by libc64gfx (see sprites.hh). They are written as assembler source
+ * (\c .byte lines) or, with \c --binary, as a contiguous sprite bank plus
+ * a symbol file with one label per sprite.
+ *
+ * Truecolour images are quantised to the C64 palette (see c64palette.hh)
+ * and the sprite colours are chosen automatically.
+ *
+ * With --cache-dir (or $C64GFX_CACHE_DIR) the outputs of a run are
+ * cached (see convcache.hh) and restored when the sheet, the layout file
+ * and the options are unchanged. --stats prints the time spent per stage
+ * on stderr (see runstats.hh).
+ *
+ * Reads PNG and PNM files only (see imageload_plain.cc).
+ *
+ * Build dependencies: libc64gfx, SDL2, libpng, CLI11
  * Requires: C++23 (-std=c++23)
  */
 
+#include "c64palette.hh"
+#include "change_ending.hh"
+#include "convcache.hh"
+#include "imageload.hh"
+#include "runstats.hh"
+#include "sprites.hh"
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <cstdint>
+#include <cstring>
 #include <format>
+#include <fstream>
 #include <iostream>
-#include <map>
+#include <numeric>
 #include <optional>
+#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <vector>
 
 #include <SDL2/SDL.h>
-#include <SDL2/SDL_image.h>
 #include <CLI/CLI.hpp>
 
-// ── sprite data structures ────────────────────────────────────────────────────
-
-/// Common interface for sprite types.
-struct SpriteInterface {
-  virtual std::ostream &write_asm(std::ostream &out) const = 0;
-  virtual int width()  const = 0;
-  virtual int height() const = 0;
-  virtual ~SpriteInterface() = default;
-};
-
-/// Standard (1-bit) 24x21 pixel sprite.
-struct SpriteData : public SpriteInterface {
-  int pixel[24][21];
-
-  std::ostream &write_asm(std::ostream &out) const override {
-    for (int iy = 0; iy < 21; ++iy) {
-      out << "\t.byte";
-      for (int ix = 0; ix < 24; ix += 8) {
-        unsigned int value = 0;
-        for (int bit = 0; bit < 8; ++bit)
-          if (pixel[ix + bit][iy] != 0)
-            value |= 1u << (7 - bit);
-        out << std::format(" ${:02X}{}", value, ix < 16 ? ',' : ' ');
-      }
-      out << '\n';
-    }
-    out << "\t.byte $00";
-    return out;
-  }
-
-  int width()  const override { return 24; }
-  int height() const override { return 21; }
-};
-
-/*! \brief Multicolour 12x21 sprite (each logical pixel = 2 screen pixels wide).
- *
- * Pixel values store the 2-bit C64 colour pattern (0-3) per logical pixel.
- */
-struct MultiSpriteData : public SpriteInterface {
-  int pixel[12][21];
-
-  std::ostream &write_asm(std::ostream &out) const override {
-    for (int iy = 0; iy < 21; ++iy) {
-      out << "\t.byte";
-      for (int ix = 0; ix < 12; ix += 4) {
-        unsigned int value = 0;
-        for (int bit = 0; bit < 8; bit += 2)
-          value |= (pixel[ix + bit / 2][iy] & 3) << (6 - bit);
-        out << std::format(" ${:02X}{}", value, ix < 8 ? ',' : ' ');
-      }
-      out << '\n';
-    }
-    out << "\t.byte $80";
-    return out;
-  }
-
-  int width()  const override { return 12; }
-  int height() const override { return 21; }
-};
-
 // ── pixel helpers ─────────────────────────────────────────────────────────────
 
 /**
@@ -110,6 +78,43 @@ int get_color(SDL_Surface *surface, int x, int y) {
   return row[x];
 }
 
+/**
+ * \brief Wrap a loaded image in an SDL surface.
+ *
+ * Indexed and grey images become 8 bpp surfaces (grey values are used
+ * as palette indices with a grey ramp palette), RGB and RGBA images
+ * become 24 and 32 bpp surfaces.
+ *
+ * \param img  Image as returned by load_image().
+ * \return New surface (to be freed by the caller).
+ */
+SDL_Surface *surface_from_image(const ImageBuffer &img) {
+  static constexpr Uint32 formats[] = {SDL_PIXELFORMAT_INDEX8, SDL_PIXELFORMAT_INDEX8,
+                                       SDL_PIXELFORMAT_RGB24, SDL_PIXELFORMAT_RGBA32};
+  const Uint32 format = formats[static_cast<int>(img.format)];
+  SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0, static_cast<int>(img.width),
+                                                        static_cast<int>(img.height),
+                                                        static_cast<int>(img.channels() * 8), format);
+  if (!surface)
+    throw std::runtime_error(std::format("SDL_CreateRGBSurfaceWithFormat() failed: {}",
+                                         SDL_GetError()));
+  if (format == SDL_PIXELFORMAT_INDEX8) {
+    std::vector<SDL_Color> colours(256);
+    for (int i = 0; i < 256; ++i) {
+      const Uint8 grey = static_cast<Uint8>(i);
+      colours[i] = {grey, grey, grey, 255};
+    }
+    for (std::size_t i = 0; i < img.palette.size() && i < colours.size(); ++i)
+      colours[i] = {img.palette[i][0], img.palette[i][1], img.palette[i][2], img.palette[i][3]};
+    SDL_SetPaletteColors(surface->format->palette, colours.data(), 0, 256);
+  }
+  SDL_LockSurface(surface);
+  for (unsigned y = 0; y < img.height; ++y)
+    std::memcpy(static_cast<Uint8 *>(surface->pixels) + y * surface->pitch, img.row(y), img.stride());
+  SDL_UnlockSurface(surface);
+  return surface;
+}
+
 // ── display ───────────────────────────────────────────────────────────────────
 
 /**
@@ -184,164 +189,541 @@ bool display_surface(SDL_Surface *surface, const std::string &title) {
   return true;
 }
 
-// ── sprite conversion ─────────────────────────────────────────────────────────
+// ── CLI options struct ────────────────────────────────────────────────────────
 
-/*! \brief Convert a region of an 8 bpp surface to a 1-bit sprite.
+/**
+ * \brief Aggregated command-line options.
  *
- * \param surface      Source surface (must be 8 bpp).
- * \param xpos         X offset of the sprite's top-left corner.
- * \param ypos         Y offset of the sprite's top-left corner.
- * \param transparent  Palette index treated as transparent (= 0 bit).
+ * All fields mirror the original gengetopt option names for easy diffing.
+ * The sheet layout and colours (--x-position … --autocol) are inherited
+ * from SheetOptions.
  */
-SpriteData convert_bw_sprite(SDL_Surface *surface,
-                             int xpos, int ypos,
-                             int transparent)
-{
-  SpriteData sprite;
-  for (int row = 0; row < 21; ++row)
-    for (int column = 0; column < 24; ++column)
-      sprite.pixel[column][row] =
-        (get_color(surface, xpos + column, ypos + row) != transparent) ? 1 : 0;
-  return sprite;
+struct Options : SheetOptions {
+  // common options
+  std::string                input_file;          ///< Positional: image file (owned by subcommand)
+  std::optional<std::string> labelname;            ///< --labelname (optional)
+  bool                       display       = false; ///< --display / -d
+  std::optional<std::string> binary_file;         ///< --binary (sprite bank output)
+  std::optional<unsigned short> load_address;     ///< --load-address
+  bool                       align         = false; ///< --align (64-byte aligned bank)
+  bool                       dedup         = false; ///< --dedup
+  bool                       dedup_mirror  = false; ///< --dedup-mirror (implies --dedup)
+  bool                       dedup_shift   = false; ///< --dedup-shift (implies --dedup)
+  bool                       auto_extract  = false; ///< --auto (bounding-box extraction)
+  std::string                palette       = "grafx2"; ///< --palette (truecolour input)
+  bool                       quantise      = false; ///< --quantise (also for 8 bpp input)
+  bool                       software      = false; ///< --software (pre-shifted software sprites)
+  bool                       mask          = false; ///< --mask (AND masks for --software)
+  std::optional<std::string> multiplex;           ///< --multiplex (frame layout file)
+  int                        mux_gap       = 2;   ///< --mux-gap (raster lines to reuse a sprite)
+  std::optional<std::string> cache_dir;           ///< --cache-dir (result cache)
+  unsigned                   cache_size    = DEFAULT_CACHE_MIB; ///< --cache-size in MiB
+  bool                       cache_stats   = false; ///< --cache-stats
+  std::string                stats;               ///< --stats format, empty if not given
+
+  // multicolour subcommand options
+  bool optimise   = false; ///< --optimise (choose multi1/multi2 and sprite colours)
+  std::string metric = "error"; ///< --metric for --optimise: "error" or "lost"
+};
+
+// ── multiplexer analysis ──────────────────────────────────────────────────────
+
+/// Number of hardware sprites of the VIC-II.
+inline constexpr int HW_SPRITES = 8;
+
+/// One hardware sprite shown in a frame of a multiplexer layout.
+struct MuxSprite {
+  int         frame;  ///< Frame number
+  std::size_t sprite; ///< Sprite number in extraction order
+  int         x, y;   ///< Screen position (y is the first raster line)
+};
+
+/**
+ * \brief Read a multiplexer layout file.
+ *
+ * Every non-empty line which does not start with \c # places a sprite or
+ * an object (from --auto) in a frame:
+ * ```
+ * <frame> sprite <number> <x> <y>
+ * <frame> object <number> <x> <y>
+ * ```
+ * An object expands to all its sprites at their layout offsets.
+ *
+ * \param path     layout file
+ * \param layouts  object layouts of an --auto extraction (may be empty)
+ * \param count    number of extracted sprites
+ * \return placements in file order
+ */
+std::vector<MuxSprite> read_mux_layout(const std::string &path, const std::vector<ObjectLayout> &layouts,
+                                       std::size_t count) {
+  std::ifstream in(path);
+  if (!in)
+    throw std::runtime_error(std::format("cannot open '{}'", path));
+  std::vector<MuxSprite> ret;
+  std::string line;
+  for (unsigned lineno = 1; std::getline(in, line); ++lineno) {
+    std::istringstream fields(line);
+    std::string kind;
+    int frame, x, y;
+    std::size_t number;
+    if (const auto start = line.find_first_not_of(" \t\r");
+        start == std::string::npos || line[start] == '#')
+      continue;
+    if (!(fields >> frame >> kind >> number >> x >> y) || (kind != "sprite" && kind != "object"))
+      throw std::invalid_argument(std::format("{}:{}: expected '<frame> sprite|object <number> <x> <y>'",
+                                              path, lineno));
+    if (kind == "sprite") {
+      if (number >= count)
+        throw std::invalid_argument(std::format("{}:{}: no sprite {}", path, lineno, number));
+      ret.push_back({frame, number, x, y});
+    } else {
+      if (number >= layouts.size())
+        throw std::invalid_argument(std::format("{}:{}: no object {} (objects need --auto)",
+                                                path, lineno, number));
+      for (const auto &entry : layouts[number].sprites)
+        ret.push_back({frame, entry.sprite, x + entry.dx, y + entry.dy});
+    }
+  }
+  return ret;
 }
 
-/*! \brief Convert a region of an 8 bpp surface to a multicolour sprite.
+/**
+ * \brief Report the raster line load of every frame and simulate a multiplexer.
  *
- * \param surface      Source surface (must be 8 bpp).
- * \param xpos         X offset of the sprite's top-left corner.
- * \param ypos         Y offset of the sprite's top-left corner.
- * \param transparent  Palette index for transparent pixels (bit pattern 00).
- * \param m1           Palette index for multicolour-1 pixels (bit pattern 01).
- * \param m2           Palette index for multicolour-2 pixels (bit pattern 11).
- *                     All other palette indices map to individual colour (10).
+ * The per-line load is computed with a sweep over the start and end
+ * lines of all sprites of a frame and reported as ranges of equal load.
+ * The multiplexer is simulated the usual way: sprites sorted by Y are
+ * assigned to the hardware sprites round-robin, and a hardware sprite can
+ * only be reused \p gap raster lines after its previous sprite ended.
+ *
+ * \param placements sprites of all frames
+ * \param gap        raster lines needed to reprogram a hardware sprite
+ * \return true if no line has more than 8 sprites and every reuse fits
  */
-MultiSpriteData convert_multi_sprite(SDL_Surface *surface,
-                                     int xpos, int ypos,
-                                     int transparent, int m1, int m2)
-{
-  MultiSpriteData sprite;
-  for (int row = 0; row < 21; ++row) {
-    for (int column = 0; column < 12; ++column) {
-      const int px = get_color(surface, xpos + column, ypos + row);
-      int pattern;
-      if      (px == transparent) pattern = 0b00;
-      else if (px == m1)          pattern = 0b01;
-      else if (px == m2)          pattern = 0b11;
-      else                        pattern = 0b10;
-      sprite.pixel[column][row] = pattern;
+bool analyse_multiplexer(std::vector<MuxSprite> placements, int gap) {
+  std::stable_sort(placements.begin(), placements.end(), [](const MuxSprite &a, const MuxSprite &b) {
+    return a.frame != b.frame ? a.frame < b.frame : a.y < b.y;
+  });
+  bool ok = true;
+  unsigned frames = 0;
+  for (auto first = placements.begin(); first != placements.end(); ++frames) {
+    const auto last = std::find_if(first, placements.end(),
+                                   [&](const MuxSprite &m) { return m.frame != first->frame; });
+    const auto count = static_cast<std::size_t>(last - first);
+
+    std::vector<std::pair<int, int> > events; // line, +1/-1
+    for (auto it = first; it != last; ++it) {
+      events.emplace_back(it->y, 1);
+      events.emplace_back(it->y + 21, -1);
     }
+    std::sort(events.begin(), events.end());
+    std::string ranges;
+    int load = 0, max_load = 0, max_line = 0;
+    for (std::size_t i = 0; i < events.size();) {
+      const int line = events[i].first;
+      for (; i < events.size() && events[i].first == line; ++i)
+        load += events[i].second;
+      if (load > max_load) {
+        max_load = load;
+        max_line = line;
+      }
+      if (load > 0 && i < events.size())
+        ranges += std::format(" {}-{}:{}{}", line, events[i].first - 1, load,
+                              load > HW_SPRITES ? "!" : "");
+    }
+
+    std::size_t late = 0;
+    std::string first_late;
+    for (std::size_t i = HW_SPRITES; i < count; ++i) {
+      const MuxSprite &prev = first[i - HW_SPRITES], &cur = first[i];
+      if (cur.y < prev.y + 21 + gap) {
+        if (late++ == 0)
+          first_late = std::format(", first: sprite {} at line {} (slot free at line {})",
+                                   cur.sprite, cur.y, prev.y + 21 + gap);
+      }
+    }
+    const bool frame_ok = max_load <= HW_SPRITES && late == 0;
+    ok = ok && frame_ok;
+    std::cerr << std::format("  frame {}: {} sprites, at most {} per line (line {}){}\n",
+                             first->frame, count, max_load, max_line,
+                             frame_ok ? "" : "  OVERRUN");
+    if (late)
+      std::cerr << std::format("    {} slot reuses too early{}\n", late, first_late);
+    std::cerr << std::format("    load:{}\n", ranges);
+    first = last;
   }
-  return sprite;
+  std::cerr << std::format("Multiplexer: {} frames, {}\n", frames, ok ? "ok" : "raster overrun");
+  return ok;
 }
 
-/*! \brief Auto-assign up to 4 colours from a sprite region (multicolour).
+/**
+ * \brief Bank order which keeps the sprites of a frame together.
  *
- * Colours are assigned ordinal values (0-3) in first-occurrence order.
- * Throws \c std::logic_error if more than 4 distinct palette indices appear.
+ * Frames are visited in order and their sprites from top to bottom; each
+ * bank sprite is placed when it is used for the first time. Sprites not
+ * used in any frame follow at the end in their old order.
  *
- * \param surface  Source surface (must be 8 bpp).
- * \param x        X offset of the sprite's top-left corner.
- * \param y        Y offset of the sprite's top-left corner.
- * \param border   Additional border offset added to both axes.
+ * \param placements sprites of all frames
+ * \param bank       maps a sprite number in extraction order to its bank index
+ * \param size       number of sprites in the bank
+ * \return old bank index for every new position
  */
-MultiSpriteData convert_sprite(SDL_Surface *surface, int x, int y, int border) {
-  MultiSpriteData sprite;
-  std::map<int, int> pixelvalues;
-  int maxpixelval = 0;
-
-  for (int iy = 0; iy < 21; ++iy) {
-    const Uint8 *pixelline = static_cast<const Uint8 *>(surface->pixels)
-                           + (y + iy + border) * surface->pitch;
-    for (int ix = 0; ix < 12; ++ix) {
-      const int px = pixelline[border + x + ix];
-      auto [it, inserted] = pixelvalues.emplace(px, maxpixelval);
-      if (inserted) ++maxpixelval;
-      sprite.pixel[ix][iy] = it->second;
+std::vector<std::size_t> multiplexer_order(std::vector<MuxSprite> placements,
+                                           const std::vector<std::size_t> &bank, std::size_t size) {
+  std::stable_sort(placements.begin(), placements.end(), [](const MuxSprite &a, const MuxSprite &b) {
+    return a.frame != b.frame ? a.frame < b.frame : (a.y != b.y ? a.y < b.y : a.x < b.x);
+  });
+  std::vector<std::size_t> order;
+  std::vector<bool> placed(size, false);
+  order.reserve(size);
+  for (const auto &m : placements) {
+    if (const std::size_t idx = bank[m.sprite]; !placed[idx]) {
+      placed[idx] = true;
+      order.push_back(idx);
     }
   }
+  for (std::size_t idx = 0; idx < size; ++idx)
+    if (!placed[idx])
+      order.push_back(idx);
+  return order;
+}
 
-  if (pixelvalues.size() > 4)
-    throw std::logic_error("too many pixel values");
+/**
+ * \brief Reorder the sprite bank and update every reference to it.
+ *
+ * \param order   old bank index for every new position, see multiplexer_order()
+ * \param bank    sprites to be written, reordered in place
+ * \param dedup   table of a deduplicated sheet (its references are updated)
+ * \param layouts object layouts, updated if there is no dedup table
+ */
+void reorder_bank(const std::vector<std::size_t> &order, std::vector<SheetSprite> &bank,
+                  std::optional<SpriteDedup> &dedup, std::vector<ObjectLayout> &layouts) {
+  std::vector<std::size_t> position(order.size());
+  std::vector<SheetSprite> reordered;
+  reordered.reserve(order.size());
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    position[order[i]] = i;
+    reordered.push_back(bank[order[i]]);
+  }
+  bank = std::move(reordered);
+  if (dedup) {
+    for (auto &ref : dedup->refs)
+      ref.index = static_cast<unsigned>(position[ref.index]);
+  } else {
+    for (auto &layout : layouts)
+      for (auto &entry : layout.sprites)
+        entry.sprite = position[entry.sprite];
+  }
+}
+
+// ── output ────────────────────────────────────────────────────────────────────
 
-  return sprite;
+/**
+ * \brief Write sprites as assembler source, one optional label per sprite.
+ */
+void write_sprites_asm(const std::vector<SheetSprite> &sprites, const Options &opts,
+                       std::ostream &out) {
+  if ((opts.quantise || opts.optimise) && opts.multi_mode)
+    out << std::format("{0}_multi1 = ${1:02X}\n{0}_multi2 = ${2:02X}\n",
+                       opts.labelname.value_or("sprite"), opts.multi1, opts.multi2);
+  for (const auto &sprite : sprites) {
+    if (opts.labelname)
+      out << std::format("{}: \n", sprite_label(*opts.labelname, sprite));
+    write_sprite_asm(sprite.bytes, out) << '\n';
+  }
 }
 
-// ── CLI options struct ────────────────────────────────────────────────────────
+/**
+ * \brief Address of the first sprite in the binary sprite bank.
+ *
+ * This is the load address, rounded up to 64 bytes with \p opts.align,
+ * or 0 if no load address was given (addresses are offsets then).
+ */
+[[nodiscard]] unsigned bank_base(const Options &opts) {
+  if (!opts.load_address)
+    return 0;
+  const unsigned addr = *opts.load_address;
+  return opts.align ? (addr + 63) / 64 * 64 : addr;
+}
 
 /**
- * \brief Aggregated command-line options.
+ * \brief Write sprites as a contiguous binary sprite bank.
  *
- * All fields mirror the original gengetopt option names for easy diffing.
+ * The bank optionally starts with the load address. With \p opts.align
+ * padding is inserted after the load address so that the first sprite
+ * (and therefore every sprite) starts on a 64-byte boundary; this is
+ * required for sprite pointers. A symbol file (same name, extension
+ * .sym) receives one label per sprite with its address, or its offset
+ * if no load address was given, plus the sprite pointer value.
  */
-struct Options {
-  // common options
-  std::string                input_file;          ///< Positional: image file (owned by subcommand)
-  int                        x_position    = 0;   ///< --x-position / -x
-  int                        y_position    = 0;   ///< --y-position / -y
-  int                        transparent   = 0;   ///< --transparent / -t
-  std::optional<std::string> labelname;            ///< --labelname (optional)
-  int                        spritecolumns = 1;   ///< --spritecolumns / -c
-  int                        spriterows    = 1;   ///< --spriterows / -r
-  int                        columnwidth   = 24;  ///< --columnwidth / -W
-  int                        rowheight     = 21;  ///< --rowheight / -H
-  bool                       display       = false; ///< --display / -d
+void write_sprite_bank(const std::vector<SheetSprite> &sprites, const Options &opts) {
+  const std::string &bankname = *opts.binary_file;
+  std::ofstream bank(bankname, std::ios::binary);
+  if (!bank)
+    throw std::runtime_error(std::format("cannot open '{}'", bankname));
 
-  // multicolour subcommand options
-  bool multi_mode = false; ///< true when the "multi" subcommand was selected
-  int  multi1     = 1;     ///< --multi1 / -1  (bit pattern 01)
-  int  multi2     = 2;     ///< --multi2 / -2  (bit pattern 11)
-  bool autocol    = false; ///< --autocol (auto-choose colours)
-};
+  const unsigned base = bank_base(opts);
+  if (opts.load_address) {
+    const unsigned addr = *opts.load_address;
+    bank.put(static_cast<char>(addr & 0xFF));
+    bank.put(static_cast<char>(addr >> 8));
+    for (unsigned i = addr; i < base; ++i)
+      bank.put(0);
+  }
+  for (const auto &sprite : sprites)
+    bank.write(reinterpret_cast<const char *>(sprite.bytes.data()), sprite.bytes.size());
+
+  const std::string symname = change_ending(bankname, "sym");
+  std::ofstream sym(symname);
+  const std::string label = opts.labelname.value_or("sprite");
+  sym << std::format("; {} sprites in {}\n", sprites.size(), bankname);
+  sym << std::format("{}_count = {}\n", label, sprites.size());
+  if ((opts.quantise || opts.optimise) && opts.multi_mode)
+    sym << std::format("{0}_multi1 = ${1:02X}\n{0}_multi2 = ${2:02X}\n", label, opts.multi1, opts.multi2);
+  for (std::size_t i = 0; i < sprites.size(); ++i) {
+    const unsigned addr = base + 64 * static_cast<unsigned>(i);
+    sym << std::format("{} = ${:04X}", sprite_label(label, sprites[i]), addr);
+    if (opts.load_address && addr % 64 == 0)
+      sym << std::format(" ; pointer ${:02X}", (addr / 64) & 0xFF);
+    sym << '\n';
+  }
+  std::cerr << std::format("Wrote {} sprites ({} bytes) to {}, symbols to {}\n",
+                           sprites.size(), 64 * sprites.size(), bankname, symname);
+}
+
+/**
+ * \brief Table entries of a deduplicated sheet, one or two bytes per position.
+ *
+ * The first byte is the sprite pointer if the bank has a 64-byte aligned
+ * load address, otherwise the index of the unique sprite. If mirrored or
+ * shifted copies were detected a second byte holds the SpriteTransform.
+ *
+ * \throw std::invalid_argument if the bank crosses a 16 KiB VIC bank
+ *        (pointers) or has more than 256 unique sprites (indices)
+ */
+std::vector<std::uint8_t> sprite_table(const SpriteDedup &dedup, const Options &opts) {
+  const unsigned base = bank_base(opts);
+  const bool pointers = !opts.software && opts.load_address && base % 64 == 0;
+  const bool transforms = opts.dedup_mirror || opts.dedup_shift;
+  std::vector<std::uint8_t> table;
+
+  const std::size_t count = dedup.unique.size();
+  if (pointers && count > 0 && base / 0x4000 != (base + 64 * (count - 1)) / 0x4000)
+    throw std::invalid_argument(std::format("the {} sprites at ${:04X} cross a 16 KiB VIC bank, "
+                                            "their pointers would wrap", count, base));
+  if (!pointers && count > 256)
+    throw std::invalid_argument(std::format("{} unique sprites do not fit into the one-byte "
+                                            "table entries (at most 256)", count));
+  table.reserve(dedup.refs.size() * (transforms ? 2 : 1));
+  for (const auto &ref : dedup.refs) {
+    // A pointer is the sprite's offset in its VIC bank divided by 64.
+    table.push_back(static_cast<std::uint8_t>(pointers ? (base % 0x4000) / 64 + ref.index : ref.index));
+    if (transforms)
+      table.push_back(static_cast<std::uint8_t>(ref.transform));
+  }
+  return table;
+}
 
-// ── sprite extraction ─────────────────────────────────────────────────────────
+/**
+ * \brief Write the table of a deduplicated sheet next to the binary bank.
+ *
+ * The table (same name as the bank, extension .ptr) has one entry per
+ * sheet position in sheet order, see sprite_table().
+ */
+void write_sprite_table(const std::vector<std::uint8_t> &table, const Options &opts) {
+  const std::string &bankname = *opts.binary_file;
+  const std::string tablename = change_ending(bankname, "ptr");
+  std::ofstream out(tablename, std::ios::binary);
+  if (!out)
+    throw std::runtime_error(std::format("cannot open '{}'", tablename));
+  out.write(reinterpret_cast<const char *>(table.data()), table.size());
+}
 
 /**
- * \brief Iterate over a sprite sheet and write assembly for every sprite.
+ * \brief Write the table of a deduplicated sheet as assembler source.
+ *
+ * Emits the label \c <label>_table followed by one \c .byte line per
+ * sheet row, see sprite_table().
  *
- * \param surface  Source SDL surface (must be 8 bpp, locked by this function).
- * \param opts     Parsed command-line options.
+ * \param positions number of sheet positions in \p table
+ * \param columns number of sprites per sheet row
  */
-void extract_sprite_data(SDL_Surface *surface, const Options &opts) {
-  if (surface->format->BitsPerPixel != 8) {
-    std::cerr << "Unknown pixel format!\n";
+void write_sprite_table_asm(const std::vector<std::uint8_t> &table, const Options &opts,
+                            std::size_t positions, std::size_t columns, std::ostream &out) {
+  if (positions == 0)
     return;
+  const std::size_t per_line = columns * (table.size() / positions);
+
+  out << std::format("{}_table: \n", opts.labelname.value_or("sprite"));
+  for (std::size_t i = 0; i < table.size(); i += per_line) {
+    const std::size_t end = std::min(i + per_line, table.size());
+    out << "\t.byte";
+    for (std::size_t j = i; j < end; ++j)
+      out << std::format(" ${:02X}{}", table[j], j + 1 < end ? "," : "");
+    out << '\n';
   }
+}
 
-  SDL_LockSurface(surface);
+/**
+ * \brief Check that the object layouts fit into their one-byte fields.
+ *
+ * The offsets are limited by extract_objects(), the sprite numbers and
+ * the number of sprites per object are not.
+ *
+ * \throw std::invalid_argument naming the first object which does not fit
+ */
+void check_layouts(const std::vector<ObjectLayout> &layouts) {
+  for (std::size_t i = 0; i < layouts.size(); ++i) {
+    const auto &layout = layouts[i];
+    if (layout.sprites.size() > 255)
+      throw std::invalid_argument(std::format("object {} has {} sprites, the layout table allows 255",
+                                              i, layout.sprites.size()));
+    for (const auto &entry : layout.sprites)
+      if (entry.sprite > 255 || entry.dx < 0 || entry.dx > 255 || entry.dy < 0 || entry.dy > 255)
+        throw std::invalid_argument(std::format("sprite {} of object {} at offset {},{} does not fit "
+                                                "into the one-byte layout entries",
+                                                entry.sprite, i, entry.dx, entry.dy));
+  }
+}
+
+/**
+ * \brief Write the object layouts of an automatic extraction.
+ *
+ * Every object starts with the number of its sprites, followed by three
+ * bytes per sprite: the sprite number in extraction order (the position
+ * in the bank, or the index into the table with --dedup), the X offset
+ * in hires pixels and the Y offset in lines relative to the object's
+ * top-left corner. With a binary bank the layouts go to a .lay file,
+ * otherwise they are emitted as \c <label>_layout.
+ *
+ * \throw std::invalid_argument if a value does not fit into its byte,
+ *        see check_layouts()
+ */
+void write_layouts(const std::vector<ObjectLayout> &layouts, const Options &opts,
+                   std::ostream &out) {
+  check_layouts(layouts);
+  if (opts.binary_file) {
+    for (const auto &layout : layouts) {
+      out.put(static_cast<char>(layout.sprites.size()));
+      for (const auto &entry : layout.sprites) {
+        out.put(static_cast<char>(entry.sprite));
+        out.put(static_cast<char>(entry.dx));
+        out.put(static_cast<char>(entry.dy));
+      }
+    }
+    return;
+  }
+  out << std::format("{}_layout: \n", opts.labelname.value_or("sprite"));
+  for (std::size_t i = 0; i < layouts.size(); ++i) {
+    const auto &layout = layouts[i];
+    out << std::format("; object {} at {},{} size {}x{}\n", i, layout.x, layout.y, layout.w, layout.h);
+    out << std::format("\t.byte {}\n", layout.sprites.size());
+    for (const auto &entry : layout.sprites)
+      out << std::format("\t.byte ${:02X}, ${:02X}, ${:02X}\n", entry.sprite, entry.dx, entry.dy);
+  }
+}
+
+// ── software sprites ──────────────────────────────────────────────────────────
 
-  const int rowheight   = opts.rowheight;
-  const int columnwidth = opts.columnwidth;
-
-  for (int y = 0;
-       (opts.spriterows > 0 ? y < opts.spriterows
-                            : y * rowheight + opts.y_position < surface->h - rowheight);
-       ++y)
-  {
-    for (int x = 0;
-         (opts.spritecolumns > 0 ? x < opts.spritecolumns
-                                 : x * columnwidth + opts.x_position < surface->w - columnwidth);
-         ++x)
-    {
-      const int x_position = x * columnwidth + opts.x_position;
-      const int y_position = y * rowheight   + opts.y_position;
-
-      if (opts.labelname)
-        std::cout << std::format("{}{}{}: \n", *opts.labelname, x, y);
-
-      if (!opts.multi_mode) {
-        convert_bw_sprite(surface, x_position, y_position, opts.transparent)
-          .write_asm(std::cout) << '\n';
-      } else {
-        MultiSpriteData sprite = opts.autocol
-          ? convert_sprite(surface, x_position, y_position, 0)
-          : convert_multi_sprite(surface, x_position, y_position,
-                                 opts.transparent, opts.multi1, opts.multi2);
-        sprite.write_asm(std::cout) << '\n';
+/**
+ * \brief Write pre-shifted software sprites and report their memory cost.
+ *
+ * Every sprite is followed by its variants in shift order; a variant is
+ * its mask table (only with \p opts.mask) followed by its data table,
+ * each SOFT_COLUMNS × 21 bytes. The labels are
+ * \c <sprite label>_s<shift> for the data and \c <sprite label>_m<shift>
+ * for the mask. With \p opts.binary_file the tables go into that file
+ * (optionally with load address) and the labels into a .sym file,
+ * otherwise assembler source is written to \p out.
+ */
+void write_software_sprites(const std::vector<SheetSprite> &sprites, const Options &opts,
+                            std::ostream &out) {
+  const std::string label = opts.labelname.value_or("sprite");
+  const std::size_t table_size = SOFT_COLUMNS * 21;
+  const std::size_t variant_size = table_size * (opts.mask ? 2 : 1);
+  const std::size_t variants = opts.multi_mode ? 4 : 8;
+
+  std::ofstream bank, sym;
+  unsigned addr = bank_base(opts);
+  if (opts.binary_file) {
+    const std::string &bankname = *opts.binary_file;
+    bank.open(bankname, std::ios::binary);
+    if (!bank)
+      throw std::runtime_error(std::format("cannot open '{}'", bankname));
+    sym.open(change_ending(bankname, "sym"));
+    if (opts.load_address) {
+      bank.put(static_cast<char>(*opts.load_address & 0xFF));
+      bank.put(static_cast<char>(*opts.load_address >> 8));
+      for (unsigned i = *opts.load_address; i < addr; ++i)
+        bank.put(0);
+    }
+    sym << std::format("; {} software sprites with {} shifts in {}\n", sprites.size(), variants,
+                       bankname);
+  }
+  auto emit = [&](const std::string &name, const std::array<std::uint8_t, SOFT_COLUMNS * 21> &table) {
+    if (opts.binary_file) {
+      sym << std::format("{} = ${:04X}\n", name, addr);
+      bank.write(reinterpret_cast<const char *>(table.data()), table.size());
+      addr += static_cast<unsigned>(table.size());
+      return;
+    }
+    out << std::format("{}: \n", name);
+    for (int column = 0; column < SOFT_COLUMNS; ++column) {
+      out << "\t.byte";
+      for (int row = 0; row < 21; ++row)
+        out << std::format(" ${:02X}{}", table[column * 21 + row], row < 20 ? "," : "");
+      out << '\n';
+    }
+  };
+
+  // Bytes per shift which lie in columns without a single opaque pixel.
+  std::vector<std::size_t> empty_bytes(variants, 0);
+  for (const auto &sprite : sprites) {
+    const std::string base = sprite_label(label, sprite);
+    const auto shifted = preshift_sprite(sprite.bytes, opts.multi_mode);
+    for (std::size_t v = 0; v < shifted.size(); ++v) {
+      const int shift = static_cast<int>(v);
+      if (opts.mask)
+        emit(std::format("{}_m{}", base, shift), shifted[v].mask);
+      emit(std::format("{}_s{}", base, shift), shifted[v].data);
+      for (int column = 0; column < SOFT_COLUMNS; ++column) {
+        const auto first = shifted[v].mask.begin() + column * 21;
+        if (std::all_of(first, first + 21, [](std::uint8_t m) { return m == 0xFF; }))
+          empty_bytes[v] += variant_size / SOFT_COLUMNS;
       }
     }
   }
 
-  SDL_UnlockSurface(surface);
+  std::cerr << std::format("Software sprites: {} shifts, {} bytes per shift ({} data{})\n",
+                           variants, variant_size, table_size,
+                           opts.mask ? std::format(" + {} mask", table_size) : "");
+  for (std::size_t v = 0; v < variants; ++v)
+    std::cerr << std::format("  shift {}: {:6} bytes, {:6} of them in empty columns\n", v,
+                             variant_size * sprites.size(), empty_bytes[v]);
+  std::cerr << std::format("Total: {} sprites x {} bytes = {} bytes\n", sprites.size(),
+                           variant_size * variants, variant_size * variants * sprites.size());
+}
+
+// ── result cache ──────────────────────────────────────────────────────────────
+
+/**
+ * \brief Files written for the given options, in addition to stdout.
+ *
+ * Only the binary bank has files: the bank itself, its .sym file, the
+ * .ptr table with deduplication and the .lay file with --auto.
+ */
+std::vector<std::string> output_files(const Options &opts, bool dedup) {
+  std::vector<std::string> ret;
+  if (!opts.binary_file)
+    return ret;
+  const std::string &bankname = *opts.binary_file;
+  ret.push_back(bankname);
+  ret.push_back(change_ending(bankname, "sym"));
+  if (dedup)
+    ret.push_back(change_ending(bankname, "ptr"));
+  if (opts.auto_extract)
+    ret.push_back(change_ending(bankname, "lay"));
+  return ret;
 }
 
 // ── entry point ───────────────────────────────────────────────────────────────
@@ -361,8 +743,9 @@ void extract_sprite_data(SDL_Surface *surface, const Options &opts) {
  *
  * ### SDL initialisation
  *
- * \c SDL_INIT_VIDEO is only requested when \c --display is active; without it
- * only the bare minimum needed for \c IMG_Load is initialised.
+ * \c SDL_INIT_VIDEO is only requested when \c --display is active; images
+ * are loaded with load_image() and only wrapped in an SDL surface for
+ * the display.
  *
  * \param argc  Argument count.
  * \param argv  Argument vector.
@@ -403,6 +786,65 @@ int main(int argc, char **argv) {
      ->default_val(21);
   app.add_flag("--display,-d", opts.display,
                "Display the loaded image in a window (press any key to close)");
+  app.add_option("--binary,-b", opts.binary_file,
+                 "Write a binary sprite bank to this file (plus a .sym symbol file) "
+                 "instead of assembler source");
+  app.add_option("--load-address", opts.load_address,
+                 "Prepend this load address to the binary sprite bank");
+  app.add_flag("--align", opts.align,
+               "Pad the binary sprite bank so that sprites start on 64-byte boundaries");
+  app.add_flag("--auto", opts.auto_extract,
+               "Find the objects on the transparent background and cover each one "
+               "with sprites (ignores the grid options)");
+  app.add_option("--palette", opts.palette,
+                 std::format("C64 colour palette for truecolour images (default: grafx2).\n"
+                             "Available palettes: {}",
+                             palette_names()))
+     ->check([](const std::string &val) -> std::string {
+       if (palette_registry.count(val) == 0)
+         return std::format("unknown palette '{}'. "
+                            "Run with --help for a list of valid palettes.", val);
+       return {};
+     });
+  app.add_flag("--quantise", opts.quantise,
+               "Treat an 8 bpp image like a truecolour one: match it against the C64 "
+               "palette and choose the sprite colours automatically");
+  app.add_flag("--software", opts.software,
+               "Write pre-shifted software sprites (8 shifts, 4 in multicolour mode) "
+               "in column-major layout instead of hardware sprites");
+  app.add_flag("--mask", opts.mask, "Add an AND mask to every software sprite variant");
+  app.add_option("--multiplex", opts.multiplex,
+                 "Frame layout file: report the sprites per raster line, simulate a "
+                 "multiplexer and order the bank by frames (exit code 4 on overrun)")
+     ->check(CLI::ExistingFile);
+  app.add_option("--mux-gap", opts.mux_gap,
+                 "Raster lines the multiplexer needs to reuse a hardware sprite")
+     ->default_val(2)
+     ->check(CLI::Range(0, 100));
+  app.add_flag("--dedup", opts.dedup,
+               "Store identical (and empty) sprites only once and write a table "
+               "mapping sheet positions to sprites");
+  app.add_flag("--dedup-mirror", opts.dedup_mirror,
+               "Like --dedup, also share X-mirrored copies (implies --dedup)");
+  app.add_flag("--dedup-shift", opts.dedup_shift,
+               "Like --dedup, also share copies moved by one pixel (implies --dedup)");
+  // The cache options do not change the result and stay out of the cache key.
+  app.add_option("--cache-dir", opts.cache_dir,
+                 "Reuse the results of earlier runs stored in this directory")
+     ->envname("C64GFX_CACHE_DIR")
+     ->configurable(false);
+  app.add_option("--cache-size", opts.cache_size,
+                 std::format("Size limit of the cache directory in MiB (default {})",
+                             DEFAULT_CACHE_MIB))
+     ->check(CLI::Range(1u, 1u << 20))
+     ->configurable(false);
+  app.add_flag("--cache-stats", opts.cache_stats, "Print hit rate and bytes saved by the cache")
+     ->configurable(false);
+  app.add_flag("--stats{table}", opts.stats,
+               "Print the time per stage, counters and memory use on stderr "
+               "(--stats=json for one line of JSON)")
+     ->check(CLI::IsMember({"table", "json"}))
+     ->configurable(false);
 
   // ── "mono" subcommand ─────────────────────────────────────────────────────
   CLI::App *mono_cmd = app.add_subcommand("mono", "Convert monochrome (1-bit) sprites");
@@ -425,14 +867,52 @@ int main(int argc, char **argv) {
            ->default_val(2);
   multi_cmd->add_flag("--autocol", opts.autocol,
                       "Automatically choose colours (ignores --multi1/--multi2)");
+  multi_cmd->add_flag("--optimise", opts.optimise,
+                      "Choose multicolour 1/2 and every sprite's colour for the whole sheet "
+                      "(palette indices must be C64 colours, ignores --multi1/--multi2)");
+  multi_cmd->add_option("--metric", opts.metric,
+                        "What --optimise minimises: 'error' (colour distance of replaced "
+                        "pixels) or 'lost' (number of replaced pixels)")
+           ->check(CLI::IsMember({"error", "lost"}));
 
   CLI11_PARSE(app, argc, argv);
+  const StatsReport report("spriteconv", opts.stats, std::cerr);
 
   opts.multi_mode = multi_cmd->parsed();
 
+  // ── result cache ──────────────────────────────────────────────────────────
+  // The key covers the mode, all options, the sheet and the layout file.
+  // The display is interactive, so it always converts.
+  std::optional<ConversionCache> cache;
+  std::optional<CacheKey> key;
+  if (opts.cache_dir && !opts.display) {
+    try {
+      cache.emplace(*opts.cache_dir, opts.cache_size);
+      key.emplace("spriteconv");
+      key->add(opts.multi_mode ? "multi" : "mono").add(app.config_to_str()).add(opts.input_file);
+      key->add_file(opts.input_file);
+      if (opts.multiplex)
+        key->add_file(*opts.multiplex);
+      if (const auto hit = cache->lookup(*key)) {
+        hit->restore(std::cout);
+        std::cerr << std::format("Restored {} output bytes from the cache\n", hit->bytes());
+        if (opts.cache_stats)
+          std::cerr << format_cache_stats(cache->stats());
+        return hit->status;
+      }
+    } catch (const std::exception &e) {
+      // The cache is only an optimisation: on any error it is left out.
+      std::cerr << std::format("Warning: cache not used: {}\n", e.what());
+      cache.reset();
+    }
+  }
+  std::optional<StreamCapture> captured;
+  if (cache)
+    captured.emplace(std::cout);
+
   // ── SDL initialisation ────────────────────────────────────────────────────
   // Only request SDL_INIT_VIDEO when the display window is actually needed;
-  // IMG_Load works without it and skipping it avoids opening a display
+  // surfaces work without it and skipping it avoids opening a display
   // connection in purely batch/headless usage.
   const Uint32 sdl_flags = opts.display ? SDL_INIT_VIDEO : 0;
   if (SDL_Init(sdl_flags) != 0) {
@@ -440,20 +920,149 @@ int main(int argc, char **argv) {
     return 2;
   }
 
-  SDL_Surface *surface = IMG_Load(opts.input_file.c_str());
-  if (!surface) {
-    std::cerr << std::format("Cannot load image '{}': {}\n",
-                             opts.input_file, SDL_GetError());
+  ImageBuffer sheet;
+  try {
+    sheet = load_image(opts.input_file);
+  } catch (const std::exception &e) {
+    std::cerr << std::format("Cannot load image '{}': {}\n", opts.input_file, e.what());
     SDL_Quit();
     return 3;
   }
 
-  if (opts.display)
+  // Truecolour images are quantised to a sheet of C64 colours.
+  TrueColourSheet truecolour;
+  if (sheet.channels() != 1 || opts.quantise) {
+    const StageTimer timer(Stage::quantise);
+    sheet = quantise_image(sheet, *palette_registry.at(opts.palette), opts.transparent, truecolour);
+    std::cerr << std::format("{} distinct colours, transparency from {}\n", truecolour.dist.size(),
+                             truecolour.alpha ? "alpha channel"
+                                              : std::format("colour {}", opts.transparent));
+    opts.quantise    = true;
+    opts.transparent = QUANTISED_TRANSPARENT;
+    opts.autocol     = false;
+    opts.multi1 = opts.multi2 = -1; // every opaque pixel is re-encoded later
+  }
+
+  if (opts.display) {
+    SDL_Surface *surface = surface_from_image(sheet);
     display_surface(surface, opts.input_file);
+    SDL_FreeSurface(surface);
+  }
+  if (opts.optimise && !opts.quantise) {
+    opts.autocol = false;
+    opts.multi1 = opts.multi2 = -1; // every opaque pixel is re-encoded later
+  }
 
-  extract_sprite_data(surface, opts);
+  std::vector<ObjectLayout> layouts;
+  std::vector<SheetSprite> sprites;
+  StageTimer extract_timer(Stage::resize);
+  if (opts.auto_extract) {
+    std::vector<SheetObject> skipped;
+    sprites = extract_objects(sheet, opts, layouts, skipped);
+    for (const SheetObject &obj : skipped)
+      std::cerr << std::format("Object at {},{} ({}x{}) is too large, skipped\n",
+                               obj.x, obj.y, obj.w, obj.h);
+    std::cerr << std::format("{} objects, {} sprites\n", layouts.size(), sprites.size());
+  } else {
+    sprites = extract_sprite_data(sheet, opts);
+  }
+  extract_timer.stop();
+  count_stat("sprites", sprites.size());
+  if (opts.quantise) {
+    StageTimer colour_timer(Stage::quantise);
+    const SheetColours colours = optimise_sprite_colours(sprites, truecolour, opts.multi_mode);
+    colour_timer.stop();
+    std::cerr << std::format("Sprite colours chosen, total error {:.4f}",
+                             std::accumulate(colours.error.begin(), colours.error.end(), 0.0f));
+    if (opts.multi_mode)
+      std::cerr << std::format(", multicolour 1: {}, multicolour 2: {}", colours.multi1,
+                               colours.multi2);
+    std::cerr << '\n';
+    opts.multi1 = colours.multi1;
+    opts.multi2 = colours.multi2;
+  } else if (opts.optimise && opts.multi_mode) {
+    const ColourMetric metric = opts.metric == "lost" ? ColourMetric::lost : ColourMetric::error;
+    const char *unit = metric == ColourMetric::lost ? "lost pixels" : "error";
+    StageTimer colour_timer(Stage::quantise);
+    const SheetColours colours = optimise_indexed_colours(sprites, sheet,
+                                                          *palette_registry.at(opts.palette), metric);
+    colour_timer.stop();
+    std::cerr << std::format("Multicolour 1 ($d025): {}, multicolour 2 ($d026): {}\n",
+                             colours.multi1, colours.multi2);
+    for (std::size_t s = 0; s < sprites.size(); ++s)
+      std::cerr << std::format("  sprite {:3}: colour {:2}, {} {}\n", s, colours.individual[s],
+                               unit, colours.error[s]);
+    std::cerr << std::format("Total {}: {}\n", unit,
+                             std::accumulate(colours.error.begin(), colours.error.end(), 0.0f));
+    opts.multi1 = colours.multi1;
+    opts.multi2 = colours.multi2;
+  }
+  std::optional<SpriteDedup> dedup;
+  if (opts.dedup || opts.dedup_mirror || opts.dedup_shift) {
+    const StageTimer timer(Stage::diff);
+    dedup = deduplicate_sprites(sprites, opts.multi_mode, opts.dedup_mirror, opts.dedup_shift);
+    std::cerr << std::format("{} sprites, {} unique ({} empty, {} mirrored, {} shifted), "
+                             "{} bytes saved\n",
+                             sprites.size(), dedup->unique.size(), dedup->empty, dedup->mirrored,
+                             dedup->shifted, 64 * (sprites.size() - dedup->unique.size()));
+  }
+  std::vector<SheetSprite> output = dedup ? dedup->unique : sprites;
+  bool mux_ok = true;
+  if (opts.multiplex) {
+    const auto placements = read_mux_layout(*opts.multiplex, layouts, sprites.size());
+    mux_ok = analyse_multiplexer(placements, opts.mux_gap);
+    std::vector<std::size_t> bank(sprites.size());
+    for (std::size_t i = 0; i < bank.size(); ++i)
+      bank[i] = dedup ? dedup->refs[i].index : i;
+    reorder_bank(multiplexer_order(placements, bank, output.size()), output, dedup, layouts);
+  }
+  // The tables are checked before any output is written.
+  std::vector<std::uint8_t> table;
+  try {
+    if (dedup)
+      table = sprite_table(*dedup, opts);
+    if (opts.auto_extract)
+      check_layouts(layouts);
+  } catch (const std::exception &e) {
+    std::cerr << std::format("Cannot write the sprite tables: {}\n", e.what());
+    SDL_Quit();
+    return 3;
+  }
+  StageTimer write_timer(Stage::write);
+  if (opts.software)
+    write_software_sprites(output, opts, std::cout);
+  else if (opts.binary_file)
+    write_sprite_bank(output, opts);
+  else
+    write_sprites_asm(output, opts, std::cout);
+  if (dedup && opts.binary_file) {
+    write_sprite_table(table, opts);
+  } else if (dedup) {
+    const std::size_t columns = opts.auto_extract || sprites.empty() ? 8 : sprites.back().column + 1;
+    write_sprite_table_asm(table, opts, dedup->refs.size(), columns, std::cout);
+  }
+  if (opts.auto_extract && opts.binary_file) {
+    std::ofstream layoutfile(change_ending(*opts.binary_file, "lay"), std::ios::binary);
+    write_layouts(layouts, opts, layoutfile);
+  } else if (opts.auto_extract) {
+    write_layouts(layouts, opts, std::cout);
+  }
+  write_timer.stop();
 
-  SDL_FreeSurface(surface);
   SDL_Quit();
-  return 0;
+  if (cache) {
+    try {
+      CacheEntry entry;
+      entry.status = mux_ok ? 0 : 4;
+      entry.out    = captured->release();
+      for (const auto &path : output_files(opts, dedup.has_value()))
+        entry.add_file(path);
+      cache->store(*key, entry);
+      if (opts.cache_stats)
+        std::cerr << format_cache_stats(cache->stats());
+    } catch (const std::exception &e) {
+      std::cerr << std::format("Warning: result not cached: {}\n", e.what());
+    }
+  }
+  return mux_ok ? 0 : 4;
 }
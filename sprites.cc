@@ -0,0 +1,633 @@
+#include "sprites.hh"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+/// Throw unless the sheet holds one palette index per pixel.
+void check_sheet(const ImageBuffer &sheet) {
+  if (sheet.channels() != 1)
+    throw std::invalid_argument("sprite sheets need one palette index per pixel");
+}
+
+/// Union-find root of run \p i with path halving.
+std::size_t find_root(std::vector<PixelRun> &runs, std::size_t i) {
+  while (runs[i].parent != i) {
+    runs[i].parent = runs[runs[i].parent].parent;
+    i = runs[i].parent;
+  }
+  return i;
+}
+
+/**
+ * \brief Re-encode the opaque pixels of a multicolour sprite.
+ *
+ * Every non-transparent pixel gets the pattern of the nearest of the
+ * three sprite colours; ties go to the individual colour, then to
+ * multicolour 1. The individual colour is stored in the low nibble of
+ * the metadata byte (as SpritePad does).
+ *
+ * \param dist callable (row, column) returning the NCOLORS distances of the pixel
+ */
+template <typename Dist>
+void reencode_multicolour(SpriteBytes &bytes, int multi1, int multi2, int individual, Dist &&dist) {
+  for (int row = 0; row < 21; ++row) {
+    const std::uint32_t bits = sprite_row(bytes, row);
+    std::uint32_t out = 0;
+    for (int column = 0; column < 12; ++column) {
+      std::uint32_t pattern = (bits >> (22 - 2 * column)) & 3;
+      if (pattern != 0) {
+        const auto &d = dist(row, column);
+        pattern = 0b10;
+        if (d[multi1] < d[individual] && d[multi1] <= d[multi2])
+          pattern = 0b01;
+        else if (d[multi2] < d[individual])
+          pattern = 0b11;
+      }
+      out = (out << 2) | pattern;
+    }
+    set_sprite_row(bytes, row, out);
+  }
+  bytes[63] = static_cast<std::uint8_t>(0x80 | individual);
+}
+
+} // namespace
+
+std::ostream &write_sprite_asm(const SpriteBytes &bytes, std::ostream &out) {
+  for (int iy = 0; iy < 21; ++iy)
+    out << std::format("\t.byte ${:02X}, ${:02X}, ${:02X} \n",
+                       bytes[3 * iy], bytes[3 * iy + 1], bytes[3 * iy + 2]);
+  out << std::format("\t.byte ${:02X}", bytes[63]);
+  return out;
+}
+
+// ── sprite conversion ─────────────────────────────────────────────────────────
+
+SpriteData convert_bw_sprite(const ImageBuffer &sheet, int xpos, int ypos, int transparent) {
+  SpriteData sprite;
+  for (int row = 0; row < 21; ++row) {
+    const std::uint8_t *line = sheet.row(ypos + row) + xpos;
+    std::uint32_t bits = 0;
+    for (int column = 0; column < 24; ++column)
+      bits = (bits << 1) | (line[column] != transparent ? 1u : 0u);
+    set_sprite_row(sprite.bytes, row, bits);
+  }
+  return sprite;
+}
+
+MultiSpriteData convert_multi_sprite(const ImageBuffer &sheet, int xpos, int ypos,
+                                     int transparent, int m1, int m2) {
+  MultiSpriteData sprite;
+  for (int row = 0; row < 21; ++row) {
+    const std::uint8_t *line = sheet.row(ypos + row) + xpos;
+    std::uint32_t bits = 0;
+    for (int column = 0; column < 12; ++column) {
+      const int px = line[column];
+      unsigned pattern;
+      if      (px == transparent) pattern = 0b00;
+      else if (px == m1)          pattern = 0b01;
+      else if (px == m2)          pattern = 0b11;
+      else                        pattern = 0b10;
+      bits = (bits << 2) | pattern;
+    }
+    set_sprite_row(sprite.bytes, row, bits);
+  }
+  return sprite;
+}
+
+MultiSpriteData convert_sprite(const ImageBuffer &sheet, int x, int y, int border) {
+  MultiSpriteData sprite;
+  std::map<int, int> pixelvalues;
+  int maxpixelval = 0;
+
+  for (int iy = 0; iy < 21; ++iy) {
+    const std::uint8_t *pixelline = sheet.row(y + iy + border);
+    std::uint32_t bits = 0;
+    for (int ix = 0; ix < 12; ++ix) {
+      const int px = pixelline[border + x + ix];
+      auto [it, inserted] = pixelvalues.emplace(px, maxpixelval);
+      if (inserted) ++maxpixelval;
+      bits = (bits << 2) | (it->second & 3);
+    }
+    set_sprite_row(sprite.bytes, iy, bits);
+  }
+
+  if (pixelvalues.size() > 4)
+    throw std::logic_error("too many pixel values");
+
+  return sprite;
+}
+
+// ── sprite extraction ─────────────────────────────────────────────────────────
+
+std::string sprite_label(const std::string &label, const SheetSprite &sprite) {
+  if (sprite.object >= 0)
+    return std::format("{}_{}_{}{}", label, sprite.object, sprite.column, sprite.row);
+  return std::format("{}{}{}", label, sprite.column, sprite.row);
+}
+
+std::vector<SheetSprite> extract_sprite_data(const ImageBuffer &sheet, const SheetOptions &opts) {
+  check_sheet(sheet);
+  std::vector<SheetSprite> sprites;
+  const int width       = static_cast<int>(sheet.width);
+  const int height      = static_cast<int>(sheet.height);
+  const int rowheight   = opts.rowheight;
+  const int columnwidth = opts.columnwidth;
+  // Pixels read per sprite row: one per multicolour pixel pair.
+  const int sprite_width = opts.multi_mode ? 12 : 24;
+
+  if (columnwidth < 1 || rowheight < 1)
+    throw std::invalid_argument(std::format("sprite grid cells must be at least 1x1 pixels, not {}x{}",
+                                            columnwidth, rowheight));
+  if (opts.x_position < 0 || opts.y_position < 0)
+    throw std::invalid_argument(std::format("negative sprite sheet position {},{}",
+                                            opts.x_position, opts.y_position));
+
+  for (int y = 0;
+       (opts.spriterows > 0 ? y < opts.spriterows
+                            : y * rowheight + opts.y_position < height - rowheight);
+       ++y)
+  {
+    for (int x = 0;
+         (opts.spritecolumns > 0 ? x < opts.spritecolumns
+                                 : x * columnwidth + opts.x_position < width - columnwidth);
+         ++x)
+    {
+      // The grid comes from the command line or a c64gfxd client, so every
+      // sprite is checked before its pixels are read.
+      const std::int64_t left = std::int64_t{x} * columnwidth + opts.x_position;
+      const std::int64_t top  = std::int64_t{y} * rowheight   + opts.y_position;
+      if (left + sprite_width > width || top + 21 > height)
+        throw std::invalid_argument(std::format("sprite {},{} at {},{} does not fit into the {}x{} sheet",
+                                                x, y, left, top, width, height));
+      const int x_position = static_cast<int>(left);
+      const int y_position = static_cast<int>(top);
+
+      if (!opts.multi_mode) {
+        sprites.push_back({x, y, convert_bw_sprite(sheet, x_position, y_position,
+                                                   opts.transparent).bytes,
+                           -1, x_position, y_position});
+      } else {
+        MultiSpriteData sprite = opts.autocol
+          ? convert_sprite(sheet, x_position, y_position, 0)
+          : convert_multi_sprite(sheet, x_position, y_position,
+                                 opts.transparent, opts.multi1, opts.multi2);
+        sprites.push_back({x, y, sprite.bytes, -1, x_position, y_position});
+      }
+    }
+  }
+  return sprites;
+}
+
+// ── deduplication ─────────────────────────────────────────────────────────────
+
+std::size_t SpriteBytesHash::operator()(const SpriteBytes &bytes) const noexcept {
+  std::uint64_t h = 0x9E3779B97F4A7C15ull;
+  for (std::size_t i = 0; i < bytes.size(); i += 8) {
+    std::uint64_t word;
+    std::memcpy(&word, bytes.data() + i, sizeof word);
+    h = (h ^ word) * 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 31;
+  }
+  return static_cast<std::size_t>(h);
+}
+
+bool sprite_empty(const SpriteBytes &bytes) noexcept {
+  return std::all_of(bytes.begin(), bytes.begin() + 63, [](std::uint8_t b) { return b == 0; });
+}
+
+SpriteBytes mirror_sprite(const SpriteBytes &bytes, int pixel_bits) noexcept {
+  const std::uint32_t mask = (1u << pixel_bits) - 1;
+  SpriteBytes ret = bytes;
+  for (int row = 0; row < 21; ++row) {
+    std::uint32_t in = sprite_row(bytes, row), out = 0;
+    for (int i = 0; i < 24; i += pixel_bits, in >>= pixel_bits)
+      out = (out << pixel_bits) | (in & mask);
+    set_sprite_row(ret, row, out);
+  }
+  return ret;
+}
+
+std::optional<SpriteBytes> shift_sprite(const SpriteBytes &bytes, int bits) noexcept {
+  const std::uint32_t lost = bits > 0 ? ~(0xFFFFFFu >> bits) & 0xFFFFFFu : (1u << -bits) - 1;
+  SpriteBytes ret = bytes;
+  for (int row = 0; row < 21; ++row) {
+    const std::uint32_t in = sprite_row(bytes, row);
+    if (in & lost)
+      return std::nullopt;
+    set_sprite_row(ret, row, (bits > 0 ? in << bits : in >> -bits) & 0xFFFFFF);
+  }
+  return ret;
+}
+
+SpriteDedup deduplicate_sprites(const std::vector<SheetSprite> &sprites, bool multi,
+                                bool mirror, bool shift) {
+  const int pixel_bits = multi ? 2 : 1;
+  SpriteDedup ret;
+  std::unordered_map<SpriteBytes, unsigned, SpriteBytesHash> seen;
+
+  seen.reserve(sprites.size());
+  ret.refs.reserve(sprites.size());
+  auto lookup = [&](const SpriteBytes &bytes) -> std::optional<unsigned> {
+    if (auto it = seen.find(bytes); it != seen.end())
+      return it->second;
+    return std::nullopt;
+  };
+
+  for (const auto &sprite : sprites) {
+    if (sprite_empty(sprite.bytes))
+      ++ret.empty;
+    if (auto idx = lookup(sprite.bytes)) {
+      ret.refs.push_back({*idx, SpriteTransform::none});
+      continue;
+    }
+    if (mirror) {
+      if (auto idx = lookup(mirror_sprite(sprite.bytes, pixel_bits))) {
+        ret.refs.push_back({*idx, SpriteTransform::mirror});
+        ++ret.mirrored;
+        continue;
+      }
+    }
+    if (shift) {
+      // The kept sprite moved right equals this one if this one moved left equals the kept one.
+      std::optional<unsigned> idx;
+      SpriteTransform transform = SpriteTransform::shift_right;
+      if (auto moved = shift_sprite(sprite.bytes, pixel_bits))
+        idx = lookup(*moved);
+      if (!idx) {
+        transform = SpriteTransform::shift_left;
+        if (auto moved = shift_sprite(sprite.bytes, -pixel_bits))
+          idx = lookup(*moved);
+      }
+      if (idx) {
+        ret.refs.push_back({*idx, transform});
+        ++ret.shifted;
+        continue;
+      }
+    }
+    const auto idx = static_cast<unsigned>(ret.unique.size());
+    seen.emplace(sprite.bytes, idx);
+    ret.unique.push_back(sprite);
+    ret.refs.push_back({idx, SpriteTransform::none});
+  }
+  return ret;
+}
+
+// ── automatic extraction ──────────────────────────────────────────────────────
+
+std::vector<SheetObject> find_objects(const ImageBuffer &sheet, int transparent,
+                                      std::vector<PixelRun> &runs) {
+  const int width = static_cast<int>(sheet.width);
+  std::size_t prev_begin = 0, prev_end = 0;
+  for (int y = 0; y < static_cast<int>(sheet.height); ++y) {
+    const std::uint8_t *line = sheet.row(y);
+    const std::size_t row_begin = runs.size();
+    std::size_t above = prev_begin;
+    for (int x = 0; x < width;) {
+      if (line[x] == transparent) {
+        ++x;
+        continue;
+      }
+      const int x0 = x;
+      while (x < width && line[x] != transparent)
+        ++x;
+      const std::size_t cur = runs.size();
+      runs.push_back({y, x0, x - 1, cur});
+      // Runs above which end left of this run cannot touch later runs either.
+      while (above < prev_end && runs[above].x1 + 1 < x0)
+        ++above;
+      for (std::size_t i = above; i < prev_end && runs[i].x0 <= x; ++i) {
+        const std::size_t a = find_root(runs, i), b = find_root(runs, cur);
+        if (a != b)
+          runs[std::max(a, b)].parent = std::min(a, b);
+      }
+    }
+    prev_begin = row_begin;
+    prev_end = runs.size();
+  }
+
+  std::vector<SheetObject> objects;
+  std::unordered_map<std::size_t, std::size_t> index; // root run -> object
+  for (std::size_t i = 0; i < runs.size(); ++i) {
+    const PixelRun &run = runs[i];
+    auto [it, inserted] = index.emplace(find_root(runs, i), objects.size());
+    if (inserted) {
+      objects.push_back({run.x0, run.y, run.x1 - run.x0 + 1, 1, {}});
+    } else {
+      SheetObject &obj = objects[it->second];
+      const int right = std::max(obj.x + obj.w, run.x1 + 1);
+      obj.x = std::min(obj.x, run.x0);
+      obj.w = right - obj.x;
+      obj.h = run.y - obj.y + 1;
+    }
+    objects[it->second].runs.push_back(i);
+  }
+  return objects;
+}
+
+std::vector<SheetSprite> extract_objects(const ImageBuffer &sheet, const SheetOptions &opts,
+                                         std::vector<ObjectLayout> &layouts,
+                                         std::vector<SheetObject> &skipped) {
+  check_sheet(sheet);
+  std::vector<SheetSprite> sprites;
+  std::vector<PixelRun> runs;
+  std::vector<SheetObject> objects = find_objects(sheet, opts.transparent, runs);
+  const int tile_w = opts.multi_mode ? 12 : 24;
+  const int pixel_w = opts.multi_mode ? 2 : 1;
+
+  for (SheetObject &obj : objects) {
+    const int columns = (obj.w + tile_w - 1) / tile_w;
+    const int rows = (obj.h + 20) / 21;
+    if ((columns - 1) * tile_w * pixel_w > 255 || (rows - 1) * 21 > 255) {
+      skipped.push_back(std::move(obj));
+      continue;
+    }
+    ImageBuffer scratch;
+    scratch.width = static_cast<unsigned>(columns * tile_w);
+    scratch.height = static_cast<unsigned>(rows * 21);
+    scratch.format = PixelFormat::indexed;
+    scratch.pixels.assign(scratch.stride() * scratch.height, static_cast<std::uint8_t>(opts.transparent));
+    for (std::size_t r : obj.runs) {
+      const PixelRun &run = runs[r];
+      std::memcpy(scratch.row(run.y - obj.y) + (run.x0 - obj.x), sheet.row(run.y) + run.x0,
+                  run.x1 - run.x0 + 1);
+    }
+
+    ObjectLayout layout{obj.x, obj.y, obj.w, obj.h, {}};
+    for (int row = 0; row < rows; ++row) {
+      for (int column = 0; column < columns; ++column) {
+        const int x = column * tile_w, y = row * 21;
+        SpriteBytes bytes;
+        if (!opts.multi_mode) {
+          bytes = convert_bw_sprite(scratch, x, y, opts.transparent).bytes;
+        } else {
+          bytes = (opts.autocol ? convert_sprite(scratch, x, y, 0)
+                                : convert_multi_sprite(scratch, x, y, opts.transparent,
+                                                       opts.multi1, opts.multi2)).bytes;
+        }
+        if (sprite_empty(bytes))
+          continue;
+        layout.sprites.push_back({sprites.size(), x * pixel_w, y});
+        sprites.push_back({column, row, bytes, static_cast<int>(layouts.size()),
+                           obj.x + x, obj.y + y});
+      }
+    }
+    layouts.push_back(std::move(layout));
+  }
+  return sprites;
+}
+
+// ── truecolour input ──────────────────────────────────────────────────────────
+
+ImageBuffer quantise_image(const ImageBuffer &img, const C64Palette &palette, int background,
+                           TrueColourSheet &sheet) {
+  const ImageBuffer rgba = to_rgba(img);
+  ImageBuffer indexed;
+  indexed.width = rgba.width;
+  indexed.height = rgba.height;
+  indexed.format = PixelFormat::indexed;
+  indexed.pixels.resize(indexed.stride() * indexed.height);
+  indexed.palette.resize(NCOLORS + 1);
+  for (int c = 0; c < NCOLORS; ++c)
+    indexed.palette[c] = {static_cast<std::uint8_t>(palette[c][0] * 255.0 + 0.5),
+                          static_cast<std::uint8_t>(palette[c][1] * 255.0 + 0.5),
+                          static_cast<std::uint8_t>(palette[c][2] * 255.0 + 0.5), 255};
+  indexed.palette[QUANTISED_TRANSPARENT] = {255, 0, 255, 255};
+
+  sheet.width = static_cast<int>(rgba.width);
+  sheet.ids.resize(static_cast<std::size_t>(rgba.width) * rgba.height);
+  sheet.dist.clear();
+  sheet.alpha = false;
+  std::vector<std::uint8_t> nearest;       // per distinct colour
+  std::unordered_map<std::uint32_t, std::uint32_t> distinct;
+
+  for (std::size_t i = 0; i < sheet.ids.size(); ++i) {
+    const std::uint8_t *in = &rgba.pixels[4 * i];
+    if (in[3] < 128) {
+      sheet.alpha = true;
+      indexed.pixels[i] = QUANTISED_TRANSPARENT;
+      continue;
+    }
+    const std::uint32_t rgb = (std::uint32_t{in[0]} << 16) | (std::uint32_t{in[1]} << 8) | in[2];
+    auto [it, inserted] = distinct.emplace(rgb, static_cast<std::uint32_t>(sheet.dist.size()));
+    if (inserted) {
+      std::array<float, NCOLORS> d;
+      for (int c = 0; c < NCOLORS; ++c) {
+        float total = 0.0f;
+        for (int k = 0; k < 3; ++k) {
+          const float delta = in[k] / 255.0f - static_cast<float>(palette[c][k]);
+          total += delta * delta;
+        }
+        d[c] = total;
+      }
+      sheet.dist.push_back(d);
+      nearest.push_back(static_cast<std::uint8_t>(std::min_element(d.begin(), d.end()) - d.begin()));
+    }
+    sheet.ids[i] = it->second;
+    indexed.pixels[i] = nearest[it->second];
+  }
+  if (!sheet.alpha)
+    for (std::uint8_t &px : indexed.pixels)
+      if (px == background)
+        px = QUANTISED_TRANSPARENT;
+  return indexed;
+}
+
+// ── multicolour register optimisation ─────────────────────────────────────────
+
+SheetColours choose_multicolour_registers(const std::vector<PairCosts> &costs) {
+  SheetColours ret;
+  int best_pair = 0;
+  float best_total = std::numeric_limits<float>::max();
+  for (int p = 0; p < NPAIRS; ++p) {
+    float total = 0.0f;
+    for (const auto &cost : costs)
+      total += *std::min_element(cost.begin() + p * NCOLORS, cost.begin() + (p + 1) * NCOLORS);
+    if (total < best_total) {
+      best_total = total;
+      best_pair = p;
+    }
+  }
+  ret.multi1 = COLOUR_PAIRS[best_pair][0];
+  ret.multi2 = COLOUR_PAIRS[best_pair][1];
+  for (const auto &cost : costs) {
+    const auto first = cost.begin() + best_pair * NCOLORS;
+    const auto best = std::min_element(first, first + NCOLORS);
+    ret.individual.push_back(static_cast<int>(best - first));
+    ret.error.push_back(*best);
+  }
+  return ret;
+}
+
+SheetColours optimise_sprite_colours(std::vector<SheetSprite> &sprites, const TrueColourSheet &sheet,
+                                     bool multi) {
+  const int pixel_bits = multi ? 2 : 1;
+  const int width = 24 / pixel_bits;
+  const std::uint32_t mask = (1u << pixel_bits) - 1;
+  auto pixel_id = [&](const SheetSprite &sprite, int row, int column) {
+    return sheet.ids[static_cast<std::size_t>(sprite.y + row) * sheet.width + sprite.x + column];
+  };
+  auto pixel_dist = [&](const SheetSprite &sprite, int row, int column) -> const auto & {
+    return sheet.dist[pixel_id(sprite, row, column)];
+  };
+
+  // Count-weighted distances per sprite, laid out as [colour][entry]. The
+  // entries are in colour id order, so the sums below are the same on
+  // every run.
+  std::vector<std::vector<float> > weighted(sprites.size());
+  std::vector<std::uint32_t> ids;
+  for (std::size_t s = 0; s < sprites.size(); ++s) {
+    const SheetSprite &sprite = sprites[s];
+    ids.clear();
+    for (int row = 0; row < 21; ++row) {
+      const std::uint32_t bits = sprite_row(sprite.bytes, row);
+      for (int column = 0; column < width; ++column)
+        if ((bits >> (24 - pixel_bits * (column + 1))) & mask)
+          ids.push_back(pixel_id(sprite, row, column));
+    }
+    std::sort(ids.begin(), ids.end());
+    std::size_t n = 0;
+    for (std::size_t i = 0; i < ids.size(); ++i)
+      if (i == 0 || ids[i] != ids[i - 1])
+        ++n;
+    weighted[s].resize(NCOLORS * n);
+    for (std::size_t i = 0, e = 0; i < ids.size(); ++e) {
+      std::size_t end = i;
+      while (end < ids.size() && ids[end] == ids[i])
+        ++end;
+      for (int c = 0; c < NCOLORS; ++c)
+        weighted[s][c * n + e] = sheet.dist[ids[i]][c] * static_cast<float>(end - i);
+      i = end;
+    }
+  }
+
+  SheetColours ret;
+  if (multi) {
+    std::vector<PairCosts> costs(sprites.size());
+    std::vector<float> pair_min;
+    for (std::size_t s = 0; s < sprites.size(); ++s) {
+      const std::size_t n = weighted[s].size() / NCOLORS;
+      const float *w = weighted[s].data();
+      pair_min.resize(n);
+      for (int p = 0; p < NPAIRS; ++p) {
+        const float *wa = w + COLOUR_PAIRS[p][0] * n, *wb = w + COLOUR_PAIRS[p][1] * n;
+        for (std::size_t e = 0; e < n; ++e)
+          pair_min[e] = std::min(wa[e], wb[e]);
+        for (int c = 0; c < NCOLORS; ++c) {
+          const float *wc = w + c * n;
+          float total = 0.0f;
+          for (std::size_t e = 0; e < n; ++e)
+            total += std::min(pair_min[e], wc[e]);
+          costs[s][p * NCOLORS + c] = total;
+        }
+      }
+    }
+    ret = choose_multicolour_registers(costs);
+    for (std::size_t s = 0; s < sprites.size(); ++s)
+      reencode_multicolour(sprites[s].bytes, ret.multi1, ret.multi2, ret.individual[s],
+                           [&](int row, int column) -> const auto & {
+                             return pixel_dist(sprites[s], row, column);
+                           });
+  } else {
+    for (std::size_t s = 0; s < sprites.size(); ++s) {
+      const std::size_t n = weighted[s].size() / NCOLORS;
+      int individual = 0;
+      float error = std::numeric_limits<float>::max();
+      for (int c = 0; c < NCOLORS; ++c) {
+        const float *wc = weighted[s].data() + c * n;
+        if (const float sum = std::accumulate(wc, wc + n, 0.0f); sum < error) {
+          error = sum;
+          individual = c;
+        }
+      }
+      ret.individual.push_back(individual);
+      ret.error.push_back(error);
+      sprites[s].bytes[63] = static_cast<std::uint8_t>(individual);
+    }
+  }
+  return ret;
+}
+
+SheetColours optimise_indexed_colours(std::vector<SheetSprite> &sprites, const ImageBuffer &sheet,
+                                      const C64Palette &palette, ColourMetric metric) {
+  std::array<std::array<float, NCOLORS>, NCOLORS> dist{};
+  for (int a = 0; a < NCOLORS; ++a) {
+    for (int b = 0; b < NCOLORS; ++b) {
+      float total = 0.0f;
+      for (int i = 0; i < 3; ++i) {
+        const float delta = static_cast<float>(palette[a][i] - palette[b][i]);
+        total += delta * delta;
+      }
+      dist[a][b] = metric == ColourMetric::lost ? (a == b ? 0.0f : 1.0f) : total;
+    }
+  }
+
+  auto colour_at = [&](const SheetSprite &sprite, int row, int column) {
+    const int px = sheet.row(sprite.y + row)[sprite.x + column];
+    if (px >= NCOLORS)
+      throw std::invalid_argument(
+              std::format("palette index {} at {},{} is not a C64 colour, quantise the sheet first",
+                          px, sprite.x + column, sprite.y + row));
+    return px;
+  };
+
+  std::vector<PairCosts> costs(sprites.size());
+  for (std::size_t s = 0; s < sprites.size(); ++s) {
+    std::array<unsigned, NCOLORS> histogram{};
+    for (int row = 0; row < 21; ++row) {
+      const std::uint32_t bits = sprite_row(sprites[s].bytes, row);
+      for (int column = 0; column < 12; ++column)
+        if ((bits >> (22 - 2 * column)) & 3)
+          ++histogram[colour_at(sprites[s], row, column)];
+    }
+    for (int p = 0; p < NPAIRS; ++p) {
+      const int a = COLOUR_PAIRS[p][0], b = COLOUR_PAIRS[p][1];
+      for (int c = 0; c < NCOLORS; ++c) {
+        float total = 0.0f;
+        for (int k = 0; k < NCOLORS; ++k)
+          if (histogram[k])
+            total += histogram[k] * std::min({dist[k][a], dist[k][b], dist[k][c]});
+        costs[s][p * NCOLORS + c] = total;
+      }
+    }
+  }
+
+  SheetColours ret = choose_multicolour_registers(costs);
+  for (std::size_t s = 0; s < sprites.size(); ++s)
+    reencode_multicolour(sprites[s].bytes, ret.multi1, ret.multi2, ret.individual[s],
+                         [&](int row, int column) -> const auto & {
+                           return dist[colour_at(sprites[s], row, column)];
+                         });
+  return ret;
+}
+
+// ── software sprites ──────────────────────────────────────────────────────────
+
+std::vector<ShiftedSprite> preshift_sprite(const SpriteBytes &bytes, bool multi) {
+  const int step = multi ? 2 : 1;
+  std::vector<ShiftedSprite> ret(8 / step);
+  for (int row = 0; row < 21; ++row) {
+    const std::uint32_t bits = sprite_row(bytes, row) << 8;
+    std::uint32_t opaque = bits;
+    if (multi) {
+      const std::uint32_t pairs = (bits | (bits << 1)) & 0xAAAAAAAAu;
+      opaque = pairs | (pairs >> 1);
+    }
+    for (std::size_t v = 0; v < ret.size(); ++v) {
+      const int shift = static_cast<int>(v) * step;
+      const std::uint32_t data = bits >> shift, mask = ~(opaque >> shift);
+      for (int column = 0; column < SOFT_COLUMNS; ++column) {
+        ret[v].data[column * 21 + row] = static_cast<std::uint8_t>(data >> (24 - 8 * column));
+        ret[v].mask[column * 21 + row] = static_cast<std::uint8_t>(mask >> (24 - 8 * column));
+      }
+    }
+  }
+  return ret;
+}
@@ -0,0 +1,455 @@
+#ifndef __SPRITES_HH_2026__
+#define __SPRITES_HH_2026__
+/*! \file sprites.hh
+ *  \brief Conversion of sprite sheets to C64 sprites (the core of spriteconv).
+ *
+ * Every sprite has 63 bytes of sprite data; the last byte contains metadata.
+ *
+ * Sprite layout reference: https://csdb.dk/forums/?roomid=7&topicid=125812
+ * Multicolour bit patterns: http://codebase64.org/doku.php?id=base:spriteintro
+ *
+ *   - 00: transparent
+ *   - 01: $d025  (multicolour 1)
+ *   - 11: $d026  (multicolour 2)
+ *   - 10: individual colour ($d027-$d02f)
+ *
+ * Sheets are ImageBuffers with one byte per pixel (indexed or grey); the
+ * byte is used as palette index. Truecolour sheets are turned into such
+ * a sheet by quantise_image(). Nothing is printed, the callers report
+ * the results.
+ */
+#include "c64palette.hh"
+#include "imageload.hh"
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// ── sprite data structures ────────────────────────────────────────────────────
+
+/// Packed sprite record: 21 rows of 3 bytes followed by one metadata byte.
+using SpriteBytes = std::array<std::uint8_t, 64>;
+
+/*! \brief Write a packed sprite as assembler \c .byte lines.
+ *
+ * \param bytes packed sprite record
+ * \param out output stream
+ * \return \p out
+ */
+std::ostream &write_sprite_asm(const SpriteBytes &bytes, std::ostream &out);
+
+/// Common interface for sprite types.
+struct SpriteInterface {
+  SpriteBytes bytes{}; ///< Packed sprite data
+
+  std::ostream &write_asm(std::ostream &out) const { return write_sprite_asm(bytes, out); }
+  virtual int width()  const = 0;
+  virtual int height() const = 0;
+  virtual ~SpriteInterface() = default;
+};
+
+/// Standard (1-bit) 24x21 pixel sprite, metadata byte $00.
+struct SpriteData : public SpriteInterface {
+  int width()  const override { return 24; }
+  int height() const override { return 21; }
+};
+
+/*! \brief Multicolour 12x21 sprite (each logical pixel = 2 screen pixels wide).
+ *
+ * Every logical pixel is a 2-bit C64 colour pattern; the metadata byte
+ * is $80 to mark the sprite as multicolour.
+ */
+struct MultiSpriteData : public SpriteInterface {
+  MultiSpriteData() { bytes[63] = 0x80; }
+
+  int width()  const override { return 12; }
+  int height() const override { return 21; }
+};
+
+// ── sprite conversion ─────────────────────────────────────────────────────────
+
+/*! \brief Convert a region of a sheet to a 1-bit sprite.
+ *
+ * \param sheet        Source sheet (one byte per pixel).
+ * \param xpos         X offset of the sprite's top-left corner.
+ * \param ypos         Y offset of the sprite's top-left corner.
+ * \param transparent  Palette index treated as transparent (= 0 bit).
+ */
+SpriteData convert_bw_sprite(const ImageBuffer &sheet, int xpos, int ypos, int transparent);
+
+/*! \brief Convert a region of a sheet to a multicolour sprite.
+ *
+ * \param sheet        Source sheet (one byte per pixel).
+ * \param xpos         X offset of the sprite's top-left corner.
+ * \param ypos         Y offset of the sprite's top-left corner.
+ * \param transparent  Palette index for transparent pixels (bit pattern 00).
+ * \param m1           Palette index for multicolour-1 pixels (bit pattern 01).
+ * \param m2           Palette index for multicolour-2 pixels (bit pattern 11).
+ *                     All other palette indices map to individual colour (10).
+ */
+MultiSpriteData convert_multi_sprite(const ImageBuffer &sheet, int xpos, int ypos,
+                                     int transparent, int m1, int m2);
+
+/*! \brief Auto-assign up to 4 colours from a sprite region (multicolour).
+ *
+ * Colours are assigned ordinal values (0-3) in first-occurrence order.
+ * Throws \c std::logic_error if more than 4 distinct palette indices appear.
+ *
+ * \param sheet    Source sheet (one byte per pixel).
+ * \param x        X offset of the sprite's top-left corner.
+ * \param y        Y offset of the sprite's top-left corner.
+ * \param border   Additional border offset added to both axes.
+ */
+MultiSpriteData convert_sprite(const ImageBuffer &sheet, int x, int y, int border);
+
+// ── sprite extraction ─────────────────────────────────────────────────────────
+
+/**
+ * \brief Layout and colours of a sprite sheet.
+ *
+ * The field names follow the spriteconv options.
+ */
+struct SheetOptions {
+  int  x_position    = 0;     ///< X offset of the first sprite
+  int  y_position    = 0;     ///< Y offset of the first sprite
+  int  transparent   = 0;     ///< Transparent colour index
+  int  spritecolumns = 1;     ///< Sprite columns (negative = use whole width)
+  int  spriterows    = 1;     ///< Sprite rows (negative = use whole height)
+  int  columnwidth   = 24;    ///< Width of a single sprite in the sheet
+  int  rowheight     = 21;    ///< Height of a single sprite in the sheet
+  bool multi_mode    = false; ///< Multicolour sprites
+  int  multi1        = 1;     ///< Multicolour 1 palette index (bit pattern 01)
+  int  multi2        = 2;     ///< Multicolour 2 palette index (bit pattern 11)
+  bool autocol       = false; ///< Assign the multicolour patterns automatically
+};
+
+/// One converted sprite together with its position in the sheet grid.
+struct SheetSprite {
+  int         column;      ///< Grid column in the sprite sheet (tile column of the object with --auto)
+  int         row;         ///< Grid row in the sprite sheet (tile row of the object with --auto)
+  SpriteBytes bytes;       ///< Packed sprite data
+  int         object = -1; ///< Object number with --auto, -1 for grid sheets
+  int         x = 0;       ///< X position of the top-left pixel in the sheet
+  int         y = 0;       ///< Y position of the top-left pixel in the sheet
+};
+
+/// Label of a sprite: \c <label><column><row>, or \c <label>_<object>_<column><row> with --auto.
+[[nodiscard]] std::string sprite_label(const std::string &label, const SheetSprite &sprite);
+
+/**
+ * \brief Convert every sprite of the sprite sheet.
+ *
+ * \param sheet  Source sheet (one byte per pixel).
+ * \param opts   Sheet layout and colours.
+ * \return Sprites in sheet order (row by row).
+ * \throw std::invalid_argument if the sheet has more than one byte per pixel,
+ *        the grid cells are empty, the position is negative or a sprite
+ *        of the grid does not fit into the sheet
+ */
+std::vector<SheetSprite> extract_sprite_data(const ImageBuffer &sheet, const SheetOptions &opts);
+
+// ── deduplication ─────────────────────────────────────────────────────────────
+
+/// How a sheet position is derived from its unique sprite.
+enum class SpriteTransform : std::uint8_t {
+  none        = 0, ///< Identical copy
+  mirror      = 1, ///< Mirrored along the X axis
+  shift_right = 2, ///< Moved one pixel to the right (draw the sprite at x+1)
+  shift_left  = 3, ///< Moved one pixel to the left (draw the sprite at x-1)
+};
+
+/// Reference from a sheet position to a unique sprite.
+struct SpriteRef {
+  unsigned        index;     ///< Index into SpriteDedup::unique
+  SpriteTransform transform; ///< Transformation applied to the unique sprite
+};
+
+/*! \brief Result of the sprite deduplication.
+ *
+ * \c unique holds every distinct sprite in order of first occurrence,
+ * \c refs holds one reference per sheet position.
+ */
+struct SpriteDedup {
+  std::vector<SheetSprite> unique;
+  std::vector<SpriteRef>   refs;
+  unsigned empty    = 0; ///< Number of empty sheet positions
+  unsigned mirrored = 0; ///< Number of positions matched as mirrored copies
+  unsigned shifted  = 0; ///< Number of positions matched as shifted copies
+};
+
+/// Hash over the packed sprite, eight 64-bit words folded together.
+struct SpriteBytesHash {
+  std::size_t operator()(const SpriteBytes &bytes) const noexcept;
+};
+
+/// Pixel row \p row of a packed sprite as a 24-bit value.
+[[nodiscard]] inline std::uint32_t sprite_row(const SpriteBytes &bytes, int row) noexcept {
+  return (std::uint32_t{bytes[3 * row]} << 16) | (std::uint32_t{bytes[3 * row + 1]} << 8)
+         | bytes[3 * row + 2];
+}
+
+/// Store the 24-bit value \p bits as pixel row \p row.
+inline void set_sprite_row(SpriteBytes &bytes, int row, std::uint32_t bits) noexcept {
+  bytes[3 * row]     = static_cast<std::uint8_t>(bits >> 16);
+  bytes[3 * row + 1] = static_cast<std::uint8_t>(bits >> 8);
+  bytes[3 * row + 2] = static_cast<std::uint8_t>(bits);
+}
+
+/// True if all 63 pixel bytes are zero (the metadata byte is ignored).
+[[nodiscard]] bool sprite_empty(const SpriteBytes &bytes) noexcept;
+
+/*! \brief Mirror a sprite along the X axis.
+ *
+ * \param bytes packed sprite
+ * \param pixel_bits bits per pixel, 1 for hires and 2 for multicolour
+ */
+[[nodiscard]] SpriteBytes mirror_sprite(const SpriteBytes &bytes, int pixel_bits) noexcept;
+
+/*! \brief Move a sprite one pixel to the left (\p bits > 0) or right.
+ *
+ * \param bytes packed sprite
+ * \param bits number of bits to shift, positive shifts to the left
+ * \return shifted sprite, or std::nullopt if pixels would fall off the edge
+ */
+[[nodiscard]] std::optional<SpriteBytes> shift_sprite(const SpriteBytes &bytes, int bits) noexcept;
+
+/*! \brief Collapse duplicate sprites of a sheet.
+ *
+ * Every sprite is looked up in a hash table of the sprites kept so far,
+ * so the pass is linear in the number of sheet positions. Exact copies
+ * (which includes all empty cells) always share one sprite. With
+ * \p mirror a sprite that is the X-mirrored image of a kept sprite is
+ * not stored, with \p shift neither is a sprite that equals a kept one
+ * moved by one pixel (two hires pixels in multicolour mode). Such
+ * positions can only be displayed by mirroring the sprite in software
+ * or by moving the sprite, see SpriteTransform.
+ *
+ * \param sprites sprites in sheet order
+ * \param multi multicolour sprites (2 bits per pixel)
+ * \param mirror detect mirrored copies
+ * \param shift detect shifted copies
+ */
+SpriteDedup deduplicate_sprites(const std::vector<SheetSprite> &sprites, bool multi,
+                                bool mirror, bool shift);
+
+// ── automatic extraction ──────────────────────────────────────────────────────
+
+/// Bounding box of a connected non-transparent region.
+struct SheetObject {
+  int x, y;          ///< Top-left corner in the sheet
+  int w, h;          ///< Size in pixels
+  std::vector<std::size_t> runs; ///< Indices of the object's pixel runs
+};
+
+/// Horizontal run of non-transparent pixels, also a union-find node.
+struct PixelRun {
+  int y, x0, x1;      ///< Row and first/last column (inclusive)
+  std::size_t parent; ///< Union-find parent
+};
+
+/**
+ * \brief Find the connected non-transparent regions of a sheet.
+ *
+ * The sheet is scanned once, row by row, and split into runs of
+ * non-transparent pixels. Each run is united with the runs of the row
+ * above which it touches, diagonals included. Only the runs are stored,
+ * so memory and time are proportional to the number of runs.
+ *
+ * \param sheet       Source sheet (one byte per pixel).
+ * \param transparent Palette index of the background.
+ * \param runs        Receives the runs, referenced by SheetObject::runs.
+ * \return Objects ordered by their topmost, then leftmost pixel.
+ */
+std::vector<SheetObject> find_objects(const ImageBuffer &sheet, int transparent,
+                                      std::vector<PixelRun> &runs);
+
+/// Placement of one sprite of an automatically extracted object.
+struct LayoutEntry {
+  std::size_t sprite; ///< Index of the sprite in extraction order
+  int         dx, dy; ///< Offset to the object's top-left corner (X in hires pixels)
+};
+
+/// Sprites of one automatically extracted object.
+struct ObjectLayout {
+  int x, y, w, h;                   ///< Bounding box in the sheet
+  std::vector<LayoutEntry> sprites; ///< Non-empty sprites covering the object
+};
+
+/**
+ * \brief Extract all objects of a sheet and tile them into sprites.
+ *
+ * Each object's bounding box is covered by the minimal grid of 24×21
+ * (12×21 in multicolour mode) sprites; tiles without a pixel of the
+ * object are dropped. Only the object's own pixels are copied into the
+ * tiles, so neighbouring objects reaching into the bounding box do not
+ * leak into its sprites. Objects whose sprites cannot be placed with
+ * 8-bit offsets are skipped.
+ *
+ * \param sheet    Source sheet (one byte per pixel).
+ * \param opts     Sheet layout and colours (the grid is ignored).
+ * \param layouts  Receives one layout per object.
+ * \param skipped  Receives the objects which are too large.
+ * \return Sprites in object order.
+ * \throw std::invalid_argument if the sheet has more than one byte per pixel
+ */
+std::vector<SheetSprite> extract_objects(const ImageBuffer &sheet, const SheetOptions &opts,
+                                         std::vector<ObjectLayout> &layouts,
+                                         std::vector<SheetObject> &skipped);
+
+// ── truecolour input ──────────────────────────────────────────────────────────
+
+/// Palette index of transparent pixels in a quantised sheet.
+inline constexpr int QUANTISED_TRANSPARENT = NCOLORS;
+
+/**
+ * \brief Colour information of a truecolour sheet.
+ *
+ * Every distinct RGB value of the sheet gets an id; the squared
+ * distances of the distinct colours to the palette are computed once and
+ * shared by every pixel with that colour.
+ */
+struct TrueColourSheet {
+  int width = 0;                                  ///< Sheet width in pixels
+  std::vector<std::uint32_t> ids;                 ///< Distinct colour id per pixel
+  std::vector<std::array<float, NCOLORS> > dist;  ///< Palette distances per distinct colour
+  bool alpha = false;                             ///< Transparency came from the alpha channel
+};
+
+/**
+ * \brief Quantise an arbitrary image to the C64 palette.
+ *
+ * Pixels with an alpha value below 128 are transparent; if the image
+ * has no such pixel, every pixel whose nearest palette colour is
+ * \p background is treated as transparent instead. The result holds the
+ * nearest palette index per pixel and QUANTISED_TRANSPARENT for
+ * transparent pixels, so that the grid and --auto extraction work
+ * unchanged. Its palette has the C64 colours plus magenta for
+ * transparent pixels.
+ *
+ * \param img        Source image in any pixel format.
+ * \param palette    C64 palette to match against.
+ * \param background Colour treated as transparent for images without alpha.
+ * \param sheet      Receives the distinct colours and their distances.
+ * \return Indexed sheet of the same size.
+ */
+ImageBuffer quantise_image(const ImageBuffer &img, const C64Palette &palette, int background,
+                           TrueColourSheet &sheet);
+
+// ── multicolour register optimisation ─────────────────────────────────────────
+
+/// Number of unordered pairs of two different C64 colours.
+inline constexpr int NPAIRS = NCOLORS * (NCOLORS - 1) / 2;
+
+/// The colours of every pair; pair p consists of COLOUR_PAIRS[p][0] < COLOUR_PAIRS[p][1].
+inline constexpr auto COLOUR_PAIRS = [] {
+  std::array<std::array<int, 2>, NPAIRS> ret{};
+  int p = 0;
+  for (int a = 0; a < NCOLORS; ++a)
+    for (int b = a + 1; b < NCOLORS; ++b)
+      ret[p++] = {a, b};
+  return ret;
+}();
+
+/*! \brief Error of one sprite for every colour combination.
+ *
+ * Entry \c p*NCOLORS+c is the error with the multicolour pair \c p and
+ * the individual colour \c c. Once computed, evaluating a pair for the
+ * whole sheet costs O(sprites × 16) without looking at any pixel.
+ */
+using PairCosts = std::array<float, NPAIRS * NCOLORS>;
+
+/// Shared multicolour registers and the individual colour of every sprite.
+struct SheetColours {
+  int multi1 = -1;              ///< $d025 (bit pattern 01), -1 in hires mode
+  int multi2 = -1;              ///< $d026 (bit pattern 11), -1 in hires mode
+  std::vector<int>   individual; ///< $d027+ colour per sprite
+  std::vector<float> error;      ///< Remaining error per sprite
+};
+
+/**
+ * \brief Pick the multicolour pair with the smallest total error.
+ *
+ * \param costs one table per sprite
+ * \return registers, individual colours and per-sprite errors
+ */
+SheetColours choose_multicolour_registers(const std::vector<PairCosts> &costs);
+
+/**
+ * \brief Pick the sprite colours of a quantised truecolour sheet.
+ *
+ * Every sprite is reduced to a histogram of its distinct colours, with
+ * the palette distances pre-multiplied by the pixel counts. In
+ * multicolour mode this gives the PairCosts of the sprite, from which
+ * the best shared pair and individual colours are chosen. Hires sprites
+ * only choose their individual colour. The opaque pixels are then
+ * re-encoded with the nearest of the sprite's colours; ties go to the
+ * individual colour, then to multicolour 1. The individual colour is
+ * stored in the low nibble of the metadata byte (as SpritePad does).
+ *
+ * \param sprites sprites extracted from the quantised sheet, modified in place
+ * \param sheet   colour information from quantise_image()
+ * \param multi   multicolour sprites
+ * \return chosen colours
+ */
+SheetColours optimise_sprite_colours(std::vector<SheetSprite> &sprites, const TrueColourSheet &sheet,
+                                     bool multi);
+
+/// What optimise_indexed_colours() minimises.
+enum class ColourMetric {
+  error, ///< Sum of squared RGB distances of the replaced pixels
+  lost,  ///< Number of pixels whose colour cannot be shown
+};
+
+/**
+ * \brief Choose $d025/$d026 and every sprite's colour for an indexed sheet.
+ *
+ * The palette indices of the sheet must be C64 colour numbers (0–15).
+ * Every sprite is reduced to a 16-bin histogram of its opaque pixels,
+ * from which its PairCosts are computed (16 bins instead of 252 pixels
+ * per combination). The pair with the smallest total error wins, every
+ * sprite gets its best individual colour, and pixels in colours which
+ * are not available are replaced by the nearest available one.
+ *
+ * \param sprites  sprites extracted with the multicolour converter, modified in place
+ * \param sheet    the sheet (one byte per pixel)
+ * \param palette  C64 palette for the distances between colours
+ * \param metric   quantity to minimise
+ * \return chosen colours
+ * \throw std::invalid_argument if an opaque pixel is not a C64 colour
+ */
+SheetColours optimise_indexed_colours(std::vector<SheetSprite> &sprites, const ImageBuffer &sheet,
+                                      const C64Palette &palette, ColourMetric metric);
+
+// ── software sprites ──────────────────────────────────────────────────────────
+
+/// Byte columns of a pre-shifted software sprite (24 pixels plus up to 7 shifted out).
+inline constexpr int SOFT_COLUMNS = 4;
+
+/*! \brief One pre-shifted software sprite variant.
+ *
+ * Both tables are column-major: the 21 bytes of an 8-pixel column follow
+ * each other, so a blitter can draw a column with
+ * \c lda screen,y / \c and mask,y / \c ora data,y / \c sta screen,y.
+ */
+struct ShiftedSprite {
+  std::array<std::uint8_t, SOFT_COLUMNS * 21> data; ///< Shifted pixel data
+  std::array<std::uint8_t, SOFT_COLUMNS * 21> mask; ///< AND mask, 0 bits where the sprite is opaque
+};
+
+/**
+ * \brief Generate the horizontally pre-shifted variants of a sprite.
+ *
+ * Each 24-pixel row is shifted as one 32-bit word. Hires sprites get 8
+ * variants (shifted by 0–7 pixels), multicolour sprites 4 (shifted by
+ * 0–3 double-wide pixels). In multicolour mode a pixel is opaque if its
+ * bit pair is not 00, so the mask always clears both bits of a pair.
+ *
+ * \param bytes packed sprite
+ * \param multi multicolour sprite
+ * \return one variant per shift
+ */
+std::vector<ShiftedSprite> preshift_sprite(const SpriteBytes &bytes, bool multi);
+
+#endif
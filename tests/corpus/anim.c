@@ -0,0 +1,319 @@
+unsigned char frame0000[]={// border,bg,chars,colors
+14,6,
+32,32,32,126,126,126,124,124,124,226,226,226,123,123,123,97,97,97,255,255,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,
+32,32,32,126,126,126,124,124,124,226,226,226,123,123,123,97,97,97,255,255,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,
+126,126,126,124,124,124,226,226,226,123,123,123,97,97,97,255,255,255,236,236,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,
+126,126,126,124,124,124,226,226,226,123,123,123,97,97,97,255,255,255,236,236,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,
+124,124,124,226,226,226,123,123,123,97,97,97,255,255,255,236,236,236,108,108,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,
+124,124,124,226,226,226,123,123,123,97,97,97,255,255,255,236,236,236,108,108,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,
+226,226,226,123,123,123,97,97,97,255,255,255,236,236,236,108,108,108,127,127,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,
+226,226,226,123,123,123,97,97,97,255,255,255,236,236,236,108,108,108,127,127,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,
+123,123,123,97,97,97,255,255,255,236,236,236,108,108,108,127,127,127,225,225,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,
+123,123,123,97,97,97,255,255,255,236,236,236,108,108,108,127,127,127,225,225,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,
+97,97,97,255,255,255,236,236,236,108,108,108,127,127,127,225,225,225,251,251,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,
+97,97,97,255,255,255,236,236,236,108,108,108,127,127,127,225,225,225,251,251,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,
+255,255,255,236,236,236,108,108,108,127,127,127,225,225,225,251,251,251,98,98,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,
+255,255,255,236,236,236,108,108,108,127,127,127,225,225,225,251,251,251,98,98,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,
+236,236,236,108,108,108,127,127,127,225,225,225,251,251,251,98,98,98,252,252,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,
+236,236,236,108,108,108,127,127,127,225,225,225,251,251,251,98,98,98,252,252,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,
+108,108,108,127,127,127,225,225,225,251,251,251,98,98,98,252,252,252,254,254,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,
+108,108,108,127,127,127,225,225,225,251,251,251,98,98,98,252,252,252,254,254,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,
+127,127,127,225,225,225,251,251,251,98,98,98,252,252,252,254,254,254,160,160,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,
+127,127,127,225,225,225,251,251,251,98,98,98,252,252,252,254,254,254,160,160,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,
+225,225,225,251,251,251,98,98,98,252,252,252,254,254,254,160,160,160,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,
+225,225,225,251,251,251,98,98,98,252,252,252,254,254,254,160,160,160,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,
+251,251,251,98,98,98,252,252,252,254,254,254,160,160,160,32,32,32,126,126,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,
+251,251,251,98,98,98,252,252,252,254,254,254,160,160,160,32,32,32,126,126,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,
+98,98,98,252,252,252,254,254,254,160,160,160,32,32,32,126,126,126,124,124,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,
+1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14
+};
+unsigned char frame0001[]={// border,bg,chars,colors
+14,6,
+126,126,126,124,124,124,226,226,226,123,123,123,97,97,97,255,255,255,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,252,254,
+126,126,126,124,124,124,226,226,226,123,123,123,97,97,97,255,255,255,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,252,254,
+124,124,124,226,226,226,123,123,123,97,97,97,255,255,255,236,236,236,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,254,160,
+124,124,124,226,226,226,123,123,123,97,97,97,255,255,255,236,236,236,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,254,160,
+226,226,226,123,123,123,97,97,97,255,255,255,236,236,236,108,108,108,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,160,32,
+226,226,226,123,123,123,97,97,97,255,255,255,236,236,236,108,108,108,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,160,32,
+123,123,123,97,97,97,255,255,255,236,236,236,108,108,108,127,127,127,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,126,
+123,123,123,97,97,97,255,255,255,236,236,236,108,108,108,127,127,127,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,126,
+97,97,97,255,255,255,236,236,236,108,108,108,127,127,127,225,225,225,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,126,124,
+97,97,97,255,255,255,236,236,236,108,108,108,127,127,127,225,225,225,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,126,124,
+255,255,255,236,236,236,108,108,108,127,127,127,225,225,225,251,251,251,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,124,226,
+255,255,255,236,236,236,108,108,108,127,127,127,225,225,225,251,251,251,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,124,226,
+236,236,236,108,108,108,127,127,127,225,225,225,251,251,251,98,98,98,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,226,123,
+236,236,236,108,108,108,127,127,127,225,225,225,251,251,251,98,98,98,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,226,123,
+108,108,108,127,127,127,225,225,225,251,251,251,98,98,98,252,252,252,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,123,97,
+108,108,108,127,127,127,225,225,225,251,251,251,98,98,98,252,252,252,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,123,97,
+127,127,127,225,225,225,251,251,251,98,98,98,252,252,252,254,254,254,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,97,255,
+127,127,127,225,225,225,251,251,251,98,98,98,252,252,252,254,254,254,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,97,255,
+225,225,225,251,251,251,98,98,98,252,252,252,254,254,254,160,160,160,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,255,236,
+225,225,225,251,251,251,98,98,98,252,252,252,254,254,254,160,160,160,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,255,236,
+251,251,251,98,98,98,252,252,252,254,254,254,160,160,160,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,236,108,
+251,251,251,98,98,98,252,252,252,254,254,254,160,160,160,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,236,108,
+98,98,98,252,252,252,254,254,254,160,160,160,32,32,32,126,126,126,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,108,127,
+98,98,98,252,252,252,254,254,254,160,160,160,32,32,32,126,126,126,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,108,127,
+252,252,252,254,254,254,160,160,160,32,32,32,126,126,126,124,124,124,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,127,225,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14
+};
+unsigned char frame0002[]={// border,bg,chars,colors
+14,6,
+124,124,124,226,226,226,123,123,123,97,97,97,255,255,255,236,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,254,254,254,160,
+124,124,124,226,226,226,123,123,123,97,97,97,255,255,255,236,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,254,254,254,160,
+226,226,226,123,123,123,97,97,97,255,255,255,236,236,236,108,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,160,160,160,32,
+226,226,226,123,123,123,97,97,97,255,255,255,236,236,236,108,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,160,160,160,32,
+123,123,123,97,97,97,255,255,255,236,236,236,108,108,108,127,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,126,
+123,123,123,97,97,97,255,255,255,236,236,236,108,108,108,127,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,126,
+97,97,97,255,255,255,236,236,236,108,108,108,127,127,127,225,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,126,126,126,124,
+97,97,97,255,255,255,236,236,236,108,108,108,127,127,127,225,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,126,126,126,124,
+255,255,255,236,236,236,108,108,108,127,127,127,225,225,225,251,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,124,124,124,226,
+255,255,255,236,236,236,108,108,108,127,127,127,225,225,225,251,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,124,124,124,226,
+236,236,236,108,108,108,127,127,127,225,225,225,251,251,251,98,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,226,226,226,123,
+236,236,236,108,108,108,127,127,127,225,225,225,251,251,251,98,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,226,226,226,123,
+108,108,108,127,127,127,225,225,225,251,251,251,98,98,98,252,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,123,123,123,97,
+108,108,108,127,127,127,225,225,225,251,251,251,98,98,98,252,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,123,123,123,97,
+127,127,127,225,225,225,251,251,251,98,98,98,252,252,252,254,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,97,97,97,255,
+127,127,127,225,225,225,251,251,251,98,98,98,252,252,252,254,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,97,97,97,255,
+225,225,225,251,251,251,98,98,98,252,252,252,254,254,254,160,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,255,255,255,236,
+225,225,225,251,251,251,98,98,98,252,252,252,254,254,254,160,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,255,255,255,236,
+251,251,251,98,98,98,252,252,252,254,254,254,160,160,160,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,236,236,236,108,
+251,251,251,98,98,98,252,252,252,254,254,254,160,160,160,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,236,236,236,108,
+98,98,98,252,252,252,254,254,254,160,160,160,32,32,32,126,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,108,108,108,127,
+98,98,98,252,252,252,254,254,254,160,160,160,32,32,32,126,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,108,108,108,127,
+252,252,252,254,254,254,160,160,160,32,32,32,126,126,126,124,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,127,127,127,225,
+252,252,252,254,254,254,160,160,160,32,32,32,126,126,126,124,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,127,127,127,225,
+254,254,254,160,160,160,32,32,32,126,126,126,124,124,124,226,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,225,225,225,251,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14
+};
+unsigned char frame0003[]={// border,bg,chars,colors
+14,6,
+226,226,226,123,123,123,97,97,97,255,255,255,236,236,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,254,254,160,160,160,32,
+226,226,226,123,123,123,97,97,97,255,255,255,236,236,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,254,254,160,160,160,32,
+123,123,123,97,97,97,255,255,255,236,236,236,108,108,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,160,160,32,32,32,126,
+123,123,123,97,97,97,255,255,255,236,236,236,108,108,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,160,160,32,32,32,126,
+97,97,97,255,255,255,236,236,236,108,108,108,127,127,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,126,126,126,124,
+97,97,97,255,255,255,236,236,236,108,108,108,127,127,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,126,126,126,124,
+255,255,255,236,236,236,108,108,108,127,127,127,225,225,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,126,126,124,124,124,226,
+255,255,255,236,236,236,108,108,108,127,127,127,225,225,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,126,126,124,124,124,226,
+236,236,236,108,108,108,127,127,127,225,225,225,251,251,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,124,124,226,226,226,123,
+236,236,236,108,108,108,127,127,127,225,225,225,251,251,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,124,124,226,226,226,123,
+108,108,108,127,127,127,225,225,225,251,251,251,98,98,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,226,226,123,123,123,97,
+108,108,108,127,127,127,225,225,225,251,251,251,98,98,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,226,226,123,123,123,97,
+127,127,127,225,225,225,251,251,251,98,98,98,252,252,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,123,123,97,97,97,255,
+127,127,127,225,225,225,251,251,251,98,98,98,252,252,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,123,123,97,97,97,255,
+225,225,225,251,251,251,98,98,98,252,252,252,254,254,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,97,97,255,255,255,236,
+225,225,225,251,251,251,98,98,98,252,252,252,254,254,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,97,97,255,255,255,236,
+251,251,251,98,98,98,252,252,252,254,254,254,160,160,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,255,255,236,236,236,108,
+251,251,251,98,98,98,252,252,252,254,254,254,160,160,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,255,255,236,236,236,108,
+98,98,98,252,252,252,254,254,254,160,160,160,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,236,236,108,108,108,127,
+98,98,98,252,252,252,254,254,254,160,160,160,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,236,236,108,108,108,127,
+252,252,252,254,254,254,160,160,160,32,32,32,126,126,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,108,108,127,127,127,225,
+252,252,252,254,254,254,160,160,160,32,32,32,126,126,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,108,108,127,127,127,225,
+254,254,254,160,160,160,32,32,32,126,126,126,124,124,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,127,127,225,225,225,251,
+254,254,254,160,160,160,32,32,32,126,126,126,124,124,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,127,127,225,225,225,251,
+160,160,160,32,32,32,126,126,126,124,124,124,226,226,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,225,225,251,251,251,98,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14
+};
+unsigned char frame0004[]={// border,bg,chars,colors
+14,6,
+123,123,123,97,97,97,255,255,255,236,236,236,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,254,160,160,160,32,32,32,126,
+123,123,123,97,97,97,255,255,255,236,236,236,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,254,160,160,160,32,32,32,126,
+97,97,97,255,255,255,236,236,236,108,108,108,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,160,32,32,32,126,126,126,124,
+97,97,97,255,255,255,236,236,236,108,108,108,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,160,32,32,32,126,126,126,124,
+255,255,255,236,236,236,108,108,108,127,127,127,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,126,126,126,124,124,124,226,
+255,255,255,236,236,236,108,108,108,127,127,127,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,126,126,126,124,124,124,226,
+236,236,236,108,108,108,127,127,127,225,225,225,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,126,124,124,124,226,226,226,123,
+236,236,236,108,108,108,127,127,127,225,225,225,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,126,124,124,124,226,226,226,123,
+108,108,108,127,127,127,225,225,225,251,251,251,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,124,226,226,226,123,123,123,97,
+108,108,108,127,127,127,225,225,225,251,251,251,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,124,226,226,226,123,123,123,97,
+127,127,127,225,225,225,251,251,251,98,98,98,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,226,123,123,123,97,97,97,255,
+127,127,127,225,225,225,251,251,251,98,98,98,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,226,123,123,123,97,97,97,255,
+225,225,225,251,251,251,98,98,98,252,252,252,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,123,97,97,97,255,255,255,236,
+225,225,225,251,251,251,98,98,98,252,252,252,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,123,97,97,97,255,255,255,236,
+251,251,251,98,98,98,252,252,252,254,254,254,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,97,255,255,255,236,236,236,108,
+251,251,251,98,98,98,252,252,252,254,254,254,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,97,255,255,255,236,236,236,108,
+98,98,98,252,252,252,254,254,254,160,160,160,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,255,236,236,236,108,108,108,127,
+98,98,98,252,252,252,254,254,254,160,160,160,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,255,236,236,236,108,108,108,127,
+252,252,252,254,254,254,160,160,160,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,236,108,108,108,127,127,127,225,
+252,252,252,254,254,254,160,160,160,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,236,108,108,108,127,127,127,225,
+254,254,254,160,160,160,32,32,32,126,126,126,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,108,127,127,127,225,225,225,251,
+254,254,254,160,160,160,32,32,32,126,126,126,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,108,127,127,127,225,225,225,251,
+160,160,160,32,32,32,126,126,126,124,124,124,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,127,225,225,225,251,251,251,98,
+160,160,160,32,32,32,126,126,126,124,124,124,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,127,225,225,225,251,251,251,98,
+32,32,32,126,126,126,124,124,124,226,226,226,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,225,251,251,251,98,98,98,252,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14
+};
+unsigned char frame0005[]={// border,bg,chars,colors
+14,6,
+97,97,97,255,255,255,236,236,236,108,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,160,160,160,32,32,32,126,126,126,124,
+97,97,97,255,255,255,236,236,236,108,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,160,160,160,32,32,32,126,126,126,124,
+255,255,255,236,236,236,108,108,108,127,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,126,126,126,124,124,124,226,
+255,255,255,236,236,236,108,108,108,127,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,126,126,126,124,124,124,226,
+236,236,236,108,108,108,127,127,127,225,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,126,126,126,124,124,124,226,226,226,123,
+236,236,236,108,108,108,127,127,127,225,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,126,126,126,124,124,124,226,226,226,123,
+108,108,108,127,127,127,225,225,225,251,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,124,124,124,226,226,226,123,123,123,97,
+108,108,108,127,127,127,225,225,225,251,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,124,124,124,226,226,226,123,123,123,97,
+127,127,127,225,225,225,251,251,251,98,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,226,226,226,123,123,123,97,97,97,255,
+127,127,127,225,225,225,251,251,251,98,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,226,226,226,123,123,123,97,97,97,255,
+225,225,225,251,251,251,98,98,98,252,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,123,123,123,97,97,97,255,255,255,236,
+225,225,225,251,251,251,98,98,98,252,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,123,123,123,97,97,97,255,255,255,236,
+251,251,251,98,98,98,252,252,252,254,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,97,97,97,255,255,255,236,236,236,108,
+251,251,251,98,98,98,252,252,252,254,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,97,97,97,255,255,255,236,236,236,108,
+98,98,98,252,252,252,254,254,254,160,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,255,255,255,236,236,236,108,108,108,127,
+98,98,98,252,252,252,254,254,254,160,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,255,255,255,236,236,236,108,108,108,127,
+252,252,252,254,254,254,160,160,160,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,236,236,236,108,108,108,127,127,127,225,
+252,252,252,254,254,254,160,160,160,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,236,236,236,108,108,108,127,127,127,225,
+254,254,254,160,160,160,32,32,32,126,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,108,108,108,127,127,127,225,225,225,251,
+254,254,254,160,160,160,32,32,32,126,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,108,108,108,127,127,127,225,225,225,251,
+160,160,160,32,32,32,126,126,126,124,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,127,127,127,225,225,225,251,251,251,98,
+160,160,160,32,32,32,126,126,126,124,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,127,127,127,225,225,225,251,251,251,98,
+32,32,32,126,126,126,124,124,124,226,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,225,225,225,251,251,251,98,98,98,252,
+32,32,32,126,126,126,124,124,124,226,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,225,225,225,251,251,251,98,98,98,252,
+126,126,126,124,124,124,226,226,226,123,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,251,251,251,98,98,98,252,252,252,254,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
+14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14
+};
+// META: 40 25 C64 upper
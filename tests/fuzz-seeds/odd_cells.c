@@ -0,0 +1,4 @@
+unsigned char odd[]={// border,bg,chars,colors
+14,6,1
+};
+// META: 40 25 C64 upper
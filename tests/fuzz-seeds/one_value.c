@@ -0,0 +1,4 @@
+unsigned char one[]={// border,bg,chars,colors
+14
+};
+// META: 40 25 C64 upper
@@ -0,0 +1,2 @@
+unsigned char broken[]={14,6,
+1,2;
@@ -0,0 +1,165 @@
+/**
+ * \file fuzz_parse.cc
+ * \brief Fuzz target of the PETSCII animation parsers.
+ *
+ * Every input is given to parse_file() (the C array format written by
+ * petscii80x50) and to read_binary_frames() (the binary frame stream).
+ * Rejecting an input is fine as long as it happens through the
+ * documented exceptions: std::invalid_argument for a syntax error or an
+ * incomplete binary frame, std::logic_error (including std::out_of_range)
+ * for frames with fewer than two values or an odd number of cells. Any
+ * other exception, a crash or a failed round trip is a finding.
+ *
+ * Accepted input whose frames are all complete 40×25 screens is written
+ * again (write_frames_c() or Frame::save()) and parsed a second time;
+ * the frames must be unchanged. This also checks a reimplemented parser
+ * against the writer without needing the old one. Other frame sizes are
+ * accepted by the grammar but cannot be written back.
+ *
+ * Built with -DC64GFX_LIBFUZZER the file only provides
+ * LLVMFuzzerTestOneInput() for libFuzzer (make fuzz). Otherwise it has a
+ * main() which runs every file given on the command line, or stdin, for
+ * AFL and to replay a crash.
+ *
+ * Build dependencies: libc64gfx
+ * Requires: C++23 (-std=c++23)
+ */
+
+#include "parse-petsciifile.hh"
+#include "petscii.hh"
+#include "petsciiframes.hh"
+#include <cstdint>
+#include <cstdlib>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+
+namespace {
+
+/// Discards the syntax errors which parse_file() reports on stderr.
+class NullBuffer : public std::streambuf {
+protected:
+  int overflow(int c) override { return c; }
+  std::streamsize xsputn(const char *, std::streamsize n) override { return n; }
+};
+
+/// Discards stderr for the lifetime of the object.
+class SilentStderr {
+  NullBuffer null;
+  std::streambuf *saved;
+
+public:
+  SilentStderr() : saved(std::cerr.rdbuf(&null)) {}
+  ~SilentStderr() { std::cerr.rdbuf(saved); }
+  SilentStderr(const SilentStderr &) = delete;
+  SilentStderr &operator=(const SilentStderr &) = delete;
+};
+
+/// Abort with a message, so that the fuzzer records the input.
+[[noreturn]] void finding(const std::string &what) {
+  std::cout << "fuzz_parse: " << what << std::endl;
+  std::abort();
+}
+
+/// Compare the frames of two parses, ignoring the names.
+void check_same(const FrameArray &a, const FrameArray &b, const char *format) {
+  if(a.size() != b.size()) {
+    finding(std::format("{} round trip: {} frames became {}", format, a.size(), b.size()));
+  }
+  for(unsigned i = 0; i < a.size(); ++i) {
+    const Frame &x = a[i];
+    const Frame &y = b[i];
+    if(x.border != y.border || x.background != y.background || x.chars != y.chars || x.colors != y.colors) {
+      finding(std::format("{} round trip: frame {} differs", format, i));
+    }
+  }
+}
+
+/// True if every frame is a complete screen.
+bool full_screens(const FrameArray &frames) {
+  for(const Frame &frame : frames.frames) {
+    if(frame.chars.size() != WIDTH * HEIGHT) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// Parse as C arrays and check the round trip.
+void fuzz_text(const std::string &input) {
+  FrameArray frames;
+  try {
+    const SilentStderr silent;
+    std::istringstream in(input);
+    frames = parse_file(in);
+  } catch(const std::invalid_argument &) {
+    return;
+  } catch(const std::logic_error &) {
+    return;
+  }
+  if(!full_screens(frames)) {
+    return;
+  }
+  std::ostringstream out;
+  write_frames_c(frames.frames, out);
+  std::istringstream again(out.str());
+  const SilentStderr silent;
+  check_same(frames, parse_file(again), "text");
+}
+
+/// Parse as a binary frame stream and check the round trip.
+void fuzz_binary(const std::string &input) {
+  FrameArray frames;
+  try {
+    std::istringstream in(input);
+    frames = read_binary_frames(in);
+  } catch(const std::invalid_argument &) {
+    return;
+  }
+  std::ostringstream out;
+  for(const Frame &frame : frames.frames) {
+    frame.save(out);
+  }
+  std::istringstream again(out.str());
+  check_same(frames, read_binary_frames(again), "binary");
+}
+
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t *data, std::size_t size) {
+  const std::string input(reinterpret_cast<const char *>(data), size);
+  fuzz_text(input);
+  fuzz_binary(input);
+  return 0;
+}
+
+#ifndef C64GFX_LIBFUZZER
+/**
+ * \brief Run the inputs given as files, or stdin.
+ *
+ * \return 0 if no input triggered a finding (findings abort)
+ */
+int main(int argc, char **argv) {
+  auto run = [](std::istream &in) {
+    const std::string input{ std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>() };
+    LLVMFuzzerTestOneInput(reinterpret_cast<const std::uint8_t *>(input.data()), input.size());
+  };
+  if(argc < 2) {
+    run(std::cin);
+  }
+  for(int i = 1; i < argc; ++i) {
+    std::ifstream in(argv[i], std::ios::binary);
+    if(!in) {
+      std::cerr << std::format("fuzz_parse: cannot read '{}'\n", argv[i]);
+      return 2;
+    }
+    run(in);
+  }
+  return 0;
+}
+#endif
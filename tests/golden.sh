@@ -0,0 +1,216 @@
+#! /bin/sh
+# Golden-output regression tests for the converters.
+#
+# Every case runs one converter over a file of the fixed corpus (the
+# example image and tests/corpus) in a scratch directory and compares
+# everything it produced (files, stdout and the exit status) with the
+# golden outputs stored in tests/golden/<case>/. Diagnostics on stderr
+# are kept in tests/work/<case>.stderr but not compared, except in the
+# cases of inputs which have to be rejected, where the message is the
+# result.
+#
+# Outputs are compared byte for byte unless the case names a metric of
+# tests/goldencmp (e.g. hires:0.5 allows 0.5% of the pixels of a hires
+# bitmap to have another colour, for the dithering paths).
+#
+# Usage: tests/golden.sh [--update] [CASE...]
+#   --update  store the current outputs as the new golden outputs
+#   CASE      only run the cases matching these shell patterns
+#
+# A case named NAME=REFERENCE is compared with the golden outputs of
+# the case REFERENCE, for options which have to give the same result;
+# --update leaves it alone.
+#
+# Cases whose converter has not been built are skipped; a built
+# converter without golden outputs for a case fails it, so a new case
+# cannot pass unnoticed. The converters are taken from $BINDIR (default:
+# the top directory of the source tree).
+
+set -u
+# The case patterns are matched with case, never expanded to file names.
+set -f
+
+top=$(cd "$(dirname "$0")/.." && pwd)
+BINDIR=${BINDIR:-$top}
+corpus=$top/tests/corpus
+golden=$top/tests/golden
+work=$top/tests/work
+cmp=$top/tests/goldencmp
+
+update=0
+if [ "${1:-}" = "--update" ]; then
+    update=1
+    shift
+fi
+
+if [ $update -eq 0 ] && [ ! -x "$cmp" ]; then
+    echo "$cmp not built, run make check" >&2
+    exit 2
+fi
+
+# The result cache would answer instead of the converter.
+unset C64GFX_CACHE_DIR
+
+passed=0
+failed=0
+skipped=0
+keep_stderr=0
+
+# selected NAME: true if NAME matches one of the patterns on the command line.
+selected() {
+    [ -z "$patterns" ] && return 0
+    for pattern in $patterns; do
+        case $1 in
+            $pattern) return 0 ;;
+        esac
+    done
+    return 1
+}
+patterns="$*"
+
+# compare_file METRIC GOLDEN ACTUAL
+compare_file() {
+    case $1 in
+        exact) "$cmp" "$2" "$3" ;;
+        *) "$cmp" --metric "${1%%:*}" --tolerance "${1#*:}" "$2" "$3" ;;
+    esac
+}
+
+# run_case NAME[=REFERENCE] METRIC INPUT TOOL [ARGS...]
+#   METRIC applies to the files written by the converter, stdout and the
+#   exit status are always compared exactly. INPUT is copied into the
+#   scratch directory and passed by its base name in ARGS.
+run_case() {
+    name=${1%%=*} reference=${1#*=} metric=$2 input=$3 tool=$4
+    shift 4
+    selected "$name" || return 0
+    if [ ! -x "$BINDIR/$tool" ]; then
+        echo "SKIP $name ($tool not built)"
+        skipped=$((skipped + 1))
+        return 0
+    fi
+    dir=$work/$name
+    rm -rf "$dir"
+    mkdir -p "$dir"
+    cp "$input" "$dir/"
+    (cd "$dir" && "$BINDIR/$tool" "$@" >stdout 2>"$work/$name.stderr"; echo $? >status)
+    if [ $keep_stderr -eq 1 ]; then
+        cp "$work/$name.stderr" "$dir/stderr"
+    fi
+    rm -f "$dir/$(basename "$input")"
+
+    if [ $update -eq 1 ]; then
+        [ "$reference" != "$name" ] && return 0
+        rm -rf "${golden:?}/$name"
+        mkdir -p "$golden"
+        cp -R "$dir" "$golden/$name"
+        echo "UPDATE $name"
+        return 0
+    fi
+    if [ ! -d "$golden/$reference" ]; then
+        echo "FAIL $name (no golden output, record it with tests/golden.sh --update '$reference')"
+        failed=$((failed + 1))
+        return 0
+    fi
+
+    ok=1
+    if [ "$(cd "$golden/$reference" && ls)" != "$(cd "$dir" && ls)" ]; then
+        echo "$name: output files differ:"
+        (cd "$golden/$reference" && ls) >"$work/$name.golden-files"
+        (cd "$dir" && ls) | diff "$work/$name.golden-files" - | sed -n 's/^[<>]/  &/p'
+        ok=0
+    else
+        for file in $(cd "$dir" && ls); do
+            case $file in
+                stdout|stderr|status) file_metric=exact ;;
+                *) file_metric=$metric ;;
+            esac
+            compare_file "$file_metric" "$golden/$reference/$file" "$dir/$file" || ok=0
+        done
+    fi
+    if [ $ok -eq 1 ]; then
+        echo "PASS $name"
+        passed=$((passed + 1))
+    else
+        echo "FAIL $name"
+        failed=$((failed + 1))
+    fi
+}
+
+# run_error_case NAME INPUT TOOL [ARGS...]
+#   run_case for an input which has to be rejected: stderr is compared
+#   as well, byte for byte.
+run_error_case() {
+    name=$1 input=$2 tool=$3
+    shift 3
+    keep_stderr=1
+    run_case "$name" exact "$input" "$tool" "$@"
+    keep_stderr=0
+}
+
+park=$top/examples/park.husum_2016.png
+sprites=$corpus/sprites.png
+png_too_large=$corpus/png_too_large.png
+png_ihdr_bomb=$corpus/png_ihdr_bomb.png
+wave=$corpus/wave.pgm
+anim=$corpus/anim.c
+
+# ── graphconv ─────────────────────────────────────────────────────────────────
+run_case hires_default exact "$park" graphconv park.husum_2016.png
+run_case hires_afli exact "$park" graphconv --fli 1 park.husum_2016.png
+run_case hires_fli2 exact "$park" graphconv --fli 2 park.husum_2016.png
+run_case hires_optimise exact "$park" graphconv --optimise-pairs 0.05 park.husum_2016.png
+for dither in floyd-steinberg atkinson bayer4 bayer8 blue-noise; do
+    run_case "hires_dither_$dither" hires:0.5 "$park" graphconv --dither "$dither" park.husum_2016.png
+done
+run_case hires_refine_stucki hires:0.5 "$park" graphconv --stucki --refine 3 park.husum_2016.png
+# Every palette of palette_registry in c64palette.cc.
+for palette in $(grep -o '{ "[a-z0-9]*", &palette_' "$top/c64palette.cc" | cut -d'"' -f2); do
+    run_case "hires_stucki_$palette" hires:0.5 "$park" graphconv --stucki --palette "$palette" park.husum_2016.png
+done
+# The integer pipeline decides like the double one; the Grafx2 palette
+# has no exact ties, which the two break differently. Its error diffusion
+# rounds differently and takes another path.
+run_case hires_integer_default=hires_default exact "$park" graphconv --integer park.husum_2016.png
+run_case hires_integer_optimise=hires_optimise exact "$park" graphconv --integer --optimise-pairs 0.05 park.husum_2016.png
+for dither in bayer4 bayer8 blue-noise; do
+    run_case "hires_integer_$dither=hires_dither_$dither" hires:0.5 "$park" graphconv --integer --dither "$dither" park.husum_2016.png
+done
+for dither in stucki floyd-steinberg atkinson; do
+    run_case "hires_integer_$dither" hires:0.5 "$park" graphconv --integer --dither "$dither" park.husum_2016.png
+done
+# Against the double goldens, 4.1% (Stucki, Atkinson) to 6.9%
+# (Floyd-Steinberg) of the pixels of the integer diffusions differ, while
+# another diffusion, or none, differs in 18.5% or more; 10% accepts the
+# first and catches the second.
+run_case hires_integer_stucki_double=hires_stucki_grafx2 hires:10 "$park" graphconv --integer --dither stucki park.husum_2016.png
+for dither in floyd-steinberg atkinson; do
+    run_case "hires_integer_${dither}_double=hires_dither_$dither" hires:10 "$park" graphconv --integer --dither "$dither" park.husum_2016.png
+done
+
+# ── petscii80x50 ──────────────────────────────────────────────────────────────
+for threshold in 0.3 0.5 0.7; do
+    run_case "petscii80x50_t$threshold" exact "$wave" petscii80x50 --threshold "$threshold" wave.pgm
+done
+
+# ── spriteconv ────────────────────────────────────────────────────────────────
+run_case sprites_mono exact "$sprites" spriteconv -c 4 -r 2 mono sprites.png
+run_case sprites_multi exact "$sprites" spriteconv -c 4 -r 2 multi -1 1 -2 2 sprites.png
+run_case sprites_autocol exact "$sprites" spriteconv -c 4 -r 2 multi --autocol sprites.png
+run_case sprites_dedup_bank exact "$sprites" spriteconv -c 4 -r 2 --dedup --binary bank.bin --align mono sprites.png
+# Forged headers: the loader has to refuse them before it allocates the image.
+run_error_case sprites_png_too_large "$png_too_large" spriteconv mono png_too_large.png
+run_error_case sprites_png_ihdr_bomb "$png_ihdr_bomb" spriteconv mono png_ihdr_bomb.png
+
+# ── petsciiconvert ────────────────────────────────────────────────────────────
+run_case petsciiconvert_animation exact "$anim" petsciiconvert anim.c
+run_case petsciiconvert_pingpong exact "$anim" petsciiconvert --ping-pong anim.c
+run_case petsciiconvert_binout exact "$anim" petsciiconvert --output-bin=frames.bin --start-addr=16384 anim.c
+run_case petsciiconvert_binout_separate exact "$anim" petsciiconvert --output-bin=frames.bin --separate-frame anim.c
+run_case petsciiconvert_gencode exact "$anim" petsciiconvert --generate-code --generate-code-name=wave --generate-jumptable anim.c
+
+if [ $update -eq 1 ]; then
+    exit 0
+fi
+echo "$passed passed, $failed failed, $skipped skipped"
+[ $failed -eq 0 ]
@@ -0,0 +1,162 @@
+/**
+ * \file goldencmp.cc
+ * \brief Compare a converter output with its golden output.
+ *
+ * Used by tests/golden.sh. The comparison metric depends on the output:
+ * - exact    : the files must be identical (default)
+ * - bytes    : the files must have the same size, at most the given
+ *              percentage of the bytes may differ
+ * - hires    : both files are hires bitmaps as written by graphconv
+ *              (load address, 8000 bytes bitmap, 1000 bytes colours);
+ *              at most the given percentage of the 320×200 pixels may
+ *              have a different C64 colour
+ *
+ * The hires metric decodes the colour of every pixel, so the same image
+ * stored with swapped colour nibbles compares equal. It is meant for the
+ * dithering paths, where a parallel or SIMD implementation may round
+ * differently and move a few pixels without changing the image.
+ *
+ * Exit status: 0 if the files match, 1 if they differ, 2 on errors.
+ *
+ * Build dependencies: CLI11
+ * Requires: C++23 (-std=c++23)
+ */
+
+#include <CLI/CLI.hpp>
+#include <cstdint>
+#include <cstdlib>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// ── constants ─────────────────────────────────────────────────────────────────
+
+/// Size of a graphconv output: load address, bitmap and colours.
+inline constexpr std::size_t HIRES_SIZE = 2 + 8000 + 1000;
+/// Pixels of a hires bitmap.
+inline constexpr std::size_t HIRES_PIXELS = 320 * 200;
+
+// ── helpers ───────────────────────────────────────────────────────────────────
+
+/**
+ * \brief Read a whole file.
+ * \throw std::runtime_error if the file cannot be read
+ */
+std::vector<std::uint8_t> read_file(const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  if(!in) {
+    throw std::runtime_error(std::format("cannot read '{}'", path));
+  }
+  return std::vector<std::uint8_t>(std::istreambuf_iterator<char>(in), {});
+}
+
+/**
+ * \brief Colour index of every pixel of a graphconv hires bitmap.
+ *
+ * The bitmap is stored block by block, eight bytes per 8×8 block; a set
+ * bit takes the colour in the high nibble of the block's colour byte, a
+ * clear bit the one in the low nibble.
+ *
+ * \throw std::invalid_argument if \p data has not the size of a hires bitmap
+ */
+std::vector<std::uint8_t> hires_pixels(const std::vector<std::uint8_t> &data) {
+  if(data.size() != HIRES_SIZE) {
+    throw std::invalid_argument(std::format("{} bytes are not a hires bitmap ({} bytes)", data.size(), HIRES_SIZE));
+  }
+  const std::uint8_t *bitmap = data.data() + 2;
+  const std::uint8_t *colours = bitmap + 8000;
+  std::vector<std::uint8_t> ret(HIRES_PIXELS);
+  for(std::size_t block = 0; block < 1000; ++block) {
+    const std::size_t bx = block % 40;
+    const std::size_t by = block / 40;
+    for(std::size_t row = 0; row < 8; ++row) {
+      const std::uint8_t byte = bitmap[block * 8 + row];
+      for(std::size_t col = 0; col < 8; ++col) {
+        const bool set = (byte >> (7 - col)) & 1;
+        ret[(by * 8 + row) * 320 + bx * 8 + col] = set ? colours[block] >> 4 : colours[block] & 0x0F;
+      }
+    }
+  }
+  return ret;
+}
+
+/// Number of positions where \p a and \p b differ; both have the same size.
+std::size_t count_differences(const std::vector<std::uint8_t> &a, const std::vector<std::uint8_t> &b) {
+  std::size_t ret = 0;
+  for(std::size_t i = 0; i < a.size(); ++i) {
+    ret += a[i] != b[i];
+  }
+  return ret;
+}
+
+// ── entry point ───────────────────────────────────────────────────────────────
+
+/**
+ * \brief Program entry point.
+ *
+ * Reads both files, applies the metric and reports a mismatch on stdout.
+ */
+int main(int argc, char **argv) {
+  CLI::App app{
+    std::format("goldencmp V{} – compare a converter output with its golden output", SUITE_VERSION) };
+
+  std::string golden_file;
+  std::string actual_file;
+  std::string metric = "exact";
+  double tolerance = 0.0;
+
+  app.add_option("golden", golden_file, "Golden output")
+  ->required()
+  ->check(CLI::ExistingFile);
+  app.add_option("actual", actual_file, "Output to check")
+  ->required()
+  ->check(CLI::ExistingFile);
+  app.add_option("--metric,-m", metric, "Comparison metric: exact, bytes or hires (default exact)")
+  ->check(CLI::IsMember({ "exact", "bytes", "hires" }));
+  app.add_option("--tolerance,-t", tolerance,
+                 "Percentage of bytes (bytes) or pixels (hires) allowed to differ (default 0)")
+  ->check(CLI::Range(0.0, 100.0));
+
+  CLI11_PARSE(app, argc, argv);
+
+  try {
+    const std::vector<std::uint8_t> golden = read_file(golden_file);
+    const std::vector<std::uint8_t> actual = read_file(actual_file);
+
+    if(metric == "exact" || golden.size() != actual.size()) {
+      if(golden == actual) {
+        return EXIT_SUCCESS;
+      }
+      std::size_t first = 0;
+      while(first < golden.size() && first < actual.size() && golden[first] == actual[first]) {
+        ++first;
+      }
+      std::cout << std::format("{}: differs from golden output at byte {} ({} vs. {} bytes)\n",
+                               actual_file, first, actual.size(), golden.size());
+      return EXIT_FAILURE;
+    }
+
+    const bool hires = metric == "hires";
+    const std::vector<std::uint8_t> a = hires ? hires_pixels(golden) : golden;
+    const std::vector<std::uint8_t> b = hires ? hires_pixels(actual) : actual;
+    const std::size_t differences = count_differences(a, b);
+    const double percent = a.empty() ? 0.0 : 100.0 * differences / a.size();
+    if(percent > tolerance) {
+      std::cout << std::format("{}: {} of {} {} differ ({:.3f}%, tolerance {:.3f}%)\n", actual_file,
+                               differences, a.size(), hires ? "pixels" : "bytes", percent, tolerance);
+      return EXIT_FAILURE;
+    }
+    if(differences > 0) {
+      std::cout << std::format("{}: {} {} differ ({:.3f}%), within tolerance\n", actual_file, differences,
+                               hires ? "pixels" : "bytes", percent);
+    }
+  } catch(const std::exception &e) {
+    std::cerr << "goldencmp: " << e.what() << '\n';
+    return 2;
+  }
+  return EXIT_SUCCESS;
+}